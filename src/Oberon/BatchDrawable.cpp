@@ -0,0 +1,78 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "BatchDrawable.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/MeshView.h>
+
+#include "Oberon/PhongShader.h"
+
+namespace Oberon {
+
+BatchDrawable::BatchDrawable(SceneGraph::AbstractObject3D& object, const Resource<GL::Mesh>& mesh, Containers::Array<Member>&& members, SceneGraph::DrawableGroup3D& group): PhongDrawable{object, *members[0].drawable, mesh, group}, _members{std::move(members)} {
+    for(const Member& member: _members)
+        group.remove(*member.drawable);
+    updateRanges();
+}
+
+bool BatchDrawable::unbatch(const SceneGraph::AbstractObject3D& object) {
+    for(Member& member: _members) {
+        if(!member.drawable || &member.drawable->object() != &object) continue;
+
+        drawables()->add(*member.drawable);
+        member.drawable = nullptr;
+        updateRanges();
+        return true;
+    }
+
+    return false;
+}
+
+void BatchDrawable::updateRanges() {
+    arrayResize(_ranges, 0);
+    for(const Member& member: _members) {
+        if(!member.drawable) continue;
+
+        if(!_ranges.empty() && _ranges.back().first + _ranges.back().second == member.indexOffset)
+            _ranges.back().second += member.indexCount;
+        else arrayAppend(_ranges, Containers::InPlaceInit, member.indexOffset, member.indexCount);
+    }
+}
+
+void BatchDrawable::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
+    /* The fallback used until the mesh is uploaded has no indices */
+    if(_ranges.empty() || !_mesh->isIndexed()) return;
+
+    bind(transformationMatrix, camera);
+    for(const std::pair<UnsignedInt, UnsignedInt>& range: _ranges) {
+        GL::MeshView view{*_mesh};
+        view.setCount(range.second)
+            .setIndexRange(range.first);
+        _shader.draw(view);
+    }
+}
+
+}
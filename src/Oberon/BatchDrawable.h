@@ -0,0 +1,65 @@
+#ifndef Oberon_BatchDrawable_h
+#define Oberon_BatchDrawable_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <utility>
+#include <Corrade/Containers/Array.h>
+
+#include "Oberon/PhongDrawable.h"
+
+namespace Oberon {
+
+/* Draws a mesh with the pre-transformed vertices of static objects sharing
+   a material, with the material of the first member */
+class BatchDrawable: public PhongDrawable {
+    public:
+        struct Member {
+            PhongDrawable* drawable;
+            UnsignedInt indexOffset, indexCount;
+        };
+
+        /* The member drawables are removed from the group as the batch
+           draws them instead */
+        explicit BatchDrawable(SceneGraph::AbstractObject3D& object, const Resource<GL::Mesh>& mesh, Containers::Array<Member>&& members, SceneGraph::DrawableGroup3D& group);
+
+        /* Takes the object out of the batch and puts its own drawable back
+           to the group, so it can be edited. Returns false if it isn't in
+           the batch. */
+        bool unbatch(const SceneGraph::AbstractObject3D& object);
+
+    private:
+        void draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) override;
+
+        void updateRanges();
+
+        Containers::Array<Member> _members;
+        /* Index ranges of the members still in the batch as offset and
+           count, with adjacent ones merged */
+        Containers::Array<std::pair<UnsignedInt, UnsignedInt>> _ranges;
+};
+
+}
+
+#endif
@@ -0,0 +1,437 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "Bvh.h"
+
+#include <algorithm>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Oberon {
+
+namespace {
+
+/* Bins the centers are sorted into along the split axis */
+constexpr std::size_t BinCount = 12;
+
+Float surfaceArea(const Range3D& box) {
+    const Vector3 size = box.size();
+    return 2.0f*(size.x()*size.y() + size.y()*size.z() + size.z()*size.x());
+}
+
+enum class Containment {
+    Outside,
+    Intersects,
+    Inside
+};
+
+/* The planes point inside. A box is outside if it's fully behind any of
+   them and inside if it's fully in front of all. */
+Containment containment(const Frustum& frustum, const Range3D& box) {
+    const Vector3 center = box.center();
+    const Vector3 halfSize = box.size()*0.5f;
+    Containment out = Containment::Inside;
+    for(std::size_t i = 0; i != 6; ++i) {
+        const Vector4 plane = frustum[i];
+        const Float distance = Math::dot(plane.xyz(), center) + plane.w();
+        const Float radius = Math::dot(Math::abs(plane.xyz()), halfSize);
+        if(distance + radius < 0.0f) return Containment::Outside;
+        if(distance - radius < 0.0f) out = Containment::Intersects;
+    }
+    return out;
+}
+
+/* Distance along the ray where it enters the box, negative if it misses */
+Float rayDistance(const Vector3& origin, const Vector3& inverseDirection, const Float maxDistance, const Range3D& box) {
+    Float entry = 0.0f, exit = maxDistance;
+    for(std::size_t i = 0; i != 3; ++i) {
+        Float a = (box.min()[i] - origin[i])*inverseDirection[i];
+        Float b = (box.max()[i] - origin[i])*inverseDirection[i];
+        if(a > b) std::swap(a, b);
+        entry = Math::max(entry, a);
+        exit = Math::min(exit, b);
+        if(entry > exit) return -1.0f;
+    }
+    return entry;
+}
+
+}
+
+Range3D Bvh::padded(const Range3D& box) const {
+    return box.padded(box.size()*_padding);
+}
+
+Int Bvh::allocateNode() {
+    if(_freeNode == -1) {
+        arrayAppend(_nodes, Containers::InPlaceInit, Range3D{}, -1, -1, -1, 0u);
+        return _nodes.size() - 1;
+    }
+
+    const Int node = _freeNode;
+    _freeNode = _nodes[node].parent;
+    _nodes[node] = Node{Range3D{}, -1, -1, -1, 0};
+    return node;
+}
+
+void Bvh::freeNode(const Int node) {
+    _nodes[node].parent = _freeNode;
+    _freeNode = node;
+}
+
+void Bvh::build(Containers::ArrayView<const Range3D> boxes) {
+    _nodes = Containers::Array<Node>{};
+    _root = _freeNode = -1;
+    _leafNodes = Containers::Array<Int>{Containers::DirectInit, boxes.size(), -1};
+    _boxes = Containers::Array<Range3D>{Containers::NoInit, boxes.size()};
+    _leafCount = boxes.size();
+    if(boxes.empty()) return;
+
+    Containers::Array<UnsignedInt> ids{Containers::NoInit, boxes.size()};
+    Containers::Array<Vector3> centers{Containers::NoInit, boxes.size()};
+    for(std::size_t i = 0; i != boxes.size(); ++i) {
+        ids[i] = i;
+        centers[i] = boxes[i].center();
+        _boxes[i] = boxes[i];
+    }
+
+    arrayReserve(_nodes, 2*boxes.size() - 1);
+    _root = build(ids, centers, -1);
+}
+
+Int Bvh::build(Containers::ArrayView<UnsignedInt> ids, Containers::ArrayView<const Vector3> centers, const Int parent) {
+    const Int node = allocateNode();
+    _nodes[node].parent = parent;
+
+    if(ids.size() == 1) {
+        _nodes[node].box = padded(_boxes[ids[0]]);
+        _nodes[node].id = ids[0];
+        _leafNodes[ids[0]] = node;
+        return node;
+    }
+
+    /* Split along the longest axis of the centers */
+    Range3D centerBounds{centers[ids[0]], centers[ids[0]]};
+    for(const UnsignedInt id: ids)
+        centerBounds = Math::join(centerBounds, Range3D{centers[id], centers[id]});
+    const Vector3 extent = centerBounds.size();
+    const std::size_t axis = extent.x() >= extent.y() && extent.x() >= extent.z() ? 0 :
+        extent.y() >= extent.z() ? 1 : 2;
+
+    /* Sort the centers into bins and pick the bin boundary where the
+       children's surface areas weighted by their leaf counts are the
+       smallest */
+    std::size_t middle = ids.size()/2;
+    if(extent[axis] > 0.0f) {
+        const Float scale = BinCount/extent[axis];
+        auto bin = [&](const UnsignedInt id) {
+            return Math::min(std::size_t((centers[id][axis] - centerBounds.min()[axis])*scale), BinCount - 1);
+        };
+
+        Range3D binBoxes[BinCount];
+        std::size_t binCounts[BinCount]{};
+        for(const UnsignedInt id: ids) {
+            const std::size_t i = bin(id);
+            binBoxes[i] = binCounts[i] ? Math::join(binBoxes[i], _boxes[id]) : _boxes[id];
+            ++binCounts[i];
+        }
+
+        Float rightCosts[BinCount]{};
+        Range3D right;
+        std::size_t rightCount = 0;
+        for(std::size_t i = BinCount - 1; i != 0; --i) {
+            if(binCounts[i]) {
+                right = rightCount ? Math::join(right, binBoxes[i]) : binBoxes[i];
+                rightCount += binCounts[i];
+            }
+            rightCosts[i - 1] = rightCount ? rightCount*surfaceArea(right) : 0.0f;
+        }
+
+        Float bestCost = Constants::inf();
+        std::size_t bestSplit = BinCount;
+        Range3D left;
+        std::size_t leftCount = 0;
+        for(std::size_t i = 0; i != BinCount - 1; ++i) {
+            if(binCounts[i]) {
+                left = leftCount ? Math::join(left, binBoxes[i]) : binBoxes[i];
+                leftCount += binCounts[i];
+            }
+            if(!leftCount || leftCount == ids.size()) continue;
+
+            const Float cost = leftCount*surfaceArea(left) + rightCosts[i];
+            if(cost < bestCost) {
+                bestCost = cost;
+                bestSplit = i;
+            }
+        }
+
+        if(bestSplit != BinCount)
+            middle = std::partition(ids.begin(), ids.end(), [&](const UnsignedInt id) {
+                return bin(id) <= bestSplit;
+            }) - ids.begin();
+    }
+
+    /* The node array may get reallocated by the children, so no references
+       to it are kept */
+    const Int left = build(ids.prefix(middle), centers, node);
+    const Int right = build(ids.suffix(middle), centers, node);
+    _nodes[node].left = left;
+    _nodes[node].right = right;
+    _nodes[node].box = Math::join(_nodes[left].box, _nodes[right].box);
+    return node;
+}
+
+void Bvh::insert(const UnsignedInt id, const Range3D& box) {
+    CORRADE_INTERNAL_ASSERT(!contains(id));
+    while(_leafNodes.size() <= id) {
+        arrayAppend(_leafNodes, -1);
+        arrayAppend(_boxes, Range3D{});
+    }
+
+    const Int leaf = allocateNode();
+    _nodes[leaf].box = padded(box);
+    _nodes[leaf].id = id;
+    _leafNodes[id] = leaf;
+    _boxes[id] = box;
+    ++_leafCount;
+    insertLeaf(leaf);
+}
+
+void Bvh::remove(const UnsignedInt id) {
+    CORRADE_INTERNAL_ASSERT(contains(id));
+    const Int leaf = _leafNodes[id];
+    removeLeaf(leaf);
+    freeNode(leaf);
+    _leafNodes[id] = -1;
+    --_leafCount;
+}
+
+bool Bvh::update(const UnsignedInt id, const Range3D& box) {
+    const Int leaf = _leafNodes[id];
+    _boxes[id] = box;
+    if(_nodes[leaf].box.contains(box)) return false;
+
+    removeLeaf(leaf);
+    _nodes[leaf].box = padded(box);
+    insertLeaf(leaf);
+    return true;
+}
+
+void Bvh::relabel(const UnsignedInt from, const UnsignedInt to) {
+    CORRADE_INTERNAL_ASSERT(contains(from) && !contains(to));
+    while(_leafNodes.size() <= to) {
+        arrayAppend(_leafNodes, -1);
+        arrayAppend(_boxes, Range3D{});
+    }
+
+    const Int leaf = _leafNodes[from];
+    _nodes[leaf].id = to;
+    _leafNodes[to] = leaf;
+    _boxes[to] = _boxes[from];
+    _leafNodes[from] = -1;
+}
+
+void Bvh::insertLeaf(const Int leaf) {
+    if(_root == -1) {
+        _root = leaf;
+        _nodes[leaf].parent = -1;
+        return;
+    }
+
+    /* Go down to the child that grows the least by adding the box, until
+       making a new parent here is cheaper than going further */
+    const Range3D box = _nodes[leaf].box;
+    Int sibling = _root;
+    while(!isLeaf(sibling)) {
+        const Float area = surfaceArea(_nodes[sibling].box);
+        const Float combinedArea = surfaceArea(Math::join(_nodes[sibling].box, box));
+        const Float cost = 2.0f*combinedArea;
+        const Float inheritanceCost = 2.0f*(combinedArea - area);
+
+        Float childCosts[2];
+        const Int children[]{_nodes[sibling].left, _nodes[sibling].right};
+        for(std::size_t i = 0; i != 2; ++i) {
+            const Range3D& childBox = _nodes[children[i]].box;
+            childCosts[i] = surfaceArea(Math::join(childBox, box)) + inheritanceCost;
+            if(!isLeaf(children[i])) childCosts[i] -= surfaceArea(childBox);
+        }
+
+        if(cost < childCosts[0] && cost < childCosts[1]) break;
+        sibling = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+
+    const Int oldParent = _nodes[sibling].parent;
+    const Int parent = allocateNode();
+    _nodes[parent].parent = oldParent;
+    _nodes[parent].left = sibling;
+    _nodes[parent].right = leaf;
+    _nodes[parent].box = Math::join(_nodes[sibling].box, box);
+    _nodes[sibling].parent = parent;
+    _nodes[leaf].parent = parent;
+
+    if(oldParent == -1) _root = parent;
+    else if(_nodes[oldParent].left == sibling) _nodes[oldParent].left = parent;
+    else _nodes[oldParent].right = parent;
+
+    refit(oldParent);
+}
+
+void Bvh::removeLeaf(const Int leaf) {
+    if(leaf == _root) {
+        _root = -1;
+        return;
+    }
+
+    /* The sibling takes the place of the parent */
+    const Int parent = _nodes[leaf].parent;
+    const Int grandParent = _nodes[parent].parent;
+    const Int sibling = _nodes[parent].left == leaf ? _nodes[parent].right : _nodes[parent].left;
+    _nodes[sibling].parent = grandParent;
+    freeNode(parent);
+
+    if(grandParent == -1) {
+        _root = sibling;
+        return;
+    }
+
+    if(_nodes[grandParent].left == parent) _nodes[grandParent].left = sibling;
+    else _nodes[grandParent].right = sibling;
+    refit(grandParent);
+}
+
+void Bvh::refit(Int node) {
+    for(; node != -1; node = _nodes[node].parent)
+        _nodes[node].box = Math::join(_nodes[_nodes[node].left].box, _nodes[_nodes[node].right].box);
+}
+
+void Bvh::leaves(const Int node, Containers::Array<UnsignedInt>& out) const {
+    Containers::Array<Int> stack;
+    arrayAppend(stack, node);
+    while(!stack.empty()) {
+        const Int current = stack.back();
+        arrayResize(stack, stack.size() - 1);
+        if(isLeaf(current)) arrayAppend(out, _nodes[current].id);
+        else {
+            arrayAppend(stack, _nodes[current].left);
+            arrayAppend(stack, _nodes[current].right);
+        }
+    }
+}
+
+void Bvh::frustum(const Frustum& frustum, Containers::Array<UnsignedInt>& out) const {
+    if(_root == -1) return;
+
+    Containers::Array<Int> stack;
+    arrayAppend(stack, _root);
+    while(!stack.empty()) {
+        const Int node = stack.back();
+        arrayResize(stack, stack.size() - 1);
+
+        const Containment nodeContainment = containment(frustum, _nodes[node].box);
+        if(nodeContainment == Containment::Outside) continue;
+        if(nodeContainment == Containment::Inside) {
+            leaves(node, out);
+        } else if(isLeaf(node)) {
+            if(containment(frustum, _boxes[_nodes[node].id]) != Containment::Outside)
+                arrayAppend(out, _nodes[node].id);
+        } else {
+            arrayAppend(stack, _nodes[node].left);
+            arrayAppend(stack, _nodes[node].right);
+        }
+    }
+}
+
+void Bvh::box(const Range3D& box, Containers::Array<UnsignedInt>& out) const {
+    if(_root == -1) return;
+
+    Containers::Array<Int> stack;
+    arrayAppend(stack, _root);
+    while(!stack.empty()) {
+        const Int node = stack.back();
+        arrayResize(stack, stack.size() - 1);
+
+        if(!Math::intersects(_nodes[node].box, box)) continue;
+        if(box.contains(_nodes[node].box)) {
+            leaves(node, out);
+        } else if(isLeaf(node)) {
+            if(Math::intersects(_boxes[_nodes[node].id], box))
+                arrayAppend(out, _nodes[node].id);
+        } else {
+            arrayAppend(stack, _nodes[node].left);
+            arrayAppend(stack, _nodes[node].right);
+        }
+    }
+}
+
+void Bvh::sphere(const Vector3& center, const Float radius, Containers::Array<UnsignedInt>& out) const {
+    if(_root == -1) return;
+
+    auto intersects = [&](const Range3D& box) {
+        return (Math::clamp(center, box.min(), box.max()) - center).dot() <= radius*radius;
+    };
+
+    Containers::Array<Int> stack;
+    arrayAppend(stack, _root);
+    while(!stack.empty()) {
+        const Int node = stack.back();
+        arrayResize(stack, stack.size() - 1);
+
+        if(!intersects(_nodes[node].box)) continue;
+        if(isLeaf(node)) {
+            if(intersects(_boxes[_nodes[node].id]))
+                arrayAppend(out, _nodes[node].id);
+        } else {
+            arrayAppend(stack, _nodes[node].left);
+            arrayAppend(stack, _nodes[node].right);
+        }
+    }
+}
+
+Containers::Array<std::pair<Float, UnsignedInt>> Bvh::ray(const Vector3& origin, const Vector3& direction, const Float maxDistance) const {
+    Containers::Array<std::pair<Float, UnsignedInt>> out;
+    if(_root == -1) return out;
+
+    const Vector3 inverseDirection = 1.0f/direction;
+    Containers::Array<Int> stack;
+    arrayAppend(stack, _root);
+    while(!stack.empty()) {
+        const Int node = stack.back();
+        arrayResize(stack, stack.size() - 1);
+
+        if(rayDistance(origin, inverseDirection, maxDistance, _nodes[node].box) < 0.0f)
+            continue;
+        if(isLeaf(node)) {
+            const Float distance = rayDistance(origin, inverseDirection, maxDistance, _boxes[_nodes[node].id]);
+            if(distance >= 0.0f)
+                arrayAppend(out, Containers::InPlaceInit, distance, _nodes[node].id);
+        } else {
+            arrayAppend(stack, _nodes[node].left);
+            arrayAppend(stack, _nodes[node].right);
+        }
+    }
+
+    std::sort(out.begin(), out.end());
+    return out;
+}
+
+}
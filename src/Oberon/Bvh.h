@@ -0,0 +1,113 @@
+#ifndef Oberon_Bvh_h
+#define Oberon_Bvh_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <utility>
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Range.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+/* Dynamic bounding volume hierarchy over axis-aligned boxes, with one box
+   per leaf identified by a small integer ID. It's built with the surface
+   area heuristic, boxes added later are inserted where they enlarge the
+   tree the least. The leaves are padded so that boxes moving a little
+   don't change the tree, otherwise they're removed and inserted again. */
+class Bvh {
+    public:
+        /* Fraction of the box size the leaves are padded by on each side */
+        explicit Bvh(Float padding = 0.1f): _padding{padding} {}
+
+        /* Replaces the hierarchy with one over given boxes, the IDs being
+           their indices */
+        void build(Containers::ArrayView<const Range3D> boxes);
+
+        std::size_t size() const { return _leafCount; }
+        bool contains(UnsignedInt id) const {
+            return id < _leafNodes.size() && _leafNodes[id] != -1;
+        }
+
+        /* The ID must not be used yet */
+        void insert(UnsignedInt id, const Range3D& box);
+        void remove(UnsignedInt id);
+
+        /* Returns true if the tree had to change, false if the box still
+           fits in the padded leaf */
+        bool update(UnsignedInt id, const Range3D& box);
+
+        /* Gives the leaf a new ID, which must not be used yet */
+        void relabel(UnsignedInt from, UnsignedInt to);
+
+        const Range3D& box(UnsignedInt id) const { return _boxes[id]; }
+
+        /* Queries append IDs of the leaves whose boxes are at least partially
+           inside the volume. Whole subtrees inside it are appended without
+           testing the leaves. */
+        void frustum(const Frustum& frustum, Containers::Array<UnsignedInt>& out) const;
+        void box(const Range3D& box, Containers::Array<UnsignedInt>& out) const;
+        void sphere(const Vector3& center, Float radius, Containers::Array<UnsignedInt>& out) const;
+
+        /* Leaves whose boxes the ray hits, as distance along the direction
+           and ID, nearest first */
+        Containers::Array<std::pair<Float, UnsignedInt>> ray(const Vector3& origin, const Vector3& direction, Float maxDistance = Constants::inf()) const;
+
+    private:
+        struct Node {
+            /* Padded for leaves */
+            Range3D box;
+            /* Next free node if the node is unused */
+            Int parent;
+            /* Both -1 for leaves */
+            Int left, right;
+            UnsignedInt id;
+        };
+
+        bool isLeaf(Int node) const { return _nodes[node].left == -1; }
+
+        Range3D padded(const Range3D& box) const;
+        Int allocateNode();
+        void freeNode(Int node);
+        Int build(Containers::ArrayView<UnsignedInt> ids, Containers::ArrayView<const Vector3> centers, Int parent);
+        void insertLeaf(Int leaf);
+        void removeLeaf(Int leaf);
+        void refit(Int node);
+        void leaves(Int node, Containers::Array<UnsignedInt>& out) const;
+
+        Float _padding;
+        Containers::Array<Node> _nodes;
+        Int _root{-1}, _freeNode{-1};
+        /* Leaf node and exact box of each ID, -1 for unused IDs */
+        Containers::Array<Int> _leafNodes;
+        Containers::Array<Range3D> _boxes;
+        std::size_t _leafCount{};
+};
+
+}
+
+#endif
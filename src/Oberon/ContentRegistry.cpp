@@ -0,0 +1,85 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ContentRegistry.h"
+
+#include <Corrade/Utility/FormatStl.h>
+
+namespace Oberon {
+
+bool ContentRegistry::add(const std::string& name, const char* const prefix, const Hash& hash, const std::size_t size, UnsignedInt& count, UnsignedInt& uniqueCount, std::size_t& bytesSaved) {
+    /* Contents whose first hashes collide are distinct if their second
+       hashes or sizes differ, they get a suffixed key then */
+    std::string key = Utility::formatString("{}:{:.16x}", prefix, hash.key);
+    bool present = false;
+    for(UnsignedInt i = 1; ; ++i) {
+        auto found = _contents.find(key);
+        if(found == _contents.end()) break;
+        if(found->second.check == hash.check && found->second.size == size) {
+            present = true;
+            break;
+        }
+        key = Utility::formatString("{}:{:.16x}~{}", prefix, hash.key, i);
+    }
+
+    /* Name already registered, nothing to do if it's still the same
+       content */
+    auto found = _keys.find(name);
+    if(found != _keys.end()) {
+        if(found->second == key) return false;
+        found->second = key;
+    } else {
+        _keys.emplace(name, key);
+        ++count;
+    }
+
+    /* The content is already there, just reference it */
+    if(present) {
+        bytesSaved += size;
+        return false;
+    }
+
+    _contents.emplace(key, Content{hash.check, size});
+    ++uniqueCount;
+    return true;
+}
+
+bool ContentRegistry::addMesh(const std::string& name, const Hash& hash, const std::size_t size) {
+    return add(name, "mesh", hash, size,
+        _statistics.meshCount, _statistics.uniqueMeshCount,
+        _statistics.meshBytesSaved);
+}
+
+bool ContentRegistry::addTexture(const std::string& name, const Hash& hash, const std::size_t size) {
+    return add(name, "texture", hash, size,
+        _statistics.textureCount, _statistics.uniqueTextureCount,
+        _statistics.textureBytesSaved);
+}
+
+const std::string& ContentRegistry::key(const std::string& name) const {
+    auto found = _keys.find(name);
+    return found == _keys.end() ? name : found->second;
+}
+
+}
@@ -0,0 +1,83 @@
+#ifndef Oberon_ContentRegistry_h
+#define Oberon_ContentRegistry_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <unordered_map>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+/* Maps resource names to keys derived from the resource content, so
+   identical meshes and textures are stored in the resource manager only
+   once no matter how many names refer to them. It lives in the scene data,
+   so content is shared only within one scene and not with scenes loaded
+   from other files. */
+class ContentRegistry {
+    public:
+        /* Two hashes of the content with different seeds. The first one
+           makes the key, contents whose first hashes collide are told apart
+           by the second one and their sizes. */
+        struct Hash {
+            UnsignedLong key, check;
+        };
+
+        struct Statistics {
+            /* Count of registered names and of distinct contents */
+            UnsignedInt meshCount, uniqueMeshCount;
+            UnsignedInt textureCount, uniqueTextureCount;
+
+            /* Size of the data that didn't need to be uploaded */
+            std::size_t meshBytesSaved, textureBytesSaved;
+        };
+
+        /* Registers a name for given content. Returns false if the content
+           is already present and doesn't need to be uploaded again. */
+        bool addMesh(const std::string& name, const Hash& hash, std::size_t size);
+        bool addTexture(const std::string& name, const Hash& hash, std::size_t size);
+
+        /* Resource manager key for given name, the name itself if it's not
+           registered */
+        const std::string& key(const std::string& name) const;
+
+        Statistics statistics() const { return _statistics; }
+
+    private:
+        struct Content {
+            UnsignedLong check;
+            std::size_t size;
+        };
+
+        bool add(const std::string& name, const char* prefix, const Hash& hash, std::size_t size, UnsignedInt& count, UnsignedInt& uniqueCount, std::size_t& bytesSaved);
+
+        std::unordered_map<std::string, std::string> _keys;
+        std::unordered_map<std::string, Content> _contents;
+        Statistics _statistics{};
+};
+
+}
+
+#endif
@@ -30,6 +30,8 @@ class EditorWindow;
 
 class Im3dContext;
 
+class MemoryReport;
+
 class Outline;
 
 class ProjectTree;
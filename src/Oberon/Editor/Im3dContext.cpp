@@ -32,38 +32,42 @@
 #include <Magnum/SceneGraph/TranslationRotationScalingTransformation3D.h>
 #include <Magnum/SceneGraph/Camera.h>
 
+#include "Oberon/ShaderCache.h"
 #include "Oberon/Editor/Im3dIntegration.h"
 #include "OberonExternal/im3d/im3d_math.h"
 
 namespace Oberon { namespace Editor {
 
-Im3dShader::Im3dShader(Type type) {
+Im3dShader::Im3dShader(Type type, ShaderCache* cache) {
     Utility::Resource rs("OberonEditor");
 
-    GL::Shader vert(GL::Version::GL320, GL::Shader::Type::Vertex);
-    GL::Shader frag(GL::Version::GL320, GL::Shader::Type::Fragment);
-
+    std::string define;
     switch(type) {
         case Type::Points:
-            vert.addSource("#define POINTS\n");
-            frag.addSource("#define POINTS\n");
+            define = "#define POINTS\n";
             break;
         case Type::Lines:
-            vert.addSource("#define LINES\n");
-            frag.addSource("#define LINES\n");
+            define = "#define LINES\n";
             break;
         case Type::Triangles:
-            vert.addSource("#define TRIANGLES\n");
-            frag.addSource("#define TRIANGLES\n");
+            define = "#define TRIANGLES\n";
             break;
     }
 
-    vert.addSource(rs.get("Im3d.vert"));
-    frag.addSource(rs.get("Im3d.frag"));
+    const std::string vertSource = define + rs.get("Im3d.vert");
+    const std::string fragSource = define + rs.get("Im3d.frag");
+    const std::string geomSource = type == Type::Lines ? rs.get("Im3d.geom") : std::string{};
+    const std::string sources = vertSource + geomSource + fragSource;
+    if(cache && cache->load(*this, sources)) return;
+
+    GL::Shader vert(GL::Version::GL320, GL::Shader::Type::Vertex);
+    GL::Shader frag(GL::Version::GL320, GL::Shader::Type::Fragment);
+    vert.addSource(vertSource);
+    frag.addSource(fragSource);
 
     if(type == Type::Lines) {
         GL::Shader geom(GL::Version::GL320, GL::Shader::Type::Geometry);
-        geom.addSource(rs.get("Im3d.geom"));
+        geom.addSource(geomSource);
 
         CORRADE_INTERNAL_ASSERT_OUTPUT(GL::Shader::compile({vert, geom, frag}));
         attachShaders({vert, geom, frag});
@@ -72,7 +76,9 @@ Im3dShader::Im3dShader(Type type) {
         attachShaders({vert, frag});
     }
 
+    if(cache) cache->prepare(*this);
     CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+    if(cache) cache->save(*this, sources);
 }
 
 Im3dShader& Im3dShader::setTransformationProjectionMatrix(const Matrix4& matrix) {
@@ -85,7 +91,7 @@ Im3dShader& Im3dShader::setViewport(const Vector2& size) {
     return *this;
 }
 
-Im3dContext::Im3dContext() {
+Im3dContext::Im3dContext(ShaderCache* shaderCache): _trianglesShader{Im3dShader::Type::Triangles, shaderCache}, _linesShader{Im3dShader::Type::Lines, shaderCache}, _pointsShader{Im3dShader::Type::Points, shaderCache} {
     _mesh.addVertexBuffer(_vertexBuffer, 0,
         Im3dShader::PositionSize{},
         Im3dShader::Color{
@@ -43,7 +43,8 @@ class Im3dShader: public GL::AbstractShaderProgram {
             Points
         };
 
-        explicit Im3dShader(Type type);
+        /* If the cache is null, the program is always compiled from source */
+        explicit Im3dShader(Type type, ShaderCache* cache = nullptr);
 
         Im3dShader& setTransformationProjectionMatrix(const Matrix4& matrix);
         Im3dShader& setViewport(const Vector2& size);
@@ -55,7 +56,7 @@ class Im3dShader: public GL::AbstractShaderProgram {
 
 class Im3dContext {
     public:
-        Im3dContext();
+        explicit Im3dContext(ShaderCache* shaderCache = nullptr);
 
         void newFrame();
         void drawFrame();
@@ -75,9 +76,9 @@ class Im3dContext {
         Im3dContext& setViewportSize(const Vector2i& size);
 
     private:
-        Im3dShader _trianglesShader{Im3dShader::Type::Triangles};
-        Im3dShader _linesShader{Im3dShader::Type::Lines};
-        Im3dShader _pointsShader{Im3dShader::Type::Points};
+        Im3dShader _trianglesShader;
+        Im3dShader _linesShader;
+        Im3dShader _pointsShader;
         GL::Buffer _vertexBuffer{GL::Buffer::TargetHint::Array};
         Timeline _timeline;
         GL::Mesh _mesh;
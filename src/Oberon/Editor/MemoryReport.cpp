@@ -0,0 +1,157 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "MemoryReport.h"
+
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Utility/FormatStl.h>
+
+#include "Oberon/MemoryAccounting.h"
+#include "Oberon/Editor/Viewport.h"
+
+namespace Oberon { namespace Editor {
+
+namespace {
+
+std::string formatSize(const UnsignedLong size) {
+    if(size >= 1024*1024)
+        return Utility::formatString("{:.1f} MB", size/(1024.0*1024.0));
+    if(size >= 1024)
+        return Utility::formatString("{:.1f} kB", size/1024.0);
+    return Utility::formatString("{} B", size);
+}
+
+}
+
+MemoryReport::MemoryReport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>&, Viewport* viewport):
+    Gtk::TreeView(cobject), _viewport(viewport)
+{
+    _listStore = Gtk::ListStore::create(_columns);
+    set_model(_listStore);
+
+    append_column("Type", _columns.type);
+    append_column("Name", _columns.name);
+    append_column("Details", _columns.details);
+    get_column(0)->set_sort_column(_columns.type);
+    get_column(1)->set_sort_column(_columns.name);
+    get_column(2)->set_sort_column(_columns.details);
+
+    appendSizeColumn("Size", _columns.size);
+    appendSizeColumn("Resident", _columns.residentSize);
+
+    /* Largest first until the user picks something else */
+    _listStore->set_sort_column(_columns.size, Gtk::SORT_DESCENDING);
+
+    signal_map().connect(sigc::mem_fun(*this, &MemoryReport::update));
+}
+
+void MemoryReport::update() {
+    _listStore->clear();
+
+    Containers::Optional<MemoryAccounting::Report> report = _viewport->memoryReport();
+    if(!report) return;
+
+    for(const MemoryAccounting::Texture& texture: report->textures) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Texture";
+        row[_columns.name] = Utility::formatString("Texture {}", texture.id);
+        row[_columns.details] = Utility::formatString("{}x{}, {} levels, {}",
+            texture.size.x(), texture.size.y(), texture.levelCount, texture.format);
+        row[_columns.size] = texture.byteSize;
+        row[_columns.residentSize] = texture.residentSize;
+    }
+
+    for(const MemoryAccounting::Mesh& mesh: report->meshes) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Mesh";
+        row[_columns.name] = Utility::formatString("Mesh {}", mesh.id);
+        std::string details = Utility::formatString("{} vertices ({}), {} indices ({})",
+            mesh.vertexCount, formatSize(mesh.vertexSize),
+            mesh.indexCount, formatSize(mesh.indexSize));
+        if(mesh.optimization.acmrBefore)
+            details += Utility::formatString(", ACMR {:.2f} -> {:.2f}",
+                mesh.optimization.acmrBefore, mesh.optimization.acmrAfter);
+        row[_columns.details] = details;
+        row[_columns.size] = mesh.vertexSize + mesh.indexSize;
+        row[_columns.residentSize] = mesh.residentSize;
+    }
+
+    /* Shaders are never evicted */
+    for(const MemoryAccounting::Shader& shader: report->shaders) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Shader";
+        row[_columns.name] = "Phong";
+        row[_columns.details] = Utility::formatString("flags 0x{:.3x}, {} lights",
+            UnsignedInt(UnsignedShort(shader.flags)), shader.lightCount);
+        row[_columns.size] = shader.byteSize;
+        row[_columns.residentSize] = shader.byteSize;
+    }
+
+    for(const MemoryAccounting::Object& object: report->objects) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Object";
+        row[_columns.name] = object.name;
+        row[_columns.details] = Utility::formatString("mesh {}, textures {}",
+            formatSize(object.meshSize), formatSize(object.textureSize));
+        row[_columns.size] = object.meshSize + object.textureSize;
+        row[_columns.residentSize] = object.residentSize;
+    }
+
+    /* What sharing identical content saved, none of it is resident */
+    const ContentRegistry::Statistics& sharing = report->sharing;
+    if(sharing.meshBytesSaved) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Shared";
+        row[_columns.name] = "Meshes";
+        row[_columns.details] = Utility::formatString("{} duplicates of {} meshes",
+            sharing.meshCount - sharing.uniqueMeshCount, sharing.uniqueMeshCount);
+        row[_columns.size] = sharing.meshBytesSaved;
+        row[_columns.residentSize] = 0;
+    }
+    if(sharing.textureBytesSaved) {
+        Gtk::TreeModel::Row row = *(_listStore->append());
+        row[_columns.type] = "Shared";
+        row[_columns.name] = "Textures";
+        row[_columns.details] = Utility::formatString("{} duplicates of {} textures",
+            sharing.textureCount - sharing.uniqueTextureCount, sharing.uniqueTextureCount);
+        row[_columns.size] = sharing.textureBytesSaved;
+        row[_columns.residentSize] = 0;
+    }
+}
+
+void MemoryReport::appendSizeColumn(const Glib::ustring& title, const Gtk::TreeModelColumn<UnsignedLong>& column) {
+    Gtk::TreeViewColumn* viewColumn = Gtk::manage(new Gtk::TreeViewColumn{title});
+    Gtk::CellRendererText* renderer = Gtk::manage(new Gtk::CellRendererText);
+    renderer->property_xalign() = 1.0f;
+    viewColumn->pack_start(*renderer);
+    viewColumn->set_cell_data_func(*renderer, sigc::bind(sigc::mem_fun(*this, &MemoryReport::onSizeCellData), &column));
+    viewColumn->set_sort_column(column);
+    append_column(*viewColumn);
+}
+
+void MemoryReport::onSizeCellData(Gtk::CellRenderer* renderer, const Gtk::TreeModel::iterator& iter, const Gtk::TreeModelColumn<UnsignedLong>* column) {
+    static_cast<Gtk::CellRendererText*>(renderer)->property_text() = formatSize(iter->get_value(*column));
+}
+
+}}
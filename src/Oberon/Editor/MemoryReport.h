@@ -0,0 +1,68 @@
+#ifndef Oberon_Editor_MemoryReport_h
+#define Oberon_Editor_MemoryReport_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <gtkmm/builder.h>
+#include <gtkmm/liststore.h>
+#include <gtkmm/treeview.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/Editor/Editor.h"
+
+namespace Oberon { namespace Editor {
+
+/* Lists the memory used by the textures, meshes, shaders and objects of the
+   loaded scene. It's refreshed every time it's shown and can be sorted by
+   any column. */
+class MemoryReport: public Gtk::TreeView {
+    public:
+        explicit MemoryReport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>& builder, Viewport* viewport);
+
+        void update();
+
+    private:
+        void appendSizeColumn(const Glib::ustring& title, const Gtk::TreeModelColumn<UnsignedLong>& column);
+        void onSizeCellData(Gtk::CellRenderer* renderer, const Gtk::TreeModel::iterator& iter, const Gtk::TreeModelColumn<UnsignedLong>* column);
+
+    private:
+        struct ModelColumns: public Gtk::TreeModel::ColumnRecord {
+            explicit ModelColumns() { add(type); add(name); add(details); add(size); add(residentSize); }
+
+            Gtk::TreeModelColumn<std::string> type;
+            Gtk::TreeModelColumn<std::string> name;
+            Gtk::TreeModelColumn<std::string> details;
+            Gtk::TreeModelColumn<UnsignedLong> size;
+            Gtk::TreeModelColumn<UnsignedLong> residentSize;
+        };
+
+        ModelColumns _columns;
+        Glib::RefPtr<Gtk::ListStore> _listStore;
+
+        Viewport* _viewport;
+};
+
+}}
+
+#endif
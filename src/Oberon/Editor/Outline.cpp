@@ -24,6 +24,8 @@
 
 #include "Outline.h"
 
+#include "Oberon/Hlod.h"
+#include "Oberon/StaticBatch.h"
 #include "Oberon/SceneData.h"
 #include "Oberon/Editor/Properties.h"
 
@@ -81,6 +83,26 @@ void Outline::onRowActivated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColu
     _selectedObjects.push_back(objectId);
 }
 
+void Outline::selectObject(UnsignedInt objectId) {
+    _treeStore->foreach_iter([&](const Gtk::TreeModel::iterator& iter) {
+        if(iter->get_value(_columns.objectId) != objectId) return false;
+
+        get_selection()->select(iter);
+        scroll_to_row(_treeStore->get_path(iter));
+        return true;
+    });
+
+    _properties->showObjectProperties(_sceneData->objects[objectId]);
+    _selectedObjects.clear();
+    _selectedObjects.push_back(objectId);
+}
+
+void Outline::clearSelection() {
+    get_selection()->unselect_all();
+    _properties->hide();
+    _selectedObjects.clear();
+}
+
 void Outline::onButtonPressEvent(GdkEventButton* buttonEvent) {
     if(buttonEvent->type == GDK_BUTTON_PRESS && buttonEvent->button == GDK_BUTTON_SECONDARY)
         _menuPopup->popup_at_pointer(reinterpret_cast<GdkEvent*>(buttonEvent));
@@ -100,7 +122,10 @@ void Outline::onDeleteItemActivate() {
                 _sceneData->objects[parentObjectId].children.end(), objectId);
             _sceneData->objects[parentObjectId].children.erase(childIdIter);
 
-            /* Delete object from the scene */
+            /* Delete object from the scene together with the proxies that
+               draw it, the batches would draw it too */
+            Hlod::dissolve(*_sceneData, objectId);
+            StaticBatch::unbatch(*_sceneData, objectId);
             /* TODO: also delete the objectInfo from the sceneData when
                corrade will have arbitrary deletion of the Arrays. */
             delete _sceneData->objects[objectId].object;
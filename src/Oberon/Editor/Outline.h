@@ -41,6 +41,12 @@ class Outline: public Gtk::TreeView {
 
         std::vector<UnsignedInt>& selectedObjects() { return _selectedObjects; }
 
+        /* Selects the object row and shows the object properties */
+        void selectObject(UnsignedInt objectId);
+
+        /* Deselects the object row and hides the object properties */
+        void clearSelection();
+
     private:
         void onRowActivated(const Gtk::TreeModel::Path& path, Gtk::TreeViewColumn*);
         void onButtonPressEvent(GdkEventButton* buttonEvent);
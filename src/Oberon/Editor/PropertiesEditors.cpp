@@ -24,6 +24,9 @@
 
 #include "PropertiesEditors.h"
 
+#include "Oberon/BatchDrawable.h"
+#include "Oberon/GpuScene.h"
+#include "Oberon/InstancedDrawable.h"
 #include "Oberon/PhongDrawable.h"
 #include "Oberon/SceneData.h"
 
@@ -68,10 +71,13 @@ TransformationEditor::TransformationEditor(BaseObjectType* cobject, const Glib::
 
 void TransformationEditor::showEditor(const ObjectInfo& objectInfo) {
     _object = objectInfo.object;
+    _batch = objectInfo.batch;
     updateEditor();
 }
 
 void TransformationEditor::updateEditor() {
+    _updating = true;
+
     Vector3 translation = _object->translation();
     _translationX->set_value(double(translation.x()));
     _translationY->set_value(double(translation.y()));
@@ -86,15 +92,28 @@ void TransformationEditor::updateEditor() {
     _scalingX->set_value(double(scaling.x()));
     _scalingY->set_value(double(scaling.y()));
     _scalingZ->set_value(double(scaling.z()));
+
+    _updating = false;
+}
+
+void TransformationEditor::unbatch() {
+    if(_batch) _batch->unbatch(*_object);
+    _batch = nullptr;
 }
 
 void TransformationEditor::onTranslationChanged() {
+    if(_updating) return;
+
+    unbatch();
     _object->setTranslation({Float(_translationX->get_value()),
         Float(_translationY->get_value()),
         Float(_translationZ->get_value())});
 }
 
 void TransformationEditor::onRotationChanged() {
+    if(_updating) return;
+
+    unbatch();
     Math::Vector3<Rad> euler{Rad(Deg(_rotationX->get_value())),
         Rad(Deg(_rotationY->get_value())),
         Rad(Deg(_rotationZ->get_value()))};
@@ -105,6 +124,9 @@ void TransformationEditor::onRotationChanged() {
 }
 
 void TransformationEditor::onScalingChanged() {
+    if(_updating) return;
+
+    unbatch();
     _object->setScaling({Float(_scalingX->get_value()),
         Float(_scalingY->get_value()),
         Float(_scalingZ->get_value())});
@@ -121,6 +143,9 @@ void PhongDrawableEditor::showEditor(const ObjectInfo& objectInfo) {
     SceneGraph::AbstractFeature3D* feature = objectInfo.features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
     if(feature) {
         _phongDrawable = reinterpret_cast<PhongDrawable*>(feature);
+        _batch = objectInfo.batch;
+        _gpuScene = objectInfo.gpuScene;
+        _instances = objectInfo.instances;
         updateEditor();
         show();
     } else {
@@ -136,6 +161,16 @@ void PhongDrawableEditor::updateEditor() {
 }
 
 void PhongDrawableEditor::onColorChanged() {
+    /* The batch draws the object with its own copy of the material */
+    if(_batch) _batch->unbatch(_phongDrawable->object());
+    _batch = nullptr;
+    /* Same for the GPU-driven path, which has the material in a buffer */
+    if(_gpuScene) _gpuScene->release(_phongDrawable->object());
+    _gpuScene = nullptr;
+    /* And for the instances, which draw it with the color of another */
+    if(_instances) _instances->release(_phongDrawable->object());
+    _instances = nullptr;
+
     Gdk::RGBA gdkColor = _colorButton->get_rgba();
     _phongDrawable->setColor({Float(gdkColor.get_red()), Float(gdkColor.get_green()), Float(gdkColor.get_blue()), Float(gdkColor.get_alpha())});
 }
@@ -41,6 +41,7 @@ class TransformationEditor: public Gtk::Expander {
         void updateEditor();
 
     private:
+        void unbatch();
         void onTranslationChanged();
         void onRotationChanged();
         void onScalingChanged();
@@ -59,6 +60,11 @@ class TransformationEditor: public Gtk::Expander {
         Gtk::SpinButton* _scalingZ;
 
         Object3D* _object;
+        /* The object is taken out of its batch once it's changed */
+        BatchDrawable* _batch;
+        /* Set while the spin buttons are updated from the object, so their
+           signals don't change it back */
+        bool _updating{};
 };
 
 class PhongDrawableEditor: public Gtk::Expander {
@@ -75,6 +81,9 @@ class PhongDrawableEditor: public Gtk::Expander {
         Gtk::ColorButton* _colorButton;
 
         PhongDrawable* _phongDrawable;
+        BatchDrawable* _batch;
+        GpuScene* _gpuScene;
+        InstancedDrawable* _instances;
 };
 
 }}
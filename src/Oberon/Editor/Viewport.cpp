@@ -24,10 +24,14 @@
 
 #include "Viewport.h"
 
+#include <gtkmm/button.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/FormatStl.h>
 #include <Magnum/GL/Framebuffer.h>
 #include <Magnum/Platform/GLContext.h>
 #include <Magnum/SceneGraph/Camera.h>
 
+#include "Oberon/SceneCache.h"
 #include "Oberon/SceneView.h"
 #include "Oberon/Editor/Im3dIntegration.h"
 #include "Oberon/Editor/Outline.h"
@@ -35,7 +39,7 @@
 
 namespace Oberon { namespace Editor {
 
-Viewport::Viewport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>&, Outline& outline, Properties& properties, Platform::GLContext& context):
+Viewport::Viewport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>& builder, Outline& outline, Properties& properties, Platform::GLContext& context):
     Gtk::GLArea(cobject), _outline(outline), _properties(properties), _context(context), _isDragging{false}
 {
     /* Set size requests and scaling behavior */
@@ -61,12 +65,87 @@ Viewport::Viewport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>&, O
     signal_button_press_event().connect(sigc::mem_fun(this, &Viewport::onButtonPressEvent));
     signal_button_release_event().connect(sigc::mem_fun(this, &Viewport::onButtonReleaseEvent));
     signal_key_press_event().connect(sigc::mem_fun(this, &Viewport::onKeyPressEvent));
+
+    builder->get_widget("compress_textures_button", _compressTexturesButton);
+
+    /* Loading progress widgets */
+    builder->get_widget("loading_box", _loadingBox);
+    builder->get_widget("loading_label", _loadingLabel);
+    builder->get_widget("loading_progress_bar", _loadingProgressBar);
+
+    Gtk::Button* loadingCancelButton;
+    builder->get_widget("loading_cancel_button", loadingCancelButton);
+    loadingCancelButton->signal_clicked().connect(sigc::mem_fun(this, &Viewport::onLoadingCancel));
 }
 
 void Viewport::loadScene(const std::string& path) {
-    /* Make sure the OpenGL context is current then load the scene */
+    /* Make sure the OpenGL context is current then start loading the scene
+       in the background. The current scene is rendered until the new one
+       is complete. */
+    make_current();
+    SceneImporter::Configuration configuration;
+    configuration.async = true;
+    configuration.optimizeMeshes = true;
+    configuration.compactVertexFormats = true;
+    configuration.lodCount = 3;
+    configuration.hlodGridSize = 16;
+    configuration.batchTriangleLimit = 512;
+    configuration.instancingThreshold = 4;
+    /* Encoding is slow enough to make the first load of large scenes take
+       a lot longer, so it's opt-in. Without a cache it'd be paid on every
+       load. */
+    configuration.cacheDirectory = SceneCache::defaultDirectory();
+    configuration.compressTextures = _compressTexturesButton->get_active() && !configuration.cacheDirectory.empty();
+    configuration.shaderCache = _shaderCache.get();
+    configuration.gpuMemoryBudget = std::size_t{1024}*1024*1024;
+    configuration.uploadBudget = 64*1024*1024;
+    configuration.uploadTimeBudget = 8.0f;
+    _loadingSceneView = Containers::pointer<SceneView>(path, _viewportSize, configuration);
+
+    _loadingBox->show();
+    _loadingLabel->set_text("Loading");
+    _loadingProgressBar->set_fraction(0.0);
+
+    /* Force queue redraw, the loading continues in onRender() */
+    queue_render();
+}
+
+Containers::Optional<MemoryAccounting::Report> Viewport::memoryReport() {
+    if(!_sceneView) return {};
+
+    /* The shader sizes are queried from GL */
     make_current();
-    _sceneView = Containers::pointer<SceneView>(path, _viewportSize);
+    return _sceneView->memoryReport();
+}
+
+void Viewport::continueLoading() {
+    /* Show the progress of the first stage that isn't done yet */
+    const SceneImporter::Progress progress = _loadingSceneView->loadingProgress();
+    const std::pair<const char*, SceneImporter::Progress::Stage> stages[]{
+        {"materials", progress.materials},
+        {"textures", progress.textures},
+        {"meshes", progress.meshes},
+        {"objects", progress.objects}
+    };
+    UnsignedInt loaded = 0, count = 0;
+    bool labelSet = false;
+    for(const std::pair<const char*, SceneImporter::Progress::Stage>& stage: stages) {
+        if(!labelSet && stage.second.loaded < stage.second.count) {
+            _loadingLabel->set_text(Utility::formatString("Loading {} ({}/{})",
+                stage.first, stage.second.loaded, stage.second.count));
+            labelSet = true;
+        }
+
+        loaded += stage.second.loaded;
+        count += stage.second.count;
+    }
+    _loadingProgressBar->set_fraction(count ? double(loaded)/count : 0.0);
+
+    if(!_loadingSceneView->continueLoading()) return;
+
+    /* The new scene is complete, replace the current one with it */
+    _sceneView = std::move(_loadingSceneView);
+    _loadingBox->hide();
 
     _outline.updateWithSceneData(_sceneView->data());
 
@@ -74,9 +153,14 @@ void Viewport::loadScene(const std::string& path) {
         .setCameraObject(_sceneView->data().cameraObject)
         .setCamera(_sceneView->data().camera)
         .setViewportSize(_viewportSize);
+}
 
-    /* Force queue redraw */
-    queue_render();
+void Viewport::onLoadingCancel() {
+    /* The partially loaded scene has GL resources, so the context needs to
+       be current when destroying it */
+    make_current();
+    _loadingSceneView = nullptr;
+    _loadingBox->hide();
 }
 
 void Viewport::onRealize() {
@@ -84,7 +168,9 @@ void Viewport::onRealize() {
     make_current();
     _context.create();
 
-    _im3d = Containers::pointer<Im3dContext>();
+    _shaderCache = Containers::pointer<ShaderCache>(
+        Utility::Directory::join(SceneCache::defaultDirectory(), "shaders"));
+    _im3d = Containers::pointer<Im3dContext>(_shaderCache.get());
 }
 
 bool Viewport::onRender(const Glib::RefPtr<Gdk::GLContext>&) {
@@ -101,6 +187,13 @@ bool Viewport::onRender(const Glib::RefPtr<Gdk::GLContext>&) {
     /* Clear the frame */
     gtkmmDefaultFramebuffer.clear(GL::FramebufferClear::Color|GL::FramebufferClear::Depth);
 
+    /* Upload what was loaded in the background so far and force queue
+       redraw until the scene is complete */
+    if(_loadingSceneView) {
+        continueLoading();
+        queue_render();
+    }
+
     /* Draw the scene if there is one loaded */
     if(_sceneView) {
         _sceneView->draw();
@@ -139,6 +232,9 @@ void Viewport::onResize(int width, int height) {
         _sceneView->updateViewport(_viewportSize);
         _im3d->setViewportSize(_viewportSize);
     }
+
+    if(_loadingSceneView)
+        _loadingSceneView->updateViewport(_viewportSize);
 }
 
 bool Viewport::onMotionNotifyEvent(GdkEventMotion* motionEvent) {
@@ -171,6 +267,10 @@ bool Viewport::onButtonPressEvent(GdkEventButton* buttonEvent) {
 
             Im3d::AppData& ad = Im3d::GetAppData();
             ad.m_keyDown[Im3d::Mouse_Left] = true;
+
+            /* Clicking outside of the gizmo selects another object */
+            if(_outline.selectedObjects().empty() || Im3d::GetHotId() == Im3d::Id_Invalid)
+                pickObject({Float(buttonEvent->x), Float(buttonEvent->y)});
         } else if(buttonEvent->button == GDK_BUTTON_SECONDARY) {
             /* Grab focus so that key events work */
             grab_focus();
@@ -196,6 +296,31 @@ bool Viewport::onButtonReleaseEvent(GdkEventButton* releaseEvent) {
     return true;
 }
 
+void Viewport::pickObject(const Vector2& position) {
+    SceneData& data = _sceneView->data();
+
+    /* Unproject the cursor on the near and far plane */
+    Vector2 cursor = position/Vector2{_viewportSize}*2.0f - Vector2{1.0f};
+    cursor.y() = -cursor.y();
+    const Matrix4 unprojection = (data.camera->projectionMatrix()*data.camera->cameraMatrix()).inverted();
+    const Vector3 nearPoint = unprojection.transformPoint({cursor, -1.0f});
+    const Vector3 farPoint = unprojection.transformPoint({cursor, 1.0f});
+
+    /* Batches, proxies and instances don't belong to any object, their
+       members are hit instead */
+    data.culling.updateBounds();
+    for(const std::pair<Float, UnsignedInt>& hit: data.culling.bvh().ray(nearPoint, (farPoint - nearPoint).normalized())) {
+        const Int objectId = data.culling.objectId(hit.second);
+        if(objectId == -1) continue;
+
+        _outline.selectObject(objectId);
+        return;
+    }
+
+    /* Clicking into empty space deselects */
+    _outline.clearSelection();
+}
+
 bool Viewport::onKeyPressEvent(GdkEventKey* keyEvent) {
     if(_sceneView) {
         if(_isDragging) {
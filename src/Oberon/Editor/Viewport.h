@@ -24,12 +24,19 @@
     SOFTWARE.
 */
 
+#include <gtkmm/box.h>
 #include <gtkmm/builder.h>
+#include <gtkmm/checkbutton.h>
 #include <gtkmm/glarea.h>
+#include <gtkmm/label.h>
+#include <gtkmm/progressbar.h>
+#include <Corrade/Containers/Optional.h>
 #include <Corrade/Containers/Pointer.h>
 #include <Magnum/Math/Vector2.h>
 #include <Magnum/Platform/Platform.h>
 
+#include "Oberon/MemoryAccounting.h"
+#include "Oberon/ShaderCache.h"
 #include "Oberon/Editor/Editor.h"
 #include "Oberon/Editor/Im3dContext.h"
 
@@ -37,11 +44,17 @@ namespace Oberon { namespace Editor {
 
 class Viewport: public Gtk::GLArea {
     public:
-        explicit Viewport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>&, Outline& outline, Properties& properties, Platform::GLContext& context);
+        explicit Viewport(BaseObjectType* cobject, const Glib::RefPtr<Gtk::Builder>& builder, Outline& outline, Properties& properties, Platform::GLContext& context);
 
         void loadScene(const std::string& path);
 
+        /* Report of the loaded scene, empty if there's none */
+        Containers::Optional<MemoryAccounting::Report> memoryReport();
+
     private:
+        void continueLoading();
+        void onLoadingCancel();
+
         void onRealize();
         bool onRender(const Glib::RefPtr<Gdk::GLContext>&);
         void onResize(int width, int height);
@@ -52,14 +65,28 @@ class Viewport: public Gtk::GLArea {
 
         bool onKeyPressEvent(GdkEventKey* keyEvent);
 
+        /* Selects the nearest object whose bounding box is under the
+           cursor, deselects if there's none */
+        void pickObject(const Vector2& position);
+
         Outline& _outline;
         Properties& _properties;
         Platform::GLContext& _context;
 
+        /* Declared before the scenes so it outlives their loading */
+        Containers::Pointer<ShaderCache> _shaderCache;
         Containers::Pointer<Im3dContext> _im3d;
 
         Vector2i _viewportSize;
         Containers::Pointer<SceneView> _sceneView;
+        Containers::Pointer<SceneView> _loadingSceneView;
+
+        /* Applies to the next loaded scene */
+        Gtk::CheckButton* _compressTexturesButton;
+
+        Gtk::Box* _loadingBox;
+        Gtk::Label* _loadingLabel;
+        Gtk::ProgressBar* _loadingProgressBar;
 
         bool _isDragging;
         Vector2 _previousMousePosition;
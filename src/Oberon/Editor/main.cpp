@@ -26,6 +26,7 @@
 #include <Magnum/Platform/GLContext.h>
 
 #include "Oberon/Editor/EditorWindow.h"
+#include "Oberon/Editor/MemoryReport.h"
 #include "Oberon/Editor/Outline.h"
 #include "Oberon/Editor/ProjectTree.h"
 #include "Oberon/Editor/Properties.h"
@@ -52,6 +53,9 @@ int main(int argc, char** argv) {
     Oberon::Editor::Viewport* viewport;
     builder->get_widget_derived("Viewport", viewport, *outline, *properties, context);
 
+    Oberon::Editor::MemoryReport* memoryReport;
+    builder->get_widget_derived("MemoryReport", memoryReport, viewport);
+
     Oberon::Editor::ProjectTree* projectTree;
     builder->get_widget_derived("ProjectTree", projectTree, viewport);
 
@@ -0,0 +1,269 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "FrustumCulling.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Intersection.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Drawable.h>
+
+#if defined(__AVX__)
+#include <immintrin.h>
+#elif defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace Oberon {
+
+namespace {
+
+/* Below this the linear SIMD pass is faster than traversing the
+   hierarchy */
+constexpr std::size_t BvhCullingThreshold = 16384;
+
+template<class T> void removeSwap(Containers::Array<T>& array, std::size_t i) {
+    array[i] = array[array.size() - 1];
+    arrayResize(array, array.size() - 1);
+}
+
+}
+
+/* Attached to the object of the drawable, gets the new absolute
+   transformation whenever the object is cleaned after it moved */
+class FrustumCulling::Bounds: public SceneGraph::AbstractFeature3D {
+    public:
+        explicit Bounds(SceneGraph::AbstractObject3D& object, FrustumCulling& culling, UnsignedInt id): SceneGraph::AbstractFeature3D{object}, id{id}, _culling(culling) {
+            setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+            /* A dirty object doesn't notify the features again until it's
+               cleaned, so it has to be cleaned in the next updateBounds() */
+            if(object.isDirty()) markDirty();
+        }
+
+        ~Bounds() { _culling.remove(id); }
+
+        UnsignedInt id;
+        bool dirty{};
+
+    private:
+        void markDirty() override {
+            if(dirty) return;
+            dirty = true;
+            arrayAppend(_culling._dirty, this);
+        }
+
+        void clean(const Matrix4& absoluteTransformationMatrix) override {
+            _culling.update(id, absoluteTransformationMatrix);
+        }
+
+        FrustumCulling& _culling;
+};
+
+Range3D FrustumCulling::transform(const Range3D& box, const Matrix4& transformation) {
+    const Vector3 halfSize = box.size()*0.5f;
+    return Range3D::fromCenter(transformation.transformPoint(box.center()),
+        Math::abs(transformation[0].xyz())*halfSize.x() +
+        Math::abs(transformation[1].xyz())*halfSize.y() +
+        Math::abs(transformation[2].xyz())*halfSize.z());
+}
+
+void FrustumCulling::add(SceneGraph::Drawable3D& drawable, const Range3D& box, const OcclusionCulling::Occluder* const occluder, const Int objectId) {
+    const UnsignedInt id = _drawables.size();
+    arrayAppend(_drawables, &drawable);
+    arrayAppend(_occluders, occluder);
+    arrayAppend(_objectIds, objectId);
+    arrayAppend(_boxes, box);
+    arrayAppend(_absoluteTransformations, Matrix4{});
+    arrayAppend(_centerX, 0.0f);
+    arrayAppend(_centerY, 0.0f);
+    arrayAppend(_centerZ, 0.0f);
+    arrayAppend(_halfSizeX, 0.0f);
+    arrayAppend(_halfSizeY, 0.0f);
+    arrayAppend(_halfSizeZ, 0.0f);
+    /* Drawn until the first cull() */
+    arrayAppend(_visible, true);
+    arrayAppend(_bounds, new Bounds{drawable.object(), *this, id});
+
+    const Matrix4 absoluteTransformation = drawable.object().absoluteTransformationMatrix();
+    if(_bvhBuilt) _bvh.insert(id, transform(box, absoluteTransformation));
+    update(id, absoluteTransformation);
+}
+
+void FrustumCulling::buildBvh() {
+    Containers::Array<Range3D> boxes{Containers::NoInit, _drawables.size()};
+    for(std::size_t i = 0; i != boxes.size(); ++i) boxes[i] = box(i);
+    _bvh.build(boxes);
+    _bvhBuilt = true;
+}
+
+void FrustumCulling::update(const UnsignedInt id, const Matrix4& absoluteTransformation) {
+    _absoluteTransformations[id] = absoluteTransformation;
+    const Range3D box = transform(_boxes[id], absoluteTransformation);
+    const Vector3 center = box.center();
+    const Vector3 halfSize = box.size()*0.5f;
+    _centerX[id] = center.x();
+    _centerY[id] = center.y();
+    _centerZ[id] = center.z();
+    _halfSizeX[id] = halfSize.x();
+    _halfSizeY[id] = halfSize.y();
+    _halfSizeZ[id] = halfSize.z();
+    if(_bvhBuilt) _bvh.update(id, box);
+}
+
+void FrustumCulling::remove(const UnsignedInt id) {
+    Bounds* const bounds = _bounds[id];
+    if(bounds->dirty) for(std::size_t i = 0; i != _dirty.size(); ++i) {
+        if(_dirty[i] != bounds) continue;
+        removeSwap(_dirty, i);
+        break;
+    }
+
+    if(_bvhBuilt) {
+        _bvh.remove(id);
+        if(id != _bounds.size() - 1) _bvh.relabel(_bounds.size() - 1, id);
+    }
+
+    removeSwap(_bounds, id);
+    removeSwap(_drawables, id);
+    removeSwap(_occluders, id);
+    removeSwap(_objectIds, id);
+    removeSwap(_boxes, id);
+    removeSwap(_absoluteTransformations, id);
+    removeSwap(_centerX, id);
+    removeSwap(_centerY, id);
+    removeSwap(_centerZ, id);
+    removeSwap(_halfSizeX, id);
+    removeSwap(_halfSizeY, id);
+    removeSwap(_halfSizeZ, id);
+    removeSwap(_visible, id);
+    if(id != _bounds.size()) _bounds[id]->id = id;
+}
+
+void FrustumCulling::updateBounds() {
+    /* Cleaning the objects that moved updates their boxes */
+    for(Bounds* bounds: _dirty) {
+        bounds->dirty = false;
+        bounds->object().setClean();
+    }
+    arrayResize(_dirty, 0);
+}
+
+void FrustumCulling::cull(SceneGraph::Camera3D& camera) {
+    updateBounds();
+
+    /* The planes point inside, a box is outside if it's fully behind any
+       of them. The half-size projected on the plane normal is added to the
+       center distance, so only the corner closest to the inside counts. */
+    const Frustum frustum = Frustum::fromMatrix(camera.projectionMatrix()*camera.cameraMatrix());
+    const std::size_t count = _drawables.size();
+    std::size_t i = 0;
+
+    /* Whole subtrees outside or inside of the frustum are decided with a
+       single test */
+    if(_bvhBuilt && count >= BvhCullingThreshold) {
+        arrayResize(_bvhVisible, 0);
+        _bvh.frustum(frustum, _bvhVisible);
+        for(bool& visible: _visible) visible = false;
+        for(const UnsignedInt id: _bvhVisible) _visible[id] = true;
+        i = count;
+    }
+
+    #if defined(__AVX__)
+    for(; i + 8 <= count; i += 8) {
+        const __m256 centerX = _mm256_loadu_ps(_centerX.data() + i);
+        const __m256 centerY = _mm256_loadu_ps(_centerY.data() + i);
+        const __m256 centerZ = _mm256_loadu_ps(_centerZ.data() + i);
+        const __m256 halfSizeX = _mm256_loadu_ps(_halfSizeX.data() + i);
+        const __m256 halfSizeY = _mm256_loadu_ps(_halfSizeY.data() + i);
+        const __m256 halfSizeZ = _mm256_loadu_ps(_halfSizeZ.data() + i);
+        __m256 outside = _mm256_setzero_ps();
+        for(std::size_t j = 0; j != 6; ++j) {
+            const Vector4 plane = frustum[j];
+            const Vector3 absNormal = Math::abs(plane.xyz());
+            __m256 distance = _mm256_set1_ps(plane.w());
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerX, _mm256_set1_ps(plane.x())));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerY, _mm256_set1_ps(plane.y())));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(centerZ, _mm256_set1_ps(plane.z())));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeX, _mm256_set1_ps(absNormal.x())));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeY, _mm256_set1_ps(absNormal.y())));
+            distance = _mm256_add_ps(distance, _mm256_mul_ps(halfSizeZ, _mm256_set1_ps(absNormal.z())));
+            outside = _mm256_or_ps(outside, _mm256_cmp_ps(distance, _mm256_setzero_ps(), _CMP_LT_OQ));
+        }
+        const Int mask = _mm256_movemask_ps(outside);
+        for(std::size_t k = 0; k != 8; ++k)
+            _visible[i + k] = !(mask & (1 << k));
+    }
+    #elif defined(__SSE__)
+    for(; i + 4 <= count; i += 4) {
+        const __m128 centerX = _mm_loadu_ps(_centerX.data() + i);
+        const __m128 centerY = _mm_loadu_ps(_centerY.data() + i);
+        const __m128 centerZ = _mm_loadu_ps(_centerZ.data() + i);
+        const __m128 halfSizeX = _mm_loadu_ps(_halfSizeX.data() + i);
+        const __m128 halfSizeY = _mm_loadu_ps(_halfSizeY.data() + i);
+        const __m128 halfSizeZ = _mm_loadu_ps(_halfSizeZ.data() + i);
+        __m128 outside = _mm_setzero_ps();
+        for(std::size_t j = 0; j != 6; ++j) {
+            const Vector4 plane = frustum[j];
+            const Vector3 absNormal = Math::abs(plane.xyz());
+            __m128 distance = _mm_set1_ps(plane.w());
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerX, _mm_set1_ps(plane.x())));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerY, _mm_set1_ps(plane.y())));
+            distance = _mm_add_ps(distance, _mm_mul_ps(centerZ, _mm_set1_ps(plane.z())));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeX, _mm_set1_ps(absNormal.x())));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeY, _mm_set1_ps(absNormal.y())));
+            distance = _mm_add_ps(distance, _mm_mul_ps(halfSizeZ, _mm_set1_ps(absNormal.z())));
+            outside = _mm_or_ps(outside, _mm_cmplt_ps(distance, _mm_setzero_ps()));
+        }
+        const Int mask = _mm_movemask_ps(outside);
+        for(std::size_t k = 0; k != 4; ++k)
+            _visible[i + k] = !(mask & (1 << k));
+    }
+    #endif
+
+    /* The rest, or everything without SIMD */
+    for(; i != count; ++i)
+        _visible[i] = Math::Intersection::aabbFrustum(
+            Vector3{_centerX[i], _centerY[i], _centerZ[i]},
+            Vector3{_halfSizeX[i], _halfSizeY[i], _halfSizeZ[i]}, frustum);
+
+    _culledCount = 0;
+    for(std::size_t j = 0; j != count; ++j)
+        if(!_visible[j] && _drawables[j]->drawables()) ++_culledCount;
+}
+
+std::vector<std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>> FrustumCulling::visibleDrawables(SceneGraph::Camera3D& camera, SceneGraph::DrawableGroup3D& group) const {
+    const Matrix4 cameraMatrix = camera.cameraMatrix();
+    std::vector<std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>> out;
+    out.reserve(group.size());
+    for(std::size_t i = 0; i != _drawables.size(); ++i)
+        if(_visible[i] && _drawables[i]->drawables() == &group)
+            out.emplace_back(*_drawables[i], cameraMatrix*_absoluteTransformations[i]);
+    return out;
+}
+
+}
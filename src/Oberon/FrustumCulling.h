@@ -0,0 +1,146 @@
+#ifndef Oberon_FrustumCulling_h
+#define Oberon_FrustumCulling_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <functional>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+
+#include "Oberon/Bvh.h"
+#include "Oberon/Oberon.h"
+#include "Oberon/OcclusionCulling.h"
+
+namespace Oberon {
+
+/* Keeps world-space bounding boxes of the drawables as a structure of
+   arrays and tests them against the camera frustum four or eight at a time
+   with SSE or AVX, so drawables outside of it are not drawn at all. The
+   boxes follow the transformations of their objects. Once built, a
+   bounding volume hierarchy over the boxes culls large scenes instead and
+   answers spatial queries, with the drawable indices as IDs. */
+class FrustumCulling {
+    public:
+        /* Starts culling the drawable, with given bounding box in the space
+           of its object. It's culled until the object is destroyed. With
+           an occluder it can hide other drawables in the occlusion
+           culling. The object ID is what picking selects for the
+           drawable. */
+        void add(SceneGraph::Drawable3D& drawable, const Range3D& box, const OcclusionCulling::Occluder* occluder = nullptr, Int objectId = -1);
+
+        std::size_t size() const { return _drawables.size(); }
+
+        SceneGraph::Drawable3D& drawable(UnsignedInt id) const {
+            return *_drawables[id];
+        }
+
+        /* ID of the object in the scene data, -1 for drawables such as
+           batches that don't belong to a single object */
+        Int objectId(UnsignedInt id) const { return _objectIds[id]; }
+
+        /* Null if the drawable isn't an occluder */
+        const OcclusionCulling::Occluder* occluder(UnsignedInt id) const {
+            return _occluders[id];
+        }
+
+        const Matrix4& absoluteTransformation(UnsignedInt id) const {
+            return _absoluteTransformations[id];
+        }
+
+        /* World-space bounding box */
+        Range3D box(UnsignedInt id) const {
+            return Range3D::fromCenter(
+                {_centerX[id], _centerY[id], _centerZ[id]},
+                {_halfSizeX[id], _halfSizeY[id], _halfSizeZ[id]});
+        }
+
+        /* Whether the drawable passed the last cull() */
+        bool isVisible(UnsignedInt id) const { return _visible[id]; }
+
+        /* Leaves the drawable out of visibleDrawables() until the next
+           cull(), for culling stages after this one */
+        void hide(UnsignedInt id) { _visible[id] = false; }
+
+        /* Builds the hierarchy over the drawables added so far, the ones
+           added later are inserted into it */
+        void buildBvh();
+
+        /* Empty until buildBvh() is called. The boxes are as of the last
+           updateBounds(). */
+        const Bvh& bvh() const { return _bvh; }
+
+        /* Brings the boxes of objects that moved up to date, called by
+           cull() */
+        void updateBounds();
+
+        /* Tests all boxes against the frustum of the camera. To be called
+           once per frame before visibleDrawables(). */
+        void cull(SceneGraph::Camera3D& camera);
+
+        /* Drawables of the group inside the frustum in the last cull() with
+           their camera-relative transformations, to be passed to
+           SceneGraph::Camera3D::draw(). Drawables that weren't added are
+           not included. */
+        std::vector<std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>> visibleDrawables(SceneGraph::Camera3D& camera, SceneGraph::DrawableGroup3D& group) const;
+
+        /* Count of drawables in any group that were outside of the frustum
+           in the last cull() */
+        UnsignedInt culledCount() const { return _culledCount; }
+
+        /* Bounding box of the transformed box */
+        static Range3D transform(const Range3D& box, const Matrix4& transformation);
+
+    private:
+        class Bounds;
+
+        void update(UnsignedInt id, const Matrix4& absoluteTransformation);
+        void remove(UnsignedInt id);
+
+        Containers::Array<Bounds*> _bounds;
+        Containers::Array<SceneGraph::Drawable3D*> _drawables;
+        Containers::Array<const OcclusionCulling::Occluder*> _occluders;
+        Containers::Array<Int> _objectIds;
+        /* In the space of the object */
+        Containers::Array<Range3D> _boxes;
+        Containers::Array<Matrix4> _absoluteTransformations;
+        /* World-space boxes as center and half-size */
+        Containers::Array<Float> _centerX, _centerY, _centerZ,
+            _halfSizeX, _halfSizeY, _halfSizeZ;
+        Containers::Array<bool> _visible;
+        /* Bounds of objects that moved since the last updateBounds() */
+        Containers::Array<Bounds*> _dirty;
+        UnsignedInt _culledCount{};
+
+        Bvh _bvh;
+        bool _bvhBuilt{};
+        Containers::Array<UnsignedInt> _bvhVisible;
+};
+
+}
+
+#endif
@@ -0,0 +1,518 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "GlbFile.h"
+
+#include <cctype>
+#include <cstdlib>
+#include <cstring>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/String.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/VertexFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Trade/MeshData.h>
+
+namespace Oberon {
+
+namespace Implementation {
+
+struct GlbAccessor {
+    /* Offset into the binary chunk, -1 if it has no data there */
+    Long offset;
+    /* Zero if tightly packed */
+    UnsignedInt stride;
+    UnsignedInt count;
+    VertexFormat format;
+    bool valid;
+};
+
+struct GlbMesh {
+    MeshPrimitive primitive;
+    Int indices;
+    Containers::Array<std::pair<Trade::MeshAttribute, UnsignedInt>> attributes;
+};
+
+}
+
+namespace {
+
+constexpr UnsignedInt Magic = 0x46546c67;
+constexpr UnsignedInt JsonChunk = 0x4e4f534a;
+constexpr UnsignedInt BinaryChunk = 0x004e4942;
+
+/* The JSON is split into tokens first, with each value followed by its
+   children, like in jsmn. Only what's needed for the meshes is then read
+   from them, without building any tree. */
+struct Token {
+    enum class Type: UnsignedByte {
+        Object,
+        Array,
+        String,
+        Primitive
+    };
+
+    Type type;
+    /* Children count, object keys and values counted separately */
+    UnsignedInt size;
+    std::size_t begin, end;
+    /* Token after this one and all its children */
+    UnsignedInt next;
+};
+
+class JsonTokenizer {
+    public:
+        explicit JsonTokenizer(Containers::ArrayView<const char> json): _json{json} {}
+
+        bool tokenize(Containers::Array<Token>& tokens) {
+            skipWhitespace();
+            return value(tokens) && (skipWhitespace(), _position == _json.size());
+        }
+
+    private:
+        void skipWhitespace() {
+            while(_position < _json.size() && std::strchr(" \t\r\n", _json[_position]) && _json[_position])
+                ++_position;
+        }
+
+        bool value(Containers::Array<Token>& tokens) {
+            if(_position == _json.size()) return false;
+
+            const UnsignedInt index = tokens.size();
+            arrayAppend(tokens, Token{Token::Type::Primitive, 0, _position, 0, 0});
+
+            const char c = _json[_position];
+            if(c == '{' || c == '[') {
+                const char close = c == '{' ? '}' : ']';
+                tokens[index].type = c == '{' ? Token::Type::Object : Token::Type::Array;
+                ++_position;
+                skipWhitespace();
+                if(_position < _json.size() && _json[_position] == close) {
+                    ++_position;
+                } else for(;;) {
+                    if(c == '{') {
+                        if(_position == _json.size() || _json[_position] != '"' || !value(tokens)) return false;
+                        skipWhitespace();
+                        if(_position == _json.size() || _json[_position] != ':') return false;
+                        ++_position;
+                        skipWhitespace();
+                        ++tokens[index].size;
+                    }
+                    if(!value(tokens)) return false;
+                    ++tokens[index].size;
+                    skipWhitespace();
+
+                    if(_position == _json.size()) return false;
+                    if(_json[_position] == close) {
+                        ++_position;
+                        break;
+                    }
+                    if(_json[_position] != ',') return false;
+                    ++_position;
+                    skipWhitespace();
+                }
+
+            /* Strings are kept escaped, none of the compared keys have
+               escapes */
+            } else if(c == '"') {
+                tokens[index].type = Token::Type::String;
+                tokens[index].begin = ++_position;
+                while(_position < _json.size() && _json[_position] != '"')
+                    _position += _json[_position] == '\\' ? 2 : 1;
+                if(_position >= _json.size()) return false;
+                tokens[index].end = _position++;
+                tokens[index].next = tokens.size();
+                return true;
+
+            } else {
+                while(_position < _json.size() && !std::strchr(",}] \t\r\n", _json[_position]))
+                    ++_position;
+                if(tokens[index].begin == _position) return false;
+            }
+
+            tokens[index].end = _position;
+            tokens[index].next = tokens.size();
+            return true;
+        }
+
+        Containers::ArrayView<const char> _json;
+        std::size_t _position{};
+};
+
+class Json {
+    public:
+        explicit Json(Containers::ArrayView<const char> json, Containers::ArrayView<const Token> tokens): _json{json}, _tokens{tokens} {}
+
+        /* Value of given key, -1 if the token is not an object or doesn't
+           have the key */
+        Int find(const Int object, const char* key) const {
+            if(object == -1 || _tokens[object].type != Token::Type::Object) return -1;
+            const std::size_t keySize = std::strlen(key);
+            for(UnsignedInt i = object + 1, j = 0; j != _tokens[object].size; j += 2) {
+                const Token& token = _tokens[i];
+                if(token.end - token.begin == keySize && std::memcmp(_json + token.begin, key, keySize) == 0)
+                    return i + 1;
+                i = _tokens[i + 1].next;
+            }
+            return -1;
+        }
+
+        /* Elements of an array, empty if the token is not an array */
+        Containers::Array<UnsignedInt> elements(const Int array) const {
+            Containers::Array<UnsignedInt> out;
+            if(array == -1 || _tokens[array].type != Token::Type::Array) return out;
+            for(UnsignedInt i = array + 1, j = 0; j != _tokens[array].size; ++j) {
+                arrayAppend(out, i);
+                i = _tokens[i].next;
+            }
+            return out;
+        }
+
+        /* Members of an object as key and value pairs */
+        Containers::Array<std::pair<UnsignedInt, UnsignedInt>> members(const Int object) const {
+            Containers::Array<std::pair<UnsignedInt, UnsignedInt>> out;
+            if(object == -1 || _tokens[object].type != Token::Type::Object) return out;
+            for(UnsignedInt i = object + 1, j = 0; j != _tokens[object].size; j += 2) {
+                arrayAppend(out, Containers::InPlaceInit, i, i + 1);
+                i = _tokens[i + 1].next;
+            }
+            return out;
+        }
+
+        std::string string(const Int token) const {
+            if(token == -1) return {};
+            return std::string{_json + _tokens[token].begin, _tokens[token].end - _tokens[token].begin};
+        }
+
+        /* Value of a number or a boolean, the default if there's none */
+        Long integer(const Int token, const Long defaultValue = 0) const {
+            if(token == -1 || _tokens[token].type != Token::Type::Primitive) return defaultValue;
+            const std::string value = string(token);
+            if(value == "true") return 1;
+            if(value == "false") return 0;
+            return std::strtoll(value.data(), nullptr, 10);
+        }
+
+    private:
+        const char* _json;
+        Containers::ArrayView<const Token> _tokens;
+};
+
+VertexFormat componentFormat(const Long componentType) {
+    switch(componentType) {
+        case 5120: return VertexFormat::Byte;
+        case 5121: return VertexFormat::UnsignedByte;
+        case 5122: return VertexFormat::Short;
+        case 5123: return VertexFormat::UnsignedShort;
+        case 5125: return VertexFormat::UnsignedInt;
+        case 5126: return VertexFormat::Float;
+    }
+    return VertexFormat{};
+}
+
+UnsignedInt componentCount(const std::string& type) {
+    if(type == "SCALAR") return 1;
+    if(type == "VEC2") return 2;
+    if(type == "VEC3") return 3;
+    if(type == "VEC4") return 4;
+    return 0;
+}
+
+/* Attributes the scene uses, in formats MeshTools::compile() can take.
+   Other attributes are not drawn, so they're skipped. */
+bool meshAttribute(const std::string& name, const VertexFormat format, Trade::MeshAttribute& out) {
+    if(name == "POSITION" && format == VertexFormat::Vector3)
+        out = Trade::MeshAttribute::Position;
+    else if(name == "NORMAL" && format == VertexFormat::Vector3)
+        out = Trade::MeshAttribute::Normal;
+    else if(name == "TANGENT" && format == VertexFormat::Vector4)
+        out = Trade::MeshAttribute::Tangent;
+    else if(name == "TEXCOORD_0" && (format == VertexFormat::Vector2 ||
+        format == VertexFormat::Vector2ubNormalized ||
+        format == VertexFormat::Vector2usNormalized))
+        out = Trade::MeshAttribute::TextureCoordinates;
+    else if(name == "COLOR_0" && (format == VertexFormat::Vector3 ||
+        format == VertexFormat::Vector4 ||
+        format == VertexFormat::Vector3ubNormalized ||
+        format == VertexFormat::Vector4ubNormalized ||
+        format == VertexFormat::Vector3usNormalized ||
+        format == VertexFormat::Vector4usNormalized))
+        out = Trade::MeshAttribute::Color;
+    else return false;
+    return true;
+}
+
+/* JSON chunk of a binary glTF, empty if it's not one */
+Containers::ArrayView<const char> jsonChunk(Containers::ArrayView<const char> data) {
+    UnsignedInt header[3], chunk[2];
+    if(data.size() < sizeof(header) + sizeof(chunk)) return nullptr;
+    std::memcpy(header, data, sizeof(header));
+    std::memcpy(chunk, data + sizeof(header), sizeof(chunk));
+    if(header[0] != Magic || header[1] != 2 || chunk[1] != JsonChunk)
+        return nullptr;
+
+    const std::size_t jsonOffset = sizeof(header) + sizeof(chunk);
+    if(jsonOffset + chunk[0] > data.size()) return nullptr;
+    return data.slice(jsonOffset, jsonOffset + chunk[0]);
+}
+
+/* Decodes percent-escaped characters, empty if the escapes are broken or
+   the URI has JSON escapes, which are rare enough to be left to the
+   importer */
+std::string decodeUri(const std::string& uri) {
+    std::string out;
+    for(std::size_t i = 0; i != uri.size(); ++i) {
+        if(uri[i] == '\\') return {};
+        if(uri[i] != '%') {
+            out += uri[i];
+            continue;
+        }
+
+        if(i + 2 >= uri.size() || !std::isxdigit((unsigned char)uri[i + 1]) || !std::isxdigit((unsigned char)uri[i + 2]))
+            return {};
+        out += char(std::strtol(uri.substr(i + 1, 2).data(), nullptr, 16));
+        i += 2;
+    }
+    return out;
+}
+
+}
+
+Containers::Array<std::string> GlbFile::imageFiles(const std::string& filename) {
+    if(!Utility::Directory::exists(filename)) return {};
+
+    const Containers::Array<const char, Utility::Directory::MapDeleter> data = Utility::Directory::mapRead(filename);
+    const Containers::ArrayView<const char> jsonData = Utility::String::endsWith(Utility::String::lowercase(filename), ".glb") ?
+        jsonChunk(data) : Containers::ArrayView<const char>{data};
+
+    Containers::Array<Token> tokens;
+    if(jsonData.empty() || !JsonTokenizer{jsonData}.tokenize(tokens))
+        return {};
+    const Json json{jsonData, tokens};
+
+    const std::string directory = Utility::Directory::path(filename);
+    const Containers::Array<UnsignedInt> images = json.elements(json.find(0, "images"));
+    Containers::Array<std::string> out{images.size()};
+    for(std::size_t i = 0; i != images.size(); ++i) {
+        const std::string uri = json.string(json.find(images[i], "uri"));
+        if(uri.empty() || Utility::String::beginsWith(uri, "data:"))
+            continue;
+
+        const std::string file = decodeUri(uri);
+        if(!file.empty()) out[i] = Utility::Directory::join(directory, file);
+    }
+
+    return out;
+}
+
+GlbFile::GlbFile(const std::string& filename) {
+    if(!Utility::Directory::exists(filename)) return;
+
+    _data = Utility::Directory::mapRead(filename);
+    _valid = parse();
+}
+
+GlbFile::~GlbFile() = default;
+
+bool GlbFile::parse() {
+    /* Header and the JSON chunk, followed by the binary chunk */
+    const Containers::ArrayView<const char> jsonData = jsonChunk(_data);
+    if(jsonData.empty()) return false;
+
+    UnsignedInt chunk[2];
+    const std::size_t binaryOffset = jsonData.data() - _data.data() + ((jsonData.size() + 3) & ~std::size_t{3});
+    if(binaryOffset + sizeof(chunk) <= _data.size()) {
+        std::memcpy(chunk, _data + binaryOffset, sizeof(chunk));
+        if(chunk[1] == BinaryChunk && binaryOffset + sizeof(chunk) + chunk[0] <= _data.size())
+            _binary = _data.slice(binaryOffset + sizeof(chunk), binaryOffset + sizeof(chunk) + chunk[0]);
+    }
+
+    Containers::Array<Token> tokens;
+    if(!JsonTokenizer{jsonData}.tokenize(tokens)) {
+        Warning{} << "Cannot parse the glTF JSON, using the importer for all meshes";
+        return false;
+    }
+    const Json json{jsonData, tokens};
+
+    /* Only the first buffer lives in the binary chunk */
+    const Containers::Array<UnsignedInt> buffers = json.elements(json.find(0, "buffers"));
+    const Containers::Array<UnsignedInt> bufferViews = json.elements(json.find(0, "bufferViews"));
+    const Containers::Array<UnsignedInt> accessorTokens = json.elements(json.find(0, "accessors"));
+
+    Containers::Array<Implementation::GlbAccessor> accessors{Containers::ValueInit, accessorTokens.size()};
+    for(std::size_t i = 0; i != accessorTokens.size(); ++i) {
+        const Int accessor = accessorTokens[i];
+        Implementation::GlbAccessor& out = accessors[i];
+
+        const Long view = json.integer(json.find(accessor, "bufferView"), -1);
+        if(view < 0 || std::size_t(view) >= bufferViews.size() || json.find(accessor, "sparse") != -1)
+            continue;
+        const Long buffer = json.integer(json.find(bufferViews[view], "buffer"), -1);
+        if(buffer != 0 || buffers.empty() || json.find(buffers[0], "uri") != -1)
+            continue;
+
+        const UnsignedInt count = componentCount(json.string(json.find(accessor, "type")));
+        const VertexFormat component = componentFormat(json.integer(json.find(accessor, "componentType")));
+        const bool normalized = json.integer(json.find(accessor, "normalized"));
+        if(!count || component == VertexFormat{} || (normalized && (component == VertexFormat::Float || component == VertexFormat::UnsignedInt)))
+            continue;
+        out.format = vertexFormat(component, count, normalized);
+
+        /* All of it has to be inside the view and the view inside the
+           binary chunk */
+        const Long viewOffset = json.integer(json.find(bufferViews[view], "byteOffset"));
+        const Long viewSize = json.integer(json.find(bufferViews[view], "byteLength"));
+        out.offset = viewOffset + json.integer(json.find(accessor, "byteOffset"));
+        out.stride = json.integer(json.find(bufferViews[view], "byteStride"));
+        out.count = json.integer(json.find(accessor, "count"));
+        const std::size_t size = vertexFormatSize(out.format);
+        const std::size_t stride = out.stride ? out.stride : size;
+        if(viewOffset < 0 || viewSize < 0 || std::size_t(viewOffset + viewSize) > _binary.size() || !out.count || out.offset < viewOffset ||
+           std::size_t(out.offset) + (out.count - 1)*stride + size > std::size_t(viewOffset + viewSize))
+            continue;
+
+        out.valid = true;
+    }
+
+    /* Every primitive is a separate mesh */
+    for(const UnsignedInt mesh: json.elements(json.find(0, "meshes"))) {
+        for(const UnsignedInt primitive: json.elements(json.find(mesh, "primitives"))) {
+            Implementation::GlbMesh out;
+            switch(json.integer(json.find(primitive, "mode"), 4)) {
+                case 0: out.primitive = MeshPrimitive::Points; break;
+                case 1: out.primitive = MeshPrimitive::Lines; break;
+                case 2: out.primitive = MeshPrimitive::LineLoop; break;
+                case 3: out.primitive = MeshPrimitive::LineStrip; break;
+                case 4: out.primitive = MeshPrimitive::Triangles; break;
+                case 5: out.primitive = MeshPrimitive::TriangleStrip; break;
+                case 6: out.primitive = MeshPrimitive::TriangleFan; break;
+                default: out.primitive = MeshPrimitive{};
+            }
+
+            out.indices = json.integer(json.find(primitive, "indices"), -1);
+            if(out.indices >= Int(accessors.size()) || (out.indices != -1 && !accessors[out.indices].valid))
+                out.primitive = MeshPrimitive{};
+
+            for(const std::pair<UnsignedInt, UnsignedInt>& attribute: json.members(json.find(primitive, "attributes"))) {
+                const Long accessor = json.integer(attribute.second, -1);
+                if(accessor < 0 || std::size_t(accessor) >= accessors.size() || !accessors[accessor].valid) {
+                    out.primitive = MeshPrimitive{};
+                    continue;
+                }
+
+                Trade::MeshAttribute name;
+                if(meshAttribute(json.string(attribute.first), accessors[accessor].format, name))
+                    arrayAppend(out.attributes, Containers::InPlaceInit, name, UnsignedInt(accessor));
+            }
+
+            arrayAppend(_meshes, std::move(out));
+        }
+    }
+
+    /* Images outside of the binary chunk are left empty */
+    const Containers::Array<UnsignedInt> images = json.elements(json.find(0, "images"));
+    _images = Containers::Array<Containers::ArrayView<const char>>{images.size()};
+    for(std::size_t i = 0; i != images.size(); ++i) {
+        const Long view = json.integer(json.find(images[i], "bufferView"), -1);
+        if(view < 0 || std::size_t(view) >= bufferViews.size())
+            continue;
+        const Long buffer = json.integer(json.find(bufferViews[view], "buffer"), -1);
+        if(buffer != 0 || buffers.empty() || json.find(buffers[0], "uri") != -1)
+            continue;
+
+        const Long viewOffset = json.integer(json.find(bufferViews[view], "byteOffset"));
+        const Long viewSize = json.integer(json.find(bufferViews[view], "byteLength"));
+        if(viewOffset < 0 || viewSize <= 0 || std::size_t(viewOffset) > _binary.size() || std::size_t(viewSize) > _binary.size() - viewOffset)
+            continue;
+
+        _images[i] = _binary.slice(viewOffset, viewOffset + viewSize);
+    }
+
+    _accessors = std::move(accessors);
+    return true;
+}
+
+Containers::Optional<Trade::MeshData> GlbFile::mesh(const UnsignedInt id) const {
+    if(id >= _meshes.size()) return {};
+    const Implementation::GlbMesh& mesh = _meshes[id];
+    if(mesh.primitive == MeshPrimitive{} || mesh.attributes.empty()) return {};
+
+    /* GL wants the attributes four-byte aligned. All of them together get
+       uploaded as one buffer, so they have to be close to each other or
+       unrelated data would get uploaded too. */
+    std::size_t begin = ~std::size_t{}, end = 0, used = 0;
+    UnsignedInt vertexCount = 0;
+    for(const std::pair<Trade::MeshAttribute, UnsignedInt>& attribute: mesh.attributes) {
+        const Implementation::GlbAccessor& accessor = _accessors[attribute.second];
+        const std::size_t size = vertexFormatSize(accessor.format);
+        const std::size_t stride = accessor.stride ? accessor.stride : size;
+        if(accessor.offset % 4 || stride % 4 || (vertexCount && accessor.count != vertexCount))
+            return {};
+
+        vertexCount = accessor.count;
+        begin = Math::min(begin, std::size_t(accessor.offset));
+        end = Math::max(end, std::size_t(accessor.offset) + (accessor.count - 1)*stride + size);
+        used += accessor.count*size;
+    }
+    if(end - begin > used + used/4) return {};
+
+    const Containers::ArrayView<const char> vertexData = _binary.slice(begin, end);
+    Containers::Array<Trade::MeshAttributeData> attributes{mesh.attributes.size()};
+    for(std::size_t i = 0; i != mesh.attributes.size(); ++i) {
+        const Implementation::GlbAccessor& accessor = _accessors[mesh.attributes[i].second];
+        attributes[i] = Trade::MeshAttributeData{mesh.attributes[i].first,
+            accessor.format,
+            Containers::StridedArrayView1D<const void>{vertexData,
+                _binary.data() + accessor.offset, accessor.count,
+                accessor.stride ? accessor.stride : vertexFormatSize(accessor.format)}};
+    }
+
+    /* Indices have to be tightly packed and aligned to their size */
+    if(mesh.indices != -1) {
+        const Implementation::GlbAccessor& accessor = _accessors[mesh.indices];
+        MeshIndexType type;
+        switch(accessor.format) {
+            case VertexFormat::UnsignedByte: type = MeshIndexType::UnsignedByte; break;
+            case VertexFormat::UnsignedShort: type = MeshIndexType::UnsignedShort; break;
+            case VertexFormat::UnsignedInt: type = MeshIndexType::UnsignedInt; break;
+            default: return {};
+        }
+        const std::size_t size = meshIndexTypeSize(type);
+        if(accessor.offset % size || (accessor.stride && accessor.stride != size))
+            return {};
+
+        const Containers::ArrayView<const char> indexData = _binary.slice(
+            accessor.offset, accessor.offset + accessor.count*size);
+        return Trade::MeshData{mesh.primitive,
+            Trade::DataFlags{}, indexData, Trade::MeshIndexData{type, indexData},
+            Trade::DataFlags{}, vertexData, std::move(attributes), vertexCount};
+    }
+
+    return Trade::MeshData{mesh.primitive,
+        Trade::DataFlags{}, vertexData, std::move(attributes), vertexCount};
+}
+
+}
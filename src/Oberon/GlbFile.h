@@ -0,0 +1,90 @@
+#ifndef Oberon_GlbFile_h
+#define Oberon_GlbFile_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Utility/Directory.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+namespace Implementation {
+    struct GlbAccessor;
+    struct GlbMesh;
+}
+
+/* Memory-mapped binary glTF file. Meshes whose vertex and index data can be
+   used by GL as they are point directly into the mapping, so they're
+   uploaded without any copy made on the way. Embedded images can be decoded
+   from the mapping by any number of threads. Mesh IDs are the same as with
+   TinyGltfImporter, which has every primitive of a mesh as a separate
+   mesh. */
+class GlbFile {
+    public:
+        /* Absolute paths of the images that are in external files, in the
+           order of the images of a text or binary glTF file. Images that
+           are embedded or in data URIs are left empty, as are all of them
+           if the JSON can't be parsed. */
+        static Containers::Array<std::string> imageFiles(const std::string& filename);
+
+        explicit GlbFile(const std::string& filename);
+
+        ~GlbFile();
+
+        explicit operator bool() const { return _valid; }
+
+        UnsignedInt meshCount() const { return _meshes.size(); }
+
+        /* Null if the layout isn't usable directly, the importer has to be
+           used then. Texture coordinates are not flipped, so the importer
+           needs to flip them in the materials instead. */
+        Containers::Optional<Trade::MeshData> mesh(UnsignedInt id) const;
+
+        UnsignedInt imageCount() const { return _images.size(); }
+
+        /* Encoded data of an image in the binary chunk, empty if it's in
+           an external file */
+        Containers::ArrayView<const char> image(UnsignedInt id) const {
+            return id < _images.size() ? _images[id] : nullptr;
+        }
+
+    private:
+        bool parse();
+
+        Containers::Array<const char, Utility::Directory::MapDeleter> _data;
+        Containers::ArrayView<const char> _binary;
+        bool _valid{};
+        Containers::Array<Implementation::GlbAccessor> _accessors;
+        Containers::Array<Implementation::GlbMesh> _meshes;
+        Containers::Array<Containers::ArrayView<const char>> _images;
+};
+
+}
+
+#endif
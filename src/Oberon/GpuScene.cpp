@@ -0,0 +1,428 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "GpuScene.h"
+
+#include <cstring>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Renderer.h>
+#include <Magnum/GL/Shader.h>
+#include <Magnum/GL/Version.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/MeshTools/Compile.h>
+#include <Magnum/MeshTools/Interleave.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Drawable.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/FrustumCulling.h"
+#include "Oberon/PhongDrawable.h"
+#include "Oberon/PhongShader.h"
+
+static void importShaderResources() {
+    CORRADE_RESOURCE_INITIALIZE(Oberon_RCS)
+}
+
+namespace Oberon {
+
+namespace {
+
+/* Has to match the local size in GpuCulling.comp */
+constexpr UnsignedInt CullGroupSize = 64;
+
+enum: UnsignedInt {
+    DrawsBinding = 0,
+    BoundsBinding = 1,
+    CommandsBinding = 2
+};
+
+}
+
+/* Tests the bounds of every object against the frustum planes and sets the
+   instance count of its command to zero or one */
+class GpuScene::CullShader: public GL::AbstractShaderProgram {
+    public:
+        explicit CullShader() {
+            /* The resources are compiled into a static library */
+            if(!Utility::Resource::hasGroup("Oberon"))
+                importShaderResources();
+
+            Utility::Resource rs("Oberon");
+            GL::Shader comp{GL::Version::GL430, GL::Shader::Type::Compute};
+            comp.addSource(rs.get("GpuCulling.comp"));
+            CORRADE_INTERNAL_ASSERT_OUTPUT(comp.compile());
+            attachShader(comp);
+            CORRADE_INTERNAL_ASSERT_OUTPUT(link());
+
+            _frustumPlanesUniform = uniformLocation("frustumPlanes");
+            _objectCountUniform = uniformLocation("objectCount");
+        }
+
+        CullShader& setFrustum(const Frustum& frustum) {
+            Vector4 planes[6];
+            for(std::size_t i = 0; i != 6; ++i) planes[i] = frustum[i];
+            setUniform(_frustumPlanesUniform, Containers::arrayCast<const Math::Vector<4, Float>>(Containers::arrayView(planes)));
+            return *this;
+        }
+
+        CullShader& setObjectCount(const UnsignedInt count) {
+            setUniform(_objectCountUniform, count);
+            return *this;
+        }
+
+    private:
+        Int _frustumPlanesUniform, _objectCountUniform;
+};
+
+/* Attached to the object of the drawable, gets the new absolute
+   transformation whenever the object is cleaned after it moved */
+class GpuScene::Instance: public SceneGraph::AbstractFeature3D {
+    public:
+        explicit Instance(PhongDrawable& drawable, GpuScene& scene, UnsignedInt id, const std::string& meshKey, const Range3D& box, PhongShader& shader): SceneGraph::AbstractFeature3D{drawable.object()}, drawable(drawable), group{drawable.drawables()}, id{id}, meshKey{meshKey}, box{box}, shader(shader), _scene(scene) {
+            setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+
+            /* A dirty object doesn't notify the features again until it's
+               cleaned, so it has to be cleaned in the next draw() */
+            if(object().isDirty()) markDirty();
+        }
+
+        ~Instance() { _scene.remove(id); }
+
+        void clean(const Matrix4& absoluteTransformationMatrix) override {
+            _scene.update(id, absoluteTransformationMatrix);
+        }
+
+        PhongDrawable& drawable;
+        SceneGraph::DrawableGroup3D* group;
+        UnsignedInt id;
+        std::string meshKey;
+        Range3D box;
+        PhongShader& shader;
+        bool dirty{};
+
+    private:
+        void markDirty() override {
+            if(dirty) return;
+            dirty = true;
+            arrayAppend(_scene._dirty, this);
+        }
+
+        GpuScene& _scene;
+};
+
+bool GpuScene::isSupported() {
+    /* Compute shaders, storage buffers, multi-draw indirect and the base
+       instance are all core in 4.3. The draw index comes from an instanced
+       attribute, so ARB_shader_draw_parameters isn't needed. */
+    return GL::Context::current().isVersionSupported(GL::Version::GL430);
+}
+
+bool GpuScene::canDraw(const PhongShader::Flags flags) {
+    if(flags & (PhongShader::Flag::TextureTransformation|PhongShader::Flag::GpuDriven|PhongShader::Flag::InstancedTransformation))
+        return false;
+    return !(flags & (PhongShader::Flag::DiffuseTexture|PhongShader::Flag::NormalTexture)) ||
+        (flags & PhongShader::Flag::TextureArrays);
+}
+
+bool GpuScene::MeshPool::add(const std::string& key, const Trade::MeshData& mesh, const UnsignedInt indexCount) {
+    if(mesh.primitive() != MeshPrimitive::Triangles || !mesh.isIndexed() || !mesh.attributeCount() || !mesh.vertexCount())
+        return false;
+    if(!MeshTools::isInterleaved(mesh))
+        return add(key, MeshTools::interleave(mesh), indexCount);
+
+    /* The vertex data may not start with the first attribute, offsets in the
+       layout are relative to the earliest one */
+    const UnsignedInt stride = mesh.attributeStride(0);
+    std::size_t begin = mesh.attributeOffset(0);
+    for(UnsignedInt i = 1; i != mesh.attributeCount(); ++i)
+        begin = Math::min(begin, mesh.attributeOffset(i));
+
+    Containers::Array<Attribute> attributes{Containers::NoInit, mesh.attributeCount()};
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i)
+        attributes[i] = Attribute{mesh.attributeName(i), mesh.attributeFormat(i),
+            UnsignedInt(mesh.attributeOffset(i) - begin), mesh.attributeArraySize(i)};
+
+    UnsignedInt layoutId = 0;
+    for(; layoutId != _layouts.size(); ++layoutId) {
+        const Layout& layout = _layouts[layoutId];
+        if(layout.stride != stride || layout.attributes.size() != attributes.size())
+            continue;
+
+        bool same = true;
+        for(std::size_t i = 0; i != attributes.size() && same; ++i)
+            same = layout.attributes[i].name == attributes[i].name &&
+                layout.attributes[i].format == attributes[i].format &&
+                layout.attributes[i].offset == attributes[i].offset &&
+                layout.attributes[i].arraySize == attributes[i].arraySize;
+        if(same) break;
+    }
+    if(layoutId == _layouts.size())
+        arrayAppend(_layouts, Containers::InPlaceInit, stride, std::move(attributes),
+            Containers::Array<char>{}, Containers::Array<UnsignedInt>{});
+
+    /* The last vertex can be shorter than the stride */
+    Layout& layout = _layouts[layoutId];
+    const std::size_t vertexOffset = layout.vertices.size();
+    arrayResize(layout.vertices, vertexOffset + std::size_t(stride)*mesh.vertexCount());
+    std::memcpy(layout.vertices + vertexOffset, mesh.vertexData() + begin,
+        Math::min(std::size_t(stride)*mesh.vertexCount(), mesh.vertexData().size() - begin));
+
+    const Containers::Array<UnsignedInt> indices = mesh.indicesAsArray();
+    const UnsignedInt count = indexCount ? Math::min(indexCount, UnsignedInt(indices.size())) : indices.size();
+    const UnsignedInt indexOffset = layout.indices.size();
+    arrayAppend(layout.indices, indices.prefix(count));
+
+    _meshes[key] = Range{layoutId, indexOffset, count, Int(vertexOffset/stride)};
+    return true;
+}
+
+GpuScene::GpuScene(MeshPool&& meshes): _pool{std::move(meshes)}, _cullShader{Containers::InPlaceInit} {}
+
+GpuScene::~GpuScene() = default;
+
+void GpuScene::add(PhongDrawable& drawable, const std::string& meshKey, const Range3D& box, PhongShader& shader) {
+    CORRADE_INTERNAL_ASSERT(!_built && _pool.contains(meshKey));
+    arrayAppend(_instances, new Instance{drawable, *this, UnsignedInt(_instances.size()), meshKey, box, shader});
+    drawable.drawables()->remove(drawable);
+}
+
+void GpuScene::build() {
+    /* Objects destroyed before the build are not there anymore. Group the
+       rest by the layout, the shader and the texture arrays. */
+    Containers::Array<Instance*> instances;
+    Containers::Array<UnsignedInt> groupIds;
+    for(Instance* instance: _instances) {
+        if(!instance) continue;
+
+        const UnsignedInt layout = _pool._meshes.at(instance->meshKey).layout;
+        const PhongDrawable& drawable = instance->drawable;
+        UnsignedInt groupId = 0;
+        for(; groupId != _groups.size(); ++groupId) {
+            const Group& group = _groups[groupId];
+            if(group.layout == layout && group.shader == &instance->shader &&
+               group.diffuseTexture.key() == drawable.diffuseTextureArray().key() &&
+               group.normalTexture.key() == drawable.normalTextureArray().key())
+                break;
+        }
+        if(groupId == _groups.size())
+            arrayAppend(_groups, Containers::InPlaceInit, layout, &instance->shader,
+                drawable.diffuseTextureArray(), drawable.normalTextureArray(), 0u, 0u);
+
+        ++_groups[groupId].count;
+        arrayAppend(instances, instance);
+        arrayAppend(groupIds, groupId);
+    }
+
+    UnsignedInt offset = 0;
+    for(Group& group: _groups) {
+        group.offset = offset;
+        offset += group.count;
+        group.count = 0;
+        group.shader->finish();
+    }
+
+    _instances = Containers::Array<Instance*>{Containers::ValueInit, instances.size()};
+    for(std::size_t i = 0; i != instances.size(); ++i) {
+        Group& group = _groups[groupIds[i]];
+        const UnsignedInt id = group.offset + group.count++;
+        _instances[id] = instances[i];
+        instances[i]->id = id;
+    }
+
+    /* The instanced attribute gives the draw its index, as the base instance
+       is set to it */
+    Containers::Array<UnsignedInt> drawIndices{Containers::NoInit, _instances.size()};
+    for(UnsignedInt i = 0; i != drawIndices.size(); ++i) drawIndices[i] = i;
+    _drawIndices.setData(drawIndices, GL::BufferUsage::StaticDraw);
+
+    for(const MeshPool::Layout& layout: _pool._layouts) {
+        const UnsignedInt vertexCount = layout.vertices.size()/layout.stride;
+        Containers::Array<Trade::MeshAttributeData> attributes{layout.attributes.size()};
+        for(std::size_t i = 0; i != attributes.size(); ++i) {
+            const MeshPool::Attribute& attribute = layout.attributes[i];
+            attributes[i] = Trade::MeshAttributeData{attribute.name, attribute.format,
+                Containers::StridedArrayView1D<const void>{layout.vertices,
+                    layout.vertices + attribute.offset, vertexCount, std::ptrdiff_t(layout.stride)},
+                attribute.arraySize};
+        }
+
+        const Trade::MeshData data{MeshPrimitive::Triangles,
+            {}, layout.indices, Trade::MeshIndexData{layout.indices},
+            {}, layout.vertices, std::move(attributes)};
+        GL::Mesh mesh = MeshTools::compile(data);
+        mesh.addVertexBufferInstanced(_drawIndices, 1, 0, PhongShader::DrawIndex{});
+        arrayAppend(_meshes, std::move(mesh));
+    }
+
+    _drawData = Containers::Array<Draw>{Containers::ValueInit, _instances.size()};
+    _boundsData = Containers::Array<Bounds>{Containers::ValueInit, _instances.size()};
+    _commandData = Containers::Array<Command>{Containers::ValueInit, _instances.size()};
+    _built = true;
+    for(UnsignedInt i = 0; i != _instances.size(); ++i) {
+        Instance& instance = *_instances[i];
+        PhongDrawable& drawable = instance.drawable;
+        const MeshPool::Range& range = _pool._meshes.at(instance.meshKey);
+        _commandData[i] = Command{range.indexCount, 1, range.indexOffset, range.vertexOffset, i};
+
+        Draw& draw = _drawData[i];
+        draw.ambientColor = drawable.ambientColor();
+        draw.diffuseColor = drawable.color();
+        draw.normalTextureScale = drawable.normalTextureScale();
+        draw.alphaMask = drawable.alphaMask();
+        draw.diffuseTextureLayer = drawable.diffuseTextureLayer();
+        draw.normalTextureLayer = drawable.normalTextureLayer();
+        update(i, instance.object().absoluteTransformationMatrix());
+    }
+
+    _draws.setData(_drawData, GL::BufferUsage::DynamicDraw);
+    _bounds.setData(_boundsData, GL::BufferUsage::DynamicDraw);
+    _commands.setData(_commandData, GL::BufferUsage::DynamicDraw);
+    _changedBegin = _changedEnd = 0;
+
+    /* Everything is on the GPU now */
+    _pool = MeshPool{};
+}
+
+void GpuScene::update(const UnsignedInt id, const Matrix4& absoluteTransformation) {
+    if(!_built) return;
+
+    /* The normals are not affected by the mesh transformation */
+    const Matrix3x3 normalMatrix = absoluteTransformation.normalMatrix();
+    Draw& draw = _drawData[id];
+    draw.transformationMatrix = absoluteTransformation*_instances[id]->drawable.meshTransformation();
+    draw.normalMatrix = Matrix4{
+        Vector4{normalMatrix[0], 0.0f},
+        Vector4{normalMatrix[1], 0.0f},
+        Vector4{normalMatrix[2], 0.0f},
+        Vector4{0.0f, 0.0f, 0.0f, 1.0f}};
+
+    const Range3D box = FrustumCulling::transform(_instances[id]->box, absoluteTransformation);
+    _boundsData[id] = Bounds{Vector4{box.center(), 0.0f}, Vector4{box.size()*0.5f, 0.0f}};
+
+    if(_changedBegin == _changedEnd) {
+        _changedBegin = id;
+        _changedEnd = id + 1;
+    } else {
+        _changedBegin = Math::min(_changedBegin, id);
+        _changedEnd = Math::max(_changedEnd, id + 1);
+    }
+}
+
+void GpuScene::remove(const UnsignedInt id) {
+    Instance* const instance = _instances[id];
+    if(instance->dirty) for(std::size_t i = 0; i != _dirty.size(); ++i) {
+        if(_dirty[i] != instance) continue;
+        _dirty[i] = _dirty[_dirty.size() - 1];
+        arrayResize(_dirty, _dirty.size() - 1);
+        break;
+    }
+
+    /* The ids of the others stay, the command just draws nothing */
+    _instances[id] = nullptr;
+    if(_built) {
+        _commandData[id] = Command{};
+        _commandsChanged = true;
+    }
+}
+
+bool GpuScene::release(const SceneGraph::AbstractObject3D& object) {
+    for(Instance* instance: _instances) {
+        if(!instance || &instance->object() != &object) continue;
+
+        instance->group->add(instance->drawable);
+        delete instance;
+        return true;
+    }
+
+    return false;
+}
+
+void GpuScene::draw(SceneGraph::Camera3D& camera) {
+    if(!_built || _instances.empty()) return;
+
+    /* Cleaning the objects that moved updates their data */
+    for(Instance* instance: _dirty) {
+        instance->dirty = false;
+        instance->object().setClean();
+    }
+    arrayResize(_dirty, 0);
+
+    if(_changedBegin != _changedEnd) {
+        _draws.setSubData(_changedBegin*sizeof(Draw), _drawData.slice(_changedBegin, _changedEnd));
+        _bounds.setSubData(_changedBegin*sizeof(Bounds), _boundsData.slice(_changedBegin, _changedEnd));
+        _changedBegin = _changedEnd = 0;
+    }
+    if(_commandsChanged) {
+        _commands.setSubData(0, _commandData);
+        _commandsChanged = false;
+    }
+
+    /* Cull. The commands have to be written before they're read by the
+       draws. */
+    _bounds.bind(GL::Buffer::Target::ShaderStorage, BoundsBinding);
+    _commands.bind(GL::Buffer::Target::ShaderStorage, CommandsBinding);
+    (*_cullShader)
+        .setFrustum(Frustum::fromMatrix(camera.projectionMatrix()*camera.cameraMatrix()))
+        .setObjectCount(_instances.size())
+        .dispatchCompute({(UnsignedInt(_instances.size()) + CullGroupSize - 1)/CullGroupSize, 1, 1});
+    GL::Renderer::setMemoryBarrier(GL::Renderer::MemoryBarrier::Command);
+
+    _draws.bind(GL::Buffer::Target::ShaderStorage, DrawsBinding);
+    for(Group& group: _groups) {
+        PhongShader& shader = *group.shader;
+        shader
+            .setViewMatrix(camera.cameraMatrix())
+            .setProjectionMatrix(camera.projectionMatrix());
+
+        /* The layers are per object, bound only to have the arrays there */
+        if(shader.flags() & PhongShader::Flag::AmbientTexture)
+            shader.bindAmbientTexture(*group.diffuseTexture, 0);
+        if(shader.flags() & PhongShader::Flag::DiffuseTexture)
+            shader.bindDiffuseTexture(*group.diffuseTexture, 0);
+        if(shader.flags() & PhongShader::Flag::NormalTexture)
+            shader.bindNormalTexture(*group.normalTexture, 0);
+
+        /* Magnum has no indirect draws, so the state tracker is told that
+           the GL state changes under its hands */
+        GL::Context::current().resetState(GL::Context::State::EnterExternal);
+        glUseProgram(shader.id());
+        glBindVertexArray(_meshes[group.layout].id());
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, _commands.id());
+        glMultiDrawElementsIndirect(GL_TRIANGLES, GL_UNSIGNED_INT,
+            reinterpret_cast<const void*>(std::size_t(group.offset)*sizeof(Command)),
+            group.count, 0);
+        glBindBuffer(GL_DRAW_INDIRECT_BUFFER, 0);
+        glBindVertexArray(0);
+        GL::Context::current().resetState(GL::Context::State::ExitExternal);
+    }
+}
+
+}
@@ -0,0 +1,193 @@
+#ifndef Oberon_GpuScene_h
+#define Oberon_GpuScene_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <unordered_map>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Magnum/Resource.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/PhongShader.h"
+
+namespace Oberon {
+
+/* GL 4.3 render path for the opaque objects. Meshes with the same vertex
+   layout live in one vertex and index buffer, the transformations, bounds
+   and materials of the objects in storage buffers. Every frame a compute
+   shader tests the bounds against the frustum and writes one indirect draw
+   command per object, which are then drawn with one multi-draw per group of
+   objects sharing a layout, a shader variant and texture arrays. The
+   per-object data follow the transformations of their objects. */
+class GpuScene {
+    public:
+        /* Whether the driver has compute shaders, storage buffers and
+           indirect multi-draws with a base instance. Doesn't need anything
+           Mesa's software drivers don't have. */
+        static bool isSupported();
+
+        /* Whether objects drawn with the shader variant can be drawn by
+           this, with Flag::GpuDriven added. Textures have to be in arrays
+           and can't be transformed. */
+        static bool canDraw(PhongShader::Flags flags);
+
+        /* Vertex and index data of the meshes, grouped by their vertex
+           layout */
+        class MeshPool {
+            public:
+                /* Copies the first indexCount indices of the mesh, or all
+                   if zero, and its vertices, interleaving them first if
+                   they're not. Returns false if it isn't an indexed
+                   triangle mesh. */
+                bool add(const std::string& key, const Trade::MeshData& mesh, UnsignedInt indexCount);
+
+                bool contains(const std::string& key) const {
+                    return _meshes.find(key) != _meshes.end();
+                }
+
+                std::size_t layoutCount() const { return _layouts.size(); }
+
+            private:
+                friend GpuScene;
+
+                struct Attribute {
+                    Trade::MeshAttribute name;
+                    VertexFormat format;
+                    UnsignedInt offset;
+                    UnsignedShort arraySize;
+                };
+
+                struct Layout {
+                    UnsignedInt stride;
+                    Containers::Array<Attribute> attributes;
+                    Containers::Array<char> vertices;
+                    Containers::Array<UnsignedInt> indices;
+                };
+
+                struct Range {
+                    UnsignedInt layout, indexOffset, indexCount;
+                    Int vertexOffset;
+                };
+
+                Containers::Array<Layout> _layouts;
+                std::unordered_map<std::string, Range> _meshes;
+        };
+
+        explicit GpuScene(MeshPool&& meshes);
+
+        ~GpuScene();
+
+        bool hasMesh(const std::string& key) const { return _pool.contains(key); }
+
+        /* Takes the drawable out of its group and draws it with given
+           variant of its shader, which needs PhongShader::Flag::GpuDriven.
+           The mesh has to be in the pool, the drawable can't have textures
+           other than texture arrays. To be called before build(). */
+        void add(PhongDrawable& drawable, const std::string& meshKey, const Range3D& box, PhongShader& shader);
+
+        /* Uploads the meshes and the data of the added objects and groups
+           them for drawing. The pool is released. */
+        void build();
+
+        std::size_t size() const { return _instances.size(); }
+
+        std::size_t groupCount() const { return _groups.size(); }
+
+        /* Puts the drawable of the object back to its group, for example so
+           its material can be edited. Returns false if the object isn't
+           drawn by this. */
+        bool release(const SceneGraph::AbstractObject3D& object);
+
+        /* Culls and draws everything with the camera */
+        void draw(SceneGraph::Camera3D& camera);
+
+    private:
+        class Instance;
+        class CullShader;
+
+        /* Layout of the storage buffers, matching Phong.vert and
+           GpuCulling.comp */
+        struct Draw {
+            Matrix4 transformationMatrix;
+            Matrix4 normalMatrix;
+            Color4 ambientColor;
+            Color4 diffuseColor;
+            Float normalTextureScale, alphaMask, padding[2];
+            Int diffuseTextureLayer, normalTextureLayer, padding2[2];
+        };
+
+        struct Bounds {
+            Vector4 center, halfSize;
+        };
+
+        struct Command {
+            UnsignedInt count, instanceCount, firstIndex;
+            Int baseVertex;
+            UnsignedInt baseInstance;
+        };
+
+        struct Group {
+            UnsignedInt layout;
+            PhongShader* shader;
+            Resource<GL::Texture2DArray> diffuseTexture, normalTexture;
+            UnsignedInt offset, count;
+        };
+
+        void update(UnsignedInt id, const Matrix4& absoluteTransformation);
+        void remove(UnsignedInt id);
+
+        MeshPool _pool;
+        Containers::Pointer<CullShader> _cullShader;
+
+        /* Declared before the meshes, which use it */
+        GL::Buffer _drawIndices;
+        Containers::Array<GL::Mesh> _meshes;
+        GL::Buffer _draws, _bounds, _commands;
+
+        Containers::Array<Instance*> _instances;
+        Containers::Array<Group> _groups;
+        /* CPU copies of the storage buffers */
+        Containers::Array<Draw> _drawData;
+        Containers::Array<Bounds> _boundsData;
+        Containers::Array<Command> _commandData;
+        /* Instances whose objects moved since the last draw() */
+        Containers::Array<Instance*> _dirty;
+        /* Range of the data changed since the last upload */
+        UnsignedInt _changedBegin{}, _changedEnd{};
+        bool _commandsChanged{}, _built{};
+};
+
+}
+
+#endif
@@ -0,0 +1,120 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "Hash.h"
+
+#include <cstring>
+
+namespace Oberon {
+
+namespace {
+
+constexpr UnsignedLong Prime1 = 0x9e3779b185ebca87ull;
+constexpr UnsignedLong Prime2 = 0xc2b2ae3d27d4eb4full;
+constexpr UnsignedLong Prime3 = 0x165667b19e3779f9ull;
+constexpr UnsignedLong Prime4 = 0x85ebca77c2b2ae63ull;
+constexpr UnsignedLong Prime5 = 0x27d4eb2f165667c5ull;
+
+inline UnsignedLong rotateLeft(UnsignedLong value, Int bits) {
+    return (value << bits)|(value >> (64 - bits));
+}
+
+inline UnsignedLong read64(const char* data) {
+    UnsignedLong value;
+    std::memcpy(&value, data, 8);
+    return value;
+}
+
+inline UnsignedInt read32(const char* data) {
+    UnsignedInt value;
+    std::memcpy(&value, data, 4);
+    return value;
+}
+
+inline UnsignedLong round(UnsignedLong accumulator, UnsignedLong input) {
+    accumulator += input*Prime2;
+    accumulator = rotateLeft(accumulator, 31);
+    return accumulator*Prime1;
+}
+
+inline UnsignedLong merge(UnsignedLong hash, UnsignedLong accumulator) {
+    hash ^= round(0, accumulator);
+    return hash*Prime1 + Prime4;
+}
+
+}
+
+UnsignedLong hash(const Containers::ArrayView<const void> data, const UnsignedLong seed) {
+    const char* current = static_cast<const char*>(data.data());
+    const char* const end = current + data.size();
+
+    UnsignedLong hash;
+    if(data.size() >= 32) {
+        UnsignedLong v1 = seed + Prime1 + Prime2;
+        UnsignedLong v2 = seed + Prime2;
+        UnsignedLong v3 = seed;
+        UnsignedLong v4 = seed - Prime1;
+
+        for(; current + 32 <= end; current += 32) {
+            v1 = round(v1, read64(current));
+            v2 = round(v2, read64(current + 8));
+            v3 = round(v3, read64(current + 16));
+            v4 = round(v4, read64(current + 24));
+        }
+
+        hash = rotateLeft(v1, 1) + rotateLeft(v2, 7) + rotateLeft(v3, 12) + rotateLeft(v4, 18);
+        hash = merge(hash, v1);
+        hash = merge(hash, v2);
+        hash = merge(hash, v3);
+        hash = merge(hash, v4);
+    } else hash = seed + Prime5;
+
+    hash += data.size();
+
+    for(; current + 8 <= end; current += 8) {
+        hash ^= round(0, read64(current));
+        hash = rotateLeft(hash, 27)*Prime1 + Prime4;
+    }
+
+    if(current + 4 <= end) {
+        hash ^= UnsignedLong(read32(current))*Prime1;
+        hash = rotateLeft(hash, 23)*Prime2 + Prime3;
+        current += 4;
+    }
+
+    for(; current != end; ++current) {
+        hash ^= UnsignedLong(UnsignedByte(*current))*Prime5;
+        hash = rotateLeft(hash, 11)*Prime1;
+    }
+
+    /* Final avalanche */
+    hash ^= hash >> 33;
+    hash *= Prime2;
+    hash ^= hash >> 29;
+    hash *= Prime3;
+    hash ^= hash >> 32;
+    return hash;
+}
+
+}
@@ -0,0 +1,350 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "Hlod.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/VertexFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Math/Packing.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/MeshSimplifier.h"
+#include "Oberon/PhongDrawable.h"
+#include "Oberon/SceneData.h"
+
+namespace Oberon { namespace Hlod {
+
+namespace {
+
+/* A cluster goes back to its members only once it's this fraction of its
+   distance away, so it doesn't flicker at the threshold */
+constexpr Float HlodHysteresis = 0.9f;
+
+bool samePosition(const Vector3& a, const Vector3& b) {
+    return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+/* First of the vertices at the same position for every vertex */
+Containers::Array<UnsignedInt> weld(Containers::ArrayView<const Vector3> positions) {
+    Containers::Array<UnsignedInt> order{Containers::NoInit, positions.size()};
+    for(UnsignedInt i = 0; i != order.size(); ++i) order[i] = i;
+    std::sort(order.begin(), order.end(), [&](UnsignedInt a, UnsignedInt b) {
+        const Vector3& pa = positions[a];
+        const Vector3& pb = positions[b];
+        if(pa.x() != pb.x()) return pa.x() < pb.x();
+        if(pa.y() != pb.y()) return pa.y() < pb.y();
+        if(pa.z() != pb.z()) return pa.z() < pb.z();
+        return a < b;
+    });
+
+    Containers::Array<UnsignedInt> remap{Containers::NoInit, positions.size()};
+    for(std::size_t i = 0; i != order.size(); ++i)
+        remap[order[i]] = i && samePosition(positions[order[i]], positions[order[i - 1]]) ?
+            remap[order[i - 1]] : order[i];
+    return remap;
+}
+
+void setActive(SceneData& data, HlodCluster& cluster, const bool active) {
+    if(active) {
+        data.opaqueDrawables.add(*cluster.proxy);
+        for(PhongDrawable* member: cluster.members)
+            data.opaqueDrawables.remove(*member);
+    } else {
+        data.opaqueDrawables.remove(*cluster.proxy);
+        for(PhongDrawable* member: cluster.members)
+            data.opaqueDrawables.add(*member);
+    }
+
+    cluster.active = active;
+}
+
+}
+
+Containers::Optional<Source> source(const Trade::MeshData& mesh, const Matrix4& dequantization, const Containers::ArrayView<const MeshSimplifier::Lod> lods) {
+    if(mesh.primitive() != MeshPrimitive::Triangles ||
+       !mesh.hasAttribute(Trade::MeshAttribute::Position) || !mesh.vertexCount())
+        return {};
+
+    Containers::Array<UnsignedInt> indices;
+    if(mesh.isIndexed()) {
+        const Containers::Array<UnsignedInt> all = mesh.indicesAsArray();
+        const MeshSimplifier::Lod lod = lods.empty() ?
+            MeshSimplifier::Lod{0, UnsignedInt(all.size()), 0.0f} : lods.back();
+        indices = Containers::Array<UnsignedInt>{Containers::NoInit, lod.indexCount};
+        std::memcpy(indices.data(), all.data() + lod.indexOffset, lod.indexCount*sizeof(UnsignedInt));
+    } else {
+        indices = Containers::Array<UnsignedInt>{Containers::NoInit, mesh.vertexCount() - mesh.vertexCount() % 3};
+        for(UnsignedInt i = 0; i != indices.size(); ++i) indices[i] = i;
+    }
+
+    /* The coarsest level uses only a fraction of the vertices */
+    const Containers::Array<Vector3> positions = mesh.positions3DAsArray();
+    Containers::Array<UnsignedInt> remap{Containers::DirectInit, positions.size(), ~UnsignedInt{}};
+    Source out;
+    for(UnsignedInt& index: indices) {
+        if(remap[index] == ~UnsignedInt{}) {
+            remap[index] = out.positions.size();
+            arrayAppend(out.positions, dequantization.transformPoint(positions[index]));
+        }
+        index = remap[index];
+    }
+    out.indices = std::move(indices);
+
+    return Containers::Optional<Source>{std::move(out)};
+}
+
+Color4 averageColor(const SceneCache::Image& image) {
+    if(image.levels.empty()) return Color4{1.0f};
+    const Containers::ArrayView<const char> level = image.levels.back();
+
+    /* The endpoints of the first block are close enough for a level that's
+       at most a few blocks big */
+    if(image.compressed) {
+        std::size_t offset;
+        switch(image.compressedFormat) {
+            case CompressedPixelFormat::Bc1RGBUnorm:
+            case CompressedPixelFormat::Bc1RGBSrgb:
+            case CompressedPixelFormat::Bc1RGBAUnorm:
+            case CompressedPixelFormat::Bc1RGBASrgb:
+                offset = 0;
+                break;
+            case CompressedPixelFormat::Bc2RGBAUnorm:
+            case CompressedPixelFormat::Bc2RGBASrgb:
+            case CompressedPixelFormat::Bc3RGBAUnorm:
+            case CompressedPixelFormat::Bc3RGBASrgb:
+                offset = 8;
+                break;
+            default:
+                return Color4{1.0f};
+        }
+        if(level.size() < offset + 4) return Color4{1.0f};
+
+        UnsignedShort endpoints[2];
+        std::memcpy(endpoints, level.data() + offset, sizeof(endpoints));
+        Vector3 color;
+        for(const UnsignedShort endpoint: endpoints)
+            color += Vector3{Float(endpoint >> 11)/31.0f,
+                             Float((endpoint >> 5) & 0x3f)/63.0f,
+                             Float(endpoint & 0x1f)/31.0f}*0.5f;
+
+        const bool srgb = image.compressedFormat == CompressedPixelFormat::Bc1RGBSrgb ||
+            image.compressedFormat == CompressedPixelFormat::Bc1RGBASrgb ||
+            image.compressedFormat == CompressedPixelFormat::Bc2RGBASrgb ||
+            image.compressedFormat == CompressedPixelFormat::Bc3RGBASrgb;
+        return srgb ? Color4::fromSrgb(color) : Color4{color};
+    }
+
+    UnsignedInt channelCount;
+    switch(image.format) {
+        case PixelFormat::R8Unorm: channelCount = 1; break;
+        case PixelFormat::RG8Unorm: channelCount = 2; break;
+        case PixelFormat::RGB8Unorm:
+        case PixelFormat::RGB8Srgb: channelCount = 3; break;
+        case PixelFormat::RGBA8Unorm:
+        case PixelFormat::RGBA8Srgb: channelCount = 4; break;
+        default: return Color4{1.0f};
+    }
+
+    /* Only the base level is there if the mips get generated on the GPU */
+    const Vector2i size = Math::max(image.size >> Int(image.levels.size() - 1), Vector2i{1});
+    const std::size_t rowLength = size.x()*channelCount;
+    const std::size_t rowStride = rowLength + (image.alignment - rowLength % image.alignment) % image.alignment;
+    if(level.size() < rowStride*(size.y() - 1) + rowLength) return Color4{1.0f};
+
+    Vector4d sum;
+    for(Int y = 0; y != size.y(); ++y) {
+        const UnsignedByte* const row = reinterpret_cast<const UnsignedByte*>(level.data()) + y*rowStride;
+        for(Int x = 0; x != size.x(); ++x)
+            for(UnsignedInt c = 0; c != channelCount; ++c)
+                sum[c] += row[x*channelCount + c];
+    }
+    const Vector4 average = Vector4{sum/(255.0*size.product())};
+
+    Color4 color{1.0f};
+    if(channelCount == 1) color.rgb() = Color3{average[0]};
+    else for(UnsignedInt c = 0; c != channelCount; ++c) color[c] = average[c];
+    if(image.format == PixelFormat::RGB8Srgb || image.format == PixelFormat::RGBA8Srgb)
+        color.rgb() = Color3::fromSrgb(color.rgb());
+    return color;
+}
+
+Containers::Array<Containers::Array<UnsignedInt>> cluster(const Containers::ArrayView<const Vector4> bounds, const UnsignedInt gridSize) {
+    Containers::Array<Containers::Array<UnsignedInt>> out;
+    if(bounds.empty() || !gridSize) return out;
+
+    Vector3 min = bounds[0].xyz(), max = bounds[0].xyz();
+    for(const Vector4& sphere: bounds) {
+        min = Math::min(min, sphere.xyz());
+        max = Math::max(max, sphere.xyz());
+    }
+    const Float cellSize = Math::max((max - min).max()/gridSize, 1.0e-6f);
+
+    std::vector<std::pair<UnsignedLong, UnsignedInt>> cells;
+    for(UnsignedInt i = 0; i != bounds.size(); ++i) {
+        if(bounds[i].w() > cellSize) continue;
+        const Vector3ui cell = Math::min(Vector3ui{(bounds[i].xyz() - min)/cellSize}, Vector3ui{gridSize - 1});
+        cells.emplace_back((UnsignedLong(cell.z())*gridSize + cell.y())*gridSize + cell.x(), i);
+    }
+    std::sort(cells.begin(), cells.end());
+
+    for(std::size_t begin = 0, end; begin < cells.size(); begin = end) {
+        for(end = begin + 1; end < cells.size() && cells[end].first == cells[begin].first; ++end);
+        if(end - begin < 2) continue;
+
+        Containers::Array<UnsignedInt> members{Containers::NoInit, end - begin};
+        for(std::size_t i = begin; i != end; ++i) members[i - begin] = cells[i].second;
+        arrayAppend(out, Containers::InPlaceInit, std::move(members));
+    }
+
+    return out;
+}
+
+Containers::Optional<Trade::MeshData> bake(const Containers::ArrayView<const Member> members, const Float reduction) {
+    Containers::Array<Vector3> positions;
+    Containers::Array<Color4> colors;
+    Containers::Array<UnsignedInt> indices;
+    for(const Member& member: members) {
+        const UnsignedInt offset = positions.size();
+        for(const Vector3& position: member.source->positions) {
+            arrayAppend(positions, member.transformation.transformPoint(position));
+            arrayAppend(colors, member.color);
+        }
+        for(const UnsignedInt index: member.source->indices)
+            arrayAppend(indices, offset + index);
+    }
+
+    /* Normal and texture coordinate seams would stop the simplification
+       and aren't needed for a proxy. Triangles that got degenerate are
+       dropped. */
+    const Containers::Array<UnsignedInt> remap = weld(positions);
+    std::size_t indexCount = 0;
+    for(std::size_t i = 0; i + 3 <= indices.size(); i += 3) {
+        const UnsignedInt a = remap[indices[i]], b = remap[indices[i + 1]], c = remap[indices[i + 2]];
+        if(a == b || b == c || a == c) continue;
+        indices[indexCount++] = a;
+        indices[indexCount++] = b;
+        indices[indexCount++] = c;
+    }
+    if(!indexCount) return {};
+
+    Float error;
+    indexCount = MeshSimplifier::simplify(indices.prefix(indexCount),
+        Containers::stridedArrayView(Containers::arrayView(positions)),
+        UnsignedInt(indexCount/3*reduction)*3, error);
+    if(!indexCount) return {};
+
+    /* Keep only the vertices that are still used, with normals averaged
+       from the triangles around them */
+    struct Vertex {
+        Vector3 position;
+        Vector3 normal;
+        Color4 color;
+    };
+
+    Containers::Array<UnsignedInt> newIndices{Containers::DirectInit, positions.size(), ~UnsignedInt{}};
+    Containers::Array<Vertex> vertices;
+    for(UnsignedInt& index: indices.prefix(indexCount)) {
+        if(newIndices[index] == ~UnsignedInt{}) {
+            newIndices[index] = vertices.size();
+            arrayAppend(vertices, Vertex{positions[index], {}, colors[index]});
+        }
+        index = newIndices[index];
+    }
+    for(std::size_t i = 0; i != indexCount; i += 3) {
+        Vertex* const v[]{&vertices[indices[i]], &vertices[indices[i + 1]], &vertices[indices[i + 2]]};
+        const Vector3 normal = Math::cross(v[1]->position - v[0]->position, v[2]->position - v[0]->position);
+        for(Vertex* vertex: v) vertex->normal += normal;
+    }
+    for(Vertex& vertex: vertices)
+        if(!vertex.normal.isZero()) vertex.normal = vertex.normal.normalized();
+
+    const UnsignedInt vertexCount = vertices.size();
+    Containers::Array<char> vertexData{Containers::NoInit, vertexCount*sizeof(Vertex)};
+    std::memcpy(vertexData.data(), vertices.data(), vertexData.size());
+    const auto attribute = [&](Trade::MeshAttribute name, VertexFormat format, std::size_t offset) {
+        return Trade::MeshAttributeData{name, format,
+            Containers::StridedArrayView1D<const void>{Containers::arrayView(vertexData),
+                vertexData.data() + offset, vertexCount, sizeof(Vertex)}};
+    };
+    Containers::Array<Trade::MeshAttributeData> attributes{Containers::InPlaceInit, {
+        attribute(Trade::MeshAttribute::Position, VertexFormat::Vector3, offsetof(Vertex, position)),
+        attribute(Trade::MeshAttribute::Normal, VertexFormat::Vector3, offsetof(Vertex, normal)),
+        attribute(Trade::MeshAttribute::Color, VertexFormat::Vector4, offsetof(Vertex, color))}};
+
+    Containers::Array<char> indexData{Containers::NoInit, indexCount*sizeof(UnsignedInt)};
+    std::memcpy(indexData.data(), indices.data(), indexData.size());
+    const Trade::MeshIndexData indexView{Containers::arrayCast<const UnsignedInt>(Containers::arrayView(indexData))};
+
+    return Trade::MeshData{MeshPrimitive::Triangles,
+        std::move(indexData), indexView,
+        std::move(vertexData), std::move(attributes), vertexCount};
+}
+
+void update(SceneData& data) {
+    const Vector3 cameraPosition = data.camera->object().absoluteTransformationMatrix().translation();
+    for(HlodCluster& cluster: data.hlods) {
+        if(!cluster.proxy) continue;
+
+        const Float distance = (cluster.bounds.xyz() - cameraPosition).length() - cluster.bounds.w();
+        const bool active = distance > cluster.distance*(cluster.active ? HlodHysteresis : 1.0f);
+        if(active != cluster.active) setActive(data, cluster, active);
+    }
+}
+
+void dissolve(SceneData& data, const UnsignedInt objectId) {
+    /* Drawables of the object and all its children */
+    std::vector<SceneGraph::AbstractFeature3D*> drawables;
+    std::vector<UnsignedInt> objects{objectId};
+    while(!objects.empty()) {
+        const ObjectInfo& object = data.objects[objects.back()];
+        objects.pop_back();
+        if(SceneGraph::AbstractFeature3D* drawable = object.features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)])
+            drawables.push_back(drawable);
+        objects.insert(objects.end(), object.children.begin(), object.children.end());
+    }
+
+    for(HlodCluster& cluster: data.hlods) {
+        if(!cluster.proxy || std::none_of(cluster.members.begin(), cluster.members.end(), [&](PhongDrawable* member) {
+            return std::find(drawables.begin(), drawables.end(), member) != drawables.end();
+        })) continue;
+
+        if(cluster.active) setActive(data, cluster, false);
+        delete cluster.proxyObject;
+        cluster.proxyObject = nullptr;
+        cluster.proxy = nullptr;
+        cluster.members = {};
+    }
+}
+
+}}
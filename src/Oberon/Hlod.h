@@ -0,0 +1,81 @@
+#ifndef Oberon_Hlod_h
+#define Oberon_Hlod_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/SceneCache.h"
+
+namespace Oberon { namespace Hlod {
+
+/* Geometry of a mesh kept for the baking, which is the coarsest level of
+   detail with just the vertices it uses and dequantized positions */
+struct Source {
+    Containers::Array<Vector3> positions;
+    Containers::Array<UnsignedInt> indices;
+};
+
+/* Null if the mesh is not made of triangles or has no positions */
+Containers::Optional<Source> source(const Trade::MeshData& mesh, const Matrix4& dequantization, Containers::ArrayView<const MeshSimplifier::Lod> lods);
+
+/* Average color of the smallest mip level. White for formats it can't
+   decode. */
+Color4 averageColor(const SceneCache::Image& image);
+
+/* Groups the bounding spheres by the cell they're centered in, in a grid
+   with gridSize cells along the longest side of their bounds. Spheres
+   larger than a cell and cells with a single sphere are left out. */
+Containers::Array<Containers::Array<UnsignedInt>> cluster(Containers::ArrayView<const Vector4> bounds, UnsignedInt gridSize);
+
+struct Member {
+    const Source* source;
+    Matrix4 transformation;
+    Color4 color;
+};
+
+/* Merges the members into one mesh with their colors in the vertices,
+   welds vertices at the same position and simplifies the result to
+   reduction times the triangles. Has smooth normals and 32-bit indices.
+   Null if there's nothing left. */
+Containers::Optional<Trade::MeshData> bake(Containers::ArrayView<const Member> members, Float reduction);
+
+/* Draws clusters farther from the camera than their distance as their
+   proxies and the closer ones as their members. Has to be called before
+   drawing the opaque drawables. */
+void update(SceneData& data);
+
+/* Dissolves the clusters containing drawables of the object or its
+   children. Has to be called before the object is deleted, as the proxies
+   would still draw it. */
+void dissolve(SceneData& data, UnsignedInt objectId);
+
+}}
+
+#endif
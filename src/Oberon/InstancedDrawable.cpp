@@ -0,0 +1,185 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "InstancedDrawable.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/GL/BufferTextureFormat.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/MeshView.h>
+#include <Magnum/Math/Frustum.h>
+#include <Magnum/Math/Intersection.h>
+#include <Magnum/SceneGraph/AbstractFeature.h>
+#include <Magnum/SceneGraph/AbstractObject.h>
+#include <Magnum/SceneGraph/Camera.h>
+
+#include "Oberon/FrustumCulling.h"
+#include "Oberon/PhongShader.h"
+
+namespace Oberon {
+
+namespace {
+
+/* Columns of the transformation and the normal matrix */
+constexpr std::size_t TexelsPerInstance = 7;
+
+}
+
+/* Attached to the object of a member, takes it out once it moves and
+   forgets it once it's destroyed */
+class InstancedDrawable::Tracker: public SceneGraph::AbstractFeature3D {
+    public:
+        explicit Tracker(SceneGraph::AbstractObject3D& object, InstancedDrawable& instances, UnsignedInt id): SceneGraph::AbstractFeature3D{object}, _instances(instances), _id{id} {
+            setCachedTransformations(SceneGraph::CachedTransformation::Absolute);
+        }
+
+        ~Tracker() {
+            _instances._members[_id].drawable = nullptr;
+            _instances._members[_id].tracker = nullptr;
+            _instances._dirty = true;
+        }
+
+    private:
+        /* The member gets drawn by its own drawable from now on, the
+           tracker stays until the object is destroyed */
+        void markDirty() override {
+            if(_instances._members[_id].drawable) _instances.release(_id);
+        }
+
+        InstancedDrawable& _instances;
+        UnsignedInt _id;
+};
+
+InstancedDrawable::InstancedDrawable(SceneGraph::AbstractObject3D& object, PhongShader& shader, Containers::Array<PhongDrawable*>&& members, const Range3D& box, SceneGraph::DrawableGroup3D& group): PhongDrawable{object, shader, *members[0], members[0]->mesh(), group} {
+    const PhongDrawable& first = *members[0];
+    setResidencyEntries(first.meshEntry(), first.diffuseTextureEntry(), first.normalTextureEntry());
+    if(!first.lods().empty())
+        setLods(first.lods(), first.lodBounds(), first.lodPixelError());
+
+    /* The member transformations are baked in, the objects are cleaned
+       first so only a later move notifies the tracker */
+    for(PhongDrawable* member: members) {
+        member->object().setClean();
+        const Matrix4 absoluteTransformation = member->object().absoluteTransformationMatrix();
+        const Range3D memberBox = FrustumCulling::transform(box, absoluteTransformation);
+        _box = _members.empty() ? memberBox : Math::join(_box, memberBox);
+        arrayAppend(_members, Containers::InPlaceInit, member, nullptr, absoluteTransformation, memberBox, false);
+        group.remove(*member);
+    }
+
+    /* Once the array doesn't grow anymore */
+    for(UnsignedInt i = 0; i != _members.size(); ++i)
+        _members[i].tracker = new Tracker{_members[i].drawable->object(), *this, i};
+
+    _texture.setBuffer(GL::BufferTextureFormat::RGBA32F, _buffer);
+}
+
+InstancedDrawable::~InstancedDrawable() {
+    /* Objects of the members that are still alive outlive this */
+    for(Member& member: _members)
+        delete member.tracker;
+}
+
+bool InstancedDrawable::release(const SceneGraph::AbstractObject3D& object) {
+    for(UnsignedInt i = 0; i != _members.size(); ++i) {
+        if(!_members[i].drawable || &_members[i].drawable->object() != &object)
+            continue;
+
+        release(i);
+        return true;
+    }
+
+    return false;
+}
+
+void InstancedDrawable::release(const UnsignedInt id) {
+    drawables()->add(*_members[id].drawable);
+    _members[id].drawable = nullptr;
+    _dirty = true;
+}
+
+void InstancedDrawable::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
+    /* Marks the mesh as used, so it gets reloaded if it's evicted */
+    bind(transformationMatrix, camera);
+
+    /* Only the members inside the frustum are drawn. The nearest of them
+       decides the level of detail. */
+    const Frustum frustum = Frustum::fromMatrix(camera.projectionMatrix()*camera.cameraMatrix());
+    const Member* nearest{};
+    Float nearestDistance{};
+    for(Member& member: _members) {
+        const bool visible = member.drawable && Math::Intersection::aabbFrustum(
+            member.box.center(), Vector3{member.box.size()*0.5f}, frustum);
+        if(visible != member.visible) {
+            member.visible = visible;
+            _dirty = true;
+        }
+        if(!visible) continue;
+
+        const Float distance = camera.cameraMatrix().transformPoint(member.box.center()).dot();
+        if(!nearest || distance < nearestDistance) {
+            nearest = &member;
+            nearestDistance = distance;
+        }
+    }
+
+    if(_dirty) {
+        arrayResize(_data, 0);
+        for(const Member& member: _members) {
+            if(!member.visible) continue;
+
+            const Matrix4 transformation = member.absoluteTransformation*member.drawable->meshTransformation();
+            const Matrix3x3 normalMatrix = member.absoluteTransformation.normalMatrix();
+            const Vector4 texels[]{
+                transformation[0], transformation[1],
+                transformation[2], transformation[3],
+                Vector4{normalMatrix[0], 0.0f},
+                Vector4{normalMatrix[1], 0.0f},
+                Vector4{normalMatrix[2], 0.0f}};
+            arrayAppend(_data, texels);
+        }
+        _instanceCount = _data.size()/TexelsPerInstance;
+        if(_instanceCount) _buffer.setData(_data, GL::BufferUsage::DynamicDraw);
+        _dirty = false;
+    }
+
+    /* The fallback used until the mesh is uploaded has no indices */
+    if(!_instanceCount || !_mesh->isIndexed()) return;
+
+    GL::MeshView view{*_mesh};
+    if(_lods.empty()) view
+        .setCount(_mesh->count())
+        .setIndexRange(0);
+    else {
+        const UnsignedInt lod = selectLod(camera.cameraMatrix()*nearest->absoluteTransformation, camera);
+        view.setCount(_lods[lod].indexCount)
+            .setIndexRange(_lods[lod].indexOffset);
+    }
+    view.setInstanceCount(_instanceCount);
+
+    _shader.bindInstanceData(_texture)
+        .draw(view);
+}
+
+}
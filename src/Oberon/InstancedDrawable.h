@@ -0,0 +1,84 @@
+#ifndef Oberon_InstancedDrawable_h
+#define Oberon_InstancedDrawable_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Array.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/BufferTexture.h>
+#include <Magnum/Math/Range.h>
+
+#include "Oberon/PhongDrawable.h"
+
+namespace Oberon {
+
+/* Draws objects sharing a mesh and a material with one instanced draw, with
+   the material of the first member. The transformations of the members
+   inside the frustum are in a buffer texture, uploaded only when that set
+   changes. */
+class InstancedDrawable: public PhongDrawable {
+    public:
+        /* The member drawables are removed from the group as this draws
+           them instead. The shader is the variant of theirs with
+           PhongShader::Flag::InstancedTransformation, the box the bounding
+           box of the mesh. */
+        explicit InstancedDrawable(SceneGraph::AbstractObject3D& object, PhongShader& shader, Containers::Array<PhongDrawable*>&& members, const Range3D& box, SceneGraph::DrawableGroup3D& group);
+
+        ~InstancedDrawable();
+
+        /* Bounding box of all members in the scene */
+        const Range3D& box() const { return _box; }
+
+        /* Takes the object out and puts its own drawable back to the group,
+           so it can be edited. Objects that move are taken out on their
+           own. Returns false if it isn't a member. */
+        bool release(const SceneGraph::AbstractObject3D& object);
+
+    private:
+        class Tracker;
+
+        struct Member {
+            PhongDrawable* drawable;
+            Tracker* tracker;
+            Matrix4 absoluteTransformation;
+            Range3D box;
+            bool visible;
+        };
+
+        void draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) override;
+
+        void release(UnsignedInt id);
+
+        Containers::Array<Member> _members;
+        Range3D _box;
+        GL::Buffer _buffer;
+        GL::BufferTexture _texture;
+        Containers::Array<Vector4> _data;
+        UnsignedInt _instanceCount{};
+        bool _dirty{true};
+};
+
+}
+
+#endif
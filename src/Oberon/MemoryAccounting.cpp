@@ -0,0 +1,107 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "MemoryAccounting.h"
+
+#include <algorithm>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+
+#include "Oberon/PhongDrawable.h"
+#include "Oberon/SceneData.h"
+
+namespace Oberon {
+
+void MemoryAccounting::addTexture(Texture&& texture) {
+    arrayAppend(_textures, std::move(texture));
+}
+
+void MemoryAccounting::addMesh(Mesh&& mesh) {
+    arrayAppend(_meshes, std::move(mesh));
+}
+
+MemoryAccounting::Report MemoryAccounting::report(const SceneData& data) const {
+    Report report{};
+
+    for(const Texture& texture: _textures) {
+        const ResidencyManager::Entry* entry = data.residency.find(texture.key);
+        arrayAppend(report.textures, texture).residentSize = entry ? entry->residentSize : 0;
+        report.textureSize += texture.byteSize;
+    }
+
+    for(const Mesh& mesh: _meshes) {
+        const ResidencyManager::Entry* entry = data.residency.find(mesh.key);
+        arrayAppend(report.meshes, mesh).residentSize = entry ? entry->residentSize : 0;
+        report.meshSize += mesh.vertexSize + mesh.indexSize;
+    }
+
+    /* Only drivers that can give back the binary know its size */
+    const bool hasBinary = GL::Context::current().isExtensionSupported<GL::Extensions::ARB::get_program_binary>();
+    for(const Containers::Pointer<PhongShader>& shader: data.shaderRegistry.phongShaders()) {
+        GLint size{};
+        if(hasBinary)
+            glGetProgramiv(shader->id(), GL_PROGRAM_BINARY_LENGTH, &size);
+        arrayAppend(report.shaders, Shader{shader->flags(), shader->lightCount(), std::size_t(size)});
+        report.shaderSize += size;
+    }
+
+    for(UnsignedInt i = 0; i != data.objects.size(); ++i) {
+        SceneGraph::AbstractFeature3D* feature = data.objects[i].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
+        if(!feature) continue;
+
+        Object object{i, data.objects[i].name, 0, 0, 0};
+        const PhongDrawable& drawable = static_cast<const PhongDrawable&>(*feature);
+        if(const ResidencyManager::Entry* mesh = drawable.meshEntry()) {
+            object.meshSize += mesh->size;
+            object.residentSize += mesh->residentSize;
+        }
+        for(const ResidencyManager::Entry* texture: {drawable.diffuseTextureEntry(), drawable.normalTextureEntry()}) {
+            if(!texture) continue;
+            object.textureSize += texture->size;
+            object.residentSize += texture->residentSize;
+        }
+        arrayAppend(report.objects, std::move(object));
+    }
+
+    report.sharing = data.contentRegistry.statistics();
+
+    std::sort(report.textures.begin(), report.textures.end(), [](const Texture& a, const Texture& b) {
+        return a.byteSize > b.byteSize;
+    });
+    std::sort(report.meshes.begin(), report.meshes.end(), [](const Mesh& a, const Mesh& b) {
+        return a.vertexSize + a.indexSize > b.vertexSize + b.indexSize;
+    });
+    std::sort(report.shaders.begin(), report.shaders.end(), [](const Shader& a, const Shader& b) {
+        return a.byteSize > b.byteSize;
+    });
+    std::sort(report.objects.begin(), report.objects.end(), [](const Object& a, const Object& b) {
+        return a.meshSize + a.textureSize > b.meshSize + b.textureSize;
+    });
+
+    return report;
+}
+
+}
@@ -0,0 +1,108 @@
+#ifndef Oberon_MemoryAccounting_h
+#define Oberon_MemoryAccounting_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <Corrade/Containers/Array.h>
+#include <Magnum/Math/Vector2.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/ContentRegistry.h"
+#include "Oberon/MeshOptimizer.h"
+#include "Oberon/PhongShader.h"
+
+namespace Oberon {
+
+/* Records the size of every mesh and texture uploaded for a scene, so it's
+   possible to tell which resources and objects take the most memory */
+class MemoryAccounting {
+    public:
+        struct Texture {
+            std::string key;
+            /* Texture ID in the file */
+            UnsignedInt id;
+            Vector2i size;
+            UnsignedInt levelCount;
+            std::string format;
+            /* Size with all levels and the size currently on the GPU */
+            std::size_t byteSize, residentSize;
+        };
+
+        struct Mesh {
+            std::string key;
+            /* Mesh ID in the file */
+            UnsignedInt id;
+            UnsignedInt vertexCount, indexCount;
+            std::size_t vertexSize, indexSize, residentSize;
+            /* Zero if the mesh wasn't optimized */
+            MeshOptimizer::Statistics optimization;
+        };
+
+        struct Shader {
+            PhongShader::Flags flags;
+            UnsignedInt lightCount;
+            /* Size of the linked program binary, zero if the driver can't
+               tell */
+            std::size_t byteSize;
+        };
+
+        struct Object {
+            UnsignedInt id;
+            std::string name;
+            /* Sizes of the mesh and textures the object draws with. Shared
+               resources are counted for every object using them. */
+            std::size_t meshSize, textureSize, residentSize;
+        };
+
+        /* Everything sorted by size, largest first */
+        struct Report {
+            Containers::Array<Texture> textures;
+            Containers::Array<Mesh> meshes;
+            Containers::Array<Shader> shaders;
+            Containers::Array<Object> objects;
+
+            std::size_t textureSize, meshSize, shaderSize;
+
+            /* Meshes and textures that weren't uploaded as an identical one
+               already was */
+            ContentRegistry::Statistics sharing;
+        };
+
+        /* The resident size is filled in by report() */
+        void addTexture(Texture&& texture);
+        void addMesh(Mesh&& mesh);
+
+        /* Queries the shader program sizes, so the GL context has to be
+           current */
+        Report report(const SceneData& data) const;
+
+    private:
+        Containers::Array<Texture> _textures;
+        Containers::Array<Mesh> _meshes;
+};
+
+}
+
+#endif
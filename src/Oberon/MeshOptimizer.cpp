@@ -0,0 +1,347 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "MeshOptimizer.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/MeshTools/Interleave.h>
+#include <Magnum/Trade/MeshData.h>
+
+namespace Oberon { namespace MeshOptimizer {
+
+namespace {
+
+/* Parameters of the vertex scoring, as suggested by the original article */
+constexpr UnsignedInt CacheSize = 32;
+constexpr Float CacheDecayPower = 1.5f;
+constexpr Float LastTriangleScore = 0.75f;
+constexpr Float ValenceBoostScale = 2.0f;
+constexpr Float ValenceBoostPower = 0.5f;
+
+Float vertexScore(Int cachePosition, UnsignedInt remainingTriangles) {
+    /* No triangle needs the vertex anymore */
+    if(!remainingTriangles) return -1.0f;
+
+    Float score = 0.0f;
+    if(cachePosition >= 0) {
+        /* Vertices of the last triangle get a fixed score, so it doesn't
+           matter in which order they were added */
+        if(cachePosition < 3) score = LastTriangleScore;
+        else score = std::pow(1.0f - Float(cachePosition - 3)/(CacheSize - 3), CacheDecayPower);
+    }
+
+    /* Prefer vertices with few triangles left, so they don't get stranded */
+    return score + ValenceBoostScale*std::pow(Float(remainingTriangles), -ValenceBoostPower);
+}
+
+}
+
+Float averageCacheMissRatio(const Containers::ArrayView<const UnsignedInt> indices, const UnsignedInt vertexCount, const UnsignedInt cacheSize) {
+    if(indices.size() < 3) return 0.0f;
+
+    /* Timestamp of when each vertex entered the cache, a vertex is in the
+       cache if it entered less than cacheSize misses ago */
+    Containers::Array<UnsignedInt> timestamps{Containers::ValueInit, vertexCount};
+    UnsignedInt time = cacheSize + 1;
+    UnsignedInt misses = 0;
+    for(UnsignedInt index: indices) {
+        if(time - timestamps[index] > cacheSize) {
+            timestamps[index] = time++;
+            ++misses;
+        }
+    }
+
+    return Float(misses)/(indices.size()/3);
+}
+
+void optimizeVertexCache(const Containers::ArrayView<UnsignedInt> indices, const UnsignedInt vertexCount) {
+    const UnsignedInt triangleCount = indices.size()/3;
+    if(!triangleCount) return;
+
+    /* List of triangles using each vertex. The first remaining[i] of them
+       are the ones not emitted yet. */
+    Containers::Array<UnsignedInt> offsets{Containers::ValueInit, vertexCount + 1};
+    for(UnsignedInt index: indices) ++offsets[index + 1];
+    for(UnsignedInt i = 0; i != vertexCount; ++i) offsets[i + 1] += offsets[i];
+
+    Containers::Array<UnsignedInt> remaining{Containers::NoInit, vertexCount};
+    for(UnsignedInt i = 0; i != vertexCount; ++i)
+        remaining[i] = offsets[i + 1] - offsets[i];
+
+    Containers::Array<UnsignedInt> vertexTriangles{Containers::NoInit, indices.size()};
+    {
+        Containers::Array<UnsignedInt> fill{Containers::NoInit, vertexCount};
+        for(UnsignedInt i = 0; i != vertexCount; ++i) fill[i] = offsets[i];
+        for(UnsignedInt i = 0; i != indices.size(); ++i)
+            vertexTriangles[fill[indices[i]]++] = i/3;
+    }
+
+    Containers::Array<Int> cachePositions{Containers::DirectInit, vertexCount, -1};
+    Containers::Array<Float> vertexScores{Containers::NoInit, vertexCount};
+    for(UnsignedInt i = 0; i != vertexCount; ++i)
+        vertexScores[i] = vertexScore(-1, remaining[i]);
+
+    Containers::Array<Float> triangleScores{Containers::NoInit, triangleCount};
+    Containers::Array<bool> emitted{Containers::ValueInit, triangleCount};
+    UnsignedInt bestTriangle = 0;
+    for(UnsignedInt i = 0; i != triangleCount; ++i) {
+        triangleScores[i] =
+            vertexScores[indices[i*3 + 0]] +
+            vertexScores[indices[i*3 + 1]] +
+            vertexScores[indices[i*3 + 2]];
+        if(triangleScores[i] > triangleScores[bestTriangle])
+            bestTriangle = i;
+    }
+
+    /* The cache has space for the three vertices of the emitted triangle
+       before the oldest ones are pushed out */
+    UnsignedInt cache[CacheSize + 3];
+    UnsignedInt newCache[CacheSize + 3];
+    UnsignedInt cacheCount = 0;
+
+    Containers::Array<UnsignedInt> out{Containers::NoInit, indices.size()};
+    UnsignedInt scanPosition = 0;
+    for(UnsignedInt emittedCount = 0; emittedCount != triangleCount; ++emittedCount) {
+        /* No triangle in the cache is usable, take the first remaining */
+        if(bestTriangle == ~UnsignedInt{}) {
+            while(emitted[scanPosition]) ++scanPosition;
+            bestTriangle = scanPosition;
+        }
+
+        const UnsignedInt* const triangle = indices.data() + bestTriangle*3;
+        std::memcpy(out.data() + emittedCount*3, triangle, 3*sizeof(UnsignedInt));
+        emitted[bestTriangle] = true;
+
+        /* Remove the triangle from the lists of remaining triangles */
+        for(UnsignedInt i = 0; i != 3; ++i) {
+            const UnsignedInt vertex = triangle[i];
+            UnsignedInt* const list = vertexTriangles.data() + offsets[vertex];
+            UnsignedInt* const found = std::find(list, list + remaining[vertex], bestTriangle);
+            std::swap(*found, list[--remaining[vertex]]);
+        }
+
+        /* The emitted triangle goes to the front of the cache, followed by
+           the rest in the previous order */
+        UnsignedInt newCacheCount = 0;
+        for(UnsignedInt i = 0; i != 3; ++i) newCache[newCacheCount++] = triangle[i];
+        for(UnsignedInt i = 0; i != cacheCount; ++i) {
+            const UnsignedInt vertex = cache[i];
+            if(vertex != triangle[0] && vertex != triangle[1] && vertex != triangle[2])
+                newCache[newCacheCount++] = vertex;
+        }
+
+        /* Update the scores of everything in the cache including the
+           vertices that just fell out of it */
+        for(UnsignedInt i = 0; i != newCacheCount; ++i) {
+            const UnsignedInt vertex = newCache[i];
+            cachePositions[vertex] = i < CacheSize ? Int(i) : -1;
+            vertexScores[vertex] = vertexScore(cachePositions[vertex], remaining[vertex]);
+        }
+
+        /* Update the scores of the affected triangles and pick the best one
+           for the next round */
+        bestTriangle = ~UnsignedInt{};
+        Float bestScore = -1.0f;
+        for(UnsignedInt i = 0; i != newCacheCount; ++i) {
+            const UnsignedInt vertex = newCache[i];
+            const UnsignedInt* const list = vertexTriangles.data() + offsets[vertex];
+            for(UnsignedInt j = 0; j != remaining[vertex]; ++j) {
+                const UnsignedInt t = list[j];
+                triangleScores[t] =
+                    vertexScores[indices[t*3 + 0]] +
+                    vertexScores[indices[t*3 + 1]] +
+                    vertexScores[indices[t*3 + 2]];
+                if(triangleScores[t] > bestScore) {
+                    bestScore = triangleScores[t];
+                    bestTriangle = t;
+                }
+            }
+        }
+
+        cacheCount = Math::min(newCacheCount, CacheSize);
+        std::memcpy(cache, newCache, cacheCount*sizeof(UnsignedInt));
+    }
+
+    std::memcpy(indices.data(), out.data(), indices.size()*sizeof(UnsignedInt));
+}
+
+void optimizeOverdraw(const Containers::ArrayView<UnsignedInt> indices, const Containers::StridedArrayView1D<const Vector3>& positions, const UnsignedInt cacheSize) {
+    const UnsignedInt triangleCount = indices.size()/3;
+    if(triangleCount < 2) return;
+
+    /* Simulate the cache and start a new cluster at every triangle that
+       misses all three vertices, as the order of such clusters can be
+       changed without affecting the cache efficiency */
+    struct Cluster {
+        UnsignedInt begin, end;
+        Float sortKey;
+    };
+    Containers::Array<Cluster> clusters;
+    {
+        Containers::Array<UnsignedInt> timestamps{Containers::ValueInit, positions.size()};
+        UnsignedInt time = cacheSize + 1;
+        for(UnsignedInt i = 0; i != triangleCount; ++i) {
+            UnsignedInt misses = 0;
+            for(UnsignedInt j = 0; j != 3; ++j) {
+                const UnsignedInt index = indices[i*3 + j];
+                if(time - timestamps[index] > cacheSize) {
+                    timestamps[index] = time++;
+                    ++misses;
+                }
+            }
+
+            if(i == 0 || misses == 3)
+                arrayAppend(clusters, Cluster{i, i + 1, 0.0f});
+            else clusters[clusters.size() - 1].end = i + 1;
+        }
+    }
+
+    if(clusters.size() < 2) return;
+
+    /* Area-weighted centroid and normal of each cluster and of the whole
+       mesh */
+    Containers::Array<Vector3> clusterCentroids{Containers::ValueInit, clusters.size()};
+    Containers::Array<Vector3> clusterNormals{Containers::ValueInit, clusters.size()};
+    Vector3 meshCentroid;
+    Float meshArea = 0.0f;
+    for(std::size_t i = 0; i != clusters.size(); ++i) {
+        Float clusterArea = 0.0f;
+        for(UnsignedInt t = clusters[i].begin; t != clusters[i].end; ++t) {
+            const Vector3 a = positions[indices[t*3 + 0]];
+            const Vector3 b = positions[indices[t*3 + 1]];
+            const Vector3 c = positions[indices[t*3 + 2]];
+            const Vector3 normal = Math::cross(b - a, c - a);
+            const Float area = normal.length();
+
+            clusterCentroids[i] += (a + b + c)*(area/3.0f);
+            clusterNormals[i] += normal;
+            clusterArea += area;
+        }
+
+        meshCentroid += clusterCentroids[i];
+        meshArea += clusterArea;
+        if(clusterArea > 0.0f) clusterCentroids[i] /= clusterArea;
+    }
+    if(meshArea > 0.0f) meshCentroid /= meshArea;
+
+    /* Clusters facing away from the center are likely to occlude the rest,
+       so draw them first */
+    for(std::size_t i = 0; i != clusters.size(); ++i) {
+        const Float normalLength = clusterNormals[i].length();
+        clusters[i].sortKey = normalLength > 0.0f ?
+            Math::dot(clusterCentroids[i] - meshCentroid, clusterNormals[i]/normalLength) : 0.0f;
+    }
+
+    std::stable_sort(clusters.begin(), clusters.end(), [](const Cluster& a, const Cluster& b) {
+        return a.sortKey > b.sortKey;
+    });
+
+    Containers::Array<UnsignedInt> out{Containers::NoInit, triangleCount*3};
+    UnsignedInt offset = 0;
+    for(const Cluster& cluster: clusters) {
+        const UnsignedInt size = (cluster.end - cluster.begin)*3;
+        std::memcpy(out.data() + offset, indices.data() + cluster.begin*3, size*sizeof(UnsignedInt));
+        offset += size;
+    }
+
+    std::memcpy(indices.data(), out.data(), out.size()*sizeof(UnsignedInt));
+}
+
+Containers::Array<UnsignedInt> optimizeVertexFetch(const Containers::ArrayView<UnsignedInt> indices, const UnsignedInt vertexCount) {
+    Containers::Array<UnsignedInt> remap{Containers::DirectInit, vertexCount, ~UnsignedInt{}};
+    UnsignedInt next = 0;
+    for(UnsignedInt& index: indices) {
+        if(remap[index] == ~UnsignedInt{}) remap[index] = next++;
+        index = remap[index];
+    }
+
+    for(UnsignedInt& i: remap)
+        if(i == ~UnsignedInt{}) i = next++;
+
+    return remap;
+}
+
+Trade::MeshData optimize(Trade::MeshData&& mesh, Statistics* const statistics) {
+    if(mesh.primitive() != MeshPrimitive::Triangles || !mesh.isIndexed() ||
+       !mesh.hasAttribute(Trade::MeshAttribute::Position) ||
+       !mesh.vertexCount() || mesh.indexCount() < 3)
+        return std::move(mesh);
+
+    const UnsignedInt vertexCount = mesh.vertexCount();
+    Containers::Array<UnsignedInt> indices = mesh.indicesAsArray();
+    const Float acmrBefore = averageCacheMissRatio(indices, vertexCount);
+
+    optimizeVertexCache(indices, vertexCount);
+    {
+        const Containers::Array<Vector3> positions = mesh.positions3DAsArray();
+        optimizeOverdraw(indices, Containers::stridedArrayView(Containers::arrayView(positions)));
+    }
+    const Containers::Array<UnsignedInt> remap = optimizeVertexFetch(indices, vertexCount);
+
+    if(statistics) {
+        statistics->acmrBefore = acmrBefore;
+        statistics->acmrAfter = averageCacheMissRatio(indices, vertexCount);
+    }
+
+    /* With the vertices interleaved, remapping them is just moving whole
+       rows around. The bytes outside of the rows are kept as they were. */
+    const Trade::MeshData interleaved = MeshTools::interleave(std::move(mesh));
+    const Containers::ArrayView<const char> vertexData = interleaved.vertexData();
+    std::size_t begin = vertexData.size();
+    for(UnsignedInt i = 0; i != interleaved.attributeCount(); ++i)
+        begin = Math::min(begin, interleaved.attributeOffset(i));
+    const std::size_t stride = interleaved.attributeStride(0);
+
+    Containers::Array<char> outVertexData{Containers::NoInit, vertexData.size()};
+    std::memcpy(outVertexData.data(), vertexData.data(), vertexData.size());
+    for(UnsignedInt i = 0; i != vertexCount; ++i) {
+        const std::size_t from = begin + i*stride;
+        const std::size_t to = begin + remap[i]*stride;
+        const std::size_t size = Math::min(stride, vertexData.size() - Math::max(from, to));
+        std::memcpy(outVertexData.data() + to, vertexData.data() + from, size);
+    }
+
+    Containers::Array<Trade::MeshAttributeData> attributes{interleaved.attributeCount()};
+    for(UnsignedInt i = 0; i != interleaved.attributeCount(); ++i)
+        attributes[i] = Trade::MeshAttributeData{
+            interleaved.attributeName(i), interleaved.attributeFormat(i),
+            Containers::StridedArrayView1D<const void>{Containers::arrayView(outVertexData),
+                outVertexData.data() + interleaved.attributeOffset(i),
+                vertexCount, interleaved.attributeStride(i)},
+            interleaved.attributeArraySize(i)};
+
+    Containers::Array<char> indexData{Containers::NoInit, indices.size()*sizeof(UnsignedInt)};
+    std::memcpy(indexData.data(), indices.data(), indexData.size());
+    const Trade::MeshIndexData indexView{Containers::arrayCast<const UnsignedInt>(Containers::arrayView(indexData))};
+
+    return Trade::MeshData{MeshPrimitive::Triangles,
+        std::move(indexData), indexView,
+        std::move(outVertexData), std::move(attributes), vertexCount};
+}
+
+}}
@@ -0,0 +1,67 @@
+#ifndef Oberon_MeshOptimizer_h
+#define Oberon_MeshOptimizer_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon { namespace MeshOptimizer {
+
+struct Statistics {
+    /* Average cache miss ratio before and after the optimization */
+    Float acmrBefore, acmrAfter;
+};
+
+/* Vertex shader invocations per triangle with a FIFO post-transform cache
+   of given size. 3 is the worst case, around 0.5 the optimum for large
+   regular meshes. */
+Float averageCacheMissRatio(Containers::ArrayView<const UnsignedInt> indices, UnsignedInt vertexCount, UnsignedInt cacheSize = 16);
+
+/* Reorders triangles for post-transform vertex cache efficiency, using Tom
+   Forsyth's linear-speed vertex cache optimisation */
+void optimizeVertexCache(Containers::ArrayView<UnsignedInt> indices, UnsignedInt vertexCount);
+
+/* Splits the triangles into clusters at points where the cache gets
+   flushed and sorts the clusters so ones facing outwards are drawn first,
+   which reduces overdraw without hurting the cache efficiency much.
+   Expects the indices to be optimized for the vertex cache already. */
+void optimizeOverdraw(Containers::ArrayView<UnsignedInt> indices, const Containers::StridedArrayView1D<const Vector3>& positions, UnsignedInt cacheSize = 16);
+
+/* Renumbers the vertices in the order they're first referenced, so the
+   vertex fetch goes through memory linearly. Returns the new index of
+   every vertex, unreferenced vertices are put at the end. */
+Containers::Array<UnsignedInt> optimizeVertexFetch(Containers::ArrayView<UnsignedInt> indices, UnsignedInt vertexCount);
+
+/* Runs all of the above on an indexed triangle mesh, with the vertex data
+   interleaved in the result. Other meshes are returned unchanged. */
+Trade::MeshData optimize(Trade::MeshData&& mesh, Statistics* statistics = nullptr);
+
+}}
+
+#endif
@@ -0,0 +1,190 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "MeshQuantization.h"
+
+#include <cmath>
+#include <cstring>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/VertexFormat.h>
+#include <Magnum/Math/Packing.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Trade/MeshData.h>
+
+namespace Oberon { namespace MeshQuantization {
+
+namespace {
+
+template<class T> T packSigned(Float value, Float max) {
+    return T(std::round(Math::clamp(value, -1.0f, 1.0f)*max));
+}
+
+/* Quantized format of given attribute, or the original one if the
+   attribute is left as is */
+VertexFormat quantizedFormat(Trade::MeshAttribute name, VertexFormat format) {
+    switch(name) {
+        case Trade::MeshAttribute::Position:
+            if(format == VertexFormat::Vector3) return VertexFormat::Vector3sNormalized;
+            break;
+        case Trade::MeshAttribute::Normal:
+        case Trade::MeshAttribute::Bitangent:
+            if(format == VertexFormat::Vector3) return VertexFormat::Vector3bNormalized;
+            break;
+        case Trade::MeshAttribute::Tangent:
+            if(format == VertexFormat::Vector3) return VertexFormat::Vector3bNormalized;
+            if(format == VertexFormat::Vector4) return VertexFormat::Vector4bNormalized;
+            break;
+        case Trade::MeshAttribute::TextureCoordinates:
+            if(format == VertexFormat::Vector2) return VertexFormat::Vector2h;
+            break;
+        case Trade::MeshAttribute::Color:
+            if(format == VertexFormat::Vector3) return VertexFormat::Vector3ubNormalized;
+            if(format == VertexFormat::Vector4) return VertexFormat::Vector4ubNormalized;
+            break;
+        default: break;
+    }
+
+    return format;
+}
+
+}
+
+Trade::MeshData quantize(Trade::MeshData&& mesh, Matrix4& dequantization) {
+    dequantization = Matrix4{};
+
+    /* Attributes in implementation-specific formats or arrays can't be
+       sized, leave such meshes alone */
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i)
+        if(isVertexFormatImplementationSpecific(mesh.attributeFormat(i)) ||
+           mesh.attributeArraySize(i))
+            return std::move(mesh);
+
+    /* Every attribute is four-byte aligned, as some drivers are slow with
+       anything else */
+    const UnsignedInt vertexCount = mesh.vertexCount();
+    Containers::Array<VertexFormat> formats{Containers::NoInit, mesh.attributeCount()};
+    Containers::Array<std::size_t> offsets{Containers::NoInit, mesh.attributeCount()};
+    std::size_t stride = 0;
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i) {
+        formats[i] = quantizedFormat(mesh.attributeName(i), mesh.attributeFormat(i));
+        offsets[i] = stride;
+        stride += (vertexFormatSize(formats[i]) + 3)/4*4;
+    }
+
+    /* Positions are stored relative to the bounding box, which gets mapped
+       to the [-1, 1] range */
+    if(mesh.hasAttribute(Trade::MeshAttribute::Position) &&
+       mesh.attributeFormat(Trade::MeshAttribute::Position) == VertexFormat::Vector3 &&
+       vertexCount) {
+        const Containers::StridedArrayView1D<const Vector3> positions = mesh.attribute<Vector3>(Trade::MeshAttribute::Position);
+        Range3D bounds{positions[0], positions[0]};
+        for(const Vector3& position: positions)
+            bounds = Math::join(bounds, Range3D{position, position});
+
+        const Vector3 halfSize = Math::max(bounds.size()*0.5f, Vector3{1.0e-6f});
+        dequantization = Matrix4::translation(bounds.center())*Matrix4::scaling(halfSize);
+    }
+    const Matrix4 quantization = dequantization.inverted();
+
+    Containers::Array<char> vertexData{Containers::ValueInit, stride*vertexCount};
+    Containers::Array<Trade::MeshAttributeData> attributes{mesh.attributeCount()};
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i) {
+        const VertexFormat format = mesh.attributeFormat(i);
+        char* const out = vertexData.data() + offsets[i];
+
+        /* Attributes that weren't quantized are copied as they are */
+        if(formats[i] == format) {
+            const Containers::StridedArrayView2D<const char> in = mesh.attribute(i);
+            const std::size_t size = vertexFormatSize(format);
+            for(UnsignedInt j = 0; j != vertexCount; ++j)
+                std::memcpy(out + j*stride, in[j].data(), size);
+
+        } else if(formats[i] == VertexFormat::Vector3sNormalized) {
+            const Containers::StridedArrayView1D<const Vector3> in = mesh.attribute<Vector3>(i);
+            for(UnsignedInt j = 0; j != vertexCount; ++j) {
+                const Vector3 position = quantization.transformPoint(in[j]);
+                Short* const o = reinterpret_cast<Short*>(out + j*stride);
+                for(std::size_t k = 0; k != 3; ++k)
+                    o[k] = packSigned<Short>(position[k], 32767.0f);
+            }
+
+        } else if(formats[i] == VertexFormat::Vector3bNormalized) {
+            const Containers::StridedArrayView1D<const Vector3> in = mesh.attribute<Vector3>(i);
+            for(UnsignedInt j = 0; j != vertexCount; ++j) {
+                Byte* const o = reinterpret_cast<Byte*>(out + j*stride);
+                for(std::size_t k = 0; k != 3; ++k)
+                    o[k] = packSigned<Byte>(in[j][k], 127.0f);
+            }
+
+        } else if(formats[i] == VertexFormat::Vector4bNormalized) {
+            const Containers::StridedArrayView1D<const Vector4> in = mesh.attribute<Vector4>(i);
+            for(UnsignedInt j = 0; j != vertexCount; ++j) {
+                Byte* const o = reinterpret_cast<Byte*>(out + j*stride);
+                for(std::size_t k = 0; k != 4; ++k)
+                    o[k] = packSigned<Byte>(in[j][k], 127.0f);
+            }
+
+        } else if(formats[i] == VertexFormat::Vector2h) {
+            const Containers::StridedArrayView1D<const Vector2> in = mesh.attribute<Vector2>(i);
+            for(UnsignedInt j = 0; j != vertexCount; ++j) {
+                UnsignedShort* const o = reinterpret_cast<UnsignedShort*>(out + j*stride);
+                o[0] = Math::packHalf(in[j].x());
+                o[1] = Math::packHalf(in[j].y());
+            }
+
+        } else if(formats[i] == VertexFormat::Vector3ubNormalized ||
+                  formats[i] == VertexFormat::Vector4ubNormalized) {
+            const std::size_t componentCount = format == VertexFormat::Vector4 ? 4 : 3;
+            const Containers::StridedArrayView2D<const char> in = mesh.attribute(i);
+            for(UnsignedInt j = 0; j != vertexCount; ++j) {
+                const Float* const color = static_cast<const Float*>(in[j].data());
+                UnsignedByte* const o = reinterpret_cast<UnsignedByte*>(out + j*stride);
+                for(std::size_t k = 0; k != componentCount; ++k)
+                    o[k] = UnsignedByte(std::round(Math::clamp(color[k], 0.0f, 1.0f)*255.0f));
+            }
+        }
+
+        attributes[i] = Trade::MeshAttributeData{mesh.attributeName(i),
+            formats[i], Containers::StridedArrayView1D<const void>{Containers::arrayView(vertexData),
+                out, vertexCount, std::ptrdiff_t(stride)}};
+    }
+
+    /* The indices are copied as well, as the original data may be
+       non-owned */
+    if(mesh.isIndexed()) {
+        Containers::Array<char> indexData{Containers::NoInit, mesh.indexData().size()};
+        std::memcpy(indexData.data(), mesh.indexData().data(), indexData.size());
+        const Trade::MeshIndexData indices{mesh.indexType(),
+            indexData.slice(mesh.indexOffset(), mesh.indexOffset() +
+                mesh.indexCount()*meshIndexTypeSize(mesh.indexType()))};
+        return Trade::MeshData{mesh.primitive(), std::move(indexData), indices,
+            std::move(vertexData), std::move(attributes), vertexCount};
+    }
+
+    return Trade::MeshData{mesh.primitive(), std::move(vertexData),
+        std::move(attributes), vertexCount};
+}
+
+}}
@@ -0,0 +1,50 @@
+#ifndef Oberon_MeshQuantization_h
+#define Oberon_MeshQuantization_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon { namespace MeshQuantization {
+
+/* Converts the mesh to compact vertex formats, roughly halving the vertex
+   size:
+
+   - positions to normalized shorts relative to the mesh bounds
+   - normals, tangents and bitangents to normalized bytes
+   - texture coordinates to half-floats
+   - colors to normalized unsigned bytes
+
+   Every attribute is padded to four bytes. The positions have to be
+   transformed with the dequantization matrix to get the original ones
+   back, normals are unaffected by it. Attributes in other formats are kept
+   as they are, the indices are not touched. */
+Trade::MeshData quantize(Trade::MeshData&& mesh, Matrix4& dequantization);
+
+}}
+
+#endif
@@ -0,0 +1,338 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "MeshSimplifier.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <queue>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/MeshTools/Interleave.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/MeshOptimizer.h"
+
+namespace Oberon { namespace MeshSimplifier {
+
+namespace {
+
+/* A level has to have at most this fraction of the previous one's
+   triangles to be worth keeping */
+constexpr Float MinimalLevelReduction = 0.9f;
+
+/* Area-weighted sum of squared distances to a set of planes as a
+   symmetric 4x4 matrix together with the total area. Doubles, as the sums
+   of many planes lose precision quickly. */
+struct Quadric {
+    Double a00, a01, a02, a03, a11, a12, a13, a22, a23, a33, area;
+};
+
+Quadric planeQuadric(const Vector3d& normal, const Double distance, const Double area) {
+    return Quadric{
+        area*normal.x()*normal.x(), area*normal.x()*normal.y(), area*normal.x()*normal.z(), area*normal.x()*distance,
+        area*normal.y()*normal.y(), area*normal.y()*normal.z(), area*normal.y()*distance,
+        area*normal.z()*normal.z(), area*normal.z()*distance,
+        area*distance*distance, area};
+}
+
+Quadric operator+(const Quadric& a, const Quadric& b) {
+    return Quadric{
+        a.a00 + b.a00, a.a01 + b.a01, a.a02 + b.a02, a.a03 + b.a03,
+        a.a11 + b.a11, a.a12 + b.a12, a.a13 + b.a13,
+        a.a22 + b.a22, a.a23 + b.a23,
+        a.a33 + b.a33, a.area + b.area};
+}
+
+/* Mean squared distance of the point to the planes */
+Double evaluate(const Quadric& q, const Vector3d& p) {
+    if(q.area == 0.0) return 0.0;
+
+    const Double x = p.x(), y = p.y(), z = p.z();
+    /* Rounding can make it slightly negative */
+    return Math::max(
+        q.a00*x*x + 2.0*q.a01*x*y + 2.0*q.a02*x*z + 2.0*q.a03*x +
+        q.a11*y*y + 2.0*q.a12*y*z + 2.0*q.a13*y +
+        q.a22*z*z + 2.0*q.a23*z +
+        q.a33, 0.0)/q.area;
+}
+
+struct Collapse {
+    Double cost;
+    UnsignedInt from, to;
+
+    /* For a min-heap in std::priority_queue */
+    bool operator<(const Collapse& other) const { return cost > other.cost; }
+};
+
+bool samePosition(const Vector3& a, const Vector3& b) {
+    return a.x() == b.x() && a.y() == b.y() && a.z() == b.z();
+}
+
+}
+
+UnsignedInt simplify(const Containers::ArrayView<UnsignedInt> indices, const Containers::StridedArrayView1D<const Vector3>& positions, const UnsignedInt targetIndexCount, Float& error) {
+    CORRADE_INTERNAL_ASSERT(indices.size() % 3 == 0);
+    error = 0.0f;
+    if(indices.size() <= targetIndexCount) return indices.size();
+
+    const UnsignedInt vertexCount = positions.size();
+    const UnsignedInt triangleCount = indices.size()/3;
+    const auto position = [&](UnsignedInt i) { return Vector3d{positions[i]}; };
+    const auto hasVertex = [&](UnsignedInt triangle, UnsignedInt vertex) {
+        return indices[triangle*3] == vertex || indices[triangle*3 + 1] == vertex || indices[triangle*3 + 2] == vertex;
+    };
+
+    /* Vertices sharing the position with another one are on a seam of
+       normals or texture coordinates, find them by sorting */
+    Containers::Array<bool> locked{Containers::ValueInit, vertexCount};
+    {
+        Containers::Array<UnsignedInt> order{Containers::NoInit, vertexCount};
+        for(UnsignedInt i = 0; i != vertexCount; ++i) order[i] = i;
+        std::sort(order.begin(), order.end(), [&](UnsignedInt a, UnsignedInt b) {
+            const Vector3& pa = positions[a];
+            const Vector3& pb = positions[b];
+            if(pa.x() != pb.x()) return pa.x() < pb.x();
+            if(pa.y() != pb.y()) return pa.y() < pb.y();
+            return pa.z() < pb.z();
+        });
+        for(UnsignedInt i = 1; i < vertexCount; ++i)
+            if(samePosition(positions[order[i]], positions[order[i - 1]]))
+                locked[order[i]] = locked[order[i - 1]] = true;
+    }
+
+    std::vector<std::vector<UnsignedInt>> vertexTriangles(vertexCount);
+    for(UnsignedInt i = 0; i != triangleCount; ++i)
+        for(UnsignedInt j = 0; j != 3; ++j)
+            vertexTriangles[indices[i*3 + j]].push_back(i);
+
+    /* Lock border vertices, which have an edge with just one triangle, and
+       vertices of degenerate triangles. Sum the planes of the triangles
+       around each vertex. */
+    Containers::Array<Quadric> quadrics{Containers::ValueInit, vertexCount};
+    for(UnsignedInt i = 0; i != triangleCount; ++i) {
+        const UnsignedInt* const t = indices.data() + i*3;
+        if(t[0] == t[1] || t[1] == t[2] || t[0] == t[2]) {
+            locked[t[0]] = locked[t[1]] = locked[t[2]] = true;
+            continue;
+        }
+
+        for(UnsignedInt j = 0; j != 3; ++j) {
+            const UnsignedInt a = t[j], b = t[(j + 1) % 3];
+            UnsignedInt count = 0;
+            for(const UnsignedInt other: vertexTriangles[a])
+                if(hasVertex(other, b)) ++count;
+            if(count == 1) locked[a] = locked[b] = true;
+        }
+
+        const Vector3d normal = Math::cross(position(t[1]) - position(t[0]), position(t[2]) - position(t[0]));
+        const Double length = normal.length();
+        if(length == 0.0) continue;
+        const Quadric q = planeQuadric(normal/length, -Math::dot(normal/length, position(t[0])), length*0.5);
+        for(UnsignedInt j = 0; j != 3; ++j)
+            quadrics[t[j]] = quadrics[t[j]] + q;
+    }
+
+    std::priority_queue<Collapse> queue;
+    const auto push = [&](UnsignedInt from, UnsignedInt to) {
+        if(!locked[from])
+            queue.push(Collapse{evaluate(quadrics[from] + quadrics[to], position(to)), from, to});
+    };
+    for(UnsignedInt i = 0; i != triangleCount*3; ++i) {
+        const UnsignedInt a = indices[i], b = indices[i - i % 3 + (i + 1) % 3];
+        if(a == b) continue;
+        push(a, b);
+        push(b, a);
+    }
+
+    Containers::Array<bool> removedTriangles{Containers::ValueInit, triangleCount};
+    Containers::Array<bool> removedVertices{Containers::ValueInit, vertexCount};
+    UnsignedInt remaining = triangleCount;
+    Double maxCost = 0.0;
+    std::vector<UnsignedInt> fromNeighbors, toNeighbors;
+    while(remaining*3 > targetIndexCount && !queue.empty()) {
+        const Collapse collapse = queue.top();
+        queue.pop();
+        const UnsignedInt from = collapse.from, to = collapse.to;
+        if(removedVertices[from] || removedVertices[to]) continue;
+
+        /* Outdated entries that got more expensive are pushed back with
+           the current cost */
+        const Double cost = evaluate(quadrics[from] + quadrics[to], position(to));
+        if(cost > collapse.cost) {
+            queue.push(Collapse{cost, from, to});
+            continue;
+        }
+
+        /* The edge may not exist anymore. The vertices also may not share
+           other neighbors than the ones across the shared triangles, as the
+           collapse would make the mesh non-manifold. */
+        fromNeighbors.clear();
+        toNeighbors.clear();
+        UnsignedInt sharedTriangles = 0;
+        for(const UnsignedInt triangle: vertexTriangles[from]) {
+            if(removedTriangles[triangle]) continue;
+            if(hasVertex(triangle, to)) ++sharedTriangles;
+            for(UnsignedInt j = 0; j != 3; ++j)
+                fromNeighbors.push_back(indices[triangle*3 + j]);
+        }
+        if(!sharedTriangles) continue;
+        for(const UnsignedInt triangle: vertexTriangles[to]) {
+            if(removedTriangles[triangle]) continue;
+            for(UnsignedInt j = 0; j != 3; ++j)
+                toNeighbors.push_back(indices[triangle*3 + j]);
+        }
+        std::sort(fromNeighbors.begin(), fromNeighbors.end());
+        fromNeighbors.erase(std::unique(fromNeighbors.begin(), fromNeighbors.end()), fromNeighbors.end());
+        std::sort(toNeighbors.begin(), toNeighbors.end());
+        toNeighbors.erase(std::unique(toNeighbors.begin(), toNeighbors.end()), toNeighbors.end());
+        UnsignedInt sharedNeighbors = 0;
+        for(const UnsignedInt neighbor: fromNeighbors)
+            if(neighbor != from && neighbor != to && std::binary_search(toNeighbors.begin(), toNeighbors.end(), neighbor))
+                ++sharedNeighbors;
+        if(sharedNeighbors > sharedTriangles) continue;
+
+        /* No triangle may flip over */
+        bool flips = false;
+        for(const UnsignedInt triangle: vertexTriangles[from]) {
+            if(removedTriangles[triangle] || hasVertex(triangle, to)) continue;
+            const UnsignedInt* const t = indices.data() + triangle*3;
+            const Vector3d before = Math::cross(position(t[1]) - position(t[0]), position(t[2]) - position(t[0]));
+            Vector3d p[3];
+            for(UnsignedInt j = 0; j != 3; ++j)
+                p[j] = position(t[j] == from ? to : t[j]);
+            const Vector3d after = Math::cross(p[1] - p[0], p[2] - p[0]);
+            if(Math::dot(before, after) <= 0.0) {
+                flips = true;
+                break;
+            }
+        }
+        if(flips) continue;
+
+        /* Triangles with both vertices disappear, the others get moved
+           over to the kept vertex */
+        for(const UnsignedInt triangle: vertexTriangles[from]) {
+            if(removedTriangles[triangle]) continue;
+            if(hasVertex(triangle, to)) {
+                removedTriangles[triangle] = true;
+                --remaining;
+                continue;
+            }
+
+            for(UnsignedInt j = 0; j != 3; ++j)
+                if(indices[triangle*3 + j] == from) indices[triangle*3 + j] = to;
+            vertexTriangles[to].push_back(triangle);
+        }
+        vertexTriangles[from] = {};
+        removedVertices[from] = true;
+        quadrics[to] = quadrics[from] + quadrics[to];
+        maxCost = Math::max(maxCost, cost);
+
+        /* Edges around the kept vertex have new costs */
+        for(const UnsignedInt triangle: vertexTriangles[to]) {
+            if(removedTriangles[triangle]) continue;
+            for(UnsignedInt j = 0; j != 3; ++j) {
+                const UnsignedInt neighbor = indices[triangle*3 + j];
+                if(neighbor == to) continue;
+                push(neighbor, to);
+                push(to, neighbor);
+            }
+        }
+    }
+
+    UnsignedInt out = 0;
+    for(UnsignedInt i = 0; i != triangleCount; ++i) {
+        if(removedTriangles[i]) continue;
+        for(UnsignedInt j = 0; j != 3; ++j)
+            indices[out++] = indices[i*3 + j];
+    }
+
+    error = Float(std::sqrt(maxCost));
+    return out;
+}
+
+Trade::MeshData generateLods(Trade::MeshData&& mesh, const UnsignedInt levelCount, const Float reduction, Containers::Array<Lod>& lods) {
+    lods = {};
+    if(!levelCount || mesh.primitive() != MeshPrimitive::Triangles ||
+       !mesh.isIndexed() || !mesh.hasAttribute(Trade::MeshAttribute::Position) ||
+       !mesh.vertexCount() || mesh.indexCount() < 3)
+        return std::move(mesh);
+
+    const UnsignedInt vertexCount = mesh.vertexCount();
+    const Containers::Array<Vector3> positions = mesh.positions3DAsArray();
+    Containers::Array<UnsignedInt> indices = mesh.indicesAsArray();
+    arrayAppend(lods, Lod{0, UnsignedInt(indices.size()), 0.0f});
+
+    /* Each level is simplified from the previous one, which is faster than
+       starting from the full mesh every time. The errors add up. */
+    Containers::Array<UnsignedInt> level{Containers::NoInit, indices.size()};
+    for(UnsignedInt i = 0; i != levelCount; ++i) {
+        const Lod previous = lods.back();
+        std::memcpy(level.data(), indices.data() + previous.indexOffset, previous.indexCount*sizeof(UnsignedInt));
+
+        const UnsignedInt target = UnsignedInt(previous.indexCount/3*reduction)*3;
+        Float error;
+        const UnsignedInt count = simplify(level.prefix(previous.indexCount),
+            Containers::stridedArrayView(Containers::arrayView(positions)),
+            target, error);
+        if(!count || count > previous.indexCount*MinimalLevelReduction)
+            break;
+
+        MeshOptimizer::optimizeVertexCache(level.prefix(count), vertexCount);
+        arrayAppend(lods, Lod{UnsignedInt(indices.size()), count, previous.error + error});
+        arrayAppend(indices, Containers::arrayView(level.prefix(count)));
+    }
+
+    if(lods.size() == 1) {
+        lods = {};
+        return std::move(mesh);
+    }
+
+    /* The vertex data stay the same, just copied as the original may be
+       non-owned */
+    const Trade::MeshData interleaved = MeshTools::interleave(std::move(mesh));
+    Containers::Array<char> vertexData{Containers::NoInit, interleaved.vertexData().size()};
+    std::memcpy(vertexData.data(), interleaved.vertexData().data(), vertexData.size());
+
+    Containers::Array<Trade::MeshAttributeData> attributes{interleaved.attributeCount()};
+    for(UnsignedInt i = 0; i != interleaved.attributeCount(); ++i)
+        attributes[i] = Trade::MeshAttributeData{
+            interleaved.attributeName(i), interleaved.attributeFormat(i),
+            Containers::StridedArrayView1D<const void>{Containers::arrayView(vertexData),
+                vertexData.data() + interleaved.attributeOffset(i),
+                vertexCount, interleaved.attributeStride(i)},
+            interleaved.attributeArraySize(i)};
+
+    Containers::Array<char> indexData{Containers::NoInit, indices.size()*sizeof(UnsignedInt)};
+    std::memcpy(indexData.data(), indices.data(), indexData.size());
+    const Trade::MeshIndexData indexView{Containers::arrayCast<const UnsignedInt>(Containers::arrayView(indexData))};
+
+    return Trade::MeshData{MeshPrimitive::Triangles,
+        std::move(indexData), indexView,
+        std::move(vertexData), std::move(attributes), vertexCount};
+}
+
+}}
@@ -0,0 +1,64 @@
+#ifndef Oberon_MeshSimplifier_h
+#define Oberon_MeshSimplifier_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/Math/Vector3.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon { namespace MeshSimplifier {
+
+struct Lod {
+    /* Range of the level in the index buffer */
+    UnsignedInt indexOffset, indexCount;
+    /* Estimated distance of the level from the full mesh in the mesh
+       space, zero for the full mesh itself */
+    Float error;
+};
+
+/* Collapses edges with the smallest quadric error first until at most
+   targetIndexCount indices are left or nothing more can be collapsed. A
+   vertex is only ever moved onto its neighbor, so the result uses the
+   original vertex data. Vertices on borders and on attribute seams, where
+   more vertices share a position, stay in place. The result is written to
+   the beginning of indices and its size returned, error is set to the
+   root mean square distance to the original surface of the worst
+   collapse. */
+UnsignedInt simplify(Containers::ArrayView<UnsignedInt> indices, const Containers::StridedArrayView1D<const Vector3>& positions, UnsignedInt targetIndexCount, Float& error);
+
+/* Appends up to levelCount simplified levels of detail to the indices of
+   an indexed triangle mesh, each with reduction times the triangles of the
+   previous one and optimized for the vertex cache. Stops early once the
+   simplification doesn't reduce the mesh much anymore. The first entry of
+   lods is the full mesh. Other meshes are returned unchanged and lods is
+   left empty. */
+Trade::MeshData generateLods(Trade::MeshData&& mesh, UnsignedInt levelCount, Float reduction, Containers::Array<Lod>& lods);
+
+}}
+
+#endif
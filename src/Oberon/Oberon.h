@@ -25,6 +25,7 @@
 */
 
 #include <Magnum/Magnum.h>
+#include <Magnum/GL/GL.h>
 #include <Magnum/SceneGraph/SceneGraph.h>
 
 namespace Oberon {
@@ -34,16 +35,46 @@ using namespace Magnum;
 typedef SceneGraph::Object<SceneGraph::TranslationRotationScalingTransformation3D> Object3D;
 typedef SceneGraph::Scene<SceneGraph::TranslationRotationScalingTransformation3D> Scene3D;
 
+typedef ResourceManager<GL::Mesh, GL::Texture2D, GL::Texture2DArray> SceneResourceManager;
+
+class BatchDrawable;
+
+class Bvh;
+
+class ContentRegistry;
+
+class FrustumCulling;
+
+class GlbFile;
+
+class GpuScene;
+
+class InstancedDrawable;
+
 class LightDrawable;
 
+class MemoryAccounting;
+
 struct ObjectInfo;
 
+class OcclusionCulling;
+
 class PhongDrawable;
 
+class PhongShader;
+
+class PixelBufferRing;
+
+class ResidencyManager;
+
 struct SceneData;
 
 class SceneView;
 
+class ShaderCache;
+
+class ShaderRegistry;
+
 }
 
 #endif
@@ -0,0 +1,277 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "OcclusionCulling.h"
+
+#include <algorithm>
+#include <chrono>
+#include <utility>
+#include <vector>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/SceneGraph/Camera.h>
+#include <Magnum/SceneGraph/Drawable.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/FrustumCulling.h"
+#include "Oberon/Hlod.h"
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+namespace Oberon {
+
+namespace {
+
+constexpr Int TileSize = 8;
+
+}
+
+Containers::Optional<OcclusionCulling::Occluder> OcclusionCulling::occluder(const Trade::MeshData& mesh, const Matrix4& dequantization, const Containers::ArrayView<const MeshSimplifier::Lod> lods, const UnsignedInt triangleLimit) {
+    /* The levels go from the full mesh to the coarsest. Coarser levels
+       can bulge out of the full mesh, so the finest one that fits is
+       used. */
+    std::size_t level = 0;
+    if(lods.empty()) {
+        const UnsignedInt indexCount = mesh.isIndexed() ? mesh.indexCount() : mesh.vertexCount();
+        if(indexCount > 3*triangleLimit) return {};
+    } else {
+        while(level != lods.size() && lods[level].indexCount > 3*triangleLimit) ++level;
+        if(level == lods.size()) return {};
+    }
+
+    Containers::Optional<Hlod::Source> source = Hlod::source(mesh, dequantization, lods.prefix(lods.empty() ? 0 : level + 1));
+    if(!source || source->indices.empty()) return {};
+
+    Occluder out;
+    out.positions = std::move(source->positions);
+    out.indices = std::move(source->indices);
+    return Containers::Optional<Occluder>{std::move(out)};
+}
+
+OcclusionCulling::OcclusionCulling(Containers::Array<Occluder>&& occluders, const Vector2i& size, const Float occluderScreenSize, const UnsignedInt triangleBudget): _occluders{std::move(occluders)}, _tileCount{(size + Vector2i{TileSize - 1})/TileSize}, _occluderScreenSize{occluderScreenSize}, _triangleBudget{triangleBudget} {
+    _size = _tileCount*TileSize;
+    _depth = Containers::Array<Float>{Containers::NoInit, std::size_t(_size.product())};
+    _tileDepth = Containers::Array<Float>{Containers::NoInit, std::size_t(_tileCount.product())};
+}
+
+/* Clips the triangle to the near plane, the rest is clipped by the
+   screen bounds in the rasterization */
+void OcclusionCulling::rasterize(const Vector4& a, const Vector4& b, const Vector4& c) {
+    const Vector4 in[]{a, b, c};
+    Vector4 out[4];
+    std::size_t count = 0;
+    for(std::size_t i = 0; i != 3; ++i) {
+        const Vector4& current = in[i];
+        const Vector4& next = in[(i + 1)%3];
+        const Float currentDistance = current.z() + current.w();
+        const Float nextDistance = next.z() + next.w();
+        if(currentDistance >= 0.0f) out[count++] = current;
+        if((currentDistance >= 0.0f) != (nextDistance >= 0.0f))
+            out[count++] = Math::lerp(current, next, currentDistance/(currentDistance - nextDistance));
+    }
+
+    auto screen = [&](const Vector4& position) {
+        const Vector3 ndc = position.xyz()/position.w();
+        return Vector3{(ndc.xy()*0.5f + Vector2{0.5f})*Vector2{_size}, ndc.z()};
+    };
+    for(std::size_t i = 2; i < count; ++i)
+        rasterize(screen(out[0]), screen(out[i - 1]), screen(out[i]));
+}
+
+void OcclusionCulling::rasterize(Vector3 a, Vector3 b, Vector3 c) {
+    /* Both windings are drawn, so mirrored transformations don't matter */
+    Float area = (b.x() - a.x())*(c.y() - a.y()) - (b.y() - a.y())*(c.x() - a.x());
+    if(Math::abs(area) < 1.0e-8f) return;
+    if(area < 0.0f) {
+        std::swap(b, c);
+        area = -area;
+    }
+
+    /* Clamped before the conversion, vertices close to the near plane can
+       be very far off the screen */
+    const Vector2 screenSize{_size};
+    const Vector2i min{Math::clamp(Math::min(a.xy(), Math::min(b.xy(), c.xy())), Vector2{0.0f}, screenSize)};
+    const Vector2i max{Math::clamp(Math::max(a.xy(), Math::max(b.xy(), c.xy())), Vector2{-1.0f}, screenSize - Vector2{1.0f})};
+    const Int minX = min.x(), maxX = max.x(), minY = min.y(), maxY = max.y();
+    if(minX > maxX || minY > maxY) return;
+
+    /* Edge functions and the depth as planes over the pixel centers, each
+       edge function is the weight of the opposite vertex times the area */
+    const Vector3 edgeX{b.y() - c.y(), c.y() - a.y(), a.y() - b.y()};
+    const Vector3 edgeY{c.x() - b.x(), a.x() - c.x(), b.x() - a.x()};
+    const Vector3 edgeOrigin{
+        b.x()*c.y() - b.y()*c.x(),
+        c.x()*a.y() - c.y()*a.x(),
+        a.x()*b.y() - a.y()*b.x()};
+    const Float depthX = (edgeX.x()*a.z() + edgeX.y()*b.z() + edgeX.z()*c.z())/area;
+    const Float depthY = (edgeY.x()*a.z() + edgeY.y()*b.z() + edgeY.z()*c.z())/area;
+    const Float depthOrigin = (edgeOrigin.x()*a.z() + edgeOrigin.y()*b.z() + edgeOrigin.z()*c.z())/area;
+
+    for(Int y = minY; y <= maxY; ++y) {
+        const Float centerY = y + 0.5f;
+        Float* const row = _depth.data() + y*_size.x();
+        Int x = minX;
+
+        #if defined(__SSE__)
+        /* The width is a multiple of the tile size, so aligning down keeps
+           the four pixels inside the row */
+        const __m128 edge0X = _mm_set1_ps(edgeX.x());
+        const __m128 edge1X = _mm_set1_ps(edgeX.y());
+        const __m128 edge2X = _mm_set1_ps(edgeX.z());
+        const __m128 edge0Row = _mm_set1_ps(edgeY.x()*centerY + edgeOrigin.x());
+        const __m128 edge1Row = _mm_set1_ps(edgeY.y()*centerY + edgeOrigin.y());
+        const __m128 edge2Row = _mm_set1_ps(edgeY.z()*centerY + edgeOrigin.z());
+        const __m128 depthStepX = _mm_set1_ps(depthX);
+        const __m128 depthRow = _mm_set1_ps(depthY*centerY + depthOrigin);
+        const __m128 zero = _mm_setzero_ps();
+        for(x = minX & ~3; x <= maxX; x += 4) {
+            const __m128 centerX = _mm_add_ps(_mm_set1_ps(Float(x)), _mm_setr_ps(0.5f, 1.5f, 2.5f, 3.5f));
+            const __m128 edge0 = _mm_add_ps(_mm_mul_ps(edge0X, centerX), edge0Row);
+            const __m128 edge1 = _mm_add_ps(_mm_mul_ps(edge1X, centerX), edge1Row);
+            const __m128 edge2 = _mm_add_ps(_mm_mul_ps(edge2X, centerX), edge2Row);
+            const __m128 inside = _mm_and_ps(_mm_cmpge_ps(edge0, zero),
+                _mm_and_ps(_mm_cmpge_ps(edge1, zero), _mm_cmpge_ps(edge2, zero)));
+            if(!_mm_movemask_ps(inside)) continue;
+
+            const __m128 depth = _mm_add_ps(_mm_mul_ps(depthStepX, centerX), depthRow);
+            const __m128 previous = _mm_loadu_ps(row + x);
+            const __m128 nearest = _mm_min_ps(previous, depth);
+            _mm_storeu_ps(row + x, _mm_or_ps(_mm_and_ps(inside, nearest), _mm_andnot_ps(inside, previous)));
+        }
+        #endif
+
+        for(; x <= maxX; ++x) {
+            const Float centerX = x + 0.5f;
+            if(edgeX.x()*centerX + edgeY.x()*centerY + edgeOrigin.x() < 0.0f ||
+               edgeX.y()*centerX + edgeY.y()*centerY + edgeOrigin.y() < 0.0f ||
+               edgeX.z()*centerX + edgeY.z()*centerY + edgeOrigin.z() < 0.0f)
+                continue;
+            row[x] = Math::min(row[x], depthX*centerX + depthY*centerY + depthOrigin);
+        }
+    }
+}
+
+bool OcclusionCulling::isOccluded(const Matrix4& viewProjection, const Range3D& box) const {
+    Vector2 min{Constants::inf()}, max{-Constants::inf()};
+    Float nearest = Constants::inf();
+    for(std::size_t i = 0; i != 8; ++i) {
+        const Vector4 corner = viewProjection*Vector4{
+            i & 1 ? box.max().x() : box.min().x(),
+            i & 2 ? box.max().y() : box.min().y(),
+            i & 4 ? box.max().z() : box.min().z(), 1.0f};
+
+        /* Crossing the near plane, the camera may be inside */
+        if(corner.z() < -corner.w() || corner.w() <= 0.0f) return false;
+
+        const Vector3 ndc = corner.xyz()/corner.w();
+        min = Math::min(min, ndc.xy());
+        max = Math::max(max, ndc.xy());
+        nearest = Math::min(nearest, ndc.z());
+    }
+
+    const Vector2 screenMin = (min*0.5f + Vector2{0.5f})*Vector2{_size};
+    const Vector2 screenMax = (max*0.5f + Vector2{0.5f})*Vector2{_size};
+    const Vector2i tileMin = Math::max(Vector2i{Math::floor(screenMin)}/TileSize, Vector2i{0});
+    const Vector2i tileMax = Math::min(Vector2i{Math::floor(screenMax)}/TileSize, _tileCount - Vector2i{1});
+    if(tileMin.x() > tileMax.x() || tileMin.y() > tileMax.y()) return false;
+
+    for(Int y = tileMin.y(); y <= tileMax.y(); ++y)
+        for(Int x = tileMin.x(); x <= tileMax.x(); ++x)
+            if(_tileDepth[y*_tileCount.x() + x] >= nearest) return false;
+    return true;
+}
+
+void OcclusionCulling::cull(SceneGraph::Camera3D& camera, FrustumCulling& culling) {
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    _statistics = {};
+
+    const Matrix4 cameraMatrix = camera.cameraMatrix();
+    const Matrix4 viewProjection = camera.projectionMatrix()*cameraMatrix;
+    const Vector3 cameraPosition = cameraMatrix.invertedRigid().translation();
+
+    /* Pick the occluders that appear the largest */
+    std::vector<std::pair<Float, UnsignedInt>> candidates;
+    for(UnsignedInt id = 0; id != culling.size(); ++id) {
+        if(!culling.occluder(id) || !culling.isVisible(id)) continue;
+
+        const Range3D box = culling.box(id);
+        const Float distance = Math::max((box.center() - cameraPosition).length(), 1.0e-4f);
+        const Float screenSize = box.size().length()*0.5f/distance;
+        if(screenSize >= _occluderScreenSize)
+            candidates.emplace_back(screenSize, id);
+    }
+    std::sort(candidates.begin(), candidates.end(),
+        [](const std::pair<Float, UnsignedInt>& a, const std::pair<Float, UnsignedInt>& b) {
+            return a.first > b.first;
+        });
+
+    for(Float& depth: _depth) depth = 1.0f;
+    for(const std::pair<Float, UnsignedInt>& candidate: candidates) {
+        const Occluder& occluder = *culling.occluder(candidate.second);
+        const UnsignedInt triangleCount = occluder.indices.size()/3;
+        if(_statistics.triangleCount && _statistics.triangleCount + triangleCount > _triangleBudget)
+            break;
+
+        const Matrix4 transformation = viewProjection*culling.absoluteTransformation(candidate.second);
+        arrayResize(_clipPositions, Containers::NoInit, occluder.positions.size());
+        for(std::size_t i = 0; i != occluder.positions.size(); ++i)
+            _clipPositions[i] = transformation*Vector4{occluder.positions[i], 1.0f};
+        for(std::size_t i = 0; i + 2 < occluder.indices.size(); i += 3)
+            rasterize(_clipPositions[occluder.indices[i]],
+                _clipPositions[occluder.indices[i + 1]],
+                _clipPositions[occluder.indices[i + 2]]);
+
+        ++_statistics.occluderCount;
+        _statistics.triangleCount += triangleCount;
+    }
+
+    /* Nothing can be hidden without occluders */
+    if(_statistics.occluderCount) {
+        for(Int tileY = 0; tileY != _tileCount.y(); ++tileY) {
+            for(Int tileX = 0; tileX != _tileCount.x(); ++tileX) {
+                Float farthest = -1.0f;
+                for(Int y = tileY*TileSize; y != (tileY + 1)*TileSize; ++y)
+                    for(Int x = tileX*TileSize; x != (tileX + 1)*TileSize; ++x)
+                        farthest = Math::max(farthest, _depth[y*_size.x() + x]);
+                _tileDepth[tileY*_tileCount.x() + tileX] = farthest;
+            }
+        }
+
+        for(UnsignedInt id = 0; id != culling.size(); ++id) {
+            if(!culling.isVisible(id) || !culling.drawable(id).drawables()) continue;
+
+            ++_statistics.testedCount;
+            if(isOccluded(viewProjection, culling.box(id))) {
+                culling.hide(id);
+                ++_statistics.culledCount;
+            }
+        }
+    }
+
+    _statistics.milliseconds = std::chrono::duration<Float, std::milli>(std::chrono::steady_clock::now() - start).count();
+}
+
+}
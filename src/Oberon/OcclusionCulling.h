@@ -0,0 +1,97 @@
+#ifndef Oberon_OcclusionCulling_h
+#define Oberon_OcclusionCulling_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/SceneGraph/SceneGraph.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/MeshSimplifier.h"
+
+namespace Oberon {
+
+/* Rasterizes the largest occluders on the screen into a low-resolution
+   depth buffer on the CPU, four pixels at a time with SSE, and hides the
+   drawables whose bounding boxes are behind them. The boxes are tested
+   against the farthest depth of 8x8 pixel tiles, so only tiles fully
+   covered by the occluders can hide anything. */
+class OcclusionCulling {
+    public:
+        /* Geometry of a mesh used for occluding, with dequantized
+           positions. Empty if the mesh isn't an occluder. */
+        struct Occluder {
+            Containers::Array<Vector3> positions;
+            Containers::Array<UnsignedInt> indices;
+        };
+
+        /* Of the last cull() */
+        struct Statistics {
+            UnsignedInt occluderCount, triangleCount, testedCount, culledCount;
+            Float milliseconds;
+        };
+
+        /* The finest level of detail with at most triangleLimit triangles,
+           null if there's none or the mesh is not made of triangles */
+        static Containers::Optional<Occluder> occluder(const Trade::MeshData& mesh, const Matrix4& dequantization, Containers::ArrayView<const MeshSimplifier::Lod> lods, UnsignedInt triangleLimit);
+
+        /* Takes the occluder of each mesh. Occluders whose bounding sphere
+           radius is less than occluderScreenSize times their distance are
+           not rasterized, the larger ones go first until triangleBudget is
+           reached. The size gets rounded up to whole tiles. */
+        explicit OcclusionCulling(Containers::Array<Occluder>&& occluders, const Vector2i& size = {256, 128}, Float occluderScreenSize = 0.1f, UnsignedInt triangleBudget = 8192);
+
+        const Occluder& occluder(UnsignedInt mesh) const { return _occluders[mesh]; }
+
+        /* Rasterizes the occluders that passed the frustum culling and hides
+           the drawables behind them. To be called after
+           FrustumCulling::cull(). */
+        void cull(SceneGraph::Camera3D& camera, FrustumCulling& culling);
+
+        const Statistics& statistics() const { return _statistics; }
+
+    private:
+        void rasterize(const Vector4& a, const Vector4& b, const Vector4& c);
+        void rasterize(Vector3 a, Vector3 b, Vector3 c);
+        bool isOccluded(const Matrix4& viewProjection, const Range3D& box) const;
+
+        Containers::Array<Occluder> _occluders;
+        Vector2i _size, _tileCount;
+        Float _occluderScreenSize;
+        UnsignedInt _triangleBudget;
+        /* Depth in the normalized device coordinates, bottom row first */
+        Containers::Array<Float> _depth;
+        /* Farthest depth in each tile */
+        Containers::Array<Float> _tileDepth;
+        Containers::Array<Vector4> _clipPositions;
+        Statistics _statistics{};
+};
+
+}
+
+#endif
@@ -0,0 +1,176 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/* The GPU-driven path gets the material from the vertex shader instead of
+   the uniforms */
+#ifdef GPU_DRIVEN
+flat in lowp vec4 drawAmbientColor;
+flat in lowp vec4 drawDiffuseColor;
+flat in mediump vec2 drawParameters;
+flat in mediump ivec2 drawTextureLayers;
+
+#define ambientColor drawAmbientColor
+#define diffuseColor drawDiffuseColor
+#define normalTextureScale drawParameters.x
+#define alphaMask drawParameters.y
+#define ambientTextureLayer drawTextureLayers.x
+#define diffuseTextureLayer drawTextureLayers.x
+#define normalTextureLayer drawTextureLayers.y
+#else
+uniform lowp vec4 ambientColor;
+#endif
+
+/* With texture arrays, the textures are sampled at the layer given by a
+   uniform */
+#ifdef TEXTURE_ARRAYS
+#define textureSampler sampler2DArray
+#define TEXTURE_COORDINATES(layer) vec3(interpolatedTextureCoordinates, float(layer))
+#else
+#define textureSampler sampler2D
+#define TEXTURE_COORDINATES(layer) interpolatedTextureCoordinates
+#endif
+
+#ifdef AMBIENT_TEXTURE
+uniform lowp textureSampler ambientTexture;
+#if defined(TEXTURE_ARRAYS) && !defined(GPU_DRIVEN)
+uniform mediump int ambientTextureLayer;
+#endif
+#endif
+
+#if LIGHT_COUNT
+#ifndef GPU_DRIVEN
+uniform lowp vec4 diffuseColor;
+#endif
+uniform lowp vec4 specularColor;
+uniform mediump float shininess;
+
+#ifdef DIFFUSE_TEXTURE
+uniform lowp textureSampler diffuseTexture;
+#if defined(TEXTURE_ARRAYS) && !defined(GPU_DRIVEN)
+uniform mediump int diffuseTextureLayer;
+#endif
+#endif
+
+#ifdef NORMAL_TEXTURE
+uniform lowp textureSampler normalTexture;
+#ifndef GPU_DRIVEN
+uniform mediump float normalTextureScale;
+#ifdef TEXTURE_ARRAYS
+uniform mediump int normalTextureLayer;
+#endif
+#endif
+#endif
+
+/* Directional lights have w = 0 */
+uniform highp vec4 lightPositions[LIGHT_COUNT];
+uniform lowp vec3 lightColors[LIGHT_COUNT];
+uniform highp float lightRanges[LIGHT_COUNT];
+#endif
+
+#if defined(ALPHA_MASK) && !defined(GPU_DRIVEN)
+uniform lowp float alphaMask;
+#endif
+
+in highp vec3 transformedPosition;
+in mediump vec3 transformedNormal;
+
+#ifdef NORMAL_TEXTURE
+in mediump vec3 transformedTangent;
+#endif
+
+#ifdef TEXTURED
+in mediump vec2 interpolatedTextureCoordinates;
+#endif
+
+#ifdef VERTEX_COLOR
+in lowp vec4 interpolatedVertexColor;
+#endif
+
+out lowp vec4 fragmentColor;
+
+void main() {
+    lowp vec4 finalAmbientColor = ambientColor;
+    #ifdef AMBIENT_TEXTURE
+    finalAmbientColor *= texture(ambientTexture, TEXTURE_COORDINATES(ambientTextureLayer));
+    #endif
+    #ifdef VERTEX_COLOR
+    finalAmbientColor *= interpolatedVertexColor;
+    #endif
+
+    fragmentColor = finalAmbientColor;
+
+    #if LIGHT_COUNT
+    lowp vec4 finalDiffuseColor = diffuseColor;
+    #ifdef DIFFUSE_TEXTURE
+    finalDiffuseColor *= texture(diffuseTexture, TEXTURE_COORDINATES(diffuseTextureLayer));
+    #endif
+    #ifdef VERTEX_COLOR
+    finalDiffuseColor *= interpolatedVertexColor;
+    #endif
+
+    mediump vec3 normalizedTransformedNormal = normalize(transformedNormal);
+
+    #ifdef NORMAL_TEXTURE
+    mediump vec3 normalizedTransformedTangent = normalize(transformedTangent);
+    mediump mat3 tbn = mat3(normalizedTransformedTangent,
+        normalize(cross(normalizedTransformedNormal, normalizedTransformedTangent)),
+        normalizedTransformedNormal);
+    mediump vec3 textureNormal = texture(normalTexture, TEXTURE_COORDINATES(normalTextureLayer)).rgb*2.0 - vec3(1.0);
+    textureNormal.xy *= normalTextureScale;
+    normalizedTransformedNormal = tbn*normalize(textureNormal);
+    #endif
+
+    mediump vec3 normalizedCameraDirection = normalize(-transformedPosition);
+
+    for(int i = 0; i < LIGHT_COUNT; ++i) {
+        highp vec3 lightDirection = lightPositions[i].xyz - transformedPosition*lightPositions[i].w;
+        highp float lightDistance = length(lightDirection);
+        mediump vec3 normalizedLightDirection = lightDirection/max(lightDistance, 0.0001);
+
+        /* Point lights fall off with the square of the distance, smoothly
+           reaching zero at the range */
+        lowp float attenuation = 1.0;
+        if(lightPositions[i].w != 0.0) {
+            lowp float falloff = clamp(1.0 - pow(lightDistance/lightRanges[i], 4.0), 0.0, 1.0);
+            attenuation = falloff*falloff/(1.0 + lightDistance*lightDistance);
+        }
+
+        lowp float intensity = max(0.0, dot(normalizedTransformedNormal, normalizedLightDirection))*attenuation;
+        fragmentColor.rgb += finalDiffuseColor.rgb*lightColors[i]*intensity;
+
+        if(intensity > 0.001) {
+            highp vec3 reflection = reflect(-normalizedLightDirection, normalizedTransformedNormal);
+            mediump float specularity = clamp(pow(max(0.0, dot(normalizedCameraDirection, reflection)), shininess), 0.0, 1.0);
+            fragmentColor.rgb += specularColor.rgb*lightColors[i]*specularity*attenuation;
+        }
+    }
+
+    /* The alpha is taken from the diffuse color if there are lights */
+    fragmentColor.a = finalDiffuseColor.a;
+    #endif
+
+    #ifdef ALPHA_MASK
+    if(fragmentColor.a < alphaMask) discard;
+    #endif
+}
@@ -0,0 +1,157 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+/* The GPU-driven path takes the transformation and the material of the
+   object from a storage buffer, at the index given by the instanced
+   attribute */
+#ifdef GPU_DRIVEN
+struct Draw {
+    mat4 transformationMatrix;
+    mat4 normalMatrix;
+    vec4 ambientColor;
+    vec4 diffuseColor;
+    /* Normal texture scale and alpha mask */
+    vec4 parameters;
+    /* Diffuse and normal texture layer */
+    ivec4 textureLayers;
+};
+
+layout(std430, binding = 0) readonly buffer Draws {
+    Draw draws[];
+};
+
+uniform highp mat4 viewMatrix;
+#else
+uniform highp mat4 transformationMatrix;
+uniform mediump mat3 normalMatrix;
+#endif
+uniform highp mat4 projectionMatrix;
+
+#ifdef TEXTURE_TRANSFORMATION
+uniform mediump mat3 textureMatrix;
+#endif
+
+#ifdef INSTANCED_TRANSFORMATION
+uniform highp samplerBuffer instanceData;
+#endif
+
+in highp vec4 position;
+in mediump vec3 normal;
+
+#ifdef NORMAL_TEXTURE
+in mediump vec3 tangent;
+#endif
+
+#ifdef TEXTURED
+in mediump vec2 textureCoordinates;
+#endif
+
+#ifdef VERTEX_COLOR
+in lowp vec4 vertexColor;
+#endif
+
+#ifdef GPU_DRIVEN
+in highp uint drawIndex;
+#endif
+
+out highp vec3 transformedPosition;
+out mediump vec3 transformedNormal;
+
+#ifdef NORMAL_TEXTURE
+out mediump vec3 transformedTangent;
+#endif
+
+#ifdef TEXTURED
+out mediump vec2 interpolatedTextureCoordinates;
+#endif
+
+#ifdef VERTEX_COLOR
+out lowp vec4 interpolatedVertexColor;
+#endif
+
+#ifdef GPU_DRIVEN
+flat out lowp vec4 drawAmbientColor;
+flat out lowp vec4 drawDiffuseColor;
+flat out mediump vec2 drawParameters;
+flat out mediump ivec2 drawTextureLayers;
+#endif
+
+void main() {
+    #ifdef GPU_DRIVEN
+    highp mat4 transformationMatrix = viewMatrix*draws[drawIndex].transformationMatrix;
+    /* The view matrix is a rigid transformation */
+    mediump mat3 normalMatrix = mat3(viewMatrix)*mat3(draws[drawIndex].normalMatrix);
+    drawAmbientColor = draws[drawIndex].ambientColor;
+    drawDiffuseColor = draws[drawIndex].diffuseColor;
+    drawParameters = draws[drawIndex].parameters.xy;
+    drawTextureLayers = draws[drawIndex].textureLayers.xy;
+    #endif
+
+    highp vec4 objectPosition = position;
+    mediump vec3 objectNormal = normal;
+    #ifdef NORMAL_TEXTURE
+    mediump vec3 objectTangent = tangent;
+    #endif
+
+    /* Instances are transformed to the scene first, the uniforms then
+       contain only the camera */
+    #ifdef INSTANCED_TRANSFORMATION
+    int instance = gl_InstanceID*7;
+    objectPosition = mat4(
+        texelFetch(instanceData, instance),
+        texelFetch(instanceData, instance + 1),
+        texelFetch(instanceData, instance + 2),
+        texelFetch(instanceData, instance + 3))*objectPosition;
+    mediump mat3 instanceNormalMatrix = mat3(
+        texelFetch(instanceData, instance + 4).xyz,
+        texelFetch(instanceData, instance + 5).xyz,
+        texelFetch(instanceData, instance + 6).xyz);
+    objectNormal = instanceNormalMatrix*objectNormal;
+    #ifdef NORMAL_TEXTURE
+    objectTangent = instanceNormalMatrix*objectTangent;
+    #endif
+    #endif
+
+    highp vec4 transformedPosition4 = transformationMatrix*objectPosition;
+    transformedPosition = transformedPosition4.xyz/transformedPosition4.w;
+    transformedNormal = normalMatrix*objectNormal;
+
+    #ifdef NORMAL_TEXTURE
+    transformedTangent = normalMatrix*objectTangent;
+    #endif
+
+    #ifdef TEXTURED
+    #ifdef TEXTURE_TRANSFORMATION
+    interpolatedTextureCoordinates = (textureMatrix*vec3(textureCoordinates, 1.0)).xy;
+    #else
+    interpolatedTextureCoordinates = textureCoordinates;
+    #endif
+    #endif
+
+    #ifdef VERTEX_COLOR
+    interpolatedVertexColor = vertexColor;
+    #endif
+
+    gl_Position = projectionMatrix*transformedPosition4;
+}
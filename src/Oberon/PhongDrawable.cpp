@@ -25,33 +25,94 @@
 #include "PhongDrawable.h"
 
 #include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/MeshView.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
 #include <Magnum/SceneGraph/Camera.h>
-#include <Magnum/Shaders/Phong.h>
+
+#include "Oberon/PhongShader.h"
 
 namespace Oberon {
 
-void PhongDrawable::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
-    (*_shader)
-        .setTransformationMatrix(transformationMatrix)
+namespace {
+
+/* A coarser level is picked only once its error projects to this fraction
+   of the threshold, so objects around the switching distance don't flicker
+   between two levels */
+constexpr Float LodHysteresis = 0.75f;
+
+}
+
+PhongDrawable& PhongDrawable::setLods(const Containers::ArrayView<const MeshSimplifier::Lod> lods, const Vector4& bounds, const Float pixelError) {
+    _lods = Containers::Array<MeshSimplifier::Lod>{Containers::NoInit, lods.size()};
+    for(std::size_t i = 0; i != lods.size(); ++i) _lods[i] = lods[i];
+    _bounds = bounds;
+    _lodPixelError = pixelError;
+    _lod = 0;
+    return *this;
+}
+
+void PhongDrawable::bind(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
+    ResidencyManager::use(_meshEntry);
+    ResidencyManager::use(_diffuseTextureEntry);
+    ResidencyManager::use(_normalTextureEntry);
+
+    /* The normals are not affected by the mesh transformation */
+    _shader
+        .setTransformationMatrix(transformationMatrix*_meshTransformation)
         .setNormalMatrix(transformationMatrix.normalMatrix())
         .setProjectionMatrix(camera.projectionMatrix())
-        .setAmbientColor(_color*0.06f)
+        .setAmbientColor(ambientColor())
         .setDiffuseColor(_color);
 
-    if(_diffuseTexture) (*_shader)
+    if(_diffuseTexture) _shader
         .bindAmbientTexture(*_diffuseTexture)
         .bindDiffuseTexture(*_diffuseTexture);
-    if(_normalTexture) (*_shader)
+    if(_normalTexture) _shader
         .bindNormalTexture(*_normalTexture)
         .setNormalTextureScale(_normalTextureScale);
+    if(_diffuseTextureArray) _shader
+        .bindAmbientTexture(*_diffuseTextureArray, _diffuseTextureLayer)
+        .bindDiffuseTexture(*_diffuseTextureArray, _diffuseTextureLayer);
+    if(_normalTextureArray) _shader
+        .bindNormalTexture(*_normalTextureArray, _normalTextureLayer)
+        .setNormalTextureScale(_normalTextureScale);
+
+    if(_shader.flags() & PhongShader::Flag::TextureTransformation)
+        _shader.setTextureMatrix(_textureMatrix);
+    if(_shader.flags() & PhongShader::Flag::AlphaMask)
+        _shader.setAlphaMask(_alphaMask);
+}
+
+void PhongDrawable::draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
+    bind(transformationMatrix, camera);
+
+    /* The fallback used until the mesh is uploaded has no indices */
+    if(_lods.empty() || !_mesh->isIndexed()) {
+        _shader.draw(*_mesh);
+        return;
+    }
+
+    GL::MeshView view{*_mesh};
+    const UnsignedInt lod = selectLod(transformationMatrix, camera);
+    view.setCount(_lods[lod].indexCount)
+        .setIndexRange(_lods[lod].indexOffset);
+    _shader.draw(view);
+}
 
-    if(_shader->flags() & Shaders::Phong::Flag::TextureTransformation)
-        _shader->setTextureMatrix(_textureMatrix);
-    if(_shader->flags() & Shaders::Phong::Flag::AlphaMask)
-        _shader->setAlphaMask(_alphaMask);
+UnsignedInt PhongDrawable::selectLod(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) {
+    /* Pixels per unit of the mesh space at the point of the bounding
+       sphere nearest to the camera */
+    const Float scaling = transformationMatrix.scaling().max();
+    const Float distance = Math::max(transformationMatrix.transformPoint(_bounds.xyz()).length() - _bounds.w()*scaling, 1.0e-4f);
+    const Float pixelsPerUnit = scaling*camera.projectionMatrix()[1][1]*camera.viewport().y()*0.5f/distance;
 
-    _shader->draw(*_mesh);
+    UnsignedInt lod = Math::min(_lod, UnsignedInt(_lods.size() - 1));
+    while(lod + 1 < _lods.size() && _lods[lod + 1].error*pixelsPerUnit < _lodPixelError*LodHysteresis)
+        ++lod;
+    while(lod && _lods[lod].error*pixelsPerUnit > _lodPixelError)
+        --lod;
+    return _lod = lod;
 }
 
 }
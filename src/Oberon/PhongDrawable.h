@@ -24,40 +24,124 @@
     SOFTWARE.
 */
 
+#include <Corrade/Containers/Array.h>
 #include <Magnum/Resource.h>
 #include <Magnum/GL/GL.h>
 #include <Magnum/Math/Color.h>
 #include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Vector4.h>
 #include <Magnum/SceneGraph/Drawable.h>
-#include <Magnum/Shaders/Shaders.h>
 
 #include "Oberon/Oberon.h"
+#include "Oberon/MeshSimplifier.h"
+#include "Oberon/ResidencyManager.h"
 
 namespace Oberon {
 
 class PhongDrawable: public SceneGraph::Drawable3D {
     public:
-        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, const Resource<GL::AbstractShaderProgram, Shaders::Phong>& shader, const Resource<GL::Mesh>& mesh, const Color4& color, const Resource<GL::Texture2D>& diffuseTexture, const Resource<GL::Texture2D>& normalTexture, Float normalTextureScale, Float alphaMask, Matrix3 textureMatrix, SceneGraph::DrawableGroup3D& group): SceneGraph::Drawable3D{object, &group}, _shader{shader}, _mesh{mesh}, _color{color}, _diffuseTexture{diffuseTexture}, _normalTexture{normalTexture}, _normalTextureScale{normalTextureScale}, _alphaMask{alphaMask}, _textureMatrix{textureMatrix} {}
+        /* The mesh transformation is applied to the vertex positions only,
+           such as to dequantize them */
+        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, PhongShader& shader, const Resource<GL::Mesh>& mesh, const Matrix4& meshTransformation, const Color4& color, const Resource<GL::Texture2D>& diffuseTexture, const Resource<GL::Texture2D>& normalTexture, Float normalTextureScale, Float alphaMask, Matrix3 textureMatrix, SceneGraph::DrawableGroup3D& group): SceneGraph::Drawable3D{object, &group}, _shader{shader}, _mesh{mesh}, _meshTransformation{meshTransformation}, _color{color}, _diffuseTexture{diffuseTexture}, _normalTexture{normalTexture}, _normalTextureScale{normalTextureScale}, _alphaMask{alphaMask}, _textureMatrix{textureMatrix} {}
 
-        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, const Resource<GL::AbstractShaderProgram, Shaders::Phong>& shader, const Resource<GL::Mesh>& mesh, const Color4& color, SceneGraph::DrawableGroup3D& group): SceneGraph::Drawable3D{object, &group}, _shader(shader), _mesh(mesh), _color{color} {}
+        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, PhongShader& shader, const Resource<GL::Mesh>& mesh, const Matrix4& meshTransformation, const Color4& color, SceneGraph::DrawableGroup3D& group): SceneGraph::Drawable3D{object, &group}, _shader{shader}, _mesh(mesh), _meshTransformation{meshTransformation}, _color{color} {}
 
-        const Color4 color() { return _color; }
+        /* Draws another mesh with the shader, color and textures of the
+           material drawable. The mesh has no transformation and no levels
+           of detail. */
+        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, const PhongDrawable& material, const Resource<GL::Mesh>& mesh, SceneGraph::DrawableGroup3D& group): PhongDrawable{object, material._shader, material, mesh, group} {}
+
+        /* Same as above with another variant of the material shader */
+        explicit PhongDrawable(SceneGraph::AbstractObject3D& object, PhongShader& shader, const PhongDrawable& material, const Resource<GL::Mesh>& mesh, SceneGraph::DrawableGroup3D& group): SceneGraph::Drawable3D{object, &group}, _shader(shader), _mesh(mesh), _color{material._color}, _diffuseTexture{material._diffuseTexture}, _normalTexture{material._normalTexture}, _normalTextureScale{material._normalTextureScale}, _alphaMask{material._alphaMask}, _textureMatrix{material._textureMatrix}, _diffuseTextureEntry{material._diffuseTextureEntry}, _normalTextureEntry{material._normalTextureEntry}, _diffuseTextureArray{material._diffuseTextureArray}, _normalTextureArray{material._normalTextureArray}, _diffuseTextureLayer{material._diffuseTextureLayer}, _normalTextureLayer{material._normalTextureLayer} {}
+
+        /* The resources are marked as used on every draw so they stay
+           resident or get reloaded. Null entries are not tracked. */
+        PhongDrawable& setResidencyEntries(ResidencyManager::Entry* mesh, ResidencyManager::Entry* diffuseTexture, ResidencyManager::Entry* normalTexture) {
+            _meshEntry = mesh;
+            _diffuseTextureEntry = diffuseTexture;
+            _normalTextureEntry = normalTexture;
+            return *this;
+        }
+
+        /* Layers of texture arrays used instead of the textures, the shader
+           needs PhongShader::Flag::TextureArrays */
+        PhongDrawable& setTextureArrays(const Resource<GL::Texture2DArray>& diffuseTexture, Int diffuseLayer, const Resource<GL::Texture2DArray>& normalTexture, Int normalLayer) {
+            _diffuseTextureArray = diffuseTexture;
+            _normalTextureArray = normalTexture;
+            _diffuseTextureLayer = diffuseLayer;
+            _normalTextureLayer = normalLayer;
+            return *this;
+        }
+
+        /* Levels of detail in the mesh index buffer and the bounding sphere
+           of the mesh as center and radius. The coarsest level whose error
+           projects to less than pixelError pixels is drawn. */
+        PhongDrawable& setLods(Containers::ArrayView<const MeshSimplifier::Lod> lods, const Vector4& bounds, Float pixelError);
+
+        Containers::ArrayView<const MeshSimplifier::Lod> lods() const { return _lods; }
+        const Vector4& lodBounds() const { return _bounds; }
+        Float lodPixelError() const { return _lodPixelError; }
+
+        ResidencyManager::Entry* meshEntry() const { return _meshEntry; }
+        ResidencyManager::Entry* diffuseTextureEntry() const { return _diffuseTextureEntry; }
+        ResidencyManager::Entry* normalTextureEntry() const { return _normalTextureEntry; }
+
+        Color4 color() const { return _color; }
         PhongDrawable& setColor(const Color4& color) {
             _color = color;
             return *this;
         }
 
+        /* Material state, for drawing the object outside of draw() */
+        PhongShader& shader() const { return _shader; }
+        const Resource<GL::Mesh>& mesh() const { return _mesh; }
+        const Resource<GL::Texture2D>& diffuseTexture() const { return _diffuseTexture; }
+        const Resource<GL::Texture2D>& normalTexture() const { return _normalTexture; }
+        const Matrix3& textureMatrix() const { return _textureMatrix; }
+        const Matrix4& meshTransformation() const { return _meshTransformation; }
+        Color4 ambientColor() const { return _color*0.06f; }
+        Float normalTextureScale() const { return _normalTextureScale; }
+        Float alphaMask() const { return _alphaMask; }
+        const Resource<GL::Texture2DArray>& diffuseTextureArray() const { return _diffuseTextureArray; }
+        const Resource<GL::Texture2DArray>& normalTextureArray() const { return _normalTextureArray; }
+        Int diffuseTextureLayer() const { return _diffuseTextureLayer; }
+        Int normalTextureLayer() const { return _normalTextureLayer; }
+
+    protected:
+        /* Marks the resources as used and sets up the shader for drawing
+           the mesh with given transformation */
+        void bind(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera);
+
+        /* Level of detail to draw for the mesh with given transformation,
+           with the hysteresis against the previously picked one. There has
+           to be at least one level. */
+        UnsignedInt selectLod(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera);
+
+        PhongShader& _shader;
+        Resource<GL::Mesh> _mesh;
+        Containers::Array<MeshSimplifier::Lod> _lods;
+
     private:
         void draw(const Matrix4& transformationMatrix, SceneGraph::Camera3D& camera) override;
 
-        Resource<GL::AbstractShaderProgram, Shaders::Phong> _shader;
-        Resource<GL::Mesh> _mesh;
+        Matrix4 _meshTransformation;
         Color4 _color;
         Resource<GL::Texture2D> _diffuseTexture;
         Resource<GL::Texture2D> _normalTexture;
-        Float _normalTextureScale;
-        Float _alphaMask;
+        Float _normalTextureScale{1.0f};
+        Float _alphaMask{0.5f};
         Matrix3 _textureMatrix;
+        ResidencyManager::Entry* _meshEntry{};
+        ResidencyManager::Entry* _diffuseTextureEntry{};
+        ResidencyManager::Entry* _normalTextureEntry{};
+        Resource<GL::Texture2DArray> _diffuseTextureArray;
+        Resource<GL::Texture2DArray> _normalTextureArray;
+        Int _diffuseTextureLayer{};
+        Int _normalTextureLayer{};
+        Vector4 _bounds;
+        Float _lodPixelError{};
+        UnsignedInt _lod{};
 };
 
 }
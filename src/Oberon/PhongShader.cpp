@@ -0,0 +1,375 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "PhongShader.h"
+
+#include <algorithm>
+#include <cstring>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Assert.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Corrade/Utility/Resource.h>
+#include <Magnum/GL/BufferTexture.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Constants.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+
+#include "Oberon/ShaderCache.h"
+
+#ifndef GL_COMPLETION_STATUS_KHR
+#define GL_COMPLETION_STATUS_KHR 0x91B1
+#endif
+
+static void importShaderResources() {
+    CORRADE_RESOURCE_INITIALIZE(Oberon_RCS)
+}
+
+namespace Oberon {
+
+namespace {
+
+using namespace Math::Literals;
+
+enum: Int {
+    AmbientTextureUnit = 0,
+    DiffuseTextureUnit = 1,
+    NormalTextureUnit = 2,
+    InstanceDataTextureUnit = 3
+};
+
+GLuint submitShader(const GLenum type, const char* const version, const std::string& source) {
+    const std::string versionedSource = version + source;
+    const GLchar* const data = versionedSource.data();
+    const GLint size = versionedSource.size();
+
+    const GLuint shader = glCreateShader(type);
+    glShaderSource(shader, 1, &data, &size);
+    glCompileShader(shader);
+    return shader;
+}
+
+std::string infoLog(void(APIENTRY *get)(GLuint, GLenum, GLint*), void(APIENTRY *getLog)(GLuint, GLsizei, GLsizei*, GLchar*), const GLuint id) {
+    GLint size{};
+    get(id, GL_INFO_LOG_LENGTH, &size);
+    std::string log(std::max(size, 1), '\0');
+    getLog(id, size, nullptr, &log[0]);
+    log.resize(std::strlen(log.data()));
+    return log;
+}
+
+}
+
+bool PhongShader::isParallelCompileSupported() {
+    for(const std::string& extension: GL::Context::current().extensionStrings())
+        if(extension == "GL_KHR_parallel_shader_compile" ||
+           extension == "GL_ARB_parallel_shader_compile")
+            return true;
+    return false;
+}
+
+PhongShader::PhongShader(const Flags flags, const UnsignedInt lightCount, ShaderCache* const cache): _flags{flags}, _lightCount{lightCount} {
+    /* The resources are compiled into a static library */
+    if(!Utility::Resource::hasGroup("Oberon"))
+        importShaderResources();
+
+    Utility::Resource rs("Oberon");
+
+    std::string defines = Utility::formatString("#define LIGHT_COUNT {}\n", lightCount);
+    if(flags & Flag::AmbientTexture)
+        defines += "#define AMBIENT_TEXTURE\n";
+    if(flags & Flag::DiffuseTexture)
+        defines += "#define DIFFUSE_TEXTURE\n";
+    if(flags & Flag::NormalTexture)
+        defines += "#define NORMAL_TEXTURE\n";
+    if(flags & (Flag::AmbientTexture|Flag::DiffuseTexture|Flag::NormalTexture))
+        defines += "#define TEXTURED\n";
+    if(flags & Flag::AlphaMask)
+        defines += "#define ALPHA_MASK\n";
+    if(flags & Flag::VertexColor)
+        defines += "#define VERTEX_COLOR\n";
+    if(flags & Flag::TextureTransformation)
+        defines += "#define TEXTURE_TRANSFORMATION\n";
+    if(flags & Flag::TextureArrays)
+        defines += "#define TEXTURE_ARRAYS\n";
+    if(flags & Flag::GpuDriven)
+        defines += "#define GPU_DRIVEN\n";
+    if(flags & Flag::InstancedTransformation)
+        defines += "#define INSTANCED_TRANSFORMATION\n";
+
+    const std::string vertSource = defines + rs.get("Phong.vert");
+    const std::string fragSource = defines + rs.get("Phong.frag");
+
+    /* A binary from the cache is linked already */
+    _parallelCompile = isParallelCompileSupported();
+    if(cache && cache->load(*this, vertSource + fragSource)) {
+        finish();
+        return;
+    }
+
+    /* Only submit the work, GL::Shader::compile() and link() would wait for
+       the result */
+    /* Storage buffers need GLSL 4.30 */
+    const char* const version = flags & Flag::GpuDriven ? "#version 430\n" : "#version 150\n";
+    _vert = submitShader(GL_VERTEX_SHADER, version, vertSource);
+    _frag = submitShader(GL_FRAGMENT_SHADER, version, fragSource);
+    glAttachShader(id(), _vert);
+    glAttachShader(id(), _frag);
+
+    bindAttributeLocation(Position::Location, "position");
+    bindAttributeLocation(Normal::Location, "normal");
+    if(flags & Flag::NormalTexture)
+        bindAttributeLocation(Tangent::Location, "tangent");
+    if(flags & (Flag::AmbientTexture|Flag::DiffuseTexture|Flag::NormalTexture))
+        bindAttributeLocation(TextureCoordinates::Location, "textureCoordinates");
+    if(flags & Flag::VertexColor)
+        bindAttributeLocation(Color4::Location, "vertexColor");
+    if(flags & Flag::GpuDriven)
+        bindAttributeLocation(DrawIndex::Location, "drawIndex");
+
+    if(cache) {
+        cache->prepare(*this);
+        _cache = cache;
+        _sources = vertSource + fragSource;
+    }
+    glLinkProgram(id());
+}
+
+PhongShader::~PhongShader() {
+    /* The load was canceled before the shader got finished */
+    if(_vert) glDeleteShader(_vert);
+    if(_frag) glDeleteShader(_frag);
+}
+
+bool PhongShader::isLinkCompleted() const {
+    if(_finished) return true;
+    if(!_parallelCompile) return false;
+
+    GLint completed{};
+    glGetProgramiv(id(), GL_COMPLETION_STATUS_KHR, &completed);
+    return completed;
+}
+
+void PhongShader::finish() {
+    if(_finished) return;
+    _finished = true;
+
+    if(_vert) {
+        GLint linked{};
+        glGetProgramiv(id(), GL_LINK_STATUS, &linked);
+        if(!linked) {
+            Error{} << "PhongShader: compilation with flags"
+                << UnsignedInt(UnsignedShort(_flags)) << "and" << _lightCount
+                << "lights failed:" << Debug::newline
+                << infoLog(glGetShaderiv, glGetShaderInfoLog, _vert)
+                << infoLog(glGetShaderiv, glGetShaderInfoLog, _frag)
+                << infoLog(glGetProgramiv, glGetProgramInfoLog, id());
+            CORRADE_INTERNAL_ASSERT_UNREACHABLE();
+        }
+
+        glDetachShader(id(), _vert);
+        glDetachShader(id(), _frag);
+        glDeleteShader(_vert);
+        glDeleteShader(_frag);
+        _vert = _frag = 0;
+
+        if(_cache) _cache->save(*this, _sources);
+        _cache = nullptr;
+        _sources = {};
+    }
+
+    /* Uniforms that aren't used by the variant are -1 and setting them is a
+       no-op */
+    _transformationMatrixUniform = uniformLocation("transformationMatrix");
+    _viewMatrixUniform = uniformLocation("viewMatrix");
+    _projectionMatrixUniform = uniformLocation("projectionMatrix");
+    _normalMatrixUniform = uniformLocation("normalMatrix");
+    _textureMatrixUniform = uniformLocation("textureMatrix");
+    _ambientColorUniform = uniformLocation("ambientColor");
+    _diffuseColorUniform = uniformLocation("diffuseColor");
+    _specularColorUniform = uniformLocation("specularColor");
+    _shininessUniform = uniformLocation("shininess");
+    _normalTextureScaleUniform = uniformLocation("normalTextureScale");
+    _alphaMaskUniform = uniformLocation("alphaMask");
+    _ambientTextureLayerUniform = uniformLocation("ambientTextureLayer");
+    _diffuseTextureLayerUniform = uniformLocation("diffuseTextureLayer");
+    _normalTextureLayerUniform = uniformLocation("normalTextureLayer");
+    _lightPositionsUniform = uniformLocation("lightPositions");
+    _lightColorsUniform = uniformLocation("lightColors");
+    _lightRangesUniform = uniformLocation("lightRanges");
+
+    if(_flags & Flag::AmbientTexture)
+        setUniform(uniformLocation("ambientTexture"), AmbientTextureUnit);
+    if(_lightCount && (_flags & Flag::DiffuseTexture))
+        setUniform(uniformLocation("diffuseTexture"), DiffuseTextureUnit);
+    if(_lightCount && (_flags & Flag::NormalTexture))
+        setUniform(uniformLocation("normalTexture"), NormalTextureUnit);
+    if(_flags & Flag::InstancedTransformation)
+        setUniform(uniformLocation("instanceData"), InstanceDataTextureUnit);
+
+    /* Uniform values are not part of the program binary, so the defaults
+       are set in both cases */
+    setTransformationMatrix({});
+    setViewMatrix({});
+    setProjectionMatrix({});
+    setNormalMatrix({});
+    if(_flags & Flag::TextureTransformation)
+        setTextureMatrix({});
+    setAmbientColor(_flags & Flag::AmbientTexture ? Magnum::Color4{1.0f} : Magnum::Color4{0.0f});
+    if(_lightCount) {
+        setDiffuseColor(Magnum::Color4{1.0f});
+        /* The imported materials have no specular, keep it subtle */
+        setSpecularColor(0x11111100_rgbaf);
+        setShininess(80.0f);
+        if(_flags & Flag::NormalTexture)
+            setNormalTextureScale(1.0f);
+
+        Containers::Array<Vector4> positions{Containers::DirectInit, _lightCount, 0.0f, 0.0f, 1.0f, 0.0f};
+        Containers::Array<Color3> colors{Containers::DirectInit, _lightCount, 1.0f};
+        Containers::Array<Float> ranges{Containers::DirectInit, _lightCount, Constants::inf()};
+        setLightPositions(positions);
+        setLightColors(colors);
+        setLightRanges(ranges);
+    }
+    if(_flags & Flag::AlphaMask)
+        setAlphaMask(0.5f);
+}
+
+PhongShader& PhongShader::setAmbientColor(const Magnum::Color4& color) {
+    setUniform(_ambientColorUniform, color);
+    return *this;
+}
+
+PhongShader& PhongShader::setDiffuseColor(const Magnum::Color4& color) {
+    setUniform(_diffuseColorUniform, color);
+    return *this;
+}
+
+PhongShader& PhongShader::setSpecularColor(const Magnum::Color4& color) {
+    setUniform(_specularColorUniform, color);
+    return *this;
+}
+
+PhongShader& PhongShader::setShininess(const Float shininess) {
+    setUniform(_shininessUniform, shininess);
+    return *this;
+}
+
+PhongShader& PhongShader::setNormalTextureScale(const Float scale) {
+    setUniform(_normalTextureScaleUniform, scale);
+    return *this;
+}
+
+PhongShader& PhongShader::setAlphaMask(const Float mask) {
+    setUniform(_alphaMaskUniform, mask);
+    return *this;
+}
+
+PhongShader& PhongShader::setTransformationMatrix(const Matrix4& matrix) {
+    setUniform(_transformationMatrixUniform, matrix);
+    return *this;
+}
+
+PhongShader& PhongShader::setViewMatrix(const Matrix4& matrix) {
+    setUniform(_viewMatrixUniform, matrix);
+    return *this;
+}
+
+PhongShader& PhongShader::setNormalMatrix(const Matrix3x3& matrix) {
+    setUniform(_normalMatrixUniform, matrix);
+    return *this;
+}
+
+PhongShader& PhongShader::setProjectionMatrix(const Matrix4& matrix) {
+    setUniform(_projectionMatrixUniform, matrix);
+    return *this;
+}
+
+PhongShader& PhongShader::setTextureMatrix(const Matrix3& matrix) {
+    setUniform(_textureMatrixUniform, matrix);
+    return *this;
+}
+
+PhongShader& PhongShader::setLightPositions(const Containers::ArrayView<const Vector4> positions) {
+    CORRADE_INTERNAL_ASSERT(positions.size() == _lightCount);
+    setUniform(_lightPositionsUniform, Containers::arrayCast<const Math::Vector<4, Float>>(positions));
+    return *this;
+}
+
+PhongShader& PhongShader::setLightColors(const Containers::ArrayView<const Color3> colors) {
+    CORRADE_INTERNAL_ASSERT(colors.size() == _lightCount);
+    setUniform(_lightColorsUniform, Containers::arrayCast<const Math::Vector<3, Float>>(colors));
+    return *this;
+}
+
+PhongShader& PhongShader::setLightRanges(const Containers::ArrayView<const Float> ranges) {
+    CORRADE_INTERNAL_ASSERT(ranges.size() == _lightCount);
+    setUniform(_lightRangesUniform, ranges);
+    return *this;
+}
+
+PhongShader& PhongShader::bindAmbientTexture(GL::Texture2D& texture) {
+    texture.bind(AmbientTextureUnit);
+    return *this;
+}
+
+PhongShader& PhongShader::bindDiffuseTexture(GL::Texture2D& texture) {
+    texture.bind(DiffuseTextureUnit);
+    return *this;
+}
+
+PhongShader& PhongShader::bindNormalTexture(GL::Texture2D& texture) {
+    texture.bind(NormalTextureUnit);
+    return *this;
+}
+
+PhongShader& PhongShader::bindInstanceData(GL::BufferTexture& texture) {
+    texture.bind(InstanceDataTextureUnit);
+    return *this;
+}
+
+PhongShader& PhongShader::bindAmbientTexture(GL::Texture2DArray& texture, const Int layer) {
+    texture.bind(AmbientTextureUnit);
+    setUniform(_ambientTextureLayerUniform, layer);
+    return *this;
+}
+
+PhongShader& PhongShader::bindDiffuseTexture(GL::Texture2DArray& texture, const Int layer) {
+    texture.bind(DiffuseTextureUnit);
+    setUniform(_diffuseTextureLayerUniform, layer);
+    return *this;
+}
+
+PhongShader& PhongShader::bindNormalTexture(GL::Texture2DArray& texture, const Int layer) {
+    texture.bind(NormalTextureUnit);
+    setUniform(_normalTextureLayerUniform, layer);
+    return *this;
+}
+
+}
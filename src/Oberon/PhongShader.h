@@ -0,0 +1,168 @@
+#ifndef Oberon_PhongShader_h
+#define Oberon_PhongShader_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <Corrade/Containers/ArrayView.h>
+#include <Corrade/Containers/EnumSet.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/Shaders/Generic.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+class ShaderCache;
+
+/* Blinn-Phong shader with the same interface as Shaders::Phong, but owned by
+   Oberon so the program can be created from a binary in the ShaderCache
+   instead of always being compiled from source.
+
+   The constructor only submits the compilation and linking to the driver, so
+   shaders created one after another are compiled in parallel where the
+   driver supports it. The shader has to be finished with finish() before
+   it's used. */
+class PhongShader: public GL::AbstractShaderProgram {
+    public:
+        typedef Shaders::Generic3D::Position Position;
+        typedef Shaders::Generic3D::Normal Normal;
+        typedef Shaders::Generic3D::Tangent Tangent;
+        typedef Shaders::Generic3D::TextureCoordinates TextureCoordinates;
+        typedef Shaders::Generic3D::Color4 Color4;
+
+        /* Index of the object in the storage buffer of the GPU-driven path,
+           an instanced attribute. The location isn't used by any of the
+           attributes above. */
+        typedef GL::Attribute<15, UnsignedInt> DrawIndex;
+
+        enum class Flag: UnsignedShort {
+            AmbientTexture = 1 << 0,
+            DiffuseTexture = 1 << 1,
+            NormalTexture = 1 << 2,
+            AlphaMask = 1 << 3,
+            VertexColor = 1 << 4,
+            TextureTransformation = 1 << 5,
+            /* The textures are layers of texture arrays */
+            TextureArrays = 1 << 6,
+            /* The transformation and the material of each object are read
+               from a storage buffer, needs GL 4.3. See GpuScene. */
+            GpuDriven = 1 << 7,
+            /* Each instance is transformed by its own matrices from a
+               buffer texture before the uniform ones. See
+               InstancedDrawable. */
+            InstancedTransformation = 1 << 8
+        };
+
+        typedef Containers::EnumSet<Flag> Flags;
+
+        /* Whether the driver can tell if a link is completed without
+           blocking, via KHR_parallel_shader_compile */
+        static bool isParallelCompileSupported();
+
+        /* If the cache is null, the program is always compiled from source.
+           The cache has to stay alive until the shader is finished. */
+        explicit PhongShader(Flags flags, UnsignedInt lightCount, ShaderCache* cache = nullptr);
+
+        ~PhongShader();
+
+        /* Never blocks. Without parallel compile support this returns false
+           until the shader is finished. */
+        bool isLinkCompleted() const;
+
+        bool isFinished() const { return _finished; }
+
+        /* Waits for the link to complete and sets up the uniforms. Does
+           nothing if the shader is already finished. */
+        void finish();
+
+        Flags flags() const { return _flags; }
+        UnsignedInt lightCount() const { return _lightCount; }
+
+        PhongShader& setAmbientColor(const Magnum::Color4& color);
+        PhongShader& setDiffuseColor(const Magnum::Color4& color);
+        PhongShader& setSpecularColor(const Magnum::Color4& color);
+        PhongShader& setShininess(Float shininess);
+        PhongShader& setNormalTextureScale(Float scale);
+        PhongShader& setAlphaMask(Float mask);
+
+        PhongShader& setTransformationMatrix(const Matrix4& matrix);
+        /* With Flag::GpuDriven, used instead of the transformation and
+           normal matrix */
+        PhongShader& setViewMatrix(const Matrix4& matrix);
+        PhongShader& setNormalMatrix(const Matrix3x3& matrix);
+        PhongShader& setProjectionMatrix(const Matrix4& matrix);
+        PhongShader& setTextureMatrix(const Matrix3& matrix);
+
+        PhongShader& setLightPositions(Containers::ArrayView<const Vector4> positions);
+        PhongShader& setLightColors(Containers::ArrayView<const Color3> colors);
+        PhongShader& setLightRanges(Containers::ArrayView<const Float> ranges);
+
+        PhongShader& bindAmbientTexture(GL::Texture2D& texture);
+        PhongShader& bindDiffuseTexture(GL::Texture2D& texture);
+        PhongShader& bindNormalTexture(GL::Texture2D& texture);
+
+        /* With Flag::InstancedTransformation, seven RGBA32F texels per
+           instance, the columns of its transformation and normal matrix */
+        PhongShader& bindInstanceData(GL::BufferTexture& texture);
+
+        /* With Flag::TextureArrays, the layer is a uniform so drawables
+           using other layers of the same array don't rebind it */
+        PhongShader& bindAmbientTexture(GL::Texture2DArray& texture, Int layer);
+        PhongShader& bindDiffuseTexture(GL::Texture2DArray& texture, Int layer);
+        PhongShader& bindNormalTexture(GL::Texture2DArray& texture, Int layer);
+
+    private:
+        Flags _flags;
+        UnsignedInt _lightCount;
+        bool _parallelCompile, _finished{};
+        /* Set only while a link submitted from source is pending */
+        ShaderCache* _cache{};
+        std::string _sources;
+        UnsignedInt _vert{}, _frag{};
+
+        Int _transformationMatrixUniform,
+            _viewMatrixUniform,
+            _projectionMatrixUniform,
+            _normalMatrixUniform,
+            _textureMatrixUniform,
+            _ambientColorUniform,
+            _diffuseColorUniform,
+            _specularColorUniform,
+            _shininessUniform,
+            _normalTextureScaleUniform,
+            _alphaMaskUniform,
+            _ambientTextureLayerUniform,
+            _diffuseTextureLayerUniform,
+            _normalTextureLayerUniform,
+            _lightPositionsUniform,
+            _lightColorsUniform,
+            _lightRangesUniform;
+};
+
+CORRADE_ENUMSET_OPERATORS(PhongShader::Flags)
+
+}
+
+#endif
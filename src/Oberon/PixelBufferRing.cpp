@@ -0,0 +1,175 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "PixelBufferRing.h"
+
+#include <cstring>
+#include <Magnum/ImageView.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/PixelFormat.h>
+#include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
+
+namespace Oberon {
+
+namespace {
+
+/* Enough for any pixel or block size */
+constexpr std::size_t Alignment = 256;
+
+void wait(GLsync sync) {
+    while(glClientWaitSync(sync, GL_SYNC_FLUSH_COMMANDS_BIT, 1000000) == GL_TIMEOUT_EXPIRED);
+}
+
+}
+
+PixelBufferRing::PixelBufferRing(const std::size_t size): _buffer{NoCreate} {
+    if(!size || !GL::Context::current().isExtensionSupported<GL::Extensions::ARB::buffer_storage>())
+        return;
+
+    _buffer = GL::Buffer{GL::Buffer::TargetHint::PixelUnpack};
+    _buffer.setStorage({nullptr, size}, GL::Buffer::StorageFlag::MapWrite|
+        GL::Buffer::StorageFlag::MapPersistent|
+        GL::Buffer::StorageFlag::MapCoherent);
+    _memory = _buffer.map(0, size, GL::Buffer::MapFlag::Write|
+        GL::Buffer::MapFlag::Persistent|GL::Buffer::MapFlag::Coherent);
+}
+
+PixelBufferRing::~PixelBufferRing() {
+    for(const Fence& fence: _fences) glDeleteSync(fence.sync);
+}
+
+std::size_t PixelBufferRing::allocate(const std::size_t size) {
+    /* Release fences of transfers that are done already */
+    while(!_fences.empty() && glClientWaitSync(_fences.front().sync, 0, 0) != GL_TIMEOUT_EXPIRED) {
+        glDeleteSync(_fences.front().sync);
+        _fences.pop_front();
+    }
+
+    /* Start over from the beginning if the rest doesn't fit */
+    std::size_t offset = _head;
+    if(offset + size > _memory.size()) offset = 0;
+
+    /* Wait for the newest transfer still reading from the range. Fences
+       signal in order, so all older ones are done then as well. */
+    for(std::size_t i = _fences.size(); i != 0; --i) {
+        const Fence& fence = _fences[i - 1];
+        if(fence.begin >= offset + size || offset >= fence.end) continue;
+
+        wait(fence.sync);
+        for(std::size_t j = 0; j != i; ++j) glDeleteSync(_fences[j].sync);
+        _fences.erase(_fences.begin(), _fences.begin() + i);
+        break;
+    }
+
+    _head = (offset + size + Alignment - 1)/Alignment*Alignment;
+    return offset;
+}
+
+void PixelBufferRing::fence(const std::size_t offset, const std::size_t size) {
+    _fences.push_back(Fence{offset, offset + size, glFenceSync(GL_SYNC_GPU_COMMANDS_COMPLETE, 0)});
+
+    /* The bindings were changed behind Magnum's back */
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, 0);
+    GL::Context::current().resetState(GL::Context::State::Buffers|
+        GL::Context::State::Textures|GL::Context::State::PixelStorage);
+}
+
+bool PixelBufferRing::copy(const Containers::ArrayView<const char> data, std::size_t& offset) {
+    if(!isSupported() || data.size() > _memory.size()) return false;
+
+    offset = allocate(data.size());
+    std::memcpy(_memory.data() + offset, data.data(), data.size());
+    glBindBuffer(GL_PIXEL_UNPACK_BUFFER, _buffer.id());
+    return true;
+}
+
+void PixelBufferRing::setUnpackStorage(const Int alignment) {
+    glPixelStorei(GL_UNPACK_ALIGNMENT, alignment);
+    glPixelStorei(GL_UNPACK_ROW_LENGTH, 0);
+    glPixelStorei(GL_UNPACK_IMAGE_HEIGHT, 0);
+    glPixelStorei(GL_UNPACK_SKIP_PIXELS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_ROWS, 0);
+    glPixelStorei(GL_UNPACK_SKIP_IMAGES, 0);
+}
+
+bool PixelBufferRing::setSubImage(GL::Texture2D& texture, const Int level, const ImageView2D& image) {
+    std::size_t offset;
+    if(!copy(image.data(), offset)) return false;
+
+    glBindTexture(GL_TEXTURE_2D, texture.id());
+    setUnpackStorage(image.storage().alignment());
+    glTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, image.size().x(), image.size().y(),
+        GLenum(GL::pixelFormat(image.format())),
+        GLenum(GL::pixelType(image.format())),
+        reinterpret_cast<GLvoid*>(offset));
+
+    fence(offset, image.data().size());
+    return true;
+}
+
+bool PixelBufferRing::setCompressedSubImage(GL::Texture2D& texture, const Int level, const CompressedImageView2D& image) {
+    std::size_t offset;
+    if(!copy(image.data(), offset)) return false;
+
+    glBindTexture(GL_TEXTURE_2D, texture.id());
+    glCompressedTexSubImage2D(GL_TEXTURE_2D, level, 0, 0, image.size().x(), image.size().y(),
+        GLenum(GL::compressedPixelFormat(image.format())), image.data().size(),
+        reinterpret_cast<GLvoid*>(offset));
+
+    fence(offset, image.data().size());
+    return true;
+}
+
+bool PixelBufferRing::setSubImage(GL::Texture2DArray& texture, const Int level, const Int layer, const ImageView2D& image) {
+    std::size_t offset;
+    if(!copy(image.data(), offset)) return false;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture.id());
+    setUnpackStorage(image.storage().alignment());
+    glTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, image.size().x(), image.size().y(), 1,
+        GLenum(GL::pixelFormat(image.format())),
+        GLenum(GL::pixelType(image.format())),
+        reinterpret_cast<GLvoid*>(offset));
+
+    fence(offset, image.data().size());
+    return true;
+}
+
+bool PixelBufferRing::setCompressedSubImage(GL::Texture2DArray& texture, const Int level, const Int layer, const CompressedImageView2D& image) {
+    std::size_t offset;
+    if(!copy(image.data(), offset)) return false;
+
+    glBindTexture(GL_TEXTURE_2D_ARRAY, texture.id());
+    glCompressedTexSubImage3D(GL_TEXTURE_2D_ARRAY, level, 0, 0, layer, image.size().x(), image.size().y(), 1,
+        GLenum(GL::compressedPixelFormat(image.format())), image.data().size(),
+        reinterpret_cast<GLvoid*>(offset));
+
+    fence(offset, image.data().size());
+    return true;
+}
+
+}
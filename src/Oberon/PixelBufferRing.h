@@ -0,0 +1,84 @@
+#ifndef Oberon_PixelBufferRing_h
+#define Oberon_PixelBufferRing_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <deque>
+#include <Corrade/Containers/ArrayView.h>
+#include <Magnum/GL/Buffer.h>
+#include <Magnum/GL/GL.h>
+
+#include "Oberon/Oberon.h"
+
+typedef struct __GLsync* GLsync;
+
+namespace Oberon {
+
+/* Uploads textures through a ring of persistently mapped pixel buffers. The
+   data is copied to the ring and the driver transfers it asynchronously,
+   with a fence per upload so the range is reused only once the transfer is
+   done. Requires ARB_buffer_storage. */
+class PixelBufferRing {
+    public:
+        explicit PixelBufferRing(std::size_t size);
+
+        PixelBufferRing(const PixelBufferRing&) = delete;
+        PixelBufferRing& operator=(const PixelBufferRing&) = delete;
+
+        ~PixelBufferRing();
+
+        bool isSupported() const { return !_memory.empty(); }
+
+        /* Returns false if unsupported or the image is larger than the
+           ring, the caller then has to upload it itself. The texture needs
+           to have its storage set already. */
+        bool setSubImage(GL::Texture2D& texture, Int level, const ImageView2D& image);
+        bool setCompressedSubImage(GL::Texture2D& texture, Int level, const CompressedImageView2D& image);
+
+        /* Uploads the image to one layer of the array */
+        bool setSubImage(GL::Texture2DArray& texture, Int level, Int layer, const ImageView2D& image);
+        bool setCompressedSubImage(GL::Texture2DArray& texture, Int level, Int layer, const CompressedImageView2D& image);
+
+    private:
+        struct Fence {
+            std::size_t begin, end;
+            GLsync sync;
+        };
+
+        /* Copies the data to the ring and binds the buffer. False if
+           unsupported or the data doesn't fit. */
+        bool copy(Containers::ArrayView<const char> data, std::size_t& offset);
+        void setUnpackStorage(Int alignment);
+        std::size_t allocate(std::size_t size);
+        void fence(std::size_t offset, std::size_t size);
+
+        GL::Buffer _buffer;
+        Containers::ArrayView<char> _memory;
+        std::size_t _head{};
+        std::deque<Fence> _fences;
+};
+
+}
+
+#endif
@@ -0,0 +1,144 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ResidencyManager.h"
+
+#include <algorithm>
+#include <vector>
+#include <Magnum/ResourceManager.h>
+#include <Magnum/GL/Mesh.h>
+#include <Magnum/GL/Texture.h>
+
+namespace Oberon {
+
+ResidencyManager& ResidencyManager::setSource(Containers::Pointer<Source>&& source) {
+    _source = std::move(source);
+    return *this;
+}
+
+ResidencyManager::Entry& ResidencyManager::add(const Type type, const UnsignedInt id, const std::string& key, const std::size_t size, const UnsignedInt levelCount) {
+    Entry& entry = set(Entry{type, id, key, size, size, levelCount, 0, _frame, false, false, false});
+    _residentSize += size;
+    return entry;
+}
+
+ResidencyManager::Entry& ResidencyManager::addPending(const Type type, const UnsignedInt id, const std::string& key, const std::size_t size, const UnsignedInt levelCount) {
+    return set(Entry{type, id, key, size, 0, levelCount, levelCount, _frame, false, true, false});
+}
+
+ResidencyManager::Entry& ResidencyManager::set(Entry&& entry) {
+    Containers::Pointer<Entry>& existing = _entries[entry.key];
+    if(existing) {
+        _residentSize -= existing->residentSize;
+        *existing = std::move(entry);
+    } else existing.emplace(std::move(entry));
+    return *existing;
+}
+
+ResidencyManager::Entry* ResidencyManager::find(const std::string& key) {
+    auto found = _entries.find(key);
+    return found == _entries.end() ? nullptr : found->second.get();
+}
+
+const ResidencyManager::Entry* ResidencyManager::find(const std::string& key) const {
+    auto found = _entries.find(key);
+    return found == _entries.end() ? nullptr : found->second.get();
+}
+
+/* The fallback is used until it's loaded again */
+void ResidencyManager::evict(SceneResourceManager& manager, Entry& entry) {
+    if(entry.type == Type::Mesh)
+        manager.set<GL::Mesh>(entry.key, static_cast<GL::Mesh*>(nullptr), ResourceDataState::Loading, ResourcePolicy::Resident);
+    else
+        manager.set<GL::Texture2D>(entry.key, static_cast<GL::Texture2D*>(nullptr), ResourceDataState::Loading, ResourcePolicy::Resident);
+
+    _residentSize -= entry.residentSize;
+    entry.residentSize = 0;
+    entry.skippedLevels = entry.levelCount;
+}
+
+void ResidencyManager::update(SceneResourceManager& manager) {
+    ++_frame;
+    if(!_source) return;
+
+    /* Take over what got restored since the last frame. If the reload
+       failed, the resource stays as it was and is not tried again until
+       it's used in some later frame. */
+    for(const Source::Loaded& loaded: _source->upload(manager)) {
+        Entry& entry = *loaded.entry;
+        entry.loading = false;
+        if(!loaded.size) continue;
+
+        _residentSize += loaded.size;
+        _residentSize -= entry.residentSize;
+        entry.residentSize = loaded.size;
+        entry.skippedLevels = loaded.skipLevels;
+    }
+
+    /* Request everything that was needed in this frame. The drawables use
+       the fallbacks or lower levels until it's restored. */
+    for(auto& it: _entries) {
+        Entry& entry = *it.second;
+        if(!entry.used) continue;
+
+        entry.used = false;
+        entry.lastUsedFrame = _frame;
+        if(entry.skippedLevels && !entry.pending && !entry.loading) {
+            entry.loading = true;
+            _source->request(entry, 0);
+        }
+    }
+
+    if(!_budget || _residentSize <= _budget) return;
+
+    /* Go from the least recently used resources not drawn in this frame,
+       first halve the resolution of textures and evict only if it's not
+       enough */
+    std::vector<Entry*> candidates;
+    for(auto& it: _entries)
+        if(it.second->lastUsedFrame != _frame && it.second->skippedLevels != it.second->levelCount && !it.second->pending && !it.second->loading)
+            candidates.push_back(it.second.get());
+    std::sort(candidates.begin(), candidates.end(), [](const Entry* a, const Entry* b) {
+        return a->lastUsedFrame < b->lastUsedFrame;
+    });
+
+    for(Entry* entry: candidates) {
+        if(_residentSize <= _budget) return;
+        if(entry->skippedLevels + 1 >= entry->levelCount) continue;
+
+        const std::size_t size = _source->reduce(manager, *entry);
+        if(!size) continue;
+        _residentSize += size;
+        _residentSize -= entry->residentSize;
+        entry->residentSize = size;
+        ++entry->skippedLevels;
+    }
+
+    for(Entry* entry: candidates) {
+        if(_residentSize <= _budget) return;
+        evict(manager, *entry);
+    }
+}
+
+}
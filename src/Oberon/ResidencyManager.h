@@ -0,0 +1,142 @@
+#ifndef Oberon_ResidencyManager_h
+#define Oberon_ResidencyManager_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <unordered_map>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+/* Keeps the GPU memory used by the meshes and textures of a scene under a
+   budget. Resources that weren't drawn for the longest time are first
+   reduced to their lower mip levels and then evicted, with the fallback of
+   the resource manager used in their place. Once drawn again, they're
+   reloaded from the source in the background. */
+class ResidencyManager {
+    public:
+        enum class Type: UnsignedByte {
+            Mesh,
+            Texture
+        };
+
+        struct Entry {
+            Type type;
+            /* Mesh or texture ID in the source */
+            UnsignedInt id;
+            std::string key;
+            /* Size with all levels and the size currently on the GPU */
+            std::size_t size, residentSize;
+            /* Count of mip levels the texture can be reduced by */
+            UnsignedInt levelCount;
+            UnsignedInt skippedLevels;
+            UnsignedLong lastUsedFrame;
+            bool used;
+            /* Not uploaded yet, neither restored nor evicted */
+            bool pending;
+            /* Being reloaded by the source, left alone until it's done */
+            bool loading;
+        };
+
+        /* Recreates evicted or reduced resources */
+        class Source {
+            public:
+                struct Loaded {
+                    Entry* entry;
+                    UnsignedInt skipLevels;
+                    /* Size on the GPU or 0 on failure */
+                    std::size_t size;
+                };
+
+                virtual ~Source() = default;
+
+                /* Starts recreating the resource with given count of top
+                   mip levels skipped. The entry stays valid until it's
+                   returned from upload(). */
+                virtual void request(Entry& entry, UnsignedInt skipLevels) = 0;
+
+                /* Sets the resources recreated since the last call to the
+                   resource manager as mutable, as many as the upload budget
+                   allows */
+                virtual Containers::Array<Loaded> upload(SceneResourceManager& manager) = 0;
+
+                /* Drops the top mip level of a resident texture. Returns
+                   the new size on the GPU or 0 if it's not possible. */
+                virtual std::size_t reduce(SceneResourceManager& manager, const Entry& entry) = 0;
+        };
+
+        /* Zero means unlimited */
+        std::size_t budget() const { return _budget; }
+        ResidencyManager& setBudget(std::size_t budget) {
+            _budget = budget;
+            return *this;
+        }
+
+        /* Without a source nothing is evicted */
+        ResidencyManager& setSource(Containers::Pointer<Source>&& source);
+
+        /* Starts tracking a resource that's already in the resource manager.
+           It has to be set there as mutable so it can be replaced. */
+        Entry& add(Type type, UnsignedInt id, const std::string& key, std::size_t size, UnsignedInt levelCount = 1);
+
+        /* Starts tracking a resource whose upload is still pending, so
+           drawables can reference the entry already. It's left alone until
+           add() is called for it once it's uploaded. Existing entries are
+           updated in place by both, so the pointers stay valid. */
+        Entry& addPending(Type type, UnsignedInt id, const std::string& key, std::size_t size, UnsignedInt levelCount = 1);
+
+        /* Null if the resource isn't tracked */
+        Entry* find(const std::string& key);
+        const Entry* find(const std::string& key) const;
+
+        /* Marks the resource as drawn in this frame */
+        static void use(Entry* entry) {
+            if(entry) entry->used = true;
+        }
+
+        std::size_t residentSize() const { return _residentSize; }
+
+        /* To be called once per frame after drawing. Requests the resources
+           used in this frame to be restored, takes over the restored ones
+           and reduces or evicts the least recently used ones if over the
+           budget. */
+        void update(SceneResourceManager& manager);
+
+    private:
+        Entry& set(Entry&& entry);
+        void evict(SceneResourceManager& manager, Entry& entry);
+
+        std::size_t _budget{}, _residentSize{};
+        UnsignedLong _frame{};
+        Containers::Pointer<Source> _source;
+        std::unordered_map<std::string, Containers::Pointer<Entry>> _entries;
+};
+
+}
+
+#endif
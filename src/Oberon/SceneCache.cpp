@@ -0,0 +1,890 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "SceneCache.h"
+
+#include <cstdlib>
+#include <cstring>
+#include <sys/stat.h>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Magnum/VertexFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/Hash.h"
+
+namespace Oberon { namespace SceneCache {
+
+namespace Implementation {
+
+struct ImageEntry {
+    bool compressed;
+    UnsignedInt format;
+    Int alignment;
+    Vector2i size;
+
+    struct Level {
+        UnsignedLong offset, size;
+    };
+    Containers::Array<Level> levels;
+};
+
+struct MeshEntry {
+    struct Attribute {
+        UnsignedShort name;
+        UnsignedShort arraySize;
+        UnsignedInt format;
+        UnsignedLong offset;
+        Int stride;
+    };
+
+    UnsignedInt primitive;
+    UnsignedInt vertexCount;
+    UnsignedLong vertexDataOffset, vertexDataSize;
+    bool indexed;
+    UnsignedInt indexType;
+    UnsignedLong indexDataOffset, indexDataSize;
+    UnsignedLong indexOffset;
+    UnsignedInt indexCount;
+    Containers::Array<Attribute> attributes;
+};
+
+}
+
+namespace {
+
+/* Bump when the format changes */
+constexpr UnsignedInt Version = 8;
+constexpr char Magic[8]{'O', 'B', 'E', 'R', 'O', 'N', 'S', 'C'};
+
+/* Blobs are aligned so vertex data can be used directly from the mapping */
+constexpr UnsignedLong BlobAlignment = 16;
+
+struct Header {
+    char magic[8];
+    UnsignedInt version;
+    UnsignedInt padding;
+    UnsignedLong metadataOffset;
+    UnsignedLong metadataSize;
+};
+
+struct SourceIdentification {
+    UnsignedLong size;
+    Long modificationTime;
+};
+
+/* Whether the indices in the tables point inside of them, so a corrupted
+   cache can't make the scene creation read out of bounds */
+bool validReferences(const Scene& scene) {
+    const auto valid = [](const Int index, const std::size_t size) {
+        return index == -1 || (index >= 0 && std::size_t(index) < size);
+    };
+    const auto validObjects = [&](const std::vector<UnsignedInt>& objects) {
+        for(const UnsignedInt object: objects)
+            if(object >= scene.objects.size()) return false;
+        return true;
+    };
+
+    for(const Containers::Optional<Texture>& texture: scene.textures)
+        if(texture && texture->image >= scene.imageCount) return false;
+    for(const Containers::Optional<Material>& material: scene.materials)
+        if(material && (!valid(material->diffuseTexture, scene.textures.size()) ||
+                        !valid(material->normalTexture, scene.textures.size())))
+            return false;
+    for(const Containers::Optional<Object>& object: scene.objects) {
+        if(!object) continue;
+        if(!validObjects(object->children) ||
+           !valid(object->material, scene.materials.size()) ||
+           (object->instanceType == Trade::ObjectInstanceType3D::Mesh && !valid(object->instance, scene.meshCount)) ||
+           (object->instanceType == Trade::ObjectInstanceType3D::Light && !valid(object->instance, scene.lights.size())))
+            return false;
+    }
+    if(scene.children && !validObjects(*scene.children)) return false;
+    for(const Batch& batch: scene.batches)
+        if(!validObjects(batch.objects) || batch.indexOffsets.size() != batch.objects.size() + 1)
+            return false;
+    for(const HlodCluster& cluster: scene.hlods)
+        if(!validObjects(cluster.objects)) return false;
+
+    return true;
+}
+
+/* Formats the loader can produce and Magnum can use. A cache with anything
+   else is rejected, as the image views and the GL format translation would
+   assert on it, and such images are not written to it in the first place. */
+bool validPixelFormat(const PixelFormat format) {
+    switch(format) {
+        case PixelFormat::R8Unorm:
+        case PixelFormat::RG8Unorm:
+        case PixelFormat::RGB8Unorm:
+        case PixelFormat::RGBA8Unorm:
+        case PixelFormat::R8Srgb:
+        case PixelFormat::RG8Srgb:
+        case PixelFormat::RGB8Srgb:
+        case PixelFormat::RGBA8Srgb:
+        case PixelFormat::R16Unorm:
+        case PixelFormat::RG16Unorm:
+        case PixelFormat::RGB16Unorm:
+        case PixelFormat::RGBA16Unorm:
+            return true;
+        default: return false;
+    }
+}
+
+bool validCompressedPixelFormat(const CompressedPixelFormat format) {
+    switch(format) {
+        case CompressedPixelFormat::Bc1RGBUnorm:
+        case CompressedPixelFormat::Bc1RGBSrgb:
+        case CompressedPixelFormat::Bc1RGBAUnorm:
+        case CompressedPixelFormat::Bc1RGBASrgb:
+        case CompressedPixelFormat::Bc2RGBAUnorm:
+        case CompressedPixelFormat::Bc2RGBASrgb:
+        case CompressedPixelFormat::Bc3RGBAUnorm:
+        case CompressedPixelFormat::Bc3RGBASrgb:
+        case CompressedPixelFormat::Bc4RUnorm:
+        case CompressedPixelFormat::Bc4RSnorm:
+        case CompressedPixelFormat::Bc5RGUnorm:
+        case CompressedPixelFormat::Bc5RGSnorm:
+        case CompressedPixelFormat::Bc6hRGBUfloat:
+        case CompressedPixelFormat::Bc6hRGBSfloat:
+        case CompressedPixelFormat::Bc7RGBAUnorm:
+        case CompressedPixelFormat::Bc7RGBASrgb:
+        case CompressedPixelFormat::EacR11Unorm:
+        case CompressedPixelFormat::EacR11Snorm:
+        case CompressedPixelFormat::EacRG11Unorm:
+        case CompressedPixelFormat::EacRG11Snorm:
+        case CompressedPixelFormat::Etc2RGB8Unorm:
+        case CompressedPixelFormat::Etc2RGB8Srgb:
+        case CompressedPixelFormat::Etc2RGB8A1Unorm:
+        case CompressedPixelFormat::Etc2RGB8A1Srgb:
+        case CompressedPixelFormat::Etc2RGBA8Unorm:
+        case CompressedPixelFormat::Etc2RGBA8Srgb:
+            return true;
+        default: return false;
+    }
+}
+
+/* Whether the format is known and every level is large enough for its size
+   in it */
+bool validImage(const Implementation::ImageEntry& image) {
+    if(image.compressed ? !validCompressedPixelFormat(CompressedPixelFormat(image.format)) : !validPixelFormat(PixelFormat(image.format)))
+        return false;
+    if(image.size.x() <= 0 || image.size.y() <= 0 || image.levels.empty() ||
+       image.levels.size() > UnsignedInt(Math::log2(image.size.max())) + 1 ||
+       (image.alignment != 1 && image.alignment != 2 && image.alignment != 4 && image.alignment != 8))
+        return false;
+
+    for(std::size_t i = 0; i != image.levels.size(); ++i) {
+        const Vector2i size = Math::max(image.size >> Int(i), Vector2i{1});
+        UnsignedLong levelSize;
+        if(image.compressed) {
+            const CompressedPixelFormat format = CompressedPixelFormat(image.format);
+            const Vector2i blockSize = compressedBlockSize(format).xy();
+            const Vector2i blockCount = (size + blockSize - Vector2i{1})/blockSize;
+            levelSize = UnsignedLong(blockCount.x())*blockCount.y()*compressedBlockDataSize(format);
+        } else {
+            const UnsignedLong rowSize = UnsignedLong(size.x())*pixelSize(PixelFormat(image.format));
+            levelSize = (rowSize + image.alignment - 1)/image.alignment*image.alignment*size.y();
+        }
+        if(image.levels[i].size < levelSize) return false;
+    }
+
+    return true;
+}
+
+bool validPrimitive(const UnsignedInt primitive) {
+    switch(MeshPrimitive(primitive)) {
+        case MeshPrimitive::Points:
+        case MeshPrimitive::Lines:
+        case MeshPrimitive::LineLoop:
+        case MeshPrimitive::LineStrip:
+        case MeshPrimitive::Triangles:
+        case MeshPrimitive::TriangleStrip:
+        case MeshPrimitive::TriangleFan:
+            return true;
+        default: return false;
+    }
+}
+
+/* Vertex formats with 8-, 16- and 32-bit components, which covers everything
+   the importer and the quantization produce */
+bool validVertexFormat(const VertexFormat format) {
+    switch(format) {
+        case VertexFormat::Float:
+        case VertexFormat::UnsignedByte:
+        case VertexFormat::UnsignedShort:
+        case VertexFormat::UnsignedInt:
+        case VertexFormat::Vector2:
+        case VertexFormat::Vector2h:
+        case VertexFormat::Vector2ub:
+        case VertexFormat::Vector2ubNormalized:
+        case VertexFormat::Vector2b:
+        case VertexFormat::Vector2bNormalized:
+        case VertexFormat::Vector2us:
+        case VertexFormat::Vector2usNormalized:
+        case VertexFormat::Vector2s:
+        case VertexFormat::Vector2sNormalized:
+        case VertexFormat::Vector3:
+        case VertexFormat::Vector3h:
+        case VertexFormat::Vector3ub:
+        case VertexFormat::Vector3ubNormalized:
+        case VertexFormat::Vector3b:
+        case VertexFormat::Vector3bNormalized:
+        case VertexFormat::Vector3us:
+        case VertexFormat::Vector3usNormalized:
+        case VertexFormat::Vector3s:
+        case VertexFormat::Vector3sNormalized:
+        case VertexFormat::Vector4:
+        case VertexFormat::Vector4h:
+        case VertexFormat::Vector4ubNormalized:
+        case VertexFormat::Vector4bNormalized:
+        case VertexFormat::Vector4usNormalized:
+        case VertexFormat::Vector4sNormalized:
+            return true;
+        default: return false;
+    }
+}
+
+/* Same rules as Trade::MeshAttributeData asserts on */
+bool validAttribute(const Trade::MeshAttribute name, const VertexFormat format, const UnsignedShort arraySize) {
+    if(!validVertexFormat(format)) return false;
+    if(Trade::isMeshAttributeCustom(name)) return true;
+    if(arraySize) return false;
+
+    const UnsignedInt count = vertexFormatComponentCount(format);
+    const VertexFormat component = vertexFormatComponentFormat(format);
+    const bool normalized = isVertexFormatNormalized(format);
+    const bool floatingPoint = component == VertexFormat::Float || component == VertexFormat::Half;
+    const bool signedNormalized = normalized && (component == VertexFormat::Byte || component == VertexFormat::Short);
+    switch(name) {
+        case Trade::MeshAttribute::Position:
+            return (count == 2 || count == 3) && component != VertexFormat::UnsignedInt;
+        case Trade::MeshAttribute::TextureCoordinates:
+            return count == 2 && component != VertexFormat::UnsignedInt;
+        case Trade::MeshAttribute::Normal:
+        case Trade::MeshAttribute::Bitangent:
+            return count == 3 && (floatingPoint || signedNormalized);
+        case Trade::MeshAttribute::Tangent:
+            return (count == 3 || count == 4) && (floatingPoint || signedNormalized);
+        case Trade::MeshAttribute::Color:
+            return (count == 3 || count == 4) && (floatingPoint || (normalized && !signedNormalized));
+        default: return false;
+    }
+}
+
+/* Index ranges of the levels of detail inside the mesh and occluder
+   triangles inside their positions, as the LOD selection and the occlusion
+   rasterizer don't check either */
+bool validMeshData(const Scene& scene, Containers::ArrayView<const Containers::Pointer<Implementation::MeshEntry>> meshes) {
+    for(UnsignedInt i = 0; i != scene.meshCount; ++i) {
+        if(scene.meshLods[i].empty()) continue;
+        if(!meshes[i] || !meshes[i]->indexed) return false;
+        for(const MeshSimplifier::Lod& lod: scene.meshLods[i])
+            if(UnsignedLong(lod.indexOffset) + lod.indexCount > meshes[i]->indexCount)
+                return false;
+    }
+
+    for(const OcclusionCulling::Occluder& occluder: scene.meshOccluders) {
+        if(occluder.indices.size() % 3) return false;
+        for(const UnsignedInt index: occluder.indices)
+            if(index >= occluder.positions.size()) return false;
+    }
+
+    for(std::size_t i = 0; i != scene.batches.size(); ++i) {
+        const Containers::Pointer<Implementation::MeshEntry>& mesh = meshes[scene.meshCount + i];
+        const std::vector<UnsignedInt>& offsets = scene.batches[i].indexOffsets;
+        if(!mesh) continue;
+        for(std::size_t j = 0; j + 1 < offsets.size(); ++j)
+            if(offsets[j] > offsets[j + 1]) return false;
+        if(!mesh->indexed || offsets.back() > mesh->indexCount) return false;
+    }
+
+    return true;
+}
+
+bool validIndexType(const UnsignedInt type) {
+    switch(MeshIndexType(type)) {
+        case MeshIndexType::UnsignedByte:
+        case MeshIndexType::UnsignedShort:
+        case MeshIndexType::UnsignedInt:
+            return true;
+    }
+    return false;
+}
+
+bool identify(const std::string& path, SourceIdentification& out) {
+    struct stat status;
+    if(stat(path.data(), &status) != 0) return false;
+
+    out.size = UnsignedLong(status.st_size);
+    out.modificationTime = Long(status.st_mtime);
+    return true;
+}
+
+UnsignedLong contentHash(const std::string& path) {
+    const Containers::Array<const char, Utility::Directory::MapDeleter> data = Utility::Directory::mapRead(path);
+    return hash(Containers::arrayView(data));
+}
+
+template<class T> void write(Containers::Array<char>& out, const T& value) {
+    arrayAppend(out, Containers::arrayView(reinterpret_cast<const char*>(&value), sizeof(T)));
+}
+
+void write(Containers::Array<char>& out, const std::string& value) {
+    write(out, UnsignedInt(value.size()));
+    arrayAppend(out, Containers::arrayView(value.data(), value.size()));
+}
+
+void write(Containers::Array<char>& out, const std::vector<UnsignedInt>& value) {
+    write(out, UnsignedInt(value.size()));
+    for(UnsignedInt i: value) write(out, i);
+}
+
+void write(Containers::Array<char>& out, const Object& value) {
+    write(out, value.name);
+    write(out, value.children);
+    write(out, value.instanceType);
+    write(out, value.instance);
+    write(out, value.material);
+    write(out, value.hasTranslationRotationScaling);
+    write(out, value.translation);
+    write(out, value.rotation);
+    write(out, value.scaling);
+    write(out, value.transformation);
+}
+
+void write(Containers::Array<char>& out, const Batch& value) {
+    write(out, value.objects);
+    write(out, value.indexOffsets);
+}
+
+void write(Containers::Array<char>& out, const HlodCluster& value) {
+    write(out, value.objects);
+    write(out, value.bounds);
+}
+
+template<class T> void write(Containers::Array<char>& out, const Containers::Array<T>& value);
+
+void write(Containers::Array<char>& out, const OcclusionCulling::Occluder& value) {
+    write(out, value.positions);
+    write(out, value.indices);
+}
+
+template<class T> void write(Containers::Array<char>& out, const Containers::Array<T>& value) {
+    write(out, UnsignedInt(value.size()));
+    for(const T& i: value) write(out, i);
+}
+
+template<class T> void write(Containers::Array<char>& out, const Containers::Array<Containers::Optional<T>>& value) {
+    write(out, UnsignedInt(value.size()));
+    for(const Containers::Optional<T>& i: value) {
+        write(out, bool(i));
+        if(i) write(out, *i);
+    }
+}
+
+class Deserializer {
+    public:
+        explicit Deserializer(Containers::ArrayView<const char> data): _data{data} {}
+
+        template<class T> bool read(T& value) {
+            if(_data.size() < sizeof(T)) return false;
+            std::memcpy(&value, _data.data(), sizeof(T));
+            _data = _data.suffix(sizeof(T));
+            return true;
+        }
+
+        bool read(std::string& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < size) return false;
+            value.assign(_data.data(), size);
+            _data = _data.suffix(size);
+            return true;
+        }
+
+        bool read(std::vector<UnsignedInt>& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < std::size_t(size)*sizeof(UnsignedInt)) return false;
+            value.resize(size);
+            for(UnsignedInt& i: value) read(i);
+            return true;
+        }
+
+        template<class T> bool read(Containers::Array<T>& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < std::size_t(size)*sizeof(T)) return false;
+            value = Containers::Array<T>{size};
+            for(T& i: value) read(i);
+            return true;
+        }
+
+        bool read(Batch& value) {
+            return read(value.objects) && read(value.indexOffsets) &&
+                value.indexOffsets.size() == value.objects.size() + 1;
+        }
+
+        bool read(HlodCluster& value) {
+            return read(value.objects) && read(value.bounds);
+        }
+
+        bool read(OcclusionCulling::Occluder& value) {
+            return read(value.positions) && read(value.indices);
+        }
+
+        bool read(Containers::Array<Batch>& value) {
+            return readEach(value);
+        }
+
+        bool read(Containers::Array<OcclusionCulling::Occluder>& value) {
+            return readEach(value);
+        }
+
+        bool read(Containers::Array<HlodCluster>& value) {
+            return readEach(value);
+        }
+
+        template<class T> bool read(Containers::Array<Containers::Array<T>>& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < std::size_t(size)*sizeof(UnsignedInt)) return false;
+            value = Containers::Array<Containers::Array<T>>{size};
+            for(Containers::Array<T>& i: value)
+                if(!read(i)) return false;
+            return true;
+        }
+
+        template<class T> bool read(Containers::Array<Containers::Optional<T>>& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < size) return false;
+            value = Containers::Array<Containers::Optional<T>>{size};
+            for(Containers::Optional<T>& i: value) {
+                bool present;
+                if(!read(present)) return false;
+                if(!present) continue;
+
+                i.emplace();
+                if(!read(*i)) return false;
+            }
+            return true;
+        }
+
+        bool read(Object& value) {
+            return read(value.name) &&
+                read(value.children) &&
+                read(value.instanceType) &&
+                read(value.instance) &&
+                read(value.material) &&
+                read(value.hasTranslationRotationScaling) &&
+                read(value.translation) &&
+                read(value.rotation) &&
+                read(value.scaling) &&
+                read(value.transformation);
+        }
+
+    private:
+        /* Arrays of structures that aren't copied as a whole */
+        template<class T> bool readEach(Containers::Array<T>& value) {
+            UnsignedInt size;
+            if(!read(size) || _data.size() < size) return false;
+            value = Containers::Array<T>{size};
+            for(T& i: value)
+                if(!read(i)) return false;
+            return true;
+        }
+
+        Containers::ArrayView<const char> _data;
+};
+
+}
+
+std::string defaultDirectory() {
+    const char* cacheHome = std::getenv("XDG_CACHE_HOME");
+    const std::string base = cacheHome && *cacheHome ? std::string{cacheHome} :
+        Utility::Directory::join(Utility::Directory::home(), ".cache");
+    return Utility::Directory::join(base, "oberon");
+}
+
+std::string filename(const std::string& directory, const std::string& path, const std::string& variant) {
+    return Utility::Directory::join(directory, Utility::formatString("{:.16x}{}.scene",
+        hash({path.data(), path.size()}), variant));
+}
+
+Writer::Writer(const std::string& filename, UnsignedInt imageCount, UnsignedInt meshCount): _filename{filename}, _file{}, _offset{sizeof(Header)}, _images{imageCount}, _meshes{meshCount} {
+    if(!Utility::Directory::mkpath(Utility::Directory::path(filename))) return;
+
+    /* The header gets filled on finish() */
+    _file = std::fopen((filename + ".tmp").data(), "wb");
+    const Header header{};
+    if(_file && std::fwrite(&header, sizeof(Header), 1, _file) != 1) _failed = true;
+}
+
+Writer::~Writer() {
+    if(!_file) return;
+
+    std::fclose(_file);
+    Utility::Directory::rm(_filename + ".tmp");
+}
+
+UnsignedLong Writer::writeBlob(const Containers::ArrayView<const char> data) {
+    /* Pad to the blob alignment */
+    const char padding[BlobAlignment]{};
+    const std::size_t paddingSize = (BlobAlignment - _offset%BlobAlignment)%BlobAlignment;
+    if(std::fwrite(padding, 1, paddingSize, _file) != paddingSize ||
+       std::fwrite(data.data(), 1, data.size(), _file) != data.size())
+        _failed = true;
+
+    const UnsignedLong offset = _offset + paddingSize;
+    _offset = offset + data.size();
+    return offset;
+}
+
+void Writer::writeImage(const UnsignedInt id, const Image& image) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if(!_file || _failed) return;
+
+    /* The reader wouldn't accept anything else */
+    if(image.compressed ? !validCompressedPixelFormat(image.compressedFormat) : !validPixelFormat(image.format))
+        return;
+
+    Containers::Pointer<Implementation::ImageEntry> entry{Containers::InPlaceInit};
+    entry->compressed = image.compressed;
+    entry->format = image.compressed ? UnsignedInt(image.compressedFormat) : UnsignedInt(image.format);
+    entry->alignment = image.alignment;
+    entry->size = image.size;
+    entry->levels = Containers::Array<Implementation::ImageEntry::Level>{image.levels.size()};
+    for(std::size_t i = 0; i != image.levels.size(); ++i)
+        entry->levels[i] = {writeBlob(image.levels[i]), image.levels[i].size()};
+
+    _images[id] = std::move(entry);
+}
+
+void Writer::writeMesh(const UnsignedInt id, const Trade::MeshData& mesh) {
+    std::lock_guard<std::mutex> lock{_mutex};
+    if(!_file || _failed) return;
+
+    Containers::Pointer<Implementation::MeshEntry> entry{Containers::InPlaceInit};
+    entry->primitive = UnsignedInt(mesh.primitive());
+    entry->vertexCount = mesh.vertexCount();
+    entry->vertexDataOffset = writeBlob(mesh.vertexData());
+    entry->vertexDataSize = mesh.vertexData().size();
+    entry->indexed = mesh.isIndexed();
+    if(mesh.isIndexed()) {
+        entry->indexType = UnsignedInt(mesh.indexType());
+        entry->indexDataOffset = writeBlob(mesh.indexData());
+        entry->indexDataSize = mesh.indexData().size();
+        entry->indexOffset = mesh.indexOffset();
+        entry->indexCount = mesh.indexCount();
+    }
+
+    entry->attributes = Containers::Array<Implementation::MeshEntry::Attribute>{mesh.attributeCount()};
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i) {
+        Implementation::MeshEntry::Attribute& attribute = entry->attributes[i];
+        attribute.name = UnsignedShort(mesh.attributeName(i));
+        attribute.arraySize = mesh.attributeArraySize(i);
+        attribute.format = UnsignedInt(mesh.attributeFormat(i));
+        attribute.offset = mesh.attributeOffset(i);
+        attribute.stride = mesh.attributeStride(i);
+    }
+
+    if(id >= _meshes.size()) arrayResize(_meshes, id + 1);
+    _meshes[id] = std::move(entry);
+}
+
+bool Writer::finish(const std::string& path, const Scene& scene) {
+    if(!_file || _failed) return false;
+
+    /* Identify the source file the cache is made from */
+    SourceIdentification source;
+    if(!identify(path, source)) return false;
+
+    Containers::Array<char> metadata;
+    write(metadata, source);
+    write(metadata, contentHash(path));
+
+    /* Scene description */
+    write(metadata, scene.textures);
+    write(metadata, scene.materials);
+    write(metadata, scene.lights);
+    write(metadata, scene.objects);
+    write(metadata, bool(scene.children));
+    if(scene.children) write(metadata, *scene.children);
+    write(metadata, scene.meshDequantizations);
+    write(metadata, scene.meshBounds);
+    write(metadata, scene.meshBoundingBoxes);
+    write(metadata, scene.meshLods);
+    write(metadata, scene.meshOptimizations);
+    write(metadata, scene.meshOccluders);
+    write(metadata, scene.batches);
+    write(metadata, scene.hlods);
+
+    /* Image and mesh locations. Ones that failed to import are marked as
+       missing. */
+    write(metadata, UnsignedInt(_images.size()));
+    for(const Containers::Pointer<Implementation::ImageEntry>& image: _images) {
+        write(metadata, bool(image));
+        if(!image) continue;
+
+        write(metadata, image->compressed);
+        write(metadata, image->format);
+        write(metadata, image->alignment);
+        write(metadata, image->size);
+        write(metadata, UnsignedInt(image->levels.size()));
+        for(const Implementation::ImageEntry::Level& level: image->levels)
+            write(metadata, level);
+    }
+
+    const std::size_t meshCount = scene.meshCount + scene.batches.size() + scene.hlods.size();
+    if(_meshes.size() < meshCount) arrayResize(_meshes, meshCount);
+    write(metadata, UnsignedInt(_meshes.size()));
+    for(const Containers::Pointer<Implementation::MeshEntry>& mesh: _meshes) {
+        write(metadata, bool(mesh));
+        if(!mesh) continue;
+
+        write(metadata, mesh->primitive);
+        write(metadata, mesh->vertexCount);
+        write(metadata, mesh->vertexDataOffset);
+        write(metadata, mesh->vertexDataSize);
+        write(metadata, mesh->indexed);
+        write(metadata, mesh->indexType);
+        write(metadata, mesh->indexDataOffset);
+        write(metadata, mesh->indexDataSize);
+        write(metadata, mesh->indexOffset);
+        write(metadata, mesh->indexCount);
+        write(metadata, UnsignedInt(mesh->attributes.size()));
+        for(const Implementation::MeshEntry::Attribute& attribute: mesh->attributes)
+            write(metadata, attribute);
+    }
+
+    Header header{};
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.metadataOffset = writeBlob(metadata);
+    header.metadataSize = metadata.size();
+
+    if(_failed || std::fseek(_file, 0, SEEK_SET) != 0 ||
+       std::fwrite(&header, sizeof(Header), 1, _file) != 1) {
+        Warning{} << "Cannot write the scene cache" << _filename;
+        return false;
+    }
+
+    std::fclose(_file);
+    _file = nullptr;
+
+    Utility::Directory::rm(_filename);
+    return Utility::Directory::move(_filename + ".tmp", _filename);
+}
+
+Reader::Reader(const std::string& filename, const std::string& path) {
+    if(!Utility::Directory::exists(filename)) return;
+
+    _data = Utility::Directory::mapRead(filename);
+    _valid = parse(path);
+
+    if(!_valid) Warning{} << "Ignoring an outdated or invalid scene cache" << filename;
+}
+
+Reader::~Reader() = default;
+
+bool Reader::parse(const std::string& path) {
+    Header header;
+    if(_data.size() < sizeof(Header)) return false;
+    std::memcpy(&header, _data.data(), sizeof(Header));
+    if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+       header.version != Version ||
+       header.metadataOffset > _data.size() ||
+       header.metadataSize > _data.size() - header.metadataOffset)
+        return false;
+
+    Deserializer metadata{_data.slice(header.metadataOffset, header.metadataOffset + header.metadataSize)};
+
+    /* The cache is valid if the source has the same size and either the
+       same modification time or the same contents */
+    SourceIdentification cachedSource, source;
+    UnsignedLong cachedHash;
+    if(!metadata.read(cachedSource) || !metadata.read(cachedHash) ||
+       !identify(path, source) || source.size != cachedSource.size)
+        return false;
+    if(source.modificationTime != cachedSource.modificationTime &&
+       contentHash(path) != cachedHash)
+        return false;
+
+    bool hasChildren;
+    if(!metadata.read(_scene.textures) ||
+       !metadata.read(_scene.materials) ||
+       !metadata.read(_scene.lights) ||
+       !metadata.read(_scene.objects) ||
+       !metadata.read(hasChildren))
+        return false;
+    if(hasChildren) {
+        _scene.children.emplace();
+        if(!metadata.read(*_scene.children)) return false;
+    }
+    if(!metadata.read(_scene.meshDequantizations) ||
+       !metadata.read(_scene.meshBounds) ||
+       !metadata.read(_scene.meshBoundingBoxes) ||
+       !metadata.read(_scene.meshLods) ||
+       !metadata.read(_scene.meshOptimizations) ||
+       !metadata.read(_scene.meshOccluders) ||
+       !metadata.read(_scene.batches) ||
+       !metadata.read(_scene.hlods))
+        return false;
+    _scene.meshCount = _scene.meshDequantizations.size();
+
+    /* Written so it can't overflow with garbage offsets */
+    const auto inRange = [&](UnsignedLong offset, UnsignedLong size) {
+        return offset <= _data.size() && size <= _data.size() - offset;
+    };
+
+    if(!metadata.read(_scene.imageCount)) return false;
+    _images = Containers::Array<Containers::Pointer<Implementation::ImageEntry>>{_scene.imageCount};
+    for(Containers::Pointer<Implementation::ImageEntry>& image: _images) {
+        bool present;
+        if(!metadata.read(present)) return false;
+        if(!present) continue;
+
+        image.emplace();
+        UnsignedInt levelCount;
+        if(!metadata.read(image->compressed) ||
+           !metadata.read(image->format) ||
+           !metadata.read(image->alignment) ||
+           !metadata.read(image->size) ||
+           !metadata.read(levelCount))
+            return false;
+
+        image->levels = Containers::Array<Implementation::ImageEntry::Level>{levelCount};
+        for(Implementation::ImageEntry::Level& level: image->levels)
+            if(!metadata.read(level) || !inRange(level.offset, level.size))
+                return false;
+        if(!validImage(*image)) return false;
+    }
+
+    UnsignedInt meshEntryCount;
+    if(!metadata.read(meshEntryCount) ||
+       meshEntryCount != _scene.meshCount + _scene.batches.size() + _scene.hlods.size() ||
+       _scene.meshBounds.size() != _scene.meshCount ||
+       _scene.meshBoundingBoxes.size() != _scene.meshCount ||
+       _scene.meshLods.size() != _scene.meshCount ||
+       _scene.meshOptimizations.size() != _scene.meshCount ||
+       _scene.meshOccluders.size() != _scene.meshCount)
+        return false;
+    _meshes = Containers::Array<Containers::Pointer<Implementation::MeshEntry>>{meshEntryCount};
+    for(Containers::Pointer<Implementation::MeshEntry>& mesh: _meshes) {
+        bool present;
+        if(!metadata.read(present)) return false;
+        if(!present) continue;
+
+        mesh.emplace();
+        UnsignedInt attributeCount;
+        if(!metadata.read(mesh->primitive) ||
+           !metadata.read(mesh->vertexCount) ||
+           !metadata.read(mesh->vertexDataOffset) ||
+           !metadata.read(mesh->vertexDataSize) ||
+           !metadata.read(mesh->indexed) ||
+           !metadata.read(mesh->indexType) ||
+           !metadata.read(mesh->indexDataOffset) ||
+           !metadata.read(mesh->indexDataSize) ||
+           !metadata.read(mesh->indexOffset) ||
+           !metadata.read(mesh->indexCount) ||
+           !metadata.read(attributeCount) ||
+           !validPrimitive(mesh->primitive) ||
+           !inRange(mesh->vertexDataOffset, mesh->vertexDataSize) ||
+           (mesh->indexed && (!validIndexType(mesh->indexType) ||
+            !inRange(mesh->indexDataOffset, mesh->indexDataSize) ||
+            mesh->indexOffset > mesh->indexDataSize ||
+            UnsignedLong(mesh->indexCount)*meshIndexTypeSize(MeshIndexType(mesh->indexType)) > mesh->indexDataSize - mesh->indexOffset)))
+            return false;
+
+        /* The last vertex has to fit with the whole attribute, not just its
+           offset */
+        mesh->attributes = Containers::Array<Implementation::MeshEntry::Attribute>{attributeCount};
+        for(Implementation::MeshEntry::Attribute& attribute: mesh->attributes) {
+            if(!metadata.read(attribute) || attribute.stride < 0 ||
+               !validAttribute(Trade::MeshAttribute(attribute.name), VertexFormat(attribute.format), attribute.arraySize) ||
+               attribute.offset > mesh->vertexDataSize)
+                return false;
+            const UnsignedLong size = UnsignedLong(vertexFormatSize(VertexFormat(attribute.format)))*Math::max(attribute.arraySize, UnsignedShort(1));
+            if(mesh->vertexCount && UnsignedLong(mesh->vertexCount - 1)*attribute.stride + size > mesh->vertexDataSize - attribute.offset)
+                return false;
+        }
+    }
+
+    return validReferences(_scene) && validMeshData(_scene, _meshes);
+}
+
+Containers::Optional<Image> Reader::image(const UnsignedInt id) const {
+    if(id >= _images.size() || !_images[id]) return {};
+    const Implementation::ImageEntry& entry = *_images[id];
+
+    Image image;
+    image.compressed = entry.compressed;
+    if(entry.compressed) image.compressedFormat = CompressedPixelFormat(entry.format);
+    else image.format = PixelFormat(entry.format);
+    image.alignment = entry.alignment;
+    image.size = entry.size;
+    image.levels = Containers::Array<Containers::ArrayView<const char>>{entry.levels.size()};
+    for(std::size_t i = 0; i != entry.levels.size(); ++i)
+        image.levels[i] = _data.slice(entry.levels[i].offset, entry.levels[i].offset + entry.levels[i].size);
+
+    return Containers::Optional<Image>{std::move(image)};
+}
+
+Containers::Optional<Trade::MeshData> Reader::mesh(const UnsignedInt id) const {
+    if(id >= _meshes.size() || !_meshes[id]) return {};
+    const Implementation::MeshEntry& entry = *_meshes[id];
+
+    const Containers::ArrayView<const char> vertexData = _data.slice(
+        entry.vertexDataOffset, entry.vertexDataOffset + entry.vertexDataSize);
+    Containers::Array<Trade::MeshAttributeData> attributes{entry.attributes.size()};
+    for(std::size_t i = 0; i != entry.attributes.size(); ++i) {
+        const Implementation::MeshEntry::Attribute& attribute = entry.attributes[i];
+        attributes[i] = Trade::MeshAttributeData{
+            Trade::MeshAttribute(attribute.name),
+            VertexFormat(attribute.format),
+            Containers::StridedArrayView1D<const void>{vertexData,
+                vertexData.data() + attribute.offset, entry.vertexCount,
+                attribute.stride},
+            attribute.arraySize};
+    }
+
+    /* The data are not owned by the mesh, so no copy is made */
+    if(entry.indexed) {
+        const Containers::ArrayView<const char> indexData = _data.slice(
+            entry.indexDataOffset, entry.indexDataOffset + entry.indexDataSize);
+        const MeshIndexType indexType = MeshIndexType(entry.indexType);
+        return Trade::MeshData{MeshPrimitive(entry.primitive),
+            Trade::DataFlags{}, indexData,
+            Trade::MeshIndexData{indexType, indexData.slice(entry.indexOffset,
+                entry.indexOffset + entry.indexCount*meshIndexTypeSize(indexType))},
+            Trade::DataFlags{}, vertexData, std::move(attributes),
+            entry.vertexCount};
+    }
+
+    return Trade::MeshData{MeshPrimitive(entry.primitive),
+        Trade::DataFlags{}, vertexData, std::move(attributes),
+        entry.vertexCount};
+}
+
+}}
@@ -0,0 +1,245 @@
+#ifndef Oberon_SceneCache_h
+#define Oberon_SceneCache_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <cstdio>
+#include <mutex>
+#include <string>
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Corrade/Containers/Pointer.h>
+#include <Corrade/Utility/Directory.h>
+#include <Magnum/Array.h>
+#include <Magnum/Mesh.h>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Sampler.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix3.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Math/Quaternion.h>
+#include <Magnum/Math/Range.h>
+#include <Magnum/Math/Vector4.h>
+#include <Magnum/Trade/MaterialData.h>
+#include <Magnum/Trade/ObjectData3D.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/MeshOptimizer.h"
+#include "Oberon/MeshSimplifier.h"
+#include "Oberon/OcclusionCulling.h"
+
+namespace Oberon { namespace SceneCache {
+
+namespace Implementation {
+    struct ImageEntry;
+    struct MeshEntry;
+}
+
+/* The importer converts the imported data to the structures below, so the
+   scene is created the same way whether it was imported or read from the
+   cache */
+
+struct Texture {
+    UnsignedInt image;
+    SamplerFilter minificationFilter, magnificationFilter;
+    SamplerMipmap mipmapFilter;
+    Array2D<SamplerWrapping> wrapping;
+};
+
+struct Material {
+    Color4 diffuseColor;
+    /* -1 if the material has no such texture */
+    Int diffuseTexture, normalTexture;
+    Float normalTextureScale;
+    bool hasTextureTransformation;
+    Matrix3 textureMatrix;
+    Trade::MaterialAlphaMode alphaMode;
+    Float alphaMask;
+};
+
+struct Light {
+    bool directional;
+    /* Already multiplied with the intensity */
+    Color3 color;
+    Float range;
+};
+
+struct Object {
+    std::string name;
+    std::vector<UnsignedInt> children;
+    Trade::ObjectInstanceType3D instanceType;
+    Int instance, material;
+
+    /* If the object has a separate TRS, it's used instead of the
+       transformation matrix to avoid precision issues */
+    bool hasTranslationRotationScaling;
+    Vector3 translation;
+    Quaternion rotation;
+    Vector3 scaling;
+    Matrix4 transformation;
+};
+
+struct Image {
+    /* If compressed, compressedFormat is used instead of format */
+    bool compressed;
+    PixelFormat format;
+    CompressedPixelFormat compressedFormat;
+    Int alignment{4};
+    Vector2i size;
+
+    /* Pixel data of each mip level, either pointing into data or into the
+       mapped cache file. If there's just one level, the others get
+       generated on the GPU. */
+    Containers::Array<Containers::ArrayView<const char>> levels;
+    Containers::Array<char> data;
+};
+
+struct HlodCluster {
+    /* Objects the proxy is made of */
+    std::vector<UnsignedInt> objects;
+    /* Bounding sphere of the objects in the scene as center and radius */
+    Vector4 bounds;
+};
+
+struct Batch {
+    /* Objects merged into the batch mesh and where the indices of each
+       start in it. The last offset is the total index count. */
+    std::vector<UnsignedInt> objects, indexOffsets;
+};
+
+/* Everything the scene is created from except for the image and mesh data */
+struct Scene {
+    Containers::Array<Containers::Optional<Texture>> textures;
+    Containers::Array<Containers::Optional<Material>> materials;
+    Containers::Array<Containers::Optional<Light>> lights;
+    Containers::Array<Containers::Optional<Object>> objects;
+
+    /* Top-level objects, empty if the file has no scene */
+    Containers::Optional<std::vector<UnsignedInt>> children;
+
+    /* Transformation of each mesh's positions back from the quantized
+       range, identity if the mesh is not quantized */
+    Containers::Array<Matrix4> meshDequantizations;
+
+    /* Bounding sphere of each mesh's dequantized positions as center and
+       radius */
+    Containers::Array<Vector4> meshBounds;
+
+    /* Axis-aligned bounding box of each mesh's dequantized positions */
+    Containers::Array<Range3D> meshBoundingBoxes;
+
+    /* Levels of detail of each mesh, which follow the full mesh in its
+       index buffer. Empty if the mesh has just the full one. */
+    Containers::Array<Containers::Array<MeshSimplifier::Lod>> meshLods;
+
+    /* Vertex cache efficiency of each mesh before and after the
+       optimization, zero for meshes that weren't optimized */
+    Containers::Array<MeshOptimizer::Statistics> meshOptimizations;
+
+    /* Occluder geometry of each mesh, empty for meshes that aren't
+       occluders */
+    Containers::Array<OcclusionCulling::Occluder> meshOccluders;
+
+    /* Small static objects merged into batch meshes. The batch meshes are
+       stored after the meshes of the file. */
+    Containers::Array<Batch> batches;
+
+    /* Clusters of objects baked into proxy meshes. The proxy meshes are
+       stored after the batch meshes. */
+    Containers::Array<HlodCluster> hlods;
+
+    UnsignedInt imageCount{}, meshCount{};
+};
+
+/* Default cache directory in the user cache location */
+std::string defaultDirectory();
+
+/* Cache file for given source file. Imports with different processing of
+   the same file are told apart by the variant. */
+std::string filename(const std::string& directory, const std::string& path, const std::string& variant = {});
+
+/* Writes the cache to a temporary file, which replaces the cache file only
+   once it's complete */
+class Writer {
+    public:
+        explicit Writer(const std::string& filename, UnsignedInt imageCount, UnsignedInt meshCount);
+
+        /* Removes the temporary file if not finished */
+        ~Writer();
+
+        bool isOpen() const { return _file; }
+
+        /* These two are safe to call from multiple threads. Meshes past the
+           count are the static batches followed by the proxies of the HLOD
+           clusters. */
+        void writeImage(UnsignedInt id, const Image& image);
+        void writeMesh(UnsignedInt id, const Trade::MeshData& mesh);
+
+        /* Writes the scene description together with the source file
+           identification and moves the file in place */
+        bool finish(const std::string& path, const Scene& scene);
+
+    private:
+        UnsignedLong writeBlob(Containers::ArrayView<const char> data);
+
+        std::string _filename;
+        std::FILE* _file;
+        UnsignedLong _offset;
+        bool _failed{};
+        std::mutex _mutex;
+        Containers::Array<Containers::Pointer<Implementation::ImageEntry>> _images;
+        Containers::Array<Containers::Pointer<Implementation::MeshEntry>> _meshes;
+};
+
+/* Memory-mapped cache file. Images and meshes returned from it point
+   directly into the mapping, so they have to be destroyed before it. */
+class Reader {
+    public:
+        /* The cache is valid only if it was created from the current
+           version of the source file */
+        explicit Reader(const std::string& filename, const std::string& path);
+
+        ~Reader();
+
+        explicit operator bool() const { return _valid; }
+
+        Scene& scene() { return _scene; }
+
+        Containers::Optional<Image> image(UnsignedInt id) const;
+        Containers::Optional<Trade::MeshData> mesh(UnsignedInt id) const;
+
+    private:
+        bool parse(const std::string& path);
+
+        Containers::Array<const char, Utility::Directory::MapDeleter> _data;
+        bool _valid{};
+        Scene _scene;
+        Containers::Array<Containers::Pointer<Implementation::ImageEntry>> _images;
+        Containers::Array<Containers::Pointer<Implementation::MeshEntry>> _meshes;
+};
+
+}}
+
+#endif
@@ -25,22 +25,28 @@
 */
 
 #include <Corrade/Containers/Array.h>
-#include <Corrade/PluginManager/Manager.h>
+#include <Corrade/Containers/Pointer.h>
 #include <Magnum/ResourceManager.h>
-#include <Magnum/GL/AbstractShaderProgram.h>
 #include <Magnum/GL/Mesh.h>
 #include <Magnum/GL/Texture.h>
+#include <Magnum/GL/TextureArray.h>
+#include <Magnum/Math/Vector4.h>
 #include <Magnum/SceneGraph/Drawable.h>
 #include <Magnum/SceneGraph/Scene.h>
 #include <Magnum/SceneGraph/TranslationRotationScalingTransformation3D.h>
 #include <Magnum/Trade/Trade.h>
 
+#include "Oberon/ContentRegistry.h"
+#include "Oberon/FrustumCulling.h"
+#include "Oberon/GpuScene.h"
+#include "Oberon/MemoryAccounting.h"
+#include "Oberon/PixelBufferRing.h"
 #include "Oberon/Oberon.h"
+#include "Oberon/ResidencyManager.h"
+#include "Oberon/ShaderRegistry.h"
 
 namespace Oberon {
 
-typedef ResourceManager<GL::AbstractShaderProgram, GL::Mesh, GL::Texture2D> SceneResourceManager;
-
 struct ObjectInfo {
     Object3D* object;
     std::string name;
@@ -51,12 +57,53 @@ struct ObjectInfo {
         LightDrawable
     };
     Containers::Array<SceneGraph::AbstractFeature3D*> features{Containers::ValueInit, 2};
+
+    /* Batch drawing the object instead of its PhongDrawable, null if it's
+       not batched */
+    BatchDrawable* batch{};
+
+    /* GPU-driven path drawing the object instead of its PhongDrawable, null
+       if it's not drawn by it */
+    GpuScene* gpuScene{};
+
+    /* Instanced draw drawing the object instead of its PhongDrawable, null
+       if it's not instanced */
+    InstancedDrawable* instances{};
 };
 
-struct SceneData {
-    PluginManager::Manager<Trade::AbstractImporter> manager;
+/* Objects drawn as one proxy mesh when far away */
+struct HlodCluster {
+    /* Bounding sphere in the scene as center and radius and the distance
+       from it where the proxy starts to be drawn */
+    Vector4 bounds;
+    Float distance;
+
+    /* Null if the cluster got dissolved */
+    Object3D* proxyObject;
+    PhongDrawable* proxy;
+    Containers::Array<PhongDrawable*> members;
+    bool active;
+};
 
+struct SceneData {
     SceneResourceManager resourceManager;
+    /* Meshes and textures in the resource manager are keyed by content */
+    ContentRegistry contentRegistry;
+    /* Tracks the meshes and textures to keep them under a GPU budget */
+    ResidencyManager residency;
+    /* Staging memory for the texture uploads, null if not used */
+    Containers::Pointer<PixelBufferRing> pixelBuffers;
+    ShaderRegistry shaderRegistry;
+    /* Sizes of the uploaded meshes and textures */
+    MemoryAccounting memoryAccounting;
+    /* Bounds of the Phong drawables and the hierarchy over them for
+       spatial queries. Declared before the scene, which removes them when
+       destroyed. */
+    FrustumCulling culling;
+    /* Null if occlusion culling is disabled */
+    Containers::Pointer<OcclusionCulling> occlusion;
+    /* Null if the GPU-driven path is disabled or not supported */
+    Containers::Pointer<GpuScene> gpuScene;
 
     Scene3D scene;
     Object3D* cameraObject{};
@@ -67,12 +114,14 @@ struct SceneData {
     Containers::Array<ObjectInfo> objects;
     UnsignedInt sceneObjectId{};
 
+    /* The proxies are in opaqueDrawables instead of the members while
+       active */
+    Containers::Array<HlodCluster> hlods;
+
     UnsignedInt lightCount{};
     Containers::Array<Vector4> lightPositions;
     Containers::Array<Color3> lightColors;
     Containers::Array<Float> lightRanges;
-
-    Containers::Array<std::string> phongShadersKeys;
 };
 
 }
@@ -28,14 +28,33 @@
 
 #include "SceneImporter.h"
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sstream>
+#include <thread>
+#include <unordered_map>
+#include <unordered_set>
 #include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/PluginManager/Manager.h>
 #include <Corrade/Utility/FormatStl.h>
+#include <Corrade/Utility/String.h>
 #include <Magnum/ImageView.h>
 #include <Magnum/PixelFormat.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+#include <Magnum/GL/TextureArray.h>
 #include <Magnum/GL/TextureFormat.h>
+#include <Magnum/Math/FunctionsBatch.h>
 #include <Magnum/MeshTools/Compile.h>
+#include <Magnum/MeshTools/CompressIndices.h>
+#include <Magnum/MeshTools/Interleave.h>
 #include <Magnum/SceneGraph/Camera.h>
-#include <Magnum/Shaders/Phong.h>
 #include <Magnum/Trade/AbstractImporter.h>
 #include <Magnum/Trade/ImageData.h>
 #include <Magnum/Trade/LightData.h>
@@ -46,9 +65,24 @@
 #include <Magnum/Trade/SceneData.h>
 #include <Magnum/Trade/TextureData.h>
 
+#include "Oberon/BatchDrawable.h"
+#include "Oberon/GlbFile.h"
+#include "Oberon/GpuScene.h"
+#include "Oberon/Hash.h"
+#include "Oberon/Hlod.h"
+#include "Oberon/InstancedDrawable.h"
 #include "Oberon/LightDrawable.h"
+#include "Oberon/MeshOptimizer.h"
+#include "Oberon/MeshQuantization.h"
+#include "Oberon/MeshSimplifier.h"
+#include "Oberon/OcclusionCulling.h"
 #include "Oberon/PhongDrawable.h"
+#include "Oberon/PhongShader.h"
+#include "Oberon/PixelBufferRing.h"
+#include "Oberon/SceneCache.h"
 #include "Oberon/SceneData.h"
+#include "Oberon/StaticBatch.h"
+#include "Oberon/TextureCompressor.h"
 
 namespace Oberon { namespace SceneImporter {
 
@@ -56,321 +90,1980 @@ namespace {
 
 using namespace Math::Literals;
 
-Resource<GL::AbstractShaderProgram, Shaders::Phong> phongShader(SceneData& data, Shaders::Phong::Flags flags) {
-    std::string shaderKey = "phong";
-    if(flags & Shaders::Phong::Flag::AlphaMask)
-        shaderKey += "-alphaMask";
-    if(flags & Shaders::Phong::Flag::AmbientTexture)
-        shaderKey += "-ambientTexture";
-    if(flags & Shaders::Phong::Flag::DiffuseTexture)
-        shaderKey += "-fiffuseTexture";
-    if(flags & Shaders::Phong::Flag::NormalTexture)
-        shaderKey += "-normalTexture";
-    if(flags & Shaders::Phong::Flag::TextureTransformation)
-        shaderKey += "-textureTransformation";
-    if(flags & Shaders::Phong::Flag::VertexColor)
-        shaderKey += "-vertexColor";
-
-    Resource<GL::AbstractShaderProgram, Shaders::Phong> shader =
-        data.resourceManager.get<GL::AbstractShaderProgram, Shaders::Phong>(shaderKey);
-    if(!shader) {
-        data.resourceManager.set<GL::AbstractShaderProgram>(shader.key(),
-            new Shaders::Phong{flags, data.lightCount});
+/* Through the pixel buffers if possible, directly from the memory
+   otherwise */
+void setSubImage(GL::Texture2D& texture, const Int level, const ImageView2D& image, PixelBufferRing* pixelBuffers) {
+    if(!pixelBuffers || !pixelBuffers->setSubImage(texture, level, image))
+        texture.setSubImage(level, {}, image);
+}
 
-        (*shader)
-            .setSpecularColor(0x11111100_rgbaf)
-            .setShininess(80.0f);
+void setCompressedSubImage(GL::Texture2D& texture, const Int level, const CompressedImageView2D& image, PixelBufferRing* pixelBuffers) {
+    if(!pixelBuffers || !pixelBuffers->setCompressedSubImage(texture, level, image))
+        texture.setCompressedSubImage(level, {}, image);
+}
 
-        arrayAppend(data.phongShadersKeys, shaderKey);
-    }
+void setSubImage(GL::Texture2DArray& texture, const Int level, const Int layer, const ImageView2D& image, PixelBufferRing* pixelBuffers) {
+    if(!pixelBuffers || !pixelBuffers->setSubImage(texture, level, layer, image))
+        texture.setSubImage(level, {0, 0, layer}, ImageView3D{image.storage(), image.format(), {image.size(), 1}, image.data()});
+}
 
-    return shader;
+void setCompressedSubImage(GL::Texture2DArray& texture, const Int level, const Int layer, const CompressedImageView2D& image, PixelBufferRing* pixelBuffers) {
+    if(!pixelBuffers || !pixelBuffers->setCompressedSubImage(texture, level, layer, image))
+        texture.setCompressedSubImage(level, {0, 0, layer}, CompressedImageView3D{image.format(), {image.size(), 1}, image.data()});
 }
 
-void loadImage(GL::Texture2D& texture, Trade::ImageData2D& image) {
-    if(!image.isCompressed()) {
+/* Texture format for the image, warns and returns null if it can't be
+   displayed */
+Containers::Optional<GL::TextureFormat> textureFormat(const SceneCache::Image& image) {
+    if(!image.compressed) {
         /* Whitelist only things we *can* display */
-        GL::TextureFormat format;
-        switch(image.format()) {
+        switch(image.format) {
             case PixelFormat::R8Unorm:
             case PixelFormat::RG8Unorm:
             case PixelFormat::RGB8Unorm:
             case PixelFormat::RGB8Srgb:
             case PixelFormat::RGBA8Unorm:
             case PixelFormat::RGBA8Srgb:
-                format = GL::textureFormat(image.format());
-                break;
+                return GL::textureFormat(image.format);
             default:
-                Warning{} << "Cannot load an image of format" << image.format();
-                return;
+                Warning{} << "Cannot load an image of format" << image.format;
+                return {};
         }
+    }
 
-        texture
-            .setStorage(Math::log2(image.size().max()) + 1, format, image.size())
-            .setSubImage(0, {}, image)
-            .generateMipmap();
+    /* Blacklist things we *cannot* display */
+    switch(image.compressedFormat) {
+        case CompressedPixelFormat::Bc4RSnorm:
+        case CompressedPixelFormat::Bc5RGSnorm:
+        case CompressedPixelFormat::EacR11Snorm:
+        case CompressedPixelFormat::EacRG11Snorm:
+        case CompressedPixelFormat::Bc6hRGBUfloat:
+        case CompressedPixelFormat::Bc6hRGBSfloat:
+        case CompressedPixelFormat::Astc4x4RGBAF:
+        case CompressedPixelFormat::Astc5x4RGBAF:
+        case CompressedPixelFormat::Astc5x5RGBAF:
+        case CompressedPixelFormat::Astc6x5RGBAF:
+        case CompressedPixelFormat::Astc6x6RGBAF:
+        case CompressedPixelFormat::Astc8x5RGBAF:
+        case CompressedPixelFormat::Astc8x6RGBAF:
+        case CompressedPixelFormat::Astc8x8RGBAF:
+        case CompressedPixelFormat::Astc10x5RGBAF:
+        case CompressedPixelFormat::Astc10x6RGBAF:
+        case CompressedPixelFormat::Astc10x8RGBAF:
+        case CompressedPixelFormat::Astc10x10RGBAF:
+        case CompressedPixelFormat::Astc12x10RGBAF:
+        case CompressedPixelFormat::Astc12x12RGBAF:
+            Warning{} << "Cannot load an image of format" << image.compressedFormat;
+            return {};
+
+        default: return GL::textureFormat(image.compressedFormat);
+    }
+}
+
+/* Uploads the image without given count of top mip levels */
+void loadImage(GL::Texture2D& texture, const SceneCache::Image& image, PixelBufferRing* pixelBuffers, const UnsignedInt skipLevels = 0) {
+    const Containers::Optional<GL::TextureFormat> format = textureFormat(image);
+    if(!format) return;
+
+    if(!image.compressed) {
+        /* If there's just the base level, generate the rest */
+        const PixelStorage storage = PixelStorage{}.setAlignment(image.alignment);
+        if(image.levels.size() == 1) {
+            CORRADE_INTERNAL_ASSERT(!skipLevels);
+            texture.setStorage(Math::log2(image.size.max()) + 1, *format, image.size);
+            setSubImage(texture, 0, ImageView2D{storage, image.format, image.size, image.levels[0]}, pixelBuffers);
+            texture.generateMipmap();
+
+        } else {
+            texture.setStorage(image.levels.size() - skipLevels, *format,
+                Math::max(image.size >> Int(skipLevels), Vector2i{1}));
+            for(std::size_t i = skipLevels; i != image.levels.size(); ++i)
+                setSubImage(texture, i - skipLevels, ImageView2D{storage, image.format,
+                    Math::max(image.size >> Int(i), Vector2i{1}), image.levels[i]}, pixelBuffers);
+        }
 
     } else {
-        /* Blacklist things we *cannot* display */
-        GL::TextureFormat format;
-        switch(image.compressedFormat()) {
-            case CompressedPixelFormat::Bc4RSnorm:
-            case CompressedPixelFormat::Bc5RGSnorm:
-            case CompressedPixelFormat::EacR11Snorm:
-            case CompressedPixelFormat::EacRG11Snorm:
-            case CompressedPixelFormat::Bc6hRGBUfloat:
-            case CompressedPixelFormat::Bc6hRGBSfloat:
-            case CompressedPixelFormat::Astc4x4RGBAF:
-            case CompressedPixelFormat::Astc5x4RGBAF:
-            case CompressedPixelFormat::Astc5x5RGBAF:
-            case CompressedPixelFormat::Astc6x5RGBAF:
-            case CompressedPixelFormat::Astc6x6RGBAF:
-            case CompressedPixelFormat::Astc8x5RGBAF:
-            case CompressedPixelFormat::Astc8x6RGBAF:
-            case CompressedPixelFormat::Astc8x8RGBAF:
-            case CompressedPixelFormat::Astc10x5RGBAF:
-            case CompressedPixelFormat::Astc10x6RGBAF:
-            case CompressedPixelFormat::Astc10x8RGBAF:
-            case CompressedPixelFormat::Astc10x10RGBAF:
-            case CompressedPixelFormat::Astc12x10RGBAF:
-            case CompressedPixelFormat::Astc12x12RGBAF:
-                Warning{} << "Cannot load an image of format" << image.compressedFormat();
-                return;
-
-            default: format = GL::textureFormat(image.compressedFormat());
+        texture.setStorage(image.levels.size() - skipLevels, *format,
+            Math::max(image.size >> Int(skipLevels), Vector2i{1}));
+        for(std::size_t i = skipLevels; i != image.levels.size(); ++i)
+            setCompressedSubImage(texture, i - skipLevels, CompressedImageView2D{
+                image.compressedFormat, Math::max(image.size >> Int(i), Vector2i{1}),
+                image.levels[i]}, pixelBuffers);
+    }
+}
+
+/* Uploads all levels of the image to the layer of an array that has its
+   storage set already. A single level is uploaded alone, the rest is
+   generated once all layers are there. */
+void loadImageLayer(GL::Texture2DArray& texture, const Int layer, const SceneCache::Image& image, PixelBufferRing* pixelBuffers) {
+    for(std::size_t i = 0; i != image.levels.size(); ++i) {
+        const Vector2i size = Math::max(image.size >> Int(i), Vector2i{1});
+        if(image.compressed)
+            setCompressedSubImage(texture, i, layer, CompressedImageView2D{
+                image.compressedFormat, size, image.levels[i]}, pixelBuffers);
+        else
+            setSubImage(texture, i, layer, ImageView2D{
+                PixelStorage{}.setAlignment(image.alignment), image.format,
+                size, image.levels[i]}, pixelBuffers);
+    }
+}
+
+void setSampler(GL::Texture2D& texture, const SceneCache::Texture& textureData) {
+    texture
+        .setMagnificationFilter(textureData.magnificationFilter)
+        .setMinificationFilter(textureData.minificationFilter, textureData.mipmapFilter)
+        .setWrapping(textureData.wrapping);
+}
+
+GL::Texture2D createTexture(const SceneCache::Texture& textureData, const SceneCache::Image& image, PixelBufferRing* pixelBuffers, const UnsignedInt skipLevels = 0) {
+    GL::Texture2D texture;
+    setSampler(texture, textureData);
+    loadImage(texture, image, pixelBuffers, skipLevels);
+    return texture;
+}
+
+/* Size of the image on the GPU without given count of top mip levels.
+   Generated levels add a third to the base level. */
+std::size_t textureSize(const SceneCache::Image& image, const UnsignedInt skipLevels = 0) {
+    std::size_t size = 0;
+    for(std::size_t i = skipLevels; i < image.levels.size(); ++i)
+        size += image.levels[i].size();
+    return image.levels.size() == 1 ? size*4/3 : size;
+}
+
+/* Texture with the size of the image, for the memory report */
+MemoryAccounting::Texture accountedTexture(const std::string& key, const UnsignedInt id, const SceneCache::Image& image) {
+    std::ostringstream format;
+    if(image.compressed)
+        Debug{&format, Debug::Flag::NoNewlineAtTheEnd} << image.compressedFormat;
+    else
+        Debug{&format, Debug::Flag::NoNewlineAtTheEnd} << image.format;
+
+    /* A single level gets the rest generated in loadImage() */
+    const UnsignedInt levelCount = image.levels.size() == 1 ?
+        Math::log2(image.size.max()) + 1 : image.levels.size();
+    return MemoryAccounting::Texture{key, id, image.size, levelCount,
+        format.str(), textureSize(image), 0};
+}
+
+SceneCache::Texture convertTexture(const Trade::TextureData& texture) {
+    SceneCache::Texture out;
+    out.image = texture.image();
+    out.minificationFilter = texture.minificationFilter();
+    out.magnificationFilter = texture.magnificationFilter();
+    out.mipmapFilter = texture.mipmapFilter();
+    out.wrapping = texture.wrapping().xy();
+    return out;
+}
+
+SceneCache::Material convertMaterial(const Trade::PhongMaterialData& material) {
+    SceneCache::Material out;
+    out.diffuseColor = material.diffuseColor();
+    out.diffuseTexture = material.hasAttribute(Trade::MaterialAttribute::DiffuseTexture) ?
+        Int(material.diffuseTexture()) : -1;
+    out.normalTexture = material.hasAttribute(Trade::MaterialAttribute::NormalTexture) ?
+        Int(material.normalTexture()) : -1;
+    out.normalTextureScale = out.normalTexture != -1 ?
+        material.normalTextureScale() : 1.0f;
+    out.hasTextureTransformation = material.hasTextureTransformation();
+    out.textureMatrix = material.commonTextureMatrix();
+    out.alphaMode = material.alphaMode();
+    out.alphaMask = material.alphaMask();
+    return out;
+}
+
+SceneCache::Light convertLight(const Trade::LightData& light) {
+    SceneCache::Light out;
+    out.directional = light.type() == Trade::LightData::Type::Directional;
+    out.color = light.color()*light.intensity();
+    out.range = light.range();
+    return out;
+}
+
+SceneCache::Object convertObject(const Trade::ObjectData3D& object, std::string name) {
+    SceneCache::Object out;
+    out.name = std::move(name);
+    out.children = object.children();
+    out.instanceType = object.instanceType();
+    out.instance = object.instance();
+    out.material = object.instanceType() == Trade::ObjectInstanceType3D::Mesh ?
+        static_cast<const Trade::MeshObjectData3D&>(object).material() : -1;
+    out.hasTranslationRotationScaling = !!(object.flags() & Trade::ObjectFlag3D::HasTranslationRotationScaling);
+    if(out.hasTranslationRotationScaling) {
+        out.translation = object.translation();
+        out.rotation = object.rotation();
+        out.scaling = object.scaling();
+    } else out.transformation = object.transformation();
+    return out;
+}
+
+SceneCache::Image convertImage(Trade::ImageData2D&& image) {
+    SceneCache::Image out;
+    out.compressed = image.isCompressed();
+    if(out.compressed) out.compressedFormat = image.compressedFormat();
+    else {
+        out.format = image.format();
+        out.alignment = image.storage().alignment();
+    }
+    out.size = image.size();
+    out.data = image.release();
+    out.levels = Containers::Array<Containers::ArrayView<const char>>{Containers::InPlaceInit, {out.data}};
+    return out;
+}
+
+/* Seed of the second content hash, anything different from the first one
+   makes the two independent */
+constexpr UnsignedLong ContentCheckSeed = 0x9e3779b97f4a7c15ull;
+
+/* Both content hashes chained with more data */
+ContentRegistry::Hash contentHash(Containers::ArrayView<const void> data, const ContentRegistry::Hash& seed) {
+    return {hash(data, seed.key), hash(data, seed.check)};
+}
+
+/* Hash of the pixel data and everything that affects how they're
+   interpreted */
+ContentRegistry::Hash imageHash(const SceneCache::Image& image) {
+    const struct {
+        UnsignedInt format;
+        Int alignment;
+        Vector2i size;
+    } properties{image.compressed ? UnsignedInt(image.compressedFormat) :
+        UnsignedInt(image.format), image.alignment, image.size};
+    ContentRegistry::Hash out = contentHash({&properties, sizeof(properties)},
+        {image.compressed, ContentCheckSeed + image.compressed});
+    for(Containers::ArrayView<const char> level: image.levels)
+        out = contentHash(level, out);
+    return out;
+}
+
+/* Hash of the index and vertex data together with their layout */
+ContentRegistry::Hash meshHash(const Trade::MeshData& mesh) {
+    struct Attribute {
+        UnsignedInt name, format;
+        std::size_t offset;
+        Int stride;
+        UnsignedInt arraySize;
+    };
+
+    Containers::Array<Attribute> layout{Containers::ValueInit, mesh.attributeCount() + 1};
+    layout[0].name = UnsignedInt(mesh.primitive());
+    layout[0].format = mesh.isIndexed() ? UnsignedInt(mesh.indexType()) : 0;
+    layout[0].offset = mesh.isIndexed() ? mesh.indexOffset() : 0;
+    layout[0].stride = mesh.isIndexed() ? Int(mesh.indexCount()) : 0;
+    layout[0].arraySize = mesh.vertexCount();
+    for(UnsignedInt i = 0; i != mesh.attributeCount(); ++i) {
+        layout[i + 1].name = UnsignedInt(mesh.attributeName(i));
+        layout[i + 1].format = UnsignedInt(mesh.attributeFormat(i));
+        layout[i + 1].offset = mesh.attributeOffset(i);
+        layout[i + 1].stride = mesh.attributeStride(i);
+        layout[i + 1].arraySize = mesh.attributeArraySize(i);
+    }
+
+    return contentHash(mesh.vertexData(), contentHash(mesh.indexData(),
+        contentHash(Containers::arrayView(layout), {0, ContentCheckSeed})));
+}
+
+/* Image or mesh decoded by a worker thread, waiting for the upload on the
+   main thread */
+struct DecodedResource {
+    enum class Type: UnsignedByte {
+        Image,
+        Mesh,
+        /* The id is the batch */
+        Batch,
+        /* The id is the HLOD cluster */
+        HlodProxy
+    };
+
+    Type type;
+    UnsignedInt id;
+    /* Content hash, used to upload identical data only once */
+    ContentRegistry::Hash contentHash{};
+    Containers::Optional<SceneCache::Image> image;
+    Containers::Optional<Trade::MeshData> mesh;
+};
+
+class DecodedQueue {
+    public:
+        void push(DecodedResource&& resource) {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _resources.push_back(std::move(resource));
+            }
+            _condition.notify_all();
+        }
+
+        bool tryPop(DecodedResource& resource) {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if(_resources.empty()) return false;
+            resource = std::move(_resources.front());
+            _resources.pop_front();
+            return true;
+        }
+
+        /* Waits until there's a resource in the queue or nothing more is
+           going to be pushed */
+        void wait() {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _condition.wait(lock, [this]() { return _finished || !_resources.empty(); });
+        }
+
+        bool isFinished() {
+            std::lock_guard<std::mutex> lock{_mutex};
+            return _finished;
+        }
+
+        void setFinished() {
+            {
+                std::lock_guard<std::mutex> lock{_mutex};
+                _finished = true;
+            }
+            _condition.notify_all();
+        }
+
+    private:
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::deque<DecodedResource> _resources;
+        bool _finished{};
+};
+
+/* Decoded resource registered in the scene and waiting for its upload */
+struct PendingUpload {
+    DecodedResource resource;
+    /* IDs of the textures to create from the image */
+    Containers::Array<UnsignedInt> textures;
+    /* Size of one mesh or texture on the GPU */
+    std::size_t size;
+    /* Array and layer for each of the textures, if they go to arrays */
+    Containers::Array<std::pair<UnsignedInt, Int>> layers;
+};
+
+/* Layer of a texture array a texture got packed into */
+struct TextureLayer {
+    UnsignedInt array;
+    Int layer;
+};
+
+/* Texture array being uploaded, moved to the resource manager once all its
+   layers are there */
+struct PendingArray {
+    std::string key;
+    Containers::Pointer<GL::Texture2DArray> texture;
+    UnsignedInt remainingLayers;
+    bool generateMipmap;
+};
+
+bool sameArrayFormat(const SceneCache::Image& a, const SceneCache::Image& b) {
+    return a.compressed == b.compressed &&
+        (a.compressed ? a.compressedFormat == b.compressedFormat : a.format == b.format) &&
+        a.size == b.size && a.levels.size() == b.levels.size();
+}
+
+bool sameSampler(const SceneCache::Texture& a, const SceneCache::Texture& b) {
+    return a.minificationFilter == b.minificationFilter &&
+        a.magnificationFilter == b.magnificationFilter &&
+        a.mipmapFilter == b.mipmapFilter && a.wrapping == b.wrapping;
+}
+
+/* Each worker has its own plugin manager and image importer, as neither of
+   them is safe to use from multiple threads at once. The glTF importer is
+   shared by all of them, every instance would parse the whole file and keep
+   all its buffers. */
+struct DecodeWorker {
+    PluginManager::Manager<Trade::AbstractImporter> manager;
+    Containers::Pointer<Trade::AbstractImporter> imageImporter;
+    std::thread thread;
+};
+
+/* Compresses the image if configured */
+SceneCache::Image processImage(Trade::ImageData2D&& image, const bool normalMap, const Configuration& configuration) {
+    SceneCache::Image out = convertImage(std::move(image));
+    if(configuration.compressTextures) {
+        Containers::Optional<SceneCache::Image> compressed = TextureCompressor::compress(out,
+            normalMap ? TextureCompressor::Usage::NormalMap : TextureCompressor::Usage::Color);
+        if(compressed) out = std::move(*compressed);
+    }
+
+    return out;
+}
+
+/* Imports the image and compresses it if configured */
+Containers::Optional<SceneCache::Image> importImage(Trade::AbstractImporter& importer, const UnsignedInt id, const bool normalMap, const Configuration& configuration) {
+    Containers::Optional<Trade::ImageData2D> image = importer.image2D(id);
+    if(!image) {
+        Warning{} << "Cannot load image" << id << importer.image2DName(id);
+        return {};
+    }
+
+    return processImage(std::move(*image), normalMap, configuration);
+}
+
+/* Processes the mesh as configured. Interleaves the attributes and packs
+   the indices into the smallest type possible so the uploading thread only
+   has to upload the buffers. */
+Trade::MeshData processMesh(Trade::MeshData&& mesh, const Configuration& configuration, Matrix4& dequantization, Containers::Array<MeshSimplifier::Lod>& lods, MeshOptimizer::Statistics& optimization) {
+    if(configuration.optimizeMeshes && mesh.primitive() == MeshPrimitive::Triangles && mesh.isIndexed() && mesh.hasAttribute(Trade::MeshAttribute::Position))
+        mesh = MeshOptimizer::optimize(std::move(mesh), &optimization);
+    if(configuration.lodCount)
+        mesh = MeshSimplifier::generateLods(std::move(mesh), configuration.lodCount, configuration.lodReduction, lods);
+    if(configuration.compactVertexFormats)
+        mesh = MeshQuantization::quantize(std::move(mesh), dequantization);
+    if(mesh.isIndexed())
+        mesh = MeshTools::compressIndices(std::move(mesh));
+    return MeshTools::interleave(std::move(mesh));
+}
+
+/* Imports the mesh and processes it as configured */
+Containers::Optional<Trade::MeshData> importMesh(Trade::AbstractImporter& importer, const UnsignedInt id, const Configuration& configuration, Matrix4& dequantization, Containers::Array<MeshSimplifier::Lod>& lods, MeshOptimizer::Statistics& optimization) {
+    Containers::Optional<Trade::MeshData> mesh = importer.mesh(id);
+    if(!mesh) {
+        Warning{} << "Cannot load mesh" << id << importer.meshName(id);
+        return {};
+    }
+
+    return processMesh(std::move(*mesh), configuration, dequantization, lods, optimization);
+}
+
+/* Bounding sphere as center and radius and bounding box of the dequantized
+   positions. The dequantization is just a scale and offset, so it keeps the
+   box axis-aligned. */
+void meshBounds(const Trade::MeshData& mesh, const Matrix4& dequantization, Vector4& sphere, Range3D& box) {
+    if(!mesh.hasAttribute(Trade::MeshAttribute::Position) || !mesh.vertexCount()) {
+        sphere = {};
+        box = {};
+        return;
+    }
+
+    const Containers::Array<Vector3> positions = mesh.positions3DAsArray();
+    const std::pair<Vector3, Vector3> minmax = Math::minmax(positions);
+    const Vector3 center = (minmax.first + minmax.second)*0.5f;
+    Float radius = 0.0f;
+    for(const Vector3& position: positions)
+        radius = Math::max(radius, (position - center).length());
+    sphere = {dequantization.transformPoint(center), radius*dequantization.scaling().max()};
+
+    const Vector3 a = dequantization.transformPoint(minmax.first);
+    const Vector3 b = dequantization.transformPoint(minmax.second);
+    box = {Math::min(a, b), Math::max(a, b)};
+}
+
+/* The levels of detail follow the full mesh in the index buffer, the mesh
+   itself draws only the full one */
+GL::Mesh compileMesh(const Trade::MeshData& mesh, Containers::ArrayView<const MeshSimplifier::Lod> lods) {
+    GL::Mesh out = MeshTools::compile(mesh);
+    if(!lods.empty()) out.setCount(lods[0].indexCount);
+    return out;
+}
+
+/* Meshes of binary glTF files that don't get processed can be uploaded
+   straight from the mapped file. The importer then has to flip the texture
+   coordinates in the materials instead of in the mesh data, which all
+   importers of the file have to agree on. */
+bool canMapMeshes(const std::string& path, const Configuration& configuration) {
+    return !configuration.optimizeMeshes && !configuration.compactVertexFormats && !configuration.lodCount &&
+        Utility::String::endsWith(Utility::String::lowercase(path), ".glb");
+}
+
+Containers::Pointer<Trade::AbstractImporter> loadImporter(PluginManager::Manager<Trade::AbstractImporter>& manager, const std::string& path, const Configuration& configuration) {
+    Containers::Pointer<Trade::AbstractImporter> importer = manager.loadAndInstantiate("TinyGltfImporter");
+    if(importer && canMapMeshes(path, configuration) && importer->configuration().hasValue("textureCoordinateYFlipInMaterial"))
+        importer->configuration().setValue("textureCoordinateYFlipInMaterial", true);
+    return importer;
+}
+
+/* Format and sizes of an image with mip levels, which is enough to drop
+   the top levels of its textures on the GPU */
+struct ImageLevels {
+    GL::TextureFormat format;
+    Vector2i size;
+    Containers::Array<std::size_t> sizes;
+};
+
+/* Reloads evicted resources on a thread from the cache if there's a valid
+   one, otherwise imports and processes them the same way as the loader.
+   They're uploaded within the upload budgets of the loader. */
+class ResourceSource: public ResidencyManager::Source {
+    public:
+        explicit ResourceSource(const std::string& path, const Configuration& configuration, const std::string& cacheFilename, Containers::ArrayView<const Containers::Optional<SceneCache::Texture>> textures, Containers::ArrayView<const bool> normalMapImages, Containers::Array<Containers::Optional<ImageLevels>>&& imageLevels, PixelBufferRing* pixelBuffers);
+
+        ~ResourceSource();
+
+        void request(ResidencyManager::Entry& entry, UnsignedInt skipLevels) override;
+        Containers::Array<Loaded> upload(SceneResourceManager& manager) override;
+        std::size_t reduce(SceneResourceManager& manager, const ResidencyManager::Entry& entry) override;
+
+    private:
+        /* The entry itself is not touched by the thread */
+        struct Request {
+            ResidencyManager::Entry* entry;
+            ResidencyManager::Type type;
+            UnsignedInt id, skipLevels;
+        };
+
+        struct Reload {
+            Request request;
+            Containers::Optional<SceneCache::Image> image;
+            Containers::Optional<Trade::MeshData> mesh;
+            Containers::Array<MeshSimplifier::Lod> lods;
+        };
+
+        void run();
+        bool open();
+
+        std::string _path;
+        Configuration _configuration;
+        std::string _cacheFilename;
+        Containers::Array<Containers::Optional<SceneCache::Texture>> _textures;
+        Containers::Array<bool> _normalMapImages;
+        Containers::Array<Containers::Optional<ImageLevels>> _imageLevels;
+        PixelBufferRing* _pixelBuffers;
+
+        /* Used by the thread only */
+        bool _failed{};
+        Containers::Pointer<SceneCache::Reader> _cacheReader;
+        Containers::Pointer<PluginManager::Manager<Trade::AbstractImporter>> _manager;
+        Containers::Pointer<Trade::AbstractImporter> _importer;
+
+        std::mutex _mutex;
+        std::condition_variable _condition;
+        std::deque<Request> _requests;
+        std::deque<Reload> _reloads;
+        bool _canceled{};
+        std::thread _thread;
+};
+
+ResourceSource::ResourceSource(const std::string& path, const Configuration& configuration, const std::string& cacheFilename, Containers::ArrayView<const Containers::Optional<SceneCache::Texture>> textures, Containers::ArrayView<const bool> normalMapImages, Containers::Array<Containers::Optional<ImageLevels>>&& imageLevels, PixelBufferRing* pixelBuffers): _path{path}, _configuration(configuration), _cacheFilename{cacheFilename}, _textures{textures.size()}, _normalMapImages{Containers::ValueInit, normalMapImages.size()}, _imageLevels{std::move(imageLevels)}, _pixelBuffers{pixelBuffers} {
+    for(std::size_t i = 0; i != textures.size(); ++i)
+        _textures[i] = textures[i];
+    for(std::size_t i = 0; i != normalMapImages.size(); ++i)
+        _normalMapImages[i] = normalMapImages[i];
+}
+
+ResourceSource::~ResourceSource() {
+    if(!_thread.joinable()) return;
+
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _canceled = true;
+    }
+    _condition.notify_one();
+    _thread.join();
+}
+
+void ResourceSource::request(ResidencyManager::Entry& entry, const UnsignedInt skipLevels) {
+    /* Nothing gets reloaded until something gets evicted, so the thread is
+       started only then */
+    if(!_thread.joinable())
+        _thread = std::thread{&ResourceSource::run, this};
+
+    {
+        std::lock_guard<std::mutex> lock{_mutex};
+        _requests.push_back(Request{&entry, entry.type, entry.id, skipLevels});
+    }
+    _condition.notify_one();
+}
+
+bool ResourceSource::open() {
+    if(_cacheReader || _importer) return true;
+    if(_failed) return false;
+
+    /* The cache is complete before the scene is created */
+    if(!_cacheFilename.empty()) {
+        _cacheReader.emplace(_cacheFilename, _path);
+        if(*_cacheReader) return true;
+        _cacheReader = nullptr;
+    }
+
+    _manager.emplace();
+    _importer = loadImporter(*_manager, _path, _configuration);
+    if(!_importer || !_importer->openFile(_path)) {
+        Error{} << "Cannot open the file" << _path << "to reload evicted resources";
+        _importer = nullptr;
+        _failed = true;
+        return false;
+    }
+
+    return true;
+}
+
+void ResourceSource::run() {
+    for(;;) {
+        Request request;
+        {
+            std::unique_lock<std::mutex> lock{_mutex};
+            _condition.wait(lock, [this]{ return _canceled || !_requests.empty(); });
+            if(_canceled) return;
+            request = _requests.front();
+            _requests.pop_front();
         }
 
-        texture
-            .setStorage(1, format, image.size())
-            .setCompressedSubImage(0, {}, image);
+        /* A failed reload is passed on as well so the entry is no longer
+           marked as loading */
+        Reload reload;
+        reload.request = request;
+        if(open()) {
+            if(request.type == ResidencyManager::Type::Texture) {
+                const UnsignedInt image = _textures[request.id]->image;
+                const bool normalMap = image < _normalMapImages.size() && _normalMapImages[image];
+                reload.image = _cacheReader ?
+                    _cacheReader->image(image) :
+                    importImage(*_importer, image, normalMap, _configuration);
+
+            /* The processing is deterministic, so the dequantization and the
+               levels of detail are the same as the ones the drawables use */
+            } else if(_cacheReader) {
+                reload.mesh = _cacheReader->mesh(request.id);
+                const Containers::Array<MeshSimplifier::Lod>& lods = _cacheReader->scene().meshLods[request.id];
+                reload.lods = Containers::Array<MeshSimplifier::Lod>{Containers::NoInit, lods.size()};
+                std::copy(lods.begin(), lods.end(), reload.lods.begin());
+            } else {
+                Matrix4 dequantization;
+                MeshOptimizer::Statistics optimization;
+                reload.mesh = importMesh(*_importer, request.id, _configuration, dequantization, reload.lods, optimization);
+            }
+        }
+
+        std::lock_guard<std::mutex> lock{_mutex};
+        _reloads.push_back(std::move(reload));
     }
 }
 
-void addObject(const std::string& path, SceneData& data, Containers::ArrayView<const Containers::Pointer<Trade::ObjectData3D>> objects, Containers::ArrayView<const Containers::Optional<Trade::PhongMaterialData>> materials, Containers::ArrayView<const Containers::Optional<Trade::LightData>> lights, Containers::ArrayView<const bool> hasVertexColors, Object3D& parent, UnsignedInt i) {
+Containers::Array<ResidencyManager::Source::Loaded> ResourceSource::upload(SceneResourceManager& manager) {
+    /* Same as AsyncLoader::State::uploadPending(), at least one per call and
+       then until over any of the budgets */
+    Containers::Array<Loaded> loaded;
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t uploaded = 0;
+    for(;;) {
+        if(uploaded && ((_configuration.uploadBudget && uploaded >= _configuration.uploadBudget) ||
+            (_configuration.uploadTimeBudget && std::chrono::duration<Float, std::milli>(std::chrono::steady_clock::now() - start).count() >= _configuration.uploadTimeBudget)))
+            break;
+
+        Reload reload;
+        {
+            std::lock_guard<std::mutex> lock{_mutex};
+            if(_reloads.empty()) break;
+            reload = std::move(_reloads.front());
+            _reloads.pop_front();
+        }
+
+        const ResidencyManager::Entry& entry = *reload.request.entry;
+        std::size_t size = 0;
+        if(reload.image) {
+            manager.set<GL::Texture2D>(entry.key, createTexture(*_textures[entry.id], *reload.image, _pixelBuffers, reload.request.skipLevels),
+                ResourceDataState::Mutable, ResourcePolicy::Resident);
+            size = textureSize(*reload.image, reload.request.skipLevels);
+        } else if(reload.mesh) {
+            manager.set<GL::Mesh>(entry.key, compileMesh(*reload.mesh, reload.lods),
+                ResourceDataState::Mutable, ResourcePolicy::Resident);
+            size = reload.mesh->vertexData().size() + reload.mesh->indexData().size();
+        }
+
+        arrayAppend(loaded, Loaded{reload.request.entry, reload.request.skipLevels, size});
+        uploaded += size;
+    }
+
+    return loaded;
+}
+
+std::size_t ResourceSource::reduce(SceneResourceManager& manager, const ResidencyManager::Entry& entry) {
+    /* Without copies between textures the texture gets evicted instead */
+    if(entry.type != ResidencyManager::Type::Texture ||
+       !GL::Context::current().isExtensionSupported<GL::Extensions::ARB::copy_image>())
+        return 0;
+
+    const SceneCache::Texture& textureData = *_textures[entry.id];
+    if(textureData.image >= _imageLevels.size() || !_imageLevels[textureData.image])
+        return 0;
+    const ImageLevels& levels = *_imageLevels[textureData.image];
+    const UnsignedInt skipLevels = entry.skippedLevels + 1;
+    if(levels.sizes.size() != entry.levelCount || skipLevels >= entry.levelCount)
+        return 0;
+
+    Resource<GL::Texture2D> previous = manager.get<GL::Texture2D>(entry.key);
+    if(previous.state() != ResourceState::Mutable) return 0;
+
+    /* Copy the levels that stay into a smaller texture, nothing goes through
+       the CPU */
+    const UnsignedInt levelCount = entry.levelCount - skipLevels;
+    GL::Texture2D texture;
+    setSampler(texture, textureData);
+    texture.setStorage(levelCount, levels.format, Math::max(levels.size >> Int(skipLevels), Vector2i{1}));
+    for(UnsignedInt i = 0; i != levelCount; ++i) {
+        const Vector2i size = Math::max(levels.size >> Int(skipLevels + i), Vector2i{1});
+        glCopyImageSubData(previous->id(), GL_TEXTURE_2D, skipLevels + i, 0, 0, 0,
+            texture.id(), GL_TEXTURE_2D, i, 0, 0, 0, size.x(), size.y(), 1);
+    }
+    manager.set<GL::Texture2D>(entry.key, std::move(texture),
+        ResourceDataState::Mutable, ResourcePolicy::Resident);
+
+    std::size_t size = 0;
+    for(std::size_t i = skipLevels; i != levels.sizes.size(); ++i)
+        size += levels.sizes[i];
+    return size;
+}
+
+/* Whether the resource was imported, even if it's not uploaded yet or got
+   evicted. Unlike checking the resource itself, this works with fallbacks
+   set as well. */
+template<class T> bool isImported(SceneResourceManager& manager, const std::string& key) {
+    const ResourceState state = manager.state<T>(key);
+    return state != ResourceState::NotLoaded && state != ResourceState::NotLoadedFallback;
+}
+
+/* Flags of the shader for a mesh object. Textures that failed to load are
+   not used. */
+PhongShader::Flags phongShaderFlags(const std::string& path, SceneData& data, const SceneCache::Scene& scene, Containers::ArrayView<const bool> hasVertexColors, const std::unordered_map<std::string, TextureLayer>& textureLayers, const SceneCache::Object& objectData) {
+    PhongShader::Flags flags;
+    if(hasVertexColors[objectData.instance])
+        flags |= PhongShader::Flag::VertexColor;
+
+    if(objectData.material == -1 || !scene.materials[objectData.material])
+        return flags;
+
+    /* With texture arrays, every texture that loaded is in one */
+    const auto hasTexture = [&](const Int texture) {
+        if(texture == -1) return false;
+        const std::string& key = data.contentRegistry.key(Utility::formatString("{}#{}", path, texture));
+        return textureLayers.empty() ?
+            isImported<GL::Texture2D>(data.resourceManager, key) :
+            textureLayers.find(key) != textureLayers.end();
+    };
+
+    const SceneCache::Material& material = *scene.materials[objectData.material];
+    if(hasTexture(material.diffuseTexture)) {
+        flags |= PhongShader::Flag::AmbientTexture|
+            PhongShader::Flag::DiffuseTexture;
+        if(material.hasTextureTransformation)
+            flags |= PhongShader::Flag::TextureTransformation;
+        if(material.alphaMode == Trade::MaterialAlphaMode::Mask)
+            flags |= PhongShader::Flag::AlphaMask;
+    }
+    if(hasTexture(material.normalTexture)) {
+        flags |= PhongShader::Flag::NormalTexture;
+        if(material.hasTextureTransformation)
+            flags |= PhongShader::Flag::TextureTransformation;
+    }
+    if(!textureLayers.empty() && (flags & (PhongShader::Flag::DiffuseTexture|PhongShader::Flag::NormalTexture)))
+        flags |= PhongShader::Flag::TextureArrays;
+
+    return flags;
+}
+
+void addObject(const std::string& path, const Configuration& configuration, SceneData& data, const SceneCache::Scene& scene, Containers::ArrayView<const bool> hasVertexColors, const std::unordered_map<std::string, TextureLayer>& textureLayers, Object3D& parent, UnsignedInt i) {
     /* Object failed to import, skip */
-    if(!objects[i]) return;
+    if(!scene.objects[i]) return;
 
-    const Trade::ObjectData3D& objectData = *objects[i];
+    const SceneCache::Object& objectData = *scene.objects[i];
 
     /* Add the object to the scene and set its transformation. If it has a
        separate TRS, use that to avoid precision issues. */
     Object3D& object = parent.addChild<Object3D>();
-    if(objectData.flags() & Trade::ObjectFlag3D::HasTranslationRotationScaling)
-        object.setTranslation(objectData.translation())
-              .setRotation(objectData.rotation())
-              .setScaling(objectData.scaling());
-    else object.setTransformation(objectData.transformation());
+    if(objectData.hasTranslationRotationScaling)
+        object.setTranslation(objectData.translation)
+              .setRotation(objectData.rotation)
+              .setScaling(objectData.scaling);
+    else object.setTransformation(objectData.transformation);
 
     /* Save it to the ID -> pointer mapping array */
     data.objects[i].object = &object;
 
     /* Add a drawable if the object has a mesh */
-    std::string meshKey = Utility::formatString("{}#{}", path, objectData.instance());
-    Resource<GL::Mesh> mesh = data.resourceManager.get<GL::Mesh>(meshKey);
-    if(objectData.instanceType() == Trade::ObjectInstanceType3D::Mesh && objectData.instance() != -1 && mesh) {
-        const Int materialId = static_cast<const Trade::MeshObjectData3D&>(objectData).material();
-
-        Shaders::Phong::Flags flags;
-        if(hasVertexColors[objectData.instance()])
-            flags |= Shaders::Phong::Flag::VertexColor;
+    std::string meshKey = Utility::formatString("{}#{}", path, objectData.instance);
+    if(objectData.instanceType == Trade::ObjectInstanceType3D::Mesh && objectData.instance != -1 && isImported<GL::Mesh>(data.resourceManager, data.contentRegistry.key(meshKey))) {
+        Resource<GL::Mesh> mesh = data.resourceManager.get<GL::Mesh>(data.contentRegistry.key(meshKey));
+        const Int materialId = objectData.material;
 
        /* Material not available / not loaded */
-        if(materialId == -1 || !materials[materialId]) {
+        if(materialId == -1 || !scene.materials[materialId]) {
         /* Material available */
         } else {
-            const Trade::PhongMaterialData& material = *materials[materialId];
+            const SceneCache::Material& material = *scene.materials[materialId];
 
             /* Textured material. If the texture failed to load, just use
                a default-colored material. */
             Resource<GL::Texture2D> diffuseTexture;
             Resource<GL::Texture2D> normalTexture;
+            ResidencyManager::Entry* diffuseTextureEntry{};
+            ResidencyManager::Entry* normalTextureEntry{};
+            Resource<GL::Texture2DArray> diffuseTextureArray;
+            Resource<GL::Texture2DArray> normalTextureArray;
+            Int diffuseTextureLayer{}, normalTextureLayer{};
             Float normalTextureScale = 1.0f;
-            if(material.hasAttribute(Trade::MaterialAttribute::DiffuseTexture)) {
-                std::string textureKey = Utility::formatString("{}#{}", path, material.diffuseTexture());
-                Resource<GL::Texture2D> texture = data.resourceManager.get<GL::Texture2D>(textureKey);
-                if(texture) {
-                    diffuseTexture = texture;
-                    flags |= Shaders::Phong::Flag::AmbientTexture|
-                        Shaders::Phong::Flag::DiffuseTexture;
-                    if(material.hasTextureTransformation())
-                        flags |= Shaders::Phong::Flag::TextureTransformation;
-                    if(material.alphaMode() == Trade::MaterialAlphaMode::Mask)
-                        flags |= Shaders::Phong::Flag::AlphaMask;
+            if(material.diffuseTexture != -1) {
+                std::string textureKey = data.contentRegistry.key(Utility::formatString("{}#{}", path, material.diffuseTexture));
+                auto layer = textureLayers.find(textureKey);
+                if(layer != textureLayers.end()) {
+                    diffuseTextureArray = data.resourceManager.get<GL::Texture2DArray>(Utility::formatString("{}#array{}", path, layer->second.array));
+                    diffuseTextureLayer = layer->second.layer;
+                } else if(isImported<GL::Texture2D>(data.resourceManager, textureKey)) {
+                    diffuseTexture = data.resourceManager.get<GL::Texture2D>(textureKey);
+                    diffuseTextureEntry = data.residency.find(textureKey);
                 }
             }
 
             /* Normal textured material. If the textures failed to load, just
                use a default-colored material. */
-            if(material.hasAttribute(Trade::MaterialAttribute::NormalTexture)) {
-                std::string textureKey = Utility::formatString("{}#{}", path, material.normalTexture());
-                Resource<GL::Texture2D> texture = data.resourceManager.get<GL::Texture2D>(textureKey);
-                if(texture) {
-                    normalTexture = texture;
-                    normalTextureScale = material.normalTextureScale();
-                    flags |= Shaders::Phong::Flag::NormalTexture;
-                    if(material.hasTextureTransformation())
-                        flags |= Shaders::Phong::Flag::TextureTransformation;
+            if(material.normalTexture != -1) {
+                std::string textureKey = data.contentRegistry.key(Utility::formatString("{}#{}", path, material.normalTexture));
+                auto layer = textureLayers.find(textureKey);
+                if(layer != textureLayers.end()) {
+                    normalTextureArray = data.resourceManager.get<GL::Texture2DArray>(Utility::formatString("{}#array{}", path, layer->second.array));
+                    normalTextureLayer = layer->second.layer;
+                    normalTextureScale = material.normalTextureScale;
+                } else if(isImported<GL::Texture2D>(data.resourceManager, textureKey)) {
+                    normalTexture = data.resourceManager.get<GL::Texture2D>(textureKey);
+                    normalTextureEntry = data.residency.find(textureKey);
+                    normalTextureScale = material.normalTextureScale;
                 }
             }
 
-            PhongDrawable& phongDrawable = object.addFeature<PhongDrawable>(phongShader(data, flags), mesh,
-                material.diffuseColor(), diffuseTexture, normalTexture,
-                normalTextureScale, material.alphaMask(),
-                material.commonTextureMatrix(),
-                material.alphaMode() == Trade::MaterialAlphaMode::Blend ?
+            PhongDrawable& phongDrawable = object.addFeature<PhongDrawable>(
+                data.shaderRegistry.phong(phongShaderFlags(path, data, scene, hasVertexColors, textureLayers, objectData), data.lightCount), mesh,
+                scene.meshDequantizations[objectData.instance],
+                material.diffuseColor, diffuseTexture, normalTexture,
+                normalTextureScale, material.alphaMask,
+                material.textureMatrix,
+                material.alphaMode == Trade::MaterialAlphaMode::Blend ?
                     data.transparentDrawables : data.opaqueDrawables);
+            phongDrawable.setResidencyEntries(data.residency.find(data.contentRegistry.key(meshKey)),
+                diffuseTextureEntry, normalTextureEntry);
+            if(!textureLayers.empty())
+                phongDrawable.setTextureArrays(diffuseTextureArray, diffuseTextureLayer,
+                    normalTextureArray, normalTextureLayer);
+            if(!scene.meshLods[objectData.instance].empty())
+                phongDrawable.setLods(scene.meshLods[objectData.instance],
+                    scene.meshBounds[objectData.instance], configuration.lodPixelError);
+            /* Only opaque objects hide what's behind them, alpha-masked
+               ones have holes the occluder mesh doesn't know about */
+            const OcclusionCulling::Occluder* occluder{};
+            if(data.occlusion && material.alphaMode == Trade::MaterialAlphaMode::Opaque && !data.occlusion->occluder(objectData.instance).indices.empty())
+                occluder = &data.occlusion->occluder(objectData.instance);
+            data.culling.add(phongDrawable, scene.meshBoundingBoxes[objectData.instance], occluder, i);
             data.objects[i].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)] = &phongDrawable;
         }
 
     /* Light */
-    } else if(objectData.instanceType() == Trade::ObjectInstanceType3D::Light && objectData.instance() != -1) {
+    } else if(objectData.instanceType == Trade::ObjectInstanceType3D::Light && objectData.instance != -1) {
         /* Add a light drawable, which puts correct camera-relative position
            to data.lightPositions. */
-        const Trade::LightData& light = *lights[objectData.instance()];
+        const SceneCache::Light& light = *scene.lights[objectData.instance];
         LightDrawable& lightDrawable = object.addFeature<LightDrawable>(
-            light.type() == Trade::LightData::Type::Directional ? true : false, light.color()*light.intensity(),
-            light.range(), data.lightPositions, data.lightColors, data.lightRanges, data.lightDrawables);
+            light.directional, light.color, light.range,
+            data.lightPositions, data.lightColors, data.lightRanges, data.lightDrawables);
         data.objects[i].features[UnsignedByte(ObjectInfo::FeatureType::LightDrawable)] = &lightDrawable;
 
     /* This is a node that holds the default camera -> assign the object to the
        global camera pointer */
-    } else if(objectData.instanceType() == Trade::ObjectInstanceType3D::Camera && objectData.instance() == 0) {
+    } else if(objectData.instanceType == Trade::ObjectInstanceType3D::Camera && objectData.instance == 0) {
         data.cameraObject = &object;
     }
 
     /* Recursively add children */
-    for(std::size_t id: objectData.children())
-        addObject(path, data, objects, materials, lights, hasVertexColors, object, id);
+    for(std::size_t id: objectData.children)
+        addObject(path, configuration, data, scene, hasVertexColors, textureLayers, object, id);
 }
 
+/* Adds the batch drawn with the material of its first member. Objects that
+   didn't get a drawable are left out. The batch is culled with the box of
+   all its members, as its vertices are already in the scene. */
+void addBatch(const std::string& path, SceneData& data, const SceneCache::Scene& scene, UnsignedInt i) {
+    const std::string key = data.contentRegistry.key(Utility::formatString("{}#batch{}", path, i));
+    if(!isImported<GL::Mesh>(data.resourceManager, key)) return;
+
+    const SceneCache::Batch& batchData = scene.batches[i];
+    Containers::Array<UnsignedInt> objects;
+    Containers::Array<BatchDrawable::Member> members;
+    Range3D box;
+    for(std::size_t j = 0; j != batchData.objects.size(); ++j) {
+        SceneGraph::AbstractFeature3D* feature = data.objects[batchData.objects[j]].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
+        if(!feature || static_cast<PhongDrawable*>(feature)->drawables() != &data.opaqueDrawables)
+            continue;
+
+        const Range3D memberBox = FrustumCulling::transform(
+            scene.meshBoundingBoxes[scene.objects[batchData.objects[j]]->instance],
+            feature->object().absoluteTransformationMatrix());
+        box = objects.empty() ? memberBox : Math::join(box, memberBox);
+        arrayAppend(objects, batchData.objects[j]);
+        arrayAppend(members, Containers::InPlaceInit, static_cast<PhongDrawable*>(feature),
+            batchData.indexOffsets[j], batchData.indexOffsets[j + 1] - batchData.indexOffsets[j]);
+    }
+    if(members.empty()) return;
+
+    Object3D& object = data.scene.addChild<Object3D>();
+    BatchDrawable& batch = object.addFeature<BatchDrawable>(
+        data.resourceManager.get<GL::Mesh>(key), std::move(members),
+        data.opaqueDrawables);
+    data.culling.add(batch, box);
+    for(const UnsignedInt objectId: objects)
+        data.objects[objectId].batch = &batch;
 }
 
-void load(const std::string& path, SceneData& data) {
-    Containers::Pointer<Trade::AbstractImporter> importer =
-        data.manager.loadAndInstantiate("TinyGltfImporter");
+/* Adds the proxy of the cluster, inactive. Objects that didn't get a
+   drawable are left out. */
+void addHlod(const std::string& path, const Configuration& configuration, SceneData& data, const SceneCache::Scene& scene, UnsignedInt i) {
+    const std::string key = data.contentRegistry.key(Utility::formatString("{}#hlod{}", path, i));
+    if(!isImported<GL::Mesh>(data.resourceManager, key)) return;
 
-    if(!importer->openFile(path)) {
-        Error{} << "Cannot open the file" << path;
-        return;
+    const SceneCache::HlodCluster& clusterData = scene.hlods[i];
+    Containers::Array<PhongDrawable*> members;
+    for(const UnsignedInt objectId: clusterData.objects) {
+        SceneGraph::AbstractFeature3D* feature = data.objects[objectId].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
+        if(feature && static_cast<PhongDrawable*>(feature)->drawables() == &data.opaqueDrawables)
+            arrayAppend(members, static_cast<PhongDrawable*>(feature));
     }
+    if(members.empty()) return;
 
-    /* Load all textures */
-    for(UnsignedInt i = 0; i != importer->textureCount(); ++i) {
-        Containers::Optional<Trade::TextureData> textureData = importer->texture(i);
-        if(!textureData || textureData->type() != Trade::TextureData::Type::Texture2D) {
-            Warning{} << "Cannot load texture" << i << importer->textureName(i);
+    Object3D& object = data.scene.addChild<Object3D>();
+    PhongDrawable& proxy = object.addFeature<PhongDrawable>(
+        data.shaderRegistry.phong(PhongShader::Flag::VertexColor, data.lightCount),
+        data.resourceManager.get<GL::Mesh>(key), Matrix4{}, 0xffffff_rgbf,
+        data.opaqueDrawables);
+    data.opaqueDrawables.remove(proxy);
+    data.culling.add(proxy, Range3D::fromCenter(clusterData.bounds.xyz(), Vector3{clusterData.bounds.w()}));
+
+    arrayAppend(data.hlods, Containers::InPlaceInit, clusterData.bounds,
+        clusterData.bounds.w()*configuration.hlodDistance, &object, &proxy,
+        std::move(members), false);
+}
+
+/* Drawables that get swapped with the proxies by Hlod::update() */
+std::unordered_set<const PhongDrawable*> gatherHlodMembers(const SceneData& data) {
+    std::unordered_set<const PhongDrawable*> members;
+    for(const HlodCluster& cluster: data.hlods)
+        members.insert(cluster.members.begin(), cluster.members.end());
+    return members;
+}
+
+/* Moves the opaque drawables the GPU-driven path can draw over to it.
+   Batched objects are not in the group anymore and members of HLOD
+   clusters get swapped with the proxies, so both are left out. */
+void addGpuDrawables(const std::string& path, SceneData& data, const SceneCache::Scene& scene) {
+    const std::unordered_set<const PhongDrawable*> hlodMembers = gatherHlodMembers(data);
+
+    for(UnsignedInt i = 0; i != scene.objects.size(); ++i) {
+        SceneGraph::AbstractFeature3D* feature = data.objects[i].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
+        if(!feature) continue;
+
+        PhongDrawable& drawable = *static_cast<PhongDrawable*>(feature);
+        const PhongShader::Flags flags = drawable.shader().flags();
+        if(drawable.drawables() != &data.opaqueDrawables || hlodMembers.count(&drawable) || !GpuScene::canDraw(flags))
             continue;
-        }
 
-        Containers::Optional<Trade::ImageData2D> imageData = importer->image2D(textureData->image());
-        if(!imageData) {
-            Warning{} << "Cannot load texture" << i << importer->image2DName(textureData->image());
+        const std::string key = data.contentRegistry.key(Utility::formatString("{}#{}", path, scene.objects[i]->instance));
+        if(!data.gpuScene->hasMesh(key)) continue;
+
+        data.gpuScene->add(drawable, key, scene.meshBoundingBoxes[scene.objects[i]->instance],
+            data.shaderRegistry.phong(flags|PhongShader::Flag::GpuDriven, data.lightCount));
+        data.objects[i].gpuScene = data.gpuScene.get();
+    }
+}
+
+/* Whether the drawables can be drawn with the material of each other */
+bool sameMaterial(const PhongDrawable& a, const PhongDrawable& b) {
+    return &a.shader() == &b.shader() && a.color() == b.color() &&
+        a.diffuseTexture().key() == b.diffuseTexture().key() &&
+        a.normalTexture().key() == b.normalTexture().key() &&
+        a.diffuseTextureArray().key() == b.diffuseTextureArray().key() &&
+        a.normalTextureArray().key() == b.normalTextureArray().key() &&
+        a.diffuseTextureLayer() == b.diffuseTextureLayer() &&
+        a.normalTextureLayer() == b.normalTextureLayer() &&
+        a.normalTextureScale() == b.normalTextureScale() &&
+        a.alphaMask() == b.alphaMask() &&
+        a.textureMatrix() == b.textureMatrix();
+}
+
+/* Draws opaque drawables sharing a mesh and a material with one instanced
+   draw once there's at least instancingThreshold of them. Gets only what's
+   left in the group after the batches and the GPU-driven path, members of
+   HLOD clusters are left out for the same reason as there. */
+void addInstances(const std::string& path, const Configuration& configuration, SceneData& data, const SceneCache::Scene& scene) {
+    const std::unordered_set<const PhongDrawable*> hlodMembers = gatherHlodMembers(data);
+
+    /* Objects grouped by the mesh first, then by the material. Meshes
+       deduplicated by the content registry share the key. */
+    std::unordered_map<std::string, Containers::Array<Containers::Array<UnsignedInt>>> groups;
+    for(UnsignedInt i = 0; i != scene.objects.size(); ++i) {
+        SceneGraph::AbstractFeature3D* feature = data.objects[i].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)];
+        if(!feature) continue;
+
+        PhongDrawable& drawable = *static_cast<PhongDrawable*>(feature);
+        if(drawable.drawables() != &data.opaqueDrawables || hlodMembers.count(&drawable))
             continue;
+
+        Containers::Array<Containers::Array<UnsignedInt>>& meshGroups = groups[data.contentRegistry.key(Utility::formatString("{}#{}", path, scene.objects[i]->instance))];
+        std::size_t group = 0;
+        for(; group != meshGroups.size(); ++group)
+            if(sameMaterial(*static_cast<PhongDrawable*>(data.objects[meshGroups[group][0]].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)]), drawable))
+                break;
+        if(group == meshGroups.size())
+            arrayAppend(meshGroups, Containers::InPlaceInit);
+        arrayAppend(meshGroups[group], i);
+    }
+
+    for(auto& meshGroups: groups) for(const Containers::Array<UnsignedInt>& objects: meshGroups.second) {
+        if(objects.size() < configuration.instancingThreshold) continue;
+
+        Containers::Array<PhongDrawable*> members{Containers::NoInit, objects.size()};
+        for(std::size_t j = 0; j != objects.size(); ++j)
+            members[j] = static_cast<PhongDrawable*>(data.objects[objects[j]].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)]);
+
+        PhongShader& shader = data.shaderRegistry.phong(members[0]->shader().flags()|PhongShader::Flag::InstancedTransformation, data.lightCount);
+        Object3D& object = data.scene.addChild<Object3D>();
+        InstancedDrawable& instances = object.addFeature<InstancedDrawable>(
+            shader, std::move(members),
+            scene.meshBoundingBoxes[scene.objects[objects[0]]->instance],
+            data.opaqueDrawables);
+        data.culling.add(instances, instances.box());
+        for(const UnsignedInt objectId: objects)
+            data.objects[objectId].instances = &instances;
+    }
+}
+
+}
+
+struct AsyncLoader::State {
+    explicit State(const std::string& path, const Configuration& configuration): path{path}, configuration(configuration) {}
+
+    void run();
+    bool importObject(UnsignedInt id);
+    void gatherResources();
+    Containers::Array<Matrix4> objectTransformations() const;
+    void bakeBatches(Containers::ArrayView<const Matrix4> transformations);
+    void bakeHlods(Containers::ArrayView<const Matrix4> transformations);
+    void loadCached();
+    void decode(Trade::AbstractImporter* importer);
+    void registerResource(SceneData& data, DecodedResource&& resource);
+    void packTextureArrays(SceneData& data);
+    void uploadResource(SceneData& data, const PendingUpload& upload);
+    void uploadPending(SceneData& data);
+    void submitShaders(SceneData& data);
+    void createScene(SceneData& data);
+
+    std::string path;
+    Configuration configuration;
+    std::string cacheFilename;
+
+    /* Written by the loading thread only, until the queue is finished */
+    PluginManager::Manager<Trade::AbstractImporter> manager;
+    Containers::Pointer<Trade::AbstractImporter> importer;
+    /* The workers import through the importer one at a time */
+    std::mutex importerMutex;
+    Containers::Array<Containers::Pointer<DecodeWorker>> workers;
+    /* Declared before the queue, as the images and meshes read from the
+       cache or the glTF file point into the mapped file */
+    Containers::Pointer<SceneCache::Reader> cacheReader;
+    Containers::Pointer<GlbFile> glb;
+    bool mapMeshes{};
+    /* Empty for images that are not in external files */
+    Containers::Array<std::string> imageFiles;
+    Containers::Pointer<SceneCache::Writer> cacheWriter;
+    SceneCache::Scene scene;
+    Containers::Array<UnsignedInt> images, meshes;
+    Containers::Array<bool> normalMapImages;
+    /* Filled by the workers for the batching and HLOD baking */
+    Containers::Array<Containers::Optional<StaticBatch::Source>> batchSources;
+    Containers::Array<Containers::Optional<Hlod::Source>> hlodSources;
+    Containers::Array<Color4> imageColors;
+
+    /* Written by the uploading thread only */
+    Containers::Array<bool> hasVertexColors;
+    std::deque<PendingUpload> pending;
+    /* With texture arrays, the images wait here until all are decoded */
+    Containers::Array<PendingUpload> arrayImages;
+    /* Array layer of each texture by its key in the content registry */
+    std::unordered_map<std::string, TextureLayer> textureLayers;
+    Containers::Array<PendingArray> textureArrays;
+    /* Passed to the residency manager once the scene is created */
+    Containers::Array<Containers::Optional<ImageLevels>> imageLevels;
+    /* Meshes for the GPU-driven path, null if it's disabled or not
+       supported */
+    Containers::Pointer<GpuScene::MeshPool> gpuMeshes;
+    bool gpuDrivenChecked{};
+    bool texturesPacked{};
+    bool shadersSubmitted{};
+    bool sceneCreated{};
+
+    std::atomic<bool> canceled{false};
+    std::atomic<UnsignedInt> nextJob{0};
+    std::atomic<UnsignedInt> texturesLoaded{0}, textureCount{0},
+        materialsLoaded{0}, materialCount{0},
+        meshesLoaded{0}, meshCount{0},
+        objectsLoaded{0}, objectCount{0};
+
+    DecodedQueue queue;
+    std::thread thread;
+};
+
+void AsyncLoader::State::run() {
+    /* Whatever happens, the uploading thread needs to know there's nothing
+       more to wait for */
+    struct FinishGuard {
+        ~FinishGuard() { queue.setFinished(); }
+        DecodedQueue& queue;
+    } finishGuard{queue};
+
+    /* If there's a cache made from the current version of the file, load
+       from it instead of importing */
+    if(!configuration.cacheDirectory.empty()) {
+        std::string variant;
+        if(configuration.optimizeMeshes) variant += "-optimized";
+        if(configuration.compactVertexFormats) variant += "-compact";
+        if(configuration.lodCount) variant += Utility::formatString("-lod{}x{}", configuration.lodCount, configuration.lodReduction);
+        if(configuration.hlodGridSize) variant += Utility::formatString("-hlod{}x{}", configuration.hlodGridSize, configuration.hlodReduction);
+        if(configuration.batchTriangleLimit) variant += Utility::formatString("-batch{}x{}", configuration.batchTriangleLimit, configuration.batchVertexLimit);
+        if(configuration.occlusionCulling) variant += Utility::formatString("-occluders{}", configuration.occluderTriangleLimit);
+        if(configuration.compressTextures) variant += "-compressed";
+        /* The hierarchy is stored for one scene even if everything in the
+           file is imported */
+        if(configuration.scene != -1) variant += Utility::formatString("-scene{}", configuration.scene);
+        if(configuration.reachableOnly) variant += "-reachable";
+        cacheFilename = SceneCache::filename(configuration.cacheDirectory, path, variant);
+        cacheReader.emplace(cacheFilename, path);
+        if(*cacheReader) {
+            loadCached();
+            return;
         }
 
-        /* Configure the texture */
-        GL::Texture2D texture;
-        texture
-            .setMagnificationFilter(textureData->magnificationFilter())
-            .setMinificationFilter(textureData->minificationFilter(), textureData->mipmapFilter())
-            .setWrapping(textureData->wrapping().xy());
+        cacheReader = nullptr;
+    }
+
+    importer = loadImporter(manager, path, configuration);
+    if(!importer || !importer->openFile(path)) {
+        Error{} << "Cannot open the file" << path;
+        return;
+    }
+
+    /* Map binary glTF files, so the workers can decode the embedded images
+       from the mapping in parallel and meshes that can be uploaded directly
+       don't get imported at all. If it doesn't agree with the importer on
+       what the meshes and images are, everything goes through the
+       importer. */
+    if(Utility::String::endsWith(Utility::String::lowercase(path), ".glb")) {
+        glb.emplace(path);
+        if(!*glb || glb->meshCount() != importer->meshCount() || glb->imageCount() != importer->image2DCount())
+            glb = nullptr;
+    }
+    mapMeshes = glb && canMapMeshes(path, configuration) && importer->configuration().value<bool>("textureCoordinateYFlipInMaterial");
+
+    /* Images in external files get opened by each worker on its own, so
+       they're decoded in parallel as well */
+    imageFiles = GlbFile::imageFiles(path);
+    if(imageFiles.size() != importer->image2DCount())
+        imageFiles = nullptr;
+
+    scene.imageCount = importer->image2DCount();
+    scene.meshCount = importer->meshCount();
+    scene.meshDequantizations = Containers::Array<Matrix4>{scene.meshCount};
+    scene.meshBounds = Containers::Array<Vector4>{Containers::ValueInit, scene.meshCount};
+    scene.meshBoundingBoxes = Containers::Array<Range3D>{Containers::ValueInit, scene.meshCount};
+    scene.meshLods = Containers::Array<Containers::Array<MeshSimplifier::Lod>>{scene.meshCount};
+    scene.meshOptimizations = Containers::Array<MeshOptimizer::Statistics>{Containers::ValueInit, scene.meshCount};
+    scene.meshOccluders = Containers::Array<OcclusionCulling::Occluder>{scene.meshCount};
+    scene.textures = Containers::Array<Containers::Optional<SceneCache::Texture>>{importer->textureCount()};
+    scene.materials = Containers::Array<Containers::Optional<SceneCache::Material>>{importer->materialCount()};
+    scene.lights = Containers::Array<Containers::Optional<SceneCache::Light>>{importer->lightCount()};
 
-        loadImage(texture, *imageData);
+    /* Walk the scene hierarchy first, so only what it uses gets imported */
+    bool sceneFailed = false;
+    const Int sceneId = configuration.scene != -1 ? configuration.scene : importer->defaultScene();
+    if(sceneId != -1 && !canceled) {
+        Containers::Optional<Trade::SceneData> sceneData = importer->scene(sceneId);
+        if(sceneData) {
+            scene.children = sceneData->children3D();
+            scene.objects = Containers::Array<Containers::Optional<SceneCache::Object>>{importer->object3DCount()};
+            if(configuration.reachableOnly) {
+                std::vector<UnsignedInt> objects = *scene.children;
+                objectCount = UnsignedInt(objects.size());
+                while(!objects.empty() && !canceled) {
+                    const UnsignedInt i = objects.back();
+                    objects.pop_back();
+                    if(importObject(i)) {
+                        objectCount += UnsignedInt(scene.objects[i]->children.size());
+                        objects.insert(objects.end(), scene.objects[i]->children.begin(), scene.objects[i]->children.end());
+                    }
+                    ++objectsLoaded;
+                }
+            } else {
+                objectCount = importer->object3DCount();
+                for(UnsignedInt i = 0; i != importer->object3DCount() && !canceled; ++i, ++objectsLoaded)
+                    importObject(i);
+            }
+
+        } else {
+            Error{} << "Cannot load the scene, aborting";
+            sceneFailed = true;
+        }
+    }
 
-        /* Save the texture */
-        std::string textureKey = Utility::formatString("{}#{}", path, i);
-        data.resourceManager.set<GL::Texture2D>(textureKey, std::move(texture));
+    /* Resources referenced by the imported objects */
+    Containers::Array<bool> materialUsed{Containers::DirectInit, scene.materials.size(), !configuration.reachableOnly};
+    Containers::Array<bool> lightUsed{Containers::DirectInit, scene.lights.size(), !configuration.reachableOnly};
+    for(const Containers::Optional<SceneCache::Object>& object: scene.objects) {
+        if(!object || object->instance == -1) continue;
+        if(object->instanceType == Trade::ObjectInstanceType3D::Mesh && object->material != -1 && UnsignedInt(object->material) < materialUsed.size())
+            materialUsed[object->material] = true;
+        else if(object->instanceType == Trade::ObjectInstanceType3D::Light && UnsignedInt(object->instance) < lightUsed.size())
+            lightUsed[object->instance] = true;
     }
 
-    /* Load all lights */
-    Containers::Array<Containers::Optional<Trade::LightData>> lights{importer->lightCount()};
-    for(UnsignedInt i = 0; i != importer->lightCount(); ++i) {
+    for(UnsignedInt i = 0; i != scene.lights.size(); ++i) {
+        if(!lightUsed[i]) continue;
+
         Containers::Optional<Trade::LightData> light = importer->light(i);
         if(!light) {
             Warning{} << "Cannot load light" << i << importer->lightName(i);
             continue;
         }
 
-        lights[i] = std::move(light);
+        scene.lights[i] = convertLight(*light);
     }
 
-    /* Load all materials */
-    Containers::Array<Containers::Optional<Trade::PhongMaterialData>> materials{importer->materialCount()};
-    for(UnsignedInt i = 0; i != importer->materialCount(); ++i) {
+    for(const bool used: materialUsed) if(used) ++materialCount;
+    for(UnsignedInt i = 0; i != scene.materials.size() && !canceled; ++i) {
+        if(!materialUsed[i]) continue;
+
         Containers::Optional<Trade::MaterialData> materialData = importer->material(i);
+        ++materialsLoaded;
         if(!materialData || !(materialData->types() & Trade::MaterialType::Phong) || (materialData->as<Trade::PhongMaterialData>().hasTextureTransformation() && !materialData->as<Trade::PhongMaterialData>().hasCommonTextureTransformation()) || materialData->as<Trade::PhongMaterialData>().hasTextureCoordinates()) {
             Warning{} << "Cannot load material" << i << importer->materialName(i);
             continue;
         }
 
-        materials[i] = std::move(*materialData).as<Trade::PhongMaterialData>();
+        scene.materials[i] = convertMaterial(materialData->as<Trade::PhongMaterialData>());
     }
 
-    /* Load all meshes. Remember which have vertex colors. */
-    Containers::Array<bool> hasVertexColors{Containers::DirectInit, importer->meshCount(), false};
-    for(UnsignedInt i = 0; i != importer->meshCount(); ++i) {
-        Containers::Optional<Trade::MeshData> meshData = importer->mesh(i);
-        if(!meshData) {
-            Warning{} << "Cannot load mesh" << i << importer->meshName(i);
+    /* Textures of the imported materials. Each image is then decoded only
+       once even if more textures use it. */
+    Containers::Array<bool> textureUsed{Containers::DirectInit, scene.textures.size(), !configuration.reachableOnly};
+    for(const Containers::Optional<SceneCache::Material>& material: scene.materials) {
+        if(!material) continue;
+        for(const Int texture: {material->diffuseTexture, material->normalTexture})
+            if(texture != -1 && UnsignedInt(texture) < textureUsed.size())
+                textureUsed[texture] = true;
+    }
+
+    for(UnsignedInt i = 0; i != scene.textures.size(); ++i) {
+        if(!textureUsed[i]) continue;
+
+        Containers::Optional<Trade::TextureData> textureData = importer->texture(i);
+        if(!textureData || textureData->type() != Trade::TextureData::Type::Texture2D) {
+            Warning{} << "Cannot load texture" << i << importer->textureName(i);
             continue;
         }
 
-        hasVertexColors[i] = meshData->hasAttribute(Trade::MeshAttribute::Color);
+        scene.textures[i] = convertTexture(*textureData);
+    }
 
-        /* Compile and save the mesh */
-        std::string meshKey = Utility::formatString("{}#{}", path, i);
-        data.resourceManager.set<GL::Mesh>(meshKey, MeshTools::compile(*meshData));
+    gatherResources();
+
+    if(!cacheFilename.empty()) {
+        cacheWriter.emplace(cacheFilename, scene.imageCount, scene.meshCount);
+        if(!cacheWriter->isOpen()) {
+            Warning{} << "Cannot create the scene cache" << cacheFilename;
+            cacheWriter = nullptr;
+        }
     }
 
-    /* Load the scene */
-    if(importer->defaultScene() != -1) {
-        Containers::Optional<Trade::SceneData> sceneData = importer->scene(importer->defaultScene());
-        if(!sceneData) {
-            Error{} << "Cannot load the scene, aborting";
-            return;
+    /* Images used as normal maps are compressed differently */
+    normalMapImages = Containers::Array<bool>{Containers::ValueInit, scene.imageCount};
+    for(const Containers::Optional<SceneCache::Material>& material: scene.materials) {
+        if(!material || material->normalTexture == -1 ||
+           UnsignedInt(material->normalTexture) >= scene.textures.size())
+            continue;
+        const Containers::Optional<SceneCache::Texture>& texture = scene.textures[material->normalTexture];
+        if(texture && texture->image < normalMapImages.size())
+            normalMapImages[texture->image] = true;
+    }
+
+    if(configuration.batchTriangleLimit && scene.children)
+        batchSources = Containers::Array<Containers::Optional<StaticBatch::Source>>{scene.meshCount};
+    if(configuration.hlodGridSize && scene.children) {
+        hlodSources = Containers::Array<Containers::Optional<Hlod::Source>>{scene.meshCount};
+        imageColors = Containers::Array<Color4>{Containers::DirectInit, scene.imageCount, Color4{1.0f}};
+    }
+
+    /* Spawn the workers decoding images and preparing meshes. The decoding
+       is done in parallel, the uploading thread does only the GPU uploads. */
+    const UnsignedInt jobCount = images.size() + meshes.size();
+    UnsignedInt threadCount = configuration.threadCount ?
+        configuration.threadCount : std::thread::hardware_concurrency();
+    threadCount = Math::clamp(threadCount, 1u, Math::max(jobCount, 1u));
+
+    workers = Containers::Array<Containers::Pointer<DecodeWorker>>{threadCount};
+    for(Containers::Pointer<DecodeWorker>& worker: workers) {
+        worker = Containers::Pointer<DecodeWorker>{new DecodeWorker};
+        worker->imageImporter = worker->manager.loadAndInstantiate("AnyImageImporter");
+        worker->thread = std::thread{&State::decode, this, worker->imageImporter.get()};
+    }
+
+    for(Containers::Pointer<DecodeWorker>& worker: workers)
+        worker->thread.join();
+
+    /* The batches and proxies need all meshes of their objects. Batching
+       goes first, as batched objects are left out of the proxies. */
+    if((!batchSources.empty() || !hlodSources.empty()) && !canceled && !sceneFailed) {
+        const Containers::Array<Matrix4> transformations = objectTransformations();
+        if(!batchSources.empty()) bakeBatches(transformations);
+        if(!hlodSources.empty() && !canceled) bakeHlods(transformations);
+    }
+    batchSources = nullptr;
+    hlodSources = nullptr;
+
+    /* Save the cache only if the whole file got imported */
+    if(cacheWriter && !canceled && !sceneFailed)
+        cacheWriter->finish(path, scene);
+    cacheWriter = nullptr;
+}
+
+bool AsyncLoader::State::importObject(const UnsignedInt id) {
+    /* Objects may be referenced more than once in broken files */
+    if(id >= scene.objects.size() || scene.objects[id]) return false;
+
+    Containers::Pointer<Trade::ObjectData3D> objectData = importer->object3D(id);
+    if(!objectData) {
+        Error{} << "Cannot import object" << id << importer->object3DName(id);
+        return false;
+    }
+
+    scene.objects[id] = convertObject(*objectData, importer->object3DName(id));
+    return true;
+}
+
+void AsyncLoader::State::gatherResources() {
+    /* Only images referenced by a texture get decoded and uploaded */
+    Containers::Array<bool> imageUsed{Containers::ValueInit, scene.imageCount};
+    for(const Containers::Optional<SceneCache::Texture>& texture: scene.textures)
+        if(texture && texture->image < imageUsed.size())
+            imageUsed[texture->image] = true;
+
+    for(UnsignedInt i = 0; i != imageUsed.size(); ++i)
+        if(imageUsed[i]) arrayAppend(images, i);
+
+    /* Only meshes of the objects get decoded, or the first mesh that's
+       displayed if there's no scene */
+    Containers::Array<bool> meshUsed{Containers::DirectInit, scene.meshCount, !configuration.reachableOnly};
+    if(scene.children) {
+        for(const Containers::Optional<SceneCache::Object>& object: scene.objects)
+            if(object && object->instanceType == Trade::ObjectInstanceType3D::Mesh && object->instance != -1 && UnsignedInt(object->instance) < meshUsed.size())
+                meshUsed[object->instance] = true;
+    } else if(!meshUsed.empty()) meshUsed[0] = true;
+
+    for(UnsignedInt i = 0; i != meshUsed.size(); ++i)
+        if(meshUsed[i]) arrayAppend(meshes, i);
+
+    hasVertexColors = Containers::Array<bool>{Containers::DirectInit, scene.meshCount, false};
+    textureCount = images.size();
+    meshCount = meshes.size();
+}
+
+Containers::Array<Matrix4> AsyncLoader::State::objectTransformations() const {
+    /* Transformation of every object in the scene */
+    Containers::Array<Matrix4> transformations{scene.objects.size()};
+    std::vector<std::pair<UnsignedInt, Matrix4>> stack;
+    for(const UnsignedInt i: *scene.children) stack.emplace_back(i, Matrix4{});
+    while(!stack.empty()) {
+        const std::pair<UnsignedInt, Matrix4> top = stack.back();
+        stack.pop_back();
+        if(top.first >= scene.objects.size() || !scene.objects[top.first]) continue;
+
+        const SceneCache::Object& object = *scene.objects[top.first];
+        transformations[top.first] = top.second*(object.hasTranslationRotationScaling ?
+            Matrix4::from(object.rotation.toMatrix(), object.translation)*Matrix4::scaling(object.scaling) :
+            object.transformation);
+        for(const UnsignedInt child: object.children)
+            stack.emplace_back(child, transformations[top.first]);
+    }
+
+    return transformations;
+}
+
+void AsyncLoader::State::bakeBatches(const Containers::ArrayView<const Matrix4> transformations) {
+    /* Small opaque mesh objects grouped by the material and the vertex
+       layout, with the same conditions as for adding a drawable in
+       addObject() */
+    std::map<std::pair<Int, UnsignedInt>, Containers::Array<UnsignedInt>> groups;
+    for(UnsignedInt i = 0; i != scene.objects.size(); ++i) {
+        const Containers::Optional<SceneCache::Object>& object = scene.objects[i];
+        if(!object || object->instanceType != Trade::ObjectInstanceType3D::Mesh ||
+           object->instance == -1 || UnsignedInt(object->instance) >= batchSources.size() ||
+           !batchSources[object->instance] ||
+           object->material == -1 || !scene.materials[object->material] ||
+           scene.materials[object->material]->alphaMode == Trade::MaterialAlphaMode::Blend)
+            continue;
+
+        arrayAppend(groups[{object->material, StaticBatch::layout(*batchSources[object->instance])}], i);
+    }
+
+    /* The batches are published only once all are baked, same as the HLOD
+       clusters */
+    Containers::Array<SceneCache::Batch> batches;
+    Containers::Array<Trade::MeshData> batchMeshes;
+    for(const auto& group: groups) {
+        const Containers::Array<UnsignedInt>& objects = group.second;
+        Containers::Array<Vector3> centers{Containers::NoInit, objects.size()};
+        Containers::Array<UnsignedInt> vertexCounts{Containers::NoInit, objects.size()};
+        for(std::size_t i = 0; i != objects.size(); ++i) {
+            const UnsignedInt mesh = scene.objects[objects[i]]->instance;
+            centers[i] = transformations[objects[i]].transformPoint(scene.meshBounds[mesh].xyz());
+            vertexCounts[i] = batchSources[mesh]->positions.size();
+        }
+
+        for(const Containers::Array<UnsignedInt>& batch: StaticBatch::partition(centers, vertexCounts, configuration.batchVertexLimit)) {
+            if(canceled) return;
+
+            Containers::Array<StaticBatch::Member> members;
+            SceneCache::Batch batchData;
+            for(const UnsignedInt i: batch) {
+                arrayAppend(members, Containers::InPlaceInit,
+                    &*batchSources[scene.objects[objects[i]]->instance],
+                    transformations[objects[i]]);
+                batchData.objects.push_back(objects[i]);
+            }
+
+            Trade::MeshData mesh = StaticBatch::bake(members, batchData.indexOffsets);
+            arrayAppend(batches, Containers::InPlaceInit, std::move(batchData));
+            arrayAppend(batchMeshes, Containers::InPlaceInit, MeshTools::compressIndices(std::move(mesh)));
+        }
+    }
+
+    scene.batches = std::move(batches);
+    for(UnsignedInt i = 0; i != batchMeshes.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::Batch;
+        resource.id = i;
+        resource.contentHash = meshHash(batchMeshes[i]);
+        if(cacheWriter) cacheWriter->writeMesh(scene.meshCount + i, batchMeshes[i]);
+        resource.mesh = std::move(batchMeshes[i]);
+        queue.push(std::move(resource));
+    }
+}
+
+void AsyncLoader::State::bakeHlods(const Containers::ArrayView<const Matrix4> transformations) {
+    Containers::Array<bool> batched{Containers::ValueInit, scene.objects.size()};
+    for(const SceneCache::Batch& batch: scene.batches)
+        for(const UnsignedInt i: batch.objects) batched[i] = true;
+
+    /* Opaque mesh objects that are not batched, with the same conditions as
+       for adding a drawable in addObject() */
+    Containers::Array<UnsignedInt> objects;
+    Containers::Array<Vector4> bounds;
+    for(UnsignedInt i = 0; i != scene.objects.size(); ++i) {
+        const Containers::Optional<SceneCache::Object>& object = scene.objects[i];
+        if(!object || batched[i] || object->instanceType != Trade::ObjectInstanceType3D::Mesh ||
+           object->instance == -1 || UnsignedInt(object->instance) >= hlodSources.size() ||
+           !hlodSources[object->instance] ||
+           object->material == -1 || !scene.materials[object->material] ||
+           scene.materials[object->material]->alphaMode == Trade::MaterialAlphaMode::Blend)
+            continue;
+
+        const Vector4& meshBounds = scene.meshBounds[object->instance];
+        arrayAppend(objects, i);
+        arrayAppend(bounds, Vector4{transformations[i].transformPoint(meshBounds.xyz()),
+            meshBounds.w()*transformations[i].scaling().max()});
+    }
+
+    /* The clusters are published only once all are baked, as the uploading
+       thread may read them as soon as the first proxy is pushed */
+    Containers::Array<SceneCache::HlodCluster> clusters;
+    Containers::Array<Trade::MeshData> proxies;
+    for(const Containers::Array<UnsignedInt>& cluster: Hlod::cluster(bounds, configuration.hlodGridSize)) {
+        if(canceled) return;
+
+        Containers::Array<Hlod::Member> members;
+        SceneCache::HlodCluster clusterData;
+        Vector3 min{Constants::inf()}, max{-Constants::inf()};
+        for(const UnsignedInt i: cluster) {
+            const SceneCache::Object& object = *scene.objects[objects[i]];
+            const SceneCache::Material& material = *scene.materials[object.material];
+            Color4 color = material.diffuseColor;
+            if(material.diffuseTexture != -1 && scene.textures[material.diffuseTexture])
+                color *= imageColors[scene.textures[material.diffuseTexture]->image];
+
+            arrayAppend(members, Containers::InPlaceInit,
+                &*hlodSources[object.instance], transformations[objects[i]], color);
+            clusterData.objects.push_back(objects[i]);
+            min = Math::min(min, bounds[i].xyz() - Vector3{bounds[i].w()});
+            max = Math::max(max, bounds[i].xyz() + Vector3{bounds[i].w()});
+        }
+
+        Containers::Optional<Trade::MeshData> proxy = Hlod::bake(members, configuration.hlodReduction);
+        if(!proxy) continue;
+
+        const Vector3 center = (min + max)*0.5f;
+        Float radius = 0.0f;
+        for(const UnsignedInt i: cluster)
+            radius = Math::max(radius, (bounds[i].xyz() - center).length() + bounds[i].w());
+        clusterData.bounds = {center, radius};
+
+        arrayAppend(clusters, Containers::InPlaceInit, std::move(clusterData));
+        arrayAppend(proxies, Containers::InPlaceInit, MeshTools::compressIndices(std::move(*proxy)));
+    }
+
+    scene.hlods = std::move(clusters);
+    for(UnsignedInt i = 0; i != proxies.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::HlodProxy;
+        resource.id = i;
+        resource.contentHash = meshHash(proxies[i]);
+        if(cacheWriter) cacheWriter->writeMesh(scene.meshCount + scene.batches.size() + i, proxies[i]);
+        resource.mesh = std::move(proxies[i]);
+        queue.push(std::move(resource));
+    }
+}
+
+void AsyncLoader::State::loadCached() {
+    scene = std::move(cacheReader->scene());
+    gatherResources();
+
+    /* Materials and objects are already there */
+    materialCount = materialsLoaded = scene.materials.size();
+    objectCount = objectsLoaded = scene.objects.size();
+
+    /* Images and meshes point directly into the mapped file, so there's
+       nothing to decode. The pages are read in only once uploaded. */
+    for(UnsignedInt i = 0; i != images.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::Image;
+        resource.id = images[i];
+        resource.image = cacheReader->image(resource.id);
+        if(resource.image) resource.contentHash = imageHash(*resource.image);
+        queue.push(std::move(resource));
+    }
+
+    for(UnsignedInt i = 0; i != meshes.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::Mesh;
+        resource.id = meshes[i];
+        resource.mesh = cacheReader->mesh(resource.id);
+        if(resource.mesh) resource.contentHash = meshHash(*resource.mesh);
+        queue.push(std::move(resource));
+    }
+
+    for(UnsignedInt i = 0; i != scene.batches.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::Batch;
+        resource.id = i;
+        resource.mesh = cacheReader->mesh(scene.meshCount + i);
+        if(resource.mesh) resource.contentHash = meshHash(*resource.mesh);
+        queue.push(std::move(resource));
+    }
+
+    for(UnsignedInt i = 0; i != scene.hlods.size() && !canceled; ++i) {
+        DecodedResource resource;
+        resource.type = DecodedResource::Type::HlodProxy;
+        resource.id = i;
+        resource.mesh = cacheReader->mesh(scene.meshCount + scene.batches.size() + i);
+        if(resource.mesh) resource.contentHash = meshHash(*resource.mesh);
+        queue.push(std::move(resource));
+    }
+}
+
+void AsyncLoader::State::decode(Trade::AbstractImporter* imageImporter) {
+    for(UnsignedInt job; !canceled && (job = nextJob++) < images.size() + meshes.size(); ) {
+        DecodedResource resource;
+
+        if(job < images.size()) {
+            resource.type = DecodedResource::Type::Image;
+            resource.id = images[job];
+
+            /* Embedded images are decoded from the mapping and external
+               files are opened directly, only the rest has to wait for the
+               importer */
+            Containers::Optional<Trade::ImageData2D> image;
+            const Containers::ArrayView<const char> data = glb ? glb->image(resource.id) : nullptr;
+            if(!data.empty() && imageImporter && imageImporter->openData(data))
+                image = imageImporter->image2D(0);
+            else if(!imageFiles.empty() && !imageFiles[resource.id].empty() && imageImporter && imageImporter->openFile(imageFiles[resource.id]))
+                image = imageImporter->image2D(0);
+            if(!image) {
+                std::lock_guard<std::mutex> lock{importerMutex};
+                image = importer->image2D(resource.id);
+                if(!image) Warning{} << "Cannot load image" << resource.id << importer->image2DName(resource.id);
+            }
+            if(image) resource.image = processImage(std::move(*image), normalMapImages[resource.id], configuration);
+
+            if(resource.image) {
+                resource.contentHash = imageHash(*resource.image);
+                if(!imageColors.empty()) imageColors[resource.id] = Hlod::averageColor(*resource.image);
+                if(cacheWriter) cacheWriter->writeImage(resource.id, *resource.image);
+            }
+
+        } else {
+            resource.type = DecodedResource::Type::Mesh;
+            resource.id = meshes[job - images.size()];
+            if(mapMeshes) resource.mesh = glb->mesh(resource.id);
+            if(!resource.mesh) {
+                /* Only the import itself is serialized, the processing is
+                   done in parallel */
+                Containers::Optional<Trade::MeshData> mesh;
+                {
+                    std::lock_guard<std::mutex> lock{importerMutex};
+                    mesh = importer->mesh(resource.id);
+                    if(!mesh) Warning{} << "Cannot load mesh" << resource.id << importer->meshName(resource.id);
+                }
+                if(mesh) resource.mesh = processMesh(std::move(*mesh), configuration, scene.meshDequantizations[resource.id], scene.meshLods[resource.id], scene.meshOptimizations[resource.id]);
+            }
+
+            if(resource.mesh) {
+                meshBounds(*resource.mesh, scene.meshDequantizations[resource.id], scene.meshBounds[resource.id], scene.meshBoundingBoxes[resource.id]);
+                if(!batchSources.empty()) batchSources[resource.id] = StaticBatch::source(*resource.mesh, scene.meshDequantizations[resource.id], scene.meshLods[resource.id], configuration.batchTriangleLimit);
+                if(!hlodSources.empty()) hlodSources[resource.id] = Hlod::source(*resource.mesh, scene.meshDequantizations[resource.id], scene.meshLods[resource.id]);
+                if(configuration.occlusionCulling) {
+                    Containers::Optional<OcclusionCulling::Occluder> occluder = OcclusionCulling::occluder(*resource.mesh, scene.meshDequantizations[resource.id], scene.meshLods[resource.id], configuration.occluderTriangleLimit);
+                    if(occluder) scene.meshOccluders[resource.id] = std::move(*occluder);
+                }
+                resource.contentHash = meshHash(*resource.mesh);
+                if(cacheWriter) cacheWriter->writeMesh(resource.id, *resource.mesh);
+            }
         }
 
-        /* Import all objects and first count how many lights is there first so
-           we know which shaders to instantiate. Also initialize the ObjectInfo array
-           with the object count + 1 for the scene. */
-        data.objects = Containers::Array<ObjectInfo>{Containers::ValueInit, importer->object3DCount() + 1};
-        Containers::Array<Containers::Pointer<Trade::ObjectData3D>> objects{importer->object3DCount()};
-        for(UnsignedInt i = 0; i != importer->object3DCount(); ++i) {
-            objects[i] = importer->object3D(i);
-            if(!objects[i]) {
-                Error{} << "Cannot import object" << i << importer->object3DName(i);
+        queue.push(std::move(resource));
+    }
+}
+
+void AsyncLoader::State::registerResource(SceneData& data, DecodedResource&& resource) {
+    if(resource.type == DecodedResource::Type::Image) {
+        ++texturesLoaded;
+        if(!resource.image) return;
+
+        std::size_t imageSize = 0;
+        for(Containers::ArrayView<const char> level: resource.image->levels)
+            imageSize += level.size();
+
+        /* Remember what's needed to reduce the textures on the GPU. Images
+           with generated levels can't be reduced. */
+        const SceneCache::Image& image = *resource.image;
+        if(image.levels.size() > 1) if(const Containers::Optional<GL::TextureFormat> format = textureFormat(image)) {
+            if(imageLevels.empty())
+                imageLevels = Containers::Array<Containers::Optional<ImageLevels>>{scene.imageCount};
+            Containers::Array<std::size_t> sizes{Containers::NoInit, image.levels.size()};
+            for(std::size_t i = 0; i != image.levels.size(); ++i)
+                sizes[i] = image.levels[i].size();
+            imageLevels[resource.id].emplace(ImageLevels{*format, image.size, std::move(sizes)});
+        }
+
+        /* Register every texture referencing the image */
+        const std::size_t size = textureSize(*resource.image);
+        PendingUpload upload{std::move(resource), {}, size};
+        for(UnsignedInt i = 0; i != scene.textures.size(); ++i) {
+            const Containers::Optional<SceneCache::Texture>& textureData = scene.textures[i];
+            if(!textureData || textureData->image != upload.resource.id) continue;
+
+            /* The sampler state is a part of the texture, so only textures
+               with the same image and the same sampler are shared */
+            const struct {
+                SamplerFilter minificationFilter, magnificationFilter;
+                SamplerMipmap mipmapFilter;
+                Array2D<SamplerWrapping> wrapping;
+            } sampler{textureData->minificationFilter,
+                textureData->magnificationFilter, textureData->mipmapFilter,
+                textureData->wrapping};
+            const std::string textureKey = Utility::formatString("{}#{}", path, i);
+            if(!data.contentRegistry.addTexture(textureKey, contentHash({&sampler, sizeof(sampler)}, upload.resource.contentHash), imageSize))
                 continue;
+
+            /* Mark the texture as loading, so the scene can reference it
+               before it's uploaded. Textures going to arrays are set up once
+               the arrays are made. */
+            if(!configuration.textureArrays) {
+                const std::string key = data.contentRegistry.key(textureKey);
+                data.resourceManager.set<GL::Texture2D>(key, nullptr,
+                    ResourceDataState::Loading, ResourcePolicy::Resident);
+                data.residency.addPending(ResidencyManager::Type::Texture, i, key,
+                    upload.size, upload.resource.image->levels.size());
+                data.memoryAccounting.addTexture(accountedTexture(key, i, *upload.resource.image));
             }
+            arrayAppend(upload.textures, i);
+        }
+
+        if(upload.textures.empty()) return;
+        if(configuration.textureArrays)
+            arrayAppend(arrayImages, std::move(upload));
+        else pending.push_back(std::move(upload));
+
+    } else if(resource.type == DecodedResource::Type::Mesh) {
+        ++meshesLoaded;
+        if(!resource.mesh) return;
+
+        hasVertexColors[resource.id] = resource.mesh->hasAttribute(Trade::MeshAttribute::Color);
+
+        /* Register the mesh, if the same one isn't there already. Quantized
+           meshes are the same only if they dequantize the same. */
+        const std::string meshKey = Utility::formatString("{}#{}", path, resource.id);
+        const Matrix4& dequantization = scene.meshDequantizations[resource.id];
+        const std::size_t meshSize = resource.mesh->vertexData().size() + resource.mesh->indexData().size();
+        if(!data.contentRegistry.addMesh(meshKey, contentHash({&dequantization, sizeof(Matrix4)}, resource.contentHash), meshSize))
+            return;
+
+        const std::string key = data.contentRegistry.key(meshKey);
+        data.resourceManager.set<GL::Mesh>(key, nullptr,
+            ResourceDataState::Loading, ResourcePolicy::Resident);
+        data.residency.addPending(ResidencyManager::Type::Mesh, resource.id, key, meshSize);
+        data.memoryAccounting.addMesh(MemoryAccounting::Mesh{key, resource.id,
+            resource.mesh->vertexCount(),
+            resource.mesh->isIndexed() ? resource.mesh->indexCount() : 0,
+            resource.mesh->vertexData().size(),
+            resource.mesh->indexData().size(), 0,
+            scene.meshOptimizations[resource.id]});
+
+        /* The GPU-driven path draws from its own copy, always with the full
+           level of detail */
+        if(gpuMeshes) gpuMeshes->add(key, *resource.mesh,
+            scene.meshLods[resource.id].empty() ? 0 : scene.meshLods[resource.id][0].indexCount);
+        pending.push_back(PendingUpload{std::move(resource), {}, meshSize});
+
+    /* The batches and proxies stay resident, so they're not tracked by the
+       residency manager. They're accounted with the ids they have in the
+       cache. */
+    } else {
+        if(!resource.mesh) return;
+
+        const bool batch = resource.type == DecodedResource::Type::Batch;
+        const std::string generatedKey = Utility::formatString(batch ? "{}#batch{}" : "{}#hlod{}", path, resource.id);
+        const std::size_t meshSize = resource.mesh->vertexData().size() + resource.mesh->indexData().size();
+        if(!data.contentRegistry.addMesh(generatedKey, resource.contentHash, meshSize))
+            return;
+
+        const std::string key = data.contentRegistry.key(generatedKey);
+        data.resourceManager.set<GL::Mesh>(key, nullptr,
+            ResourceDataState::Loading, ResourcePolicy::Resident);
+        data.memoryAccounting.addMesh(MemoryAccounting::Mesh{key,
+            UnsignedInt(scene.meshCount + (batch ? 0 : scene.batches.size()) + resource.id),
+            resource.mesh->vertexCount(), resource.mesh->indexCount(),
+            resource.mesh->vertexData().size(),
+            resource.mesh->indexData().size(), 0, {}});
+        pending.push_back(PendingUpload{std::move(resource), {}, meshSize});
+    }
+}
+
+void AsyncLoader::State::uploadResource(SceneData& data, const PendingUpload& upload) {
+    const DecodedResource& resource = upload.resource;
+    if(resource.type == DecodedResource::Type::Image && !upload.layers.empty()) {
+        for(const std::pair<UnsignedInt, Int>& layer: upload.layers) {
+            PendingArray& array = textureArrays[layer.first];
+            loadImageLayer(*array.texture, layer.second, *resource.image, data.pixelBuffers.get());
+            if(--array.remainingLayers) continue;
+
+            if(array.generateMipmap) array.texture->generateMipmap();
+            data.resourceManager.set<GL::Texture2DArray>(array.key, array.texture.release(),
+                ResourceDataState::Final, ResourcePolicy::Resident);
+        }
+
+    } else if(resource.type == DecodedResource::Type::Image) {
+        /* Textures with different samplers each get their own copy. They're
+           mutable so the residency manager can evict them. */
+        for(const UnsignedInt i: upload.textures) {
+            const std::string key = data.contentRegistry.key(Utility::formatString("{}#{}", path, i));
+            data.resourceManager.set<GL::Texture2D>(key, createTexture(*scene.textures[i], *resource.image, data.pixelBuffers.get()),
+                ResourceDataState::Mutable, ResourcePolicy::Resident);
+            data.residency.add(ResidencyManager::Type::Texture, i, key,
+                upload.size, resource.image->levels.size());
+        }
+
+    } else if(resource.type == DecodedResource::Type::Mesh) {
+        const std::string key = data.contentRegistry.key(Utility::formatString("{}#{}", path, resource.id));
+        data.resourceManager.set<GL::Mesh>(key, compileMesh(*resource.mesh, scene.meshLods[resource.id]),
+            ResourceDataState::Mutable, ResourcePolicy::Resident);
+        data.residency.add(ResidencyManager::Type::Mesh, resource.id, key, upload.size);
+
+    } else {
+        const std::string key = data.contentRegistry.key(Utility::formatString(
+            resource.type == DecodedResource::Type::Batch ? "{}#batch{}" : "{}#hlod{}", path, resource.id));
+        data.resourceManager.set<GL::Mesh>(key, MeshTools::compile(*resource.mesh),
+            ResourceDataState::Final, ResourcePolicy::Resident);
+    }
+}
+
+void AsyncLoader::State::packTextureArrays(SceneData& data) {
+    /* Textures with the same format, size, mip level count and sampler go
+       to the same array, up to the layer limit. Each is given by the image
+       index in arrayImages and the texture ID. */
+    struct Group {
+        const SceneCache::Image* image;
+        const SceneCache::Texture* texture;
+        Containers::Array<std::pair<UnsignedInt, UnsignedInt>> layers;
+    };
+    const std::size_t maxLayers = GL::Texture2DArray::maxSize().z();
+    Containers::Array<Group> groups;
+    for(UnsignedInt i = 0; i != arrayImages.size(); ++i) {
+        const SceneCache::Image& image = *arrayImages[i].resource.image;
+        if(!textureFormat(image)) continue;
+
+        for(const UnsignedInt textureId: arrayImages[i].textures) {
+            const SceneCache::Texture& texture = *scene.textures[textureId];
+            Group* group = nullptr;
+            for(Group& candidate: groups) {
+                if(candidate.layers.size() < maxLayers && sameArrayFormat(*candidate.image, image) && sameSampler(*candidate.texture, texture)) {
+                    group = &candidate;
+                    break;
+                }
+            }
+            if(!group) group = &arrayAppend(groups, Group{&image, &texture, {}});
+            arrayAppend(group->layers, Containers::InPlaceInit, i, textureId);
+        }
+    }
+
+    for(UnsignedInt i = 0; i != groups.size(); ++i) {
+        const Group& group = groups[i];
+        const SceneCache::Image& image = *group.image;
+
+        /* A single level gets the rest generated once all layers are
+           uploaded */
+        const UnsignedInt levelCount = image.levels.size() == 1 ?
+            Math::log2(image.size.max()) + 1 : image.levels.size();
+        Containers::Pointer<GL::Texture2DArray> texture{Containers::InPlaceInit};
+        (*texture)
+            .setMagnificationFilter(group.texture->magnificationFilter)
+            .setMinificationFilter(group.texture->minificationFilter, group.texture->mipmapFilter)
+            .setWrapping(group.texture->wrapping)
+            .setStorage(levelCount, *textureFormat(image), {image.size, Int(group.layers.size())});
+
+        /* Mark the array as loading, so the scene can reference it before
+           it's uploaded */
+        const std::string key = Utility::formatString("{}#array{}", path, i);
+        data.resourceManager.set<GL::Texture2DArray>(key, nullptr,
+            ResourceDataState::Loading, ResourcePolicy::Resident);
+        MemoryAccounting::Texture accounted = accountedTexture(key, i, image);
+        accounted.byteSize *= group.layers.size();
+        data.memoryAccounting.addTexture(std::move(accounted));
+        arrayAppend(textureArrays, PendingArray{key, std::move(texture),
+            UnsignedInt(group.layers.size()), image.levels.size() == 1});
+
+        for(UnsignedInt layer = 0; layer != group.layers.size(); ++layer) {
+            const std::string textureKey = Utility::formatString("{}#{}", path, group.layers[layer].second);
+            textureLayers[data.contentRegistry.key(textureKey)] = TextureLayer{i, Int(layer)};
+            arrayAppend(arrayImages[group.layers[layer].first].layers, Containers::InPlaceInit, i, Int(layer));
+        }
+    }
+
+    /* Each image is then uploaded to all its layers at once */
+    for(PendingUpload& upload: arrayImages)
+        if(!upload.layers.empty()) pending.push_back(std::move(upload));
+    arrayImages = nullptr;
+}
+
+void AsyncLoader::State::uploadPending(SceneData& data) {
+    /* Upload at least one resource per call so the loading always
+       progresses, then stop once over any of the budgets */
+    const std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    std::size_t uploaded = 0;
+    while(!pending.empty()) {
+        if(uploaded && ((configuration.uploadBudget && uploaded >= configuration.uploadBudget) ||
+            (configuration.uploadTimeBudget && std::chrono::duration<Float, std::milli>(std::chrono::steady_clock::now() - start).count() >= configuration.uploadTimeBudget)))
+            break;
+
+        /* Each texture sharing the image is a separate upload */
+        const PendingUpload& upload = pending.front();
+        uploadResource(data, upload);
+        uploaded += upload.size*(upload.textures.empty() ? 1 : upload.textures.size());
+        pending.pop_front();
+    }
+}
+
+void AsyncLoader::State::submitShaders(SceneData& data) {
+    /* Count how many lights is there first so we know which shaders to
+       instantiate */
+    for(const Containers::Optional<SceneCache::Object>& object: scene.objects)
+        if(object && object->instanceType == Trade::ObjectInstanceType3D::Light)
+            ++data.lightCount;
 
-            data.objects[i].name = importer->object3DName(i);
+    /* Gather all variants the objects need so they're compiled together */
+    Containers::Array<PhongShader::Flags> flags;
+    if(scene.children) {
+        for(const Containers::Optional<SceneCache::Object>& object: scene.objects) {
+            /* Same conditions as for adding a drawable in addObject() */
+            if(!object || object->instanceType != Trade::ObjectInstanceType3D::Mesh || object->instance == -1 || object->material == -1 || !scene.materials[object->material])
+                continue;
+            const std::string meshKey = Utility::formatString("{}#{}", path, object->instance);
+            if(!isImported<GL::Mesh>(data.resourceManager, data.contentRegistry.key(meshKey)))
+                continue;
+
+            arrayAppend(flags, phongShaderFlags(path, data, scene, hasVertexColors, textureLayers, *object));
+        }
+    } else if(isImported<GL::Mesh>(data.resourceManager, data.contentRegistry.key(Utility::formatString("{}#0", path)))) {
+        arrayAppend(flags, hasVertexColors[0] ? PhongShader::Flag::VertexColor : PhongShader::Flags{});
+    }
+    /* Objects that end up on the GPU-driven path need its variants */
+    if(gpuMeshes && scene.children) for(std::size_t i = 0, count = flags.size(); i != count; ++i) {
+        const PhongShader::Flags variant = flags[i];
+        if(GpuScene::canDraw(variant))
+            arrayAppend(flags, variant|PhongShader::Flag::GpuDriven);
+    }
+    /* And the ones that get drawn instanced */
+    if(configuration.instancingThreshold && scene.children) for(std::size_t i = 0, count = flags.size(); i != count; ++i) {
+        const PhongShader::Flags variant = flags[i];
+        if(!(variant & PhongShader::Flag::GpuDriven))
+            arrayAppend(flags, variant|PhongShader::Flag::InstancedTransformation);
+    }
+    if(!scene.hlods.empty())
+        arrayAppend(flags, PhongShader::Flags{PhongShader::Flag::VertexColor});
+
+    data.shaderRegistry
+        .setCache(configuration.shaderCache)
+        .prewarm(data.lightCount, flags);
+}
+
+void AsyncLoader::State::createScene(SceneData& data) {
+    /* The drawables point to the occluders, so it has to exist before
+       them */
+    if(configuration.occlusionCulling)
+        data.occlusion.emplace(std::move(scene.meshOccluders));
+
+    /* Load the scene */
+    if(scene.children) {
+        /* Initialize the ObjectInfo array with the object count + 1 for the
+           scene */
+        data.objects = Containers::Array<ObjectInfo>{Containers::ValueInit, scene.objects.size() + 1};
+        for(UnsignedInt i = 0; i != scene.objects.size(); ++i) {
+            if(!scene.objects[i]) continue;
+
+            data.objects[i].name = scene.objects[i]->name;
             if(data.objects[i].name.empty())
                 data.objects[i].name = Utility::formatString("object #{}", i);
 
-            if(objects[i]->instanceType() == Trade::ObjectInstanceType3D::Light)
-                ++data.lightCount;
-
-            data.objects[i].children = objects[i]->children();
+            data.objects[i].children = scene.objects[i]->children;
         }
 
         /* Set scene info */
         data.sceneObjectId = data.objects.size() - 1;
-        data.objects[data.sceneObjectId].children = sceneData->children3D();
+        data.objects[data.sceneObjectId].children = *scene.children;
 
         /* Recursively add all children */
-        for(UnsignedInt objectId: sceneData->children3D())
-            addObject(path, data, objects, materials, lights, hasVertexColors, data.scene, objectId);
+        for(UnsignedInt objectId: *scene.children)
+            addObject(path, configuration, data, scene, hasVertexColors, textureLayers, data.scene, objectId);
+
+        for(UnsignedInt i = 0; i != scene.batches.size(); ++i)
+            addBatch(path, data, scene, i);
+        for(UnsignedInt i = 0; i != scene.hlods.size(); ++i)
+            addHlod(path, configuration, data, scene, i);
+
+        /* Last, so it gets only what the batches and proxies don't draw */
+        if(gpuMeshes) {
+            data.gpuScene.emplace(std::move(*gpuMeshes));
+            addGpuDrawables(path, data, scene);
+            data.gpuScene->build();
+        }
+        if(configuration.instancingThreshold)
+            addInstances(path, configuration, data, scene);
 
     /* The format has no scene support, display just the first loaded mesh with
        a default material and be done with it */
-    } else if(Resource<GL::Mesh> mesh = data.resourceManager.get<GL::Mesh>(Utility::formatString("{}#0", path))) {
+    } else if(isImported<GL::Mesh>(data.resourceManager, data.contentRegistry.key(Utility::formatString("{}#0", path)))) {
         /* Create an object and add the mesh */
+        Resource<GL::Mesh> mesh = data.resourceManager.get<GL::Mesh>(data.contentRegistry.key(Utility::formatString("{}#0", path)));
         Object3D& object = data.scene.addChild<Object3D>();
         data.objects = Containers::Array<ObjectInfo>{Containers::ValueInit, 2};
         data.objects[0].object = &object;
         data.objects[0].name = "object #0";
-        PhongDrawable& phongDrawable = object.addFeature<PhongDrawable>(phongShader(
-            data, hasVertexColors[0] ? Shaders::Phong::Flag::VertexColor : Shaders::Phong::Flags{}),
-            mesh, 0xffffff_rgbf, data.opaqueDrawables);
+        PhongDrawable& phongDrawable = object.addFeature<PhongDrawable>(data.shaderRegistry.phong(
+            hasVertexColors[0] ? PhongShader::Flag::VertexColor : PhongShader::Flags{}, data.lightCount),
+            mesh, scene.meshDequantizations[0], 0xffffff_rgbf, data.opaqueDrawables);
+        phongDrawable.setResidencyEntries(data.residency.find(data.contentRegistry.key(Utility::formatString("{}#0", path))), nullptr, nullptr);
+        if(!scene.meshLods[0].empty())
+            phongDrawable.setLods(scene.meshLods[0], scene.meshBounds[0], configuration.lodPixelError);
+        data.culling.add(phongDrawable, scene.meshBoundingBoxes[0], nullptr, 0);
         data.objects[0].features[UnsignedByte(ObjectInfo::FeatureType::PhongDrawable)] = &phongDrawable;
 
         /* Set scene info */
@@ -378,6 +2071,9 @@ void load(const std::string& path, SceneData& data) {
         data.objects[data.sceneObjectId].children.push_back(0);
     }
 
+    /* All drawables are placed now, build the hierarchy over them */
+    data.culling.buildBvh();
+
     /* Complete scene info, initialize the ObjectInfo array if
        they weren't any objects in the scene */
     if(data.objects.size() < 1)
@@ -395,6 +2091,128 @@ void load(const std::string& path, SceneData& data) {
     (*(data.camera = new SceneGraph::Camera3D{*data.cameraObject}))
         .setAspectRatioPolicy(SceneGraph::AspectRatioPolicy::Extend)
         .setProjectionMatrix(Matrix4::perspectiveProjection(75.0_degf, 1.0f, 0.01f, 1000.0f));
+
+    /* Resources not uploaded yet or evicted are drawn with the fallbacks
+       until they get loaded */
+    if(configuration.gpuMemoryBudget || configuration.uploadBudget || configuration.uploadTimeBudget) {
+        const UnsignedByte white[]{0xff, 0xff, 0xff, 0xff};
+        GL::Texture2D* placeholder = new GL::Texture2D;
+        placeholder->setMinificationFilter(SamplerFilter::Nearest)
+            .setMagnificationFilter(SamplerFilter::Nearest)
+            .setStorage(1, GL::TextureFormat::RGBA8, {1, 1})
+            .setSubImage(0, {}, ImageView2D{PixelFormat::RGBA8Unorm, {1, 1}, white});
+        GL::Texture2DArray* placeholderArray = new GL::Texture2DArray;
+        placeholderArray->setMinificationFilter(SamplerFilter::Nearest)
+            .setMagnificationFilter(SamplerFilter::Nearest)
+            .setStorage(1, GL::TextureFormat::RGBA8, {1, 1, 1})
+            .setSubImage(0, {}, ImageView3D{PixelFormat::RGBA8Unorm, {1, 1, 1}, white});
+        GL::Mesh* empty = new GL::Mesh;
+        empty->setCount(0);
+        data.resourceManager
+            .setFallback<GL::Texture2D>(placeholder)
+            .setFallback<GL::Texture2DArray>(placeholderArray)
+            .setFallback<GL::Mesh>(empty);
+    }
+
+    /* Evicted resources are reloaded from the cache or the file */
+    if(configuration.gpuMemoryBudget) {
+        data.residency
+            .setBudget(configuration.gpuMemoryBudget)
+            .setSource(Containers::Pointer<ResidencyManager::Source>{new ResourceSource{
+                path, configuration, cacheFilename, scene.textures, normalMapImages,
+                std::move(imageLevels), data.pixelBuffers.get()}});
+    }
+}
+
+AsyncLoader::AsyncLoader(const std::string& path, const Configuration& configuration): _state{Containers::InPlaceInit, path, configuration} {
+    _state->thread = std::thread{&State::run, _state.get()};
+}
+
+AsyncLoader::~AsyncLoader() {
+    cancel();
+    _state->thread.join();
+}
+
+void AsyncLoader::cancel() {
+    _state->canceled = true;
+}
+
+bool AsyncLoader::isCanceled() const {
+    return _state->canceled;
+}
+
+Progress AsyncLoader::progress() const {
+    Progress progress;
+    progress.textures = {_state->texturesLoaded, _state->textureCount};
+    progress.materials = {_state->materialsLoaded, _state->materialCount};
+    progress.meshes = {_state->meshesLoaded, _state->meshCount};
+    progress.objects = {_state->objectsLoaded, _state->objectCount};
+    return progress;
+}
+
+void AsyncLoader::wait() {
+    _state->queue.wait();
+}
+
+bool AsyncLoader::upload(SceneData& data) {
+    State& state = *_state;
+
+    /* Check for the finished state before emptying the queue, so nothing
+       pushed in between is missed */
+    const bool finished = state.queue.isFinished();
+
+    /* The ring is shared with the reloads by the residency manager, so it's
+       owned by the scene */
+    if(state.configuration.pixelBufferSize && !data.pixelBuffers)
+        data.pixelBuffers.emplace(state.configuration.pixelBufferSize);
+
+    /* Checked on the GL thread, before any mesh is registered */
+    if(state.configuration.gpuDriven && !state.gpuDrivenChecked) {
+        state.gpuDrivenChecked = true;
+        if(GpuScene::isSupported()) state.gpuMeshes.emplace();
+        else Warning{} << "GL 4.3 is not supported, not using the GPU-driven path";
+    }
+
+    /* Registering is cheap, the GL uploads are then done within the
+       budget */
+    DecodedResource resource;
+    while(state.queue.tryPop(resource))
+        state.registerResource(data, std::move(resource));
+
+    /* The arrays can be made only once the sizes of all images are known */
+    if(finished && state.configuration.textureArrays && !state.texturesPacked && !state.canceled) {
+        state.packTextureArrays(data);
+        state.texturesPacked = true;
+    }
+    state.uploadPending(data);
+
+    if(state.sceneCreated) return true;
+    if(!finished || state.canceled) return false;
+
+    /* All shader variants are compiled in parallel while the upload() calls
+       wait for them */
+    if(!state.shadersSubmitted) {
+        state.submitShaders(data);
+        state.shadersSubmitted = true;
+    }
+    if(!data.shaderRegistry.finish()) return false;
+
+    state.createScene(data);
+    state.sceneCreated = true;
+    return true;
+}
+
+bool AsyncLoader::isUploaded() const {
+    return _state->sceneCreated && _state->pending.empty();
+}
+
+void load(const std::string& path, SceneData& data, const Configuration& configuration) {
+    AsyncLoader loader{path, configuration};
+    while(!loader.upload(data)) loader.wait();
+
+    /* There's no later frame to upload the rest in */
+    while(!loader.isUploaded()) loader.upload(data);
 }
 
 }}
+
@@ -25,13 +25,182 @@
 */
 
 #include <string>
+#include <Corrade/Containers/Pointer.h>
 #include <Magnum/Trade/Trade.h>
 
 #include "Oberon/Oberon.h"
 
 namespace Oberon { namespace SceneImporter {
 
-void load(const std::string& path, SceneData& data);
+struct Configuration {
+    /* Count of worker threads decoding images and preparing meshes. If zero,
+       the hardware concurrency is used. The file is parsed only once, the
+       workers decode images embedded in binary glTF files from a mapping of
+       it and images in external files by opening them directly. They take
+       turns on the importer only for the rest, such as data URIs. */
+    UnsignedInt threadCount{};
+
+    /* Load the scene in the background. SceneView then uploads the
+       resources gradually and the scene is usable only once it's done. */
+    bool async{};
+
+    /* Reorder the mesh indices for the vertex cache and overdraw and the
+       vertices for fetch locality. The cache efficiency of each mesh before
+       and after is shown in the memory report. */
+    bool optimizeMeshes{};
+
+    /* Convert the meshes to compact vertex formats with quantized
+       positions, packed normals and half-float texture coordinates */
+    bool compactVertexFormats{};
+
+    /* Simplified levels of detail generated for every mesh, each with
+       lodReduction times the triangles of the previous one. The drawables
+       pick the coarsest level whose simplification error projects to less
+       than lodPixelError pixels on the screen. */
+    UnsignedInt lodCount{};
+    Float lodReduction{0.5f};
+    Float lodPixelError{1.0f};
+
+    /* Opaque mesh objects centered in the same cell of a grid with
+       hlodGridSize cells along the longest side of the scene get baked into
+       one proxy mesh. It's simplified to hlodReduction times their
+       triangles, with the material colors and average texture colors in
+       the vertices. The proxy is drawn instead of the objects once the
+       camera is farther than hlodDistance times the cluster radius. If
+       zero, no proxies are baked. */
+    UnsignedInt hlodGridSize{};
+    Float hlodReduction{0.1f};
+    Float hlodDistance{8.0f};
+
+    /* Opaque mesh objects with at most batchTriangleLimit triangles that
+       share a material are treated as static and merged into batch meshes
+       of up to batchVertexLimit vertices, with the vertices transformed to
+       the scene. Each batch is drawn with one draw call. Batched objects are
+       not baked into HLOD proxies and an object is taken out of its batch
+       once it's edited. If zero, nothing is batched. */
+    UnsignedInt batchTriangleLimit{};
+    UnsignedInt batchVertexLimit{65536};
+
+    /* Test the bounding boxes of the drawables against a depth buffer
+       rasterized on the CPU from the largest opaque objects on the screen
+       after the frustum culling. Meshes whose finest level of detail with
+       at most occluderTriangleLimit triangles can be used as occluders. */
+    bool occlusionCulling{};
+    UnsignedInt occluderTriangleLimit{512};
+
+    /* Draw the opaque objects that aren't batched or in HLOD clusters with
+       GL 4.3 indirect multi-draws. Meshes sharing a vertex layout go to one
+       buffer, the transformations, bounds and materials to storage buffers
+       and a compute shader culls them against the frustum. Only objects
+       without textures or with textures in texture arrays are drawn this
+       way, always with the full level of detail. Ignored with a warning if
+       the driver doesn't support GL 4.3. */
+    bool gpuDriven{};
+
+    /* Opaque objects sharing a mesh and a material are drawn with one
+       instanced draw once there's at least instancingThreshold of them,
+       with the transformations in a buffer texture. Objects that are
+       batched, in HLOD clusters or on the GPU-driven path are left out and
+       an object is taken out of its instances once it's edited. If zero,
+       nothing is instanced. */
+    UnsignedInt instancingThreshold{};
+
+    /* Encode uncompressed images to BC formats with the mip chain generated
+       on the worker threads. Together with the cache the cost is paid only
+       on the first load of a file. */
+    bool compressTextures{};
+
+    /* Pack textures with the same format, size, mip level count and
+       sampler into layers of texture arrays, so drawables with different
+       textures can share the bindings. The arrays are created once
+       everything is decoded and stay resident regardless of the GPU memory
+       budget. */
+    bool textureArrays{};
+
+    /* Directory with binary caches of the loaded files. A cache made from
+       the current version of the file is loaded instead of importing it,
+       otherwise it's written during the import. If empty, caching is
+       disabled. */
+    std::string cacheDirectory;
+
+    /* GPU memory for the meshes and textures in bytes. When over it, the
+       least recently drawn textures are reduced to lower mip levels and
+       then evicted together with meshes, and reloaded once drawn again. If
+       zero, everything stays resident. */
+    std::size_t gpuMemoryBudget{};
+
+    /* Bytes of mesh and texture data and milliseconds spent uploading them
+       in one AsyncLoader::upload() call, at least one resource is uploaded
+       every call. With any of them set, the scene is created once
+       everything is decoded, drawing placeholders for resources that are
+       not uploaded yet, and SceneView::draw() uploads the rest over the
+       following frames. If both are zero, everything is uploaded before the
+       scene is created. */
+    std::size_t uploadBudget{};
+    Float uploadTimeBudget{};
+
+    /* Size of the ring of persistently mapped pixel buffers the textures
+       are uploaded through, so the driver doesn't block on copying them.
+       Images larger than that or drivers without ARB_buffer_storage upload
+       from the memory directly. If zero, the ring isn't used. */
+    std::size_t pixelBufferSize{64*1024*1024};
+
+    /* Scene of the file to load, the default one if -1 */
+    Int scene{-1};
+
+    /* Import only the meshes, materials, textures and lights used by the
+       scene, found by walking its hierarchy before anything else is
+       imported. Loading another scene of the file then imports what that
+       one uses. If disabled, everything in the file is imported. */
+    bool reachableOnly{true};
+
+    /* Cache of linked shader program binaries. If null, the shaders are
+       always compiled from source. Has to outlive the loaded scene. */
+    ShaderCache* shaderCache{};
+};
+
+/* Progress of a load, as the loaded and total count of each stage */
+struct Progress {
+    struct Stage {
+        UnsignedInt loaded, count;
+    };
+
+    Stage textures, materials, meshes, objects;
+};
+
+/* Imports the file on a background thread. The GL uploads and the scene
+   creation are done by upload(), which has to be called from the thread the
+   GL context is current in. */
+class AsyncLoader {
+    public:
+        explicit AsyncLoader(const std::string& path, const Configuration& configuration = Configuration{});
+
+        /* Cancels the load and waits for the background threads to finish */
+        ~AsyncLoader();
+
+        void cancel();
+        bool isCanceled() const;
+
+        Progress progress() const;
+
+        /* Waits until there's something to upload */
+        void wait();
+
+        /* Uploads what was decoded so far to the resource manager and
+           returns true once the whole scene is created in data. With an
+           upload budget it has to be called further until isUploaded()
+           returns true. */
+        bool upload(SceneData& data);
+
+        /* Whether the scene is created and all its resources uploaded */
+        bool isUploaded() const;
+
+    private:
+        struct State;
+        Containers::Pointer<State> _state;
+};
+
+void load(const std::string& path, SceneData& data, const Configuration& configuration = Configuration{});
 
 }}
 
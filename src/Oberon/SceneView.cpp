@@ -29,23 +29,63 @@
 #include <Magnum/GL/Renderer.h>
 #include <Magnum/Math/Color.h>
 #include <Magnum/SceneGraph/Camera.h>
-#include <Magnum/Shaders/Phong.h>
 #include <Magnum/Trade/AbstractImporter.h>
 
-#include "Oberon/SceneImporter.h"
+#include "Oberon/Hlod.h"
+#include "Oberon/OcclusionCulling.h"
+#include "Oberon/PhongShader.h"
 
 namespace Oberon {
 
-SceneView::SceneView(const std::string& path, const Vector2i& viewportSize) {
+SceneView::SceneView(const std::string& path, const Vector2i& viewportSize, const SceneImporter::Configuration& configuration): _viewportSize{viewportSize} {
     GL::Renderer::enable(GL::Renderer::Feature::DepthTest);
     GL::Renderer::enable(GL::Renderer::Feature::FaceCulling);
 
-    SceneImporter::load(path, _data);
+    /* With an upload budget the loader is kept for the uploads in draw()
+       even if the scene itself is loaded right away */
+    if(configuration.async || configuration.uploadBudget || configuration.uploadTimeBudget) {
+        _loader = Containers::pointer<SceneImporter::AsyncLoader>(path, configuration);
+        if(!configuration.async)
+            while(!continueLoading()) _loader->wait();
+        return;
+    }
+
+    SceneImporter::load(path, _data, configuration);
 
+    _isLoaded = true;
     _data.camera->setViewport(viewportSize);
 }
 
+MemoryAccounting::Report SceneView::memoryReport() const {
+    return _data.memoryAccounting.report(_data);
+}
+
+bool SceneView::continueLoading() {
+    if(_isLoaded) return true;
+    if(!_loader->upload(_data)) return false;
+
+    /* Destroying the loader releases the importer plugins and all data
+       that were needed only for the scene creation */
+    if(_loader->isUploaded()) _loader = nullptr;
+    _isLoaded = true;
+    _data.camera->setViewport(_viewportSize);
+    return true;
+}
+
+SceneImporter::Progress SceneView::loadingProgress() const {
+    return _loader ? _loader->progress() : SceneImporter::Progress{};
+}
+
 void SceneView::draw() {
+    if(!_isLoaded) return;
+
+    /* Upload the next part of the resources that are still pending, the
+       drawables use the fallbacks until then */
+    if(_loader) {
+        _loader->upload(_data);
+        if(_loader->isUploaded()) _loader = nullptr;
+    }
+
     /* Calculate light data and upload them to all shaders */
     arrayResize(_data.lightPositions, 0);
     arrayResize(_data.lightColors, 0);
@@ -54,19 +94,21 @@ void SceneView::draw() {
     CORRADE_INTERNAL_ASSERT(_data.lightPositions.size() == _data.lightCount);
     CORRADE_INTERNAL_ASSERT(_data.lightColors.size() == _data.lightCount);
     CORRADE_INTERNAL_ASSERT(_data.lightRanges.size() == _data.lightCount);
-    for(const std::string& shaderKey: _data.phongShadersKeys) {
-        Resource<GL::AbstractShaderProgram, Shaders::Phong> shader =
-            _data.resourceManager.get<GL::AbstractShaderProgram, Shaders::Phong>(shaderKey);
-        if(shader) {
-            (*shader)
-                .setLightPositions(_data.lightPositions)
-                .setLightColors(_data.lightColors)
-                .setLightRanges(_data.lightRanges);
-        }
-    }
-
-    /* Draw opaque stuff */
-    _data.camera->draw(_data.opaqueDrawables);
+    for(const Containers::Pointer<PhongShader>& shader: _data.shaderRegistry.phongShaders())
+        (*shader)
+            .setLightPositions(_data.lightPositions)
+            .setLightColors(_data.lightColors)
+            .setLightRanges(_data.lightRanges);
+
+    /* Swap the distant clusters for their proxies, cull what's outside of
+       the frustum or hidden behind occluders and draw opaque stuff */
+    Hlod::update(_data);
+    _data.culling.cull(*_data.camera);
+    if(_data.occlusion) _data.occlusion->cull(*_data.camera, _data.culling);
+    _data.camera->draw(_data.culling.visibleDrawables(*_data.camera, _data.opaqueDrawables));
+
+    /* Objects on the GPU-driven path are culled and drawn by it */
+    if(_data.gpuScene) _data.gpuScene->draw(*_data.camera);
 
     /* Draw transparent stuff back-to-front with blending enabled */
     if(!_data.transparentDrawables.isEmpty()) {
@@ -75,7 +117,7 @@ void SceneView::draw() {
         GL::Renderer::setBlendFunction(GL::Renderer::BlendFunction::SourceAlpha, GL::Renderer::BlendFunction::OneMinusSourceAlpha);
 
         std::vector<std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>>
-            drawableTransformations = _data.camera->drawableTransformations(_data.transparentDrawables);
+            drawableTransformations = _data.culling.visibleDrawables(*_data.camera, _data.transparentDrawables);
         std::sort(drawableTransformations.begin(), drawableTransformations.end(),
             [](const std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>& a,
                 const std::pair<std::reference_wrapper<SceneGraph::Drawable3D>, Matrix4>& b) {
@@ -87,10 +129,16 @@ void SceneView::draw() {
         GL::Renderer::disable(GL::Renderer::Feature::Blending);
         GL::Renderer::setDepthMask(true);
     }
+
+    /* Reload what was drawn evicted and evict what's over the budget */
+    _data.residency.update(_data.resourceManager);
 }
 
 void SceneView::updateViewport(const Vector2i& size) {
-    _data.camera->setViewport(size);
+    /* Until the scene is created there's no camera, the size gets applied
+       once there is */
+    _viewportSize = size;
+    if(_isLoaded) _data.camera->setViewport(size);
 }
 
 }
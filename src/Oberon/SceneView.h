@@ -25,12 +25,30 @@
 */
 
 #include "Oberon/SceneData.h"
+#include "Oberon/SceneImporter.h"
 
 namespace Oberon {
 
 class SceneView {
     public:
-        explicit SceneView(const std::string& path, const Vector2i& viewportSize);
+        /* Unless the configuration enables asynchronous loading, the scene
+           is loaded once the constructor returns. Otherwise
+           continueLoading() has to be called until it returns true. With an
+           upload budget, the resources are then uploaded gradually in
+           draw(). */
+        explicit SceneView(const std::string& path, const Vector2i& viewportSize, const SceneImporter::Configuration& configuration = SceneImporter::Configuration{});
+
+        bool isLoaded() const { return _isLoaded; }
+
+        /* Uploads the resources loaded in the background so far, returns
+           true once the scene is complete */
+        bool continueLoading();
+
+        SceneImporter::Progress loadingProgress() const;
+
+        /* Memory used by the meshes, textures, shaders and objects of the
+           scene. The GL context has to be current. */
+        MemoryAccounting::Report memoryReport() const;
 
         void draw();
         void updateViewport(const Vector2i& size);
@@ -39,6 +57,9 @@ class SceneView {
 
     private:
         SceneData _data;
+        Vector2i _viewportSize;
+        Containers::Pointer<SceneImporter::AsyncLoader> _loader;
+        bool _isLoaded{};
 };
 
 }
@@ -0,0 +1,146 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ShaderCache.h"
+
+#include <cstring>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Utility/Debug.h>
+#include <Corrade/Utility/Directory.h>
+#include <Corrade/Utility/FormatStl.h>
+#include <Magnum/GL/AbstractShaderProgram.h>
+#include <Magnum/GL/Context.h>
+#include <Magnum/GL/Extensions.h>
+#include <Magnum/GL/OpenGL.h>
+
+#include "Oberon/Hash.h"
+
+namespace Oberon {
+
+namespace {
+
+struct Header {
+    char magic[8];
+    UnsignedInt version;
+    UnsignedInt format;
+    UnsignedLong driver;
+    UnsignedLong sources;
+    UnsignedLong size;
+};
+
+constexpr char Magic[8]{'O', 'B', 'E', 'R', 'O', 'N', 'S', 'H'};
+constexpr UnsignedInt Version = 1;
+
+UnsignedLong sourcesHash(const std::string& sources) {
+    return hash({sources.data(), sources.size()});
+}
+
+}
+
+ShaderCache::ShaderCache(const std::string& directory): _directory{directory}, _driver{}, _supported{} {
+    GL::Context& context = GL::Context::current();
+    if(!context.isExtensionSupported<GL::Extensions::ARB::get_program_binary>())
+        return;
+
+    /* Drivers are allowed to support the extension with no binary formats */
+    GLint formatCount{};
+    glGetIntegerv(GL_NUM_PROGRAM_BINARY_FORMATS, &formatCount);
+    if(!formatCount) return;
+
+    for(const std::string& string: {context.vendorString(), context.rendererString(),
+        context.versionString(), context.shadingLanguageVersionString()})
+        _driver = hash({string.data(), string.size()}, _driver);
+    _supported = Utility::Directory::mkpath(directory);
+}
+
+std::string ShaderCache::filename(const std::string& sources) const {
+    return Utility::Directory::join(_directory, Utility::formatString("{:.16x}.program",
+        hash({sources.data(), sources.size()}, _driver)));
+}
+
+bool ShaderCache::load(GL::AbstractShaderProgram& program, const std::string& sources) {
+    if(!_supported) return false;
+
+    const std::string filename = this->filename(sources);
+    if(!Utility::Directory::exists(filename)) return false;
+
+    /* The file name is only a hash, verify that it's really the same
+       program and driver */
+    const Containers::Array<char> data = Utility::Directory::read(filename);
+    Header header;
+    if(data.size() < sizeof(Header)) return false;
+    std::memcpy(&header, data.data(), sizeof(Header));
+    if(std::memcmp(header.magic, Magic, sizeof(Magic)) != 0 ||
+       header.version != Version || header.driver != _driver ||
+       header.sources != sourcesHash(sources) ||
+       header.size != data.size() - sizeof(Header))
+        return false;
+
+    /* Driver updates that keep the version string can still reject it */
+    glProgramBinary(program.id(), header.format, data + sizeof(Header), GLsizei(header.size));
+    GLint status{};
+    glGetProgramiv(program.id(), GL_LINK_STATUS, &status);
+    if(!status) {
+        Warning{} << "ShaderCache: program binary" << filename << "was rejected by the driver, compiling from source";
+        Utility::Directory::rm(filename);
+        return false;
+    }
+
+    return true;
+}
+
+void ShaderCache::prepare(GL::AbstractShaderProgram& program) {
+    if(_supported)
+        glProgramParameteri(program.id(), GL_PROGRAM_BINARY_RETRIEVABLE_HINT, GL_TRUE);
+}
+
+void ShaderCache::save(GL::AbstractShaderProgram& program, const std::string& sources) {
+    if(!_supported) return;
+
+    GLint size{};
+    glGetProgramiv(program.id(), GL_PROGRAM_BINARY_LENGTH, &size);
+    if(!size) return;
+
+    Containers::Array<char> data{Containers::NoInit, sizeof(Header) + size};
+    GLenum format{};
+    glGetProgramBinary(program.id(), size, &size, &format, data + sizeof(Header));
+
+    Header header;
+    std::memcpy(header.magic, Magic, sizeof(Magic));
+    header.version = Version;
+    header.format = format;
+    header.driver = _driver;
+    header.sources = sourcesHash(sources);
+    header.size = UnsignedLong(size);
+    std::memcpy(data.data(), &header, sizeof(Header));
+
+    /* Write to a temporary file first so other instances never see a
+       partially written binary */
+    const std::string filename = this->filename(sources);
+    if(!Utility::Directory::write(filename + ".tmp", data.prefix(sizeof(Header) + size)) ||
+       !Utility::Directory::move(filename + ".tmp", filename))
+        Utility::Directory::rm(filename + ".tmp");
+}
+
+}
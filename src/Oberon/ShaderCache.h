@@ -0,0 +1,68 @@
+#ifndef Oberon_ShaderCache_h
+#define Oberon_ShaderCache_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <string>
+#include <Magnum/GL/GL.h>
+
+#include "Oberon/Oberon.h"
+
+namespace Oberon {
+
+/* Stores linked shader program binaries on disk so the same program doesn't
+   need to be compiled again on the next run. The binaries are specific to
+   the driver, so the files are keyed by the vendor, renderer and version
+   strings together with the program sources. If program binaries aren't
+   supported or the driver rejects a stored one, load() fails and the program
+   has to be compiled from source. */
+class ShaderCache {
+    public:
+        /* Has to be created with a current GL context */
+        explicit ShaderCache(const std::string& directory);
+
+        bool isSupported() const { return _supported; }
+
+        /* Loads a binary of a program made from given sources into the
+           program. Returns true if the program is linked afterwards. */
+        bool load(GL::AbstractShaderProgram& program, const std::string& sources);
+
+        /* Has to be called before the program is linked so the driver
+           keeps the binary around for save() */
+        void prepare(GL::AbstractShaderProgram& program);
+
+        /* Saves a binary of a linked program made from given sources */
+        void save(GL::AbstractShaderProgram& program, const std::string& sources);
+
+    private:
+        std::string filename(const std::string& sources) const;
+
+        std::string _directory;
+        UnsignedLong _driver;
+        bool _supported;
+};
+
+}
+
+#endif
@@ -0,0 +1,69 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "ShaderRegistry.h"
+
+#include <Corrade/Containers/GrowableArray.h>
+
+namespace Oberon {
+
+PhongShader& ShaderRegistry::phong(const PhongShader::Flags flags, const UnsignedInt lightCount) {
+    const UnsignedInt key = UnsignedShort(flags)|lightCount << 16;
+    auto found = _phongShaderLookup.find(key);
+    if(found != _phongShaderLookup.end()) return *found->second;
+
+    if(_phongShaders.empty())
+        _parallelCompile = PhongShader::isParallelCompileSupported();
+
+    PhongShader* shader = new PhongShader{flags, lightCount, _cache};
+    arrayAppend(_phongShaders, Containers::pointer(shader));
+    _phongShaderLookup.emplace(key, shader);
+    return *shader;
+}
+
+void ShaderRegistry::prewarm(const UnsignedInt lightCount, const Containers::ArrayView<const PhongShader::Flags> flags) {
+    for(const PhongShader::Flags variant: flags)
+        phong(variant, lightCount);
+}
+
+bool ShaderRegistry::finish() {
+    bool finished = true;
+    for(Containers::Pointer<PhongShader>& shader: _phongShaders) {
+        if(shader->isLinkCompleted()) {
+            shader->finish();
+            continue;
+        }
+
+        if(!_parallelCompile) {
+            shader->finish();
+            return false;
+        }
+
+        finished = false;
+    }
+
+    return finished;
+}
+
+}
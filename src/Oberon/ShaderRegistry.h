@@ -0,0 +1,74 @@
+#ifndef Oberon_ShaderRegistry_h
+#define Oberon_ShaderRegistry_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <unordered_map>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Pointer.h>
+
+#include "Oberon/PhongShader.h"
+
+namespace Oberon {
+
+/* Owns the shader variants of a scene, keyed by the flags and the light
+   count. Drawables keep direct references to the shaders, so nothing is
+   looked up when drawing. */
+class ShaderRegistry {
+    public:
+        explicit ShaderRegistry(ShaderCache* cache = nullptr): _cache{cache} {}
+
+        /* Cache used for the shaders created from now on */
+        ShaderRegistry& setCache(ShaderCache* cache) {
+            _cache = cache;
+            return *this;
+        }
+
+        /* Returns the variant, submitting it for compilation if it's not
+           there yet. It has to be finished before it's used. */
+        PhongShader& phong(PhongShader::Flags flags, UnsignedInt lightCount);
+
+        /* Submits all given variants for compilation at once, so they can be
+           compiled in parallel */
+        void prewarm(UnsignedInt lightCount, Containers::ArrayView<const PhongShader::Flags> flags);
+
+        /* Finishes the variants whose link completed and returns true if all
+           are finished. Without parallel compile support it's not possible
+           to check without blocking, so one variant is finished per call. */
+        bool finish();
+
+        Containers::ArrayView<const Containers::Pointer<PhongShader>> phongShaders() const {
+            return _phongShaders;
+        }
+
+    private:
+        ShaderCache* _cache;
+        bool _parallelCompile{};
+        Containers::Array<Containers::Pointer<PhongShader>> _phongShaders;
+        std::unordered_map<UnsignedInt, PhongShader*> _phongShaderLookup;
+};
+
+}
+
+#endif
@@ -0,0 +1,250 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "StaticBatch.h"
+
+#include <algorithm>
+#include <cstddef>
+#include <cstring>
+#include <utility>
+#include <Corrade/Containers/GrowableArray.h>
+#include <Corrade/Containers/StridedArrayView.h>
+#include <Magnum/VertexFormat.h>
+#include <Magnum/Math/Functions.h>
+#include <Magnum/Trade/MeshData.h>
+
+#include "Oberon/BatchDrawable.h"
+#include "Oberon/SceneData.h"
+
+namespace Oberon { namespace StaticBatch {
+
+namespace {
+
+enum: UnsignedInt {
+    Normals = 1 << 0,
+    Tangents = 1 << 1,
+    TextureCoordinates = 1 << 2,
+    Colors = 1 << 3
+};
+
+/* Spreads the lower 10 bits of the value to every third bit */
+UnsignedInt spreadBits(UnsignedInt value) {
+    value &= 0x3ff;
+    value = (value | (value << 16)) & 0x030000ff;
+    value = (value | (value << 8)) & 0x0300f00f;
+    value = (value | (value << 4)) & 0x030c30c3;
+    value = (value | (value << 2)) & 0x09249249;
+    return value;
+}
+
+}
+
+Containers::Optional<Source> source(const Trade::MeshData& mesh, const Matrix4& dequantization, const Containers::ArrayView<const MeshSimplifier::Lod> lods, const UnsignedInt triangleLimit) {
+    if(mesh.primitive() != MeshPrimitive::Triangles ||
+       !mesh.hasAttribute(Trade::MeshAttribute::Position) || !mesh.vertexCount())
+        return {};
+
+    /* The levels of detail follow the full mesh in the index buffer */
+    Containers::Array<UnsignedInt> indices;
+    if(mesh.isIndexed()) {
+        const UnsignedInt indexCount = lods.empty() ? mesh.indexCount() : lods[0].indexCount;
+        if(indexCount/3 > triangleLimit) return {};
+        const Containers::Array<UnsignedInt> all = mesh.indicesAsArray();
+        indices = Containers::Array<UnsignedInt>{Containers::NoInit, indexCount};
+        std::memcpy(indices.data(), all.data(), indexCount*sizeof(UnsignedInt));
+    } else {
+        if(mesh.vertexCount()/3 > triangleLimit) return {};
+        indices = Containers::Array<UnsignedInt>{Containers::NoInit, mesh.vertexCount() - mesh.vertexCount() % 3};
+        for(UnsignedInt i = 0; i != indices.size(); ++i) indices[i] = i;
+    }
+
+    Source out;
+    out.indices = std::move(indices);
+    out.positions = mesh.positions3DAsArray();
+    for(Vector3& position: out.positions)
+        position = dequantization.transformPoint(position);
+
+    if(mesh.hasAttribute(Trade::MeshAttribute::Normal))
+        out.normals = mesh.normalsAsArray();
+    if(mesh.hasAttribute(Trade::MeshAttribute::Tangent)) {
+        const Containers::Array<Vector3> tangents = mesh.tangentsAsArray();
+        Containers::Array<Float> signs;
+        if(vertexFormatComponentCount(mesh.attributeFormat(Trade::MeshAttribute::Tangent)) == 4)
+            signs = mesh.bitangentSignsAsArray();
+        out.tangents = Containers::Array<Vector4>{Containers::NoInit, tangents.size()};
+        for(std::size_t i = 0; i != tangents.size(); ++i)
+            out.tangents[i] = {tangents[i], signs.empty() ? 1.0f : signs[i]};
+    }
+    if(mesh.hasAttribute(Trade::MeshAttribute::TextureCoordinates))
+        out.textureCoordinates = mesh.textureCoordinates2DAsArray();
+    if(mesh.hasAttribute(Trade::MeshAttribute::Color))
+        out.colors = mesh.colorsAsArray();
+
+    return Containers::Optional<Source>{std::move(out)};
+}
+
+UnsignedInt layout(const Source& source) {
+    return (source.normals.empty() ? 0 : Normals)|
+        (source.tangents.empty() ? 0 : Tangents)|
+        (source.textureCoordinates.empty() ? 0 : TextureCoordinates)|
+        (source.colors.empty() ? 0 : Colors);
+}
+
+Containers::Array<Containers::Array<UnsignedInt>> partition(const Containers::ArrayView<const Vector3> centers, const Containers::ArrayView<const UnsignedInt> vertexCounts, const UnsignedInt vertexLimit) {
+    Containers::Array<Containers::Array<UnsignedInt>> out;
+    if(centers.empty()) return out;
+
+    Vector3 min{Constants::inf()}, max{-Constants::inf()};
+    for(const Vector3& center: centers) {
+        min = Math::min(min, center);
+        max = Math::max(max, center);
+    }
+    const Float scale = 1023.0f/Math::max((max - min).max(), 1.0e-6f);
+
+    Containers::Array<std::pair<UnsignedInt, UnsignedInt>> order{Containers::NoInit, centers.size()};
+    for(UnsignedInt i = 0; i != centers.size(); ++i) {
+        const Vector3 cell = (centers[i] - min)*scale;
+        order[i] = {spreadBits(UnsignedInt(cell.x())) |
+            (spreadBits(UnsignedInt(cell.y())) << 1) |
+            (spreadBits(UnsignedInt(cell.z())) << 2), i};
+    }
+    std::sort(order.begin(), order.end());
+
+    Containers::Array<UnsignedInt> batch;
+    UnsignedInt batchVertexCount = 0;
+    const auto flush = [&]() {
+        if(batch.size() > 1) arrayAppend(out, Containers::InPlaceInit, std::move(batch));
+        batch = {};
+        batchVertexCount = 0;
+    };
+    for(const std::pair<UnsignedInt, UnsignedInt>& i: order) {
+        if(batchVertexCount && batchVertexCount + vertexCounts[i.second] > vertexLimit)
+            flush();
+        arrayAppend(batch, i.second);
+        batchVertexCount += vertexCounts[i.second];
+    }
+    flush();
+
+    return out;
+}
+
+Trade::MeshData bake(const Containers::ArrayView<const Member> members, std::vector<UnsignedInt>& indexOffsets) {
+    const UnsignedInt layout = StaticBatch::layout(*members[0].source);
+
+    /* All attributes are interleaved floats */
+    struct Attribute {
+        Trade::MeshAttribute name;
+        VertexFormat format;
+        std::size_t offset;
+    };
+    Containers::Array<Attribute> attributes;
+    std::size_t stride = 0;
+    const auto addAttribute = [&](Trade::MeshAttribute name, VertexFormat format) {
+        arrayAppend(attributes, Containers::InPlaceInit, name, format, stride);
+        stride += vertexFormatSize(format);
+        return attributes.back().offset;
+    };
+    const std::size_t positionOffset = addAttribute(Trade::MeshAttribute::Position, VertexFormat::Vector3);
+    const std::size_t normalOffset = layout & Normals ? addAttribute(Trade::MeshAttribute::Normal, VertexFormat::Vector3) : 0;
+    const std::size_t tangentOffset = layout & Tangents ? addAttribute(Trade::MeshAttribute::Tangent, VertexFormat::Vector4) : 0;
+    const std::size_t textureCoordinateOffset = layout & TextureCoordinates ? addAttribute(Trade::MeshAttribute::TextureCoordinates, VertexFormat::Vector2) : 0;
+    const std::size_t colorOffset = layout & Colors ? addAttribute(Trade::MeshAttribute::Color, VertexFormat::Vector4) : 0;
+
+    UnsignedInt vertexCount = 0, indexCount = 0;
+    for(const Member& member: members) {
+        vertexCount += member.source->positions.size();
+        indexCount += member.source->indices.size();
+    }
+
+    Containers::Array<char> vertexData{Containers::ValueInit, vertexCount*stride};
+    Containers::Array<char> indexData{Containers::NoInit, indexCount*sizeof(UnsignedInt)};
+    const Containers::ArrayView<UnsignedInt> indices = Containers::arrayCast<UnsignedInt>(Containers::arrayView(indexData));
+    const auto write = [&](UnsignedInt vertex, std::size_t offset, const void* value, std::size_t size) {
+        std::memcpy(vertexData.data() + vertex*stride + offset, value, size);
+    };
+
+    indexOffsets.clear();
+    UnsignedInt vertexOffset = 0, indexOffset = 0;
+    for(const Member& member: members) {
+        const Source& source = *member.source;
+        const Matrix3x3 normalMatrix = member.transformation.normalMatrix();
+        const Matrix3x3 rotationScaling = member.transformation.rotationScaling();
+        /* Mirroring flips the winding and the tangent space handedness */
+        const bool mirrored = rotationScaling.determinant() < 0.0f;
+
+        for(UnsignedInt i = 0; i != source.positions.size(); ++i) {
+            const UnsignedInt vertex = vertexOffset + i;
+            const Vector3 position = member.transformation.transformPoint(source.positions[i]);
+            write(vertex, positionOffset, &position, sizeof(Vector3));
+            if(layout & Normals) {
+                const Vector3 normal = (normalMatrix*source.normals[i]).normalized();
+                write(vertex, normalOffset, &normal, sizeof(Vector3));
+            }
+            if(layout & Tangents) {
+                const Vector4 tangent{(rotationScaling*source.tangents[i].xyz()).normalized(),
+                    mirrored ? -source.tangents[i].w() : source.tangents[i].w()};
+                write(vertex, tangentOffset, &tangent, sizeof(Vector4));
+            }
+            if(layout & TextureCoordinates)
+                write(vertex, textureCoordinateOffset, &source.textureCoordinates[i], sizeof(Vector2));
+            if(layout & Colors)
+                write(vertex, colorOffset, &source.colors[i], sizeof(Color4));
+        }
+
+        indexOffsets.push_back(indexOffset);
+        for(std::size_t i = 0; i != source.indices.size(); i += 3) {
+            indices[indexOffset + i] = vertexOffset + source.indices[i];
+            indices[indexOffset + i + 1] = vertexOffset + source.indices[mirrored ? i + 2 : i + 1];
+            indices[indexOffset + i + 2] = vertexOffset + source.indices[mirrored ? i + 1 : i + 2];
+        }
+
+        vertexOffset += source.positions.size();
+        indexOffset += source.indices.size();
+    }
+    indexOffsets.push_back(indexOffset);
+
+    Containers::Array<Trade::MeshAttributeData> attributeData{Containers::ValueInit, attributes.size()};
+    for(std::size_t i = 0; i != attributes.size(); ++i)
+        attributeData[i] = Trade::MeshAttributeData{attributes[i].name, attributes[i].format,
+            Containers::StridedArrayView1D<const void>{Containers::arrayView(vertexData),
+                vertexData.data() + attributes[i].offset, vertexCount, std::ptrdiff_t(stride)}};
+
+    const Trade::MeshIndexData indexView{Containers::ArrayView<const UnsignedInt>{indices}};
+    return Trade::MeshData{MeshPrimitive::Triangles,
+        std::move(indexData), indexView,
+        std::move(vertexData), std::move(attributeData), vertexCount};
+}
+
+void unbatch(SceneData& data, const UnsignedInt objectId) {
+    std::vector<UnsignedInt> objects{objectId};
+    while(!objects.empty()) {
+        ObjectInfo& object = data.objects[objects.back()];
+        objects.pop_back();
+        if(object.batch) object.batch->unbatch(*object.object);
+        object.batch = nullptr;
+        objects.insert(objects.end(), object.children.begin(), object.children.end());
+    }
+}
+
+}}
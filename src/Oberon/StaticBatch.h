@@ -0,0 +1,81 @@
+#ifndef Oberon_StaticBatch_h
+#define Oberon_StaticBatch_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <vector>
+#include <Corrade/Containers/Array.h>
+#include <Corrade/Containers/Optional.h>
+#include <Magnum/Math/Color.h>
+#include <Magnum/Math/Matrix4.h>
+#include <Magnum/Trade/Trade.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/MeshSimplifier.h"
+
+namespace Oberon { namespace StaticBatch {
+
+/* Full level of detail of a mesh kept for the batching, with the
+   attributes the Phong shader uses and dequantized positions */
+struct Source {
+    Containers::Array<Vector3> positions, normals;
+    /* With the bitangent sign in the fourth component */
+    Containers::Array<Vector4> tangents;
+    Containers::Array<Vector2> textureCoordinates;
+    Containers::Array<Color4> colors;
+    Containers::Array<UnsignedInt> indices;
+};
+
+/* Null if the mesh is not made of triangles, has no positions or has more
+   than triangleLimit triangles */
+Containers::Optional<Source> source(const Trade::MeshData& mesh, const Matrix4& dequantization, Containers::ArrayView<const MeshSimplifier::Lod> lods, UnsignedInt triangleLimit);
+
+/* Which attributes the source has. Only sources with the same layout can
+   be batched together. */
+UnsignedInt layout(const Source& source);
+
+/* Splits objects into batches of at most vertexLimit vertices, ordered
+   along a Morton curve through their centers so each batch stays compact
+   for the culling. Batches with a single object are left out. */
+Containers::Array<Containers::Array<UnsignedInt>> partition(Containers::ArrayView<const Vector3> centers, Containers::ArrayView<const UnsignedInt> vertexCounts, UnsignedInt vertexLimit);
+
+struct Member {
+    const Source* source;
+    Matrix4 transformation;
+};
+
+/* Merges the members with the same layout into one mesh with the vertices
+   transformed to the scene. Puts where the indices of each member start to
+   indexOffsets, followed by the total index count. Has float attributes
+   and 32-bit indices. */
+Trade::MeshData bake(Containers::ArrayView<const Member> members, std::vector<UnsignedInt>& indexOffsets);
+
+/* Takes the object and all its children out of their batches. Has to be
+   called before the object is deleted, as the batches would still draw
+   it. */
+void unbatch(SceneData& data, UnsignedInt objectId);
+
+}}
+
+#endif
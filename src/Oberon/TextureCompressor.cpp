@@ -0,0 +1,338 @@
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include "TextureCompressor.h"
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <Magnum/PixelFormat.h>
+#include <Magnum/Math/Functions.h>
+
+namespace Oberon { namespace TextureCompressor {
+
+namespace {
+
+/* All levels are processed as RGBA8, with the unused channels ignored */
+struct Level {
+    Vector2i size;
+    Containers::Array<UnsignedByte> pixels;
+};
+
+Float srgbToLinear(UnsignedByte value) {
+    const Float v = value/255.0f;
+    return v <= 0.04045f ? v/12.92f : std::pow((v + 0.055f)/1.055f, 2.4f);
+}
+
+UnsignedByte linearToSrgb(Float value) {
+    const Float v = value <= 0.0031308f ? value*12.92f : 1.055f*std::pow(value, 1.0f/2.4f) - 0.055f;
+    return UnsignedByte(Math::clamp(v, 0.0f, 1.0f)*255.0f + 0.5f);
+}
+
+/* Box filter, the last row or column is repeated for odd sizes. Color
+   channels of sRGB images are averaged in linear space. */
+Level downsample(const Level& level, bool srgb, const Float* srgbTable) {
+    Level out;
+    out.size = Math::max(level.size/2, Vector2i{1});
+    out.pixels = Containers::Array<UnsignedByte>{Containers::NoInit, std::size_t(out.size.product())*4};
+    for(Int y = 0; y != out.size.y(); ++y) {
+        const Int y0 = Math::min(y*2, level.size.y() - 1);
+        const Int y1 = Math::min(y*2 + 1, level.size.y() - 1);
+        for(Int x = 0; x != out.size.x(); ++x) {
+            const Int x0 = Math::min(x*2, level.size.x() - 1);
+            const Int x1 = Math::min(x*2 + 1, level.size.x() - 1);
+            const UnsignedByte* const in[]{
+                level.pixels.data() + (y0*level.size.x() + x0)*4,
+                level.pixels.data() + (y0*level.size.x() + x1)*4,
+                level.pixels.data() + (y1*level.size.x() + x0)*4,
+                level.pixels.data() + (y1*level.size.x() + x1)*4
+            };
+            UnsignedByte* const o = out.pixels.data() + (y*out.size.x() + x)*4;
+            for(std::size_t c = 0; c != 4; ++c) {
+                if(srgb && c != 3) {
+                    o[c] = linearToSrgb((srgbTable[in[0][c]] + srgbTable[in[1][c]] +
+                        srgbTable[in[2][c]] + srgbTable[in[3][c]])*0.25f);
+                } else o[c] = UnsignedByte((in[0][c] + in[1][c] + in[2][c] + in[3][c] + 2)/4);
+            }
+        }
+    }
+
+    return out;
+}
+
+/* Gathers a 4x4 block, repeating the edge pixels for sizes not divisible
+   by four */
+void fetchBlock(const Level& level, Int blockX, Int blockY, UnsignedByte(&block)[16][4]) {
+    for(Int y = 0; y != 4; ++y) {
+        const Int py = Math::min(blockY*4 + y, level.size.y() - 1);
+        for(Int x = 0; x != 4; ++x) {
+            const Int px = Math::min(blockX*4 + x, level.size.x() - 1);
+            std::memcpy(block[y*4 + x], level.pixels.data() + (py*level.size.x() + px)*4, 4);
+        }
+    }
+}
+
+UnsignedShort packRgb565(const Float(&color)[3]) {
+    return UnsignedShort(
+        (UnsignedShort(Math::clamp(color[0], 0.0f, 255.0f)*31.0f/255.0f + 0.5f) << 11)|
+        (UnsignedShort(Math::clamp(color[1], 0.0f, 255.0f)*63.0f/255.0f + 0.5f) << 5)|
+         UnsignedShort(Math::clamp(color[2], 0.0f, 255.0f)*31.0f/255.0f + 0.5f));
+}
+
+void unpackRgb565(UnsignedShort packed, Float(&color)[3]) {
+    color[0] = Float((packed >> 11) & 0x1f)*255.0f/31.0f;
+    color[1] = Float((packed >> 5) & 0x3f)*255.0f/63.0f;
+    color[2] = Float(packed & 0x1f)*255.0f/31.0f;
+}
+
+/* Color endpoints are the extremes along the principal axis of the
+   block colors, moved slightly inwards to reduce the error of the
+   interpolated entries */
+void compressBc1Block(const UnsignedByte(&block)[16][4], char* out) {
+    Float mean[3]{};
+    for(std::size_t i = 0; i != 16; ++i)
+        for(std::size_t c = 0; c != 3; ++c) mean[c] += block[i][c]/16.0f;
+
+    Float covariance[6]{};
+    for(std::size_t i = 0; i != 16; ++i) {
+        const Float r = block[i][0] - mean[0];
+        const Float g = block[i][1] - mean[1];
+        const Float b = block[i][2] - mean[2];
+        covariance[0] += r*r;
+        covariance[1] += r*g;
+        covariance[2] += r*b;
+        covariance[3] += g*g;
+        covariance[4] += g*b;
+        covariance[5] += b*b;
+    }
+
+    /* Power iteration for the principal axis */
+    Float axis[3]{1.0f, 1.0f, 1.0f};
+    for(std::size_t iteration = 0; iteration != 8; ++iteration) {
+        const Float x = covariance[0]*axis[0] + covariance[1]*axis[1] + covariance[2]*axis[2];
+        const Float y = covariance[1]*axis[0] + covariance[3]*axis[1] + covariance[4]*axis[2];
+        const Float z = covariance[2]*axis[0] + covariance[4]*axis[1] + covariance[5]*axis[2];
+        const Float length = std::max(std::abs(x), std::max(std::abs(y), std::abs(z)));
+        if(length < 1.0e-6f) break;
+        axis[0] = x/length;
+        axis[1] = y/length;
+        axis[2] = z/length;
+    }
+
+    Float minProjection = 0.0f, maxProjection = 0.0f;
+    for(std::size_t i = 0; i != 16; ++i) {
+        const Float projection =
+            (block[i][0] - mean[0])*axis[0] +
+            (block[i][1] - mean[1])*axis[1] +
+            (block[i][2] - mean[2])*axis[2];
+        minProjection = Math::min(minProjection, projection);
+        maxProjection = Math::max(maxProjection, projection);
+    }
+
+    const Float inset = (maxProjection - minProjection)/32.0f;
+    Float endpoints[2][3];
+    for(std::size_t c = 0; c != 3; ++c) {
+        endpoints[0][c] = mean[c] + axis[c]*(maxProjection - inset);
+        endpoints[1][c] = mean[c] + axis[c]*(minProjection + inset);
+    }
+
+    UnsignedShort color0 = packRgb565(endpoints[0]);
+    UnsignedShort color1 = packRgb565(endpoints[1]);
+
+    /* The first color has to be larger for the four-color mode */
+    if(color0 < color1) std::swap(color0, color1);
+
+    UnsignedInt indices = 0;
+    if(color0 != color1) {
+        Float palette[4][3];
+        unpackRgb565(color0, palette[0]);
+        unpackRgb565(color1, palette[1]);
+        for(std::size_t c = 0; c != 3; ++c) {
+            palette[2][c] = (2.0f*palette[0][c] + palette[1][c])/3.0f;
+            palette[3][c] = (palette[0][c] + 2.0f*palette[1][c])/3.0f;
+        }
+
+        for(std::size_t i = 0; i != 16; ++i) {
+            UnsignedInt best = 0;
+            Float bestDistance = 1.0e30f;
+            for(UnsignedInt j = 0; j != 4; ++j) {
+                Float distance = 0.0f;
+                for(std::size_t c = 0; c != 3; ++c) {
+                    const Float d = block[i][c] - palette[j][c];
+                    distance += d*d;
+                }
+                if(distance < bestDistance) {
+                    bestDistance = distance;
+                    best = j;
+                }
+            }
+
+            indices |= best << (i*2);
+        }
+    }
+
+    const UnsignedByte data[8]{
+        UnsignedByte(color0 & 0xff), UnsignedByte(color0 >> 8),
+        UnsignedByte(color1 & 0xff), UnsignedByte(color1 >> 8),
+        UnsignedByte(indices & 0xff), UnsignedByte((indices >> 8) & 0xff),
+        UnsignedByte((indices >> 16) & 0xff), UnsignedByte(indices >> 24)
+    };
+    std::memcpy(out, data, 8);
+}
+
+/* Single channel in the eight-value mode with the extremes as endpoints */
+void compressBc4Block(const UnsignedByte(&block)[16][4], std::size_t channel, char* out) {
+    UnsignedByte min = 255, max = 0;
+    for(std::size_t i = 0; i != 16; ++i) {
+        min = Math::min(min, block[i][channel]);
+        max = Math::max(max, block[i][channel]);
+    }
+
+    UnsignedLong indices = 0;
+    if(min != max) {
+        Float palette[8];
+        palette[0] = max;
+        palette[1] = min;
+        for(UnsignedInt j = 1; j != 7; ++j)
+            palette[j + 1] = ((7 - j)*Float(max) + j*Float(min))/7.0f;
+
+        for(std::size_t i = 0; i != 16; ++i) {
+            UnsignedLong best = 0;
+            Float bestDistance = 1.0e30f;
+            for(UnsignedInt j = 0; j != 8; ++j) {
+                const Float distance = std::abs(block[i][channel] - palette[j]);
+                if(distance < bestDistance) {
+                    bestDistance = distance;
+                    best = j;
+                }
+            }
+
+            indices |= best << (i*3);
+        }
+    }
+
+    out[0] = char(max);
+    out[1] = char(min);
+    for(std::size_t i = 0; i != 6; ++i)
+        out[2 + i] = char((indices >> (i*8)) & 0xff);
+}
+
+}
+
+Containers::Optional<SceneCache::Image> compress(const SceneCache::Image& image, const Usage usage) {
+    if(image.compressed || image.levels.size() != 1) return {};
+
+    std::size_t channelCount;
+    bool srgb = false;
+    switch(image.format) {
+        case PixelFormat::R8Unorm: channelCount = 1; break;
+        case PixelFormat::RG8Unorm: channelCount = 2; break;
+        case PixelFormat::RGB8Srgb: srgb = true; /* fallthrough */
+        case PixelFormat::RGB8Unorm: channelCount = 3; break;
+        case PixelFormat::RGBA8Srgb: srgb = true; /* fallthrough */
+        case PixelFormat::RGBA8Unorm: channelCount = 4; break;
+        default: return {};
+    }
+
+    /* Expand the base level to RGBA8, taking the row padding into
+       account */
+    Containers::Array<Level> levels{std::size_t(Math::log2(image.size.max())) + 1};
+    levels[0].size = image.size;
+    levels[0].pixels = Containers::Array<UnsignedByte>{Containers::ValueInit, std::size_t(image.size.product())*4};
+    const std::size_t rowLength = image.size.x()*channelCount;
+    const std::size_t rowStride = (rowLength + image.alignment - 1)/image.alignment*image.alignment;
+    if(image.levels[0].size() < rowStride*(image.size.y() - 1) + rowLength) return {};
+    bool hasAlpha = false;
+    for(Int y = 0; y != image.size.y(); ++y) {
+        for(Int x = 0; x != image.size.x(); ++x) {
+            const char* const in = image.levels[0].data() + y*rowStride + x*channelCount;
+            UnsignedByte* const o = levels[0].pixels.data() + (y*image.size.x() + x)*4;
+            std::memcpy(o, in, channelCount);
+            if(channelCount == 4 && o[3] != 255) hasAlpha = true;
+        }
+    }
+
+    /* Generate the mips */
+    Float srgbTable[256];
+    if(srgb) for(UnsignedInt i = 0; i != 256; ++i)
+        srgbTable[i] = srgbToLinear(UnsignedByte(i));
+    for(std::size_t i = 1; i != levels.size(); ++i)
+        levels[i] = downsample(levels[i - 1], srgb, srgbTable);
+
+    SceneCache::Image out;
+    out.compressed = true;
+    out.size = image.size;
+    std::size_t blockSize;
+    if(channelCount == 1) {
+        out.compressedFormat = CompressedPixelFormat::Bc4RUnorm;
+        blockSize = 8;
+    } else if(channelCount == 2) {
+        out.compressedFormat = CompressedPixelFormat::Bc5RGUnorm;
+        blockSize = 16;
+    } else if(hasAlpha && usage != Usage::NormalMap) {
+        out.compressedFormat = srgb ? CompressedPixelFormat::Bc3RGBASrgb : CompressedPixelFormat::Bc3RGBAUnorm;
+        blockSize = 16;
+    } else {
+        out.compressedFormat = srgb ? CompressedPixelFormat::Bc1RGBSrgb : CompressedPixelFormat::Bc1RGBUnorm;
+        blockSize = 8;
+    }
+
+    /* Encode all levels into a single allocation */
+    std::size_t dataSize = 0;
+    for(const Level& level: levels)
+        dataSize += std::size_t((level.size.x() + 3)/4)*((level.size.y() + 3)/4)*blockSize;
+    out.data = Containers::Array<char>{Containers::NoInit, dataSize};
+    out.levels = Containers::Array<Containers::ArrayView<const char>>{levels.size()};
+
+    std::size_t offset = 0;
+    for(std::size_t i = 0; i != levels.size(); ++i) {
+        const Level& level = levels[i];
+        const Vector2i blockCount = (level.size + Vector2i{3})/4;
+        const std::size_t levelSize = std::size_t(blockCount.product())*blockSize;
+
+        UnsignedByte block[16][4];
+        char* o = out.data.data() + offset;
+        for(Int y = 0; y != blockCount.y(); ++y) {
+            for(Int x = 0; x != blockCount.x(); ++x, o += blockSize) {
+                fetchBlock(level, x, y, block);
+                if(out.compressedFormat == CompressedPixelFormat::Bc4RUnorm) {
+                    compressBc4Block(block, 0, o);
+                } else if(out.compressedFormat == CompressedPixelFormat::Bc5RGUnorm) {
+                    compressBc4Block(block, 0, o);
+                    compressBc4Block(block, 1, o + 8);
+                } else if(blockSize == 16) {
+                    compressBc4Block(block, 3, o);
+                    compressBc1Block(block, o + 8);
+                } else compressBc1Block(block, o);
+            }
+        }
+
+        out.levels[i] = out.data.slice(offset, offset + levelSize);
+        offset += levelSize;
+    }
+
+    return Containers::Optional<SceneCache::Image>{std::move(out)};
+}
+
+}}
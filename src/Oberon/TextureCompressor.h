@@ -0,0 +1,53 @@
+#ifndef Oberon_TextureCompressor_h
+#define Oberon_TextureCompressor_h
+/*
+    This file is part of Oberon.
+
+    Copyright (c) 2019-2020 Marco Melorio
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"), to deal
+    in the Software without restriction, including without limitation the rights
+    to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+    copies of the Software, and to permit persons to whom the Software is
+    furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included in all
+    copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+    AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+    OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+    SOFTWARE.
+*/
+
+#include <Corrade/Containers/Optional.h>
+
+#include "Oberon/Oberon.h"
+#include "Oberon/SceneCache.h"
+
+namespace Oberon { namespace TextureCompressor {
+
+enum class Usage: UnsignedByte {
+    Color,
+    NormalMap
+};
+
+/* Generates the full mip chain of an uncompressed 8-bit image and encodes
+   every level to a BC format picked by the channel usage:
+
+   - BC4 for single-channel images
+   - BC5 for two-channel images
+   - BC1 for images without alpha and for normal maps
+   - BC3 for images with alpha
+
+   Returns Containers::NullOpt if the image is already compressed or its
+   format is not supported. */
+Containers::Optional<SceneCache::Image> compress(const SceneCache::Image& image, Usage usage);
+
+}}
+
+#endif